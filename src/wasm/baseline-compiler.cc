@@ -0,0 +1,855 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "src/macro-assembler.h"
+#include "src/safepoint-table.h"
+
+#include "src/wasm/baseline-compiler.h"
+#include "src/wasm/wasm-module.h"
+#include "src/wasm/wasm-opcodes.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+#if DEBUG
+#define TRACE(...)                                     \
+  do {                                                 \
+    if (FLAG_trace_wasm_compiler) PrintF(__VA_ARGS__); \
+  } while (false)
+#else
+#define TRACE(...)
+#endif
+
+#if V8_TARGET_ARCH_X64
+
+bool UseBaselineCompiler() { return FLAG_wasm_baseline; }
+
+
+namespace {
+// The WASM calling convention; must match wasm-linkage.cc.
+const Register kGPParamRegisters[] = {rax, rdx, rcx, rbx, rsi, rdi};
+const XMMRegister kFPParamRegisters[] = {xmm1, xmm2, xmm3, xmm4, xmm5, xmm6};
+const XMMRegister kFPReturnRegister = xmm1;
+
+bool IsFloat(LocalType type) {
+  return type == kAstFloat32 || type == kAstFloat64;
+}
+
+
+// Operand accessors. The code has been verified by the decoder already.
+template <typename V>
+V ReadOperand(const byte* pc) {
+  V value;
+  memcpy(&value, pc + 1, sizeof(V));
+  return value;
+}
+
+
+uint32_t ReadLEB128Operand(const byte* pc) {
+  uint32_t result = 0;
+  int shift = 0;
+  for (const byte* ptr = pc + 1;; ptr++, shift += 7) {
+    result |= (*ptr & 0x7F) << shift;
+    if ((*ptr & 0x80) == 0) break;
+  }
+  return result;
+}
+
+
+MemType ReadMemAccessType(const byte* pc, LocalType type) {
+  if (type == kAstFloat32) return kMemFloat32;
+  if (type == kAstFloat64) return kMemFloat64;
+  byte operand = ReadOperand<uint8_t>(pc);
+  bool signext = MemoryAccess::SignExtendField::decode(operand);
+  switch (MemoryAccess::IntWidthField::decode(operand)) {
+    case MemoryAccess::kInt8:
+      return signext ? kMemInt8 : kMemUint8;
+    case MemoryAccess::kInt16:
+      return signext ? kMemInt16 : kMemUint16;
+    case MemoryAccess::kInt32:
+      return signext ? kMemInt32 : kMemUint32;
+    default:
+      return signext ? kMemInt64 : kMemUint64;
+  }
+}
+}  // namespace
+
+
+#define __ masm_.
+
+// Emits code for the trees of a function in a single recursive walk. Every
+// expression leaves its value in {rax} (integers) or {xmm0} (floats). Locals
+// and intermediate values live in stack slots below the fixed part of the
+// frame, none of which ever holds a tagged value.
+class BaselineCompiler {
+ public:
+  BaselineCompiler(Isolate* isolate, Zone* zone, FunctionEnv* env, int index,
+                   int32_t* counter, Handle<Code> tier_up)
+      : isolate_(isolate),
+        env_(env),
+        index_(index),
+        counter_(counter),
+        tier_up_(tier_up),
+        masm_(isolate, nullptr, 0),
+        safepoints_(zone),
+        blocks_(zone),
+        bailout_(nullptr),
+        temps_(0),
+        max_temps_(0) {}
+
+  Handle<Code> Compile(const ZoneVector<Tree*>& trees) {
+    FunctionSig* sig = env_->sig;
+    Label frame_setup, body;
+
+    // Build a STUB frame. The context slot holds a Smi so that the GC never
+    // mistakes a WASM value for a pointer.
+    __ pushq(rbp);
+    __ movp(rbp, rsp);
+    __ Push(Smi::FromInt(0));
+    __ Push(Smi::FromInt(StackFrame::STUB));
+    // The number of stack slots is only known once the body is emitted.
+    __ jmp(&frame_setup);
+    __ bind(&body);
+    SpillParameters();
+    ZeroLocals();
+    EmitTierUpCheck();
+
+    for (Tree* tree : trees) Emit(tree);
+    EmitReturn(sig->return_count() == 0 ? kAstStmt : sig->GetReturn());
+
+    int slots = static_cast<int>(env_->total_locals) + max_temps_;
+    __ bind(&frame_setup);
+    __ subp(rsp, Immediate(slots * kPointerSize));
+    __ jmp(&body);
+
+    if (bailout_ != nullptr) {
+      TRACE("Baseline compilation of WASM function #%d bailed out: %s\n",
+            index_, bailout_);
+      return Handle<Code>::null();
+    }
+
+    safepoints_.Emit(&masm_, slots);
+    CodeDesc desc;
+    masm_.GetCode(&desc);
+    Handle<Code> code = isolate_->factory()->NewCode(
+        desc, Code::ComputeFlags(Code::STUB), masm_.CodeObject(), false, true);
+    code->set_is_turbofanned(true);
+    code->set_stack_slots(slots);
+    code->set_safepoint_table_offset(safepoints_.GetCodeOffset());
+    return code;
+  }
+
+ private:
+  // An entry in the stack of enclosing blocks and loops.
+  struct Block {
+    Label* break_label;
+    Label* continue_label;  // {nullptr} for blocks.
+  };
+
+  Isolate* isolate_;
+  FunctionEnv* env_;
+  int index_;
+  int32_t* counter_;
+  Handle<Code> tier_up_;
+  MacroAssembler masm_;
+  SafepointTableBuilder safepoints_;
+  ZoneVector<Block> blocks_;
+  const char* bailout_;
+  int temps_;
+  int max_temps_;
+
+  void Bailout(const char* reason) {
+    if (bailout_ == nullptr) bailout_ = reason;
+  }
+
+  Operand Slot(int index) {
+    return Operand(rbp, -StandardFrameConstants::kFixedFrameSizeFromFp -
+                            (index + 1) * kPointerSize);
+  }
+
+  Operand LocalSlot(uint32_t index) { return Slot(static_cast<int>(index)); }
+
+  Operand TempSlot(int depth) {
+    return Slot(static_cast<int>(env_->total_locals) + depth);
+  }
+
+  void Load(LocalType type, const Operand& src) {
+    switch (type) {
+      case kAstInt32:
+        __ movl(rax, src);
+        break;
+      case kAstInt64:
+        __ movq(rax, src);
+        break;
+      case kAstFloat32:
+        __ movss(xmm0, src);
+        break;
+      case kAstFloat64:
+        __ movsd(xmm0, src);
+        break;
+      case kAstStmt:
+        break;
+    }
+  }
+
+  void Store(LocalType type, const Operand& dst) {
+    switch (type) {
+      case kAstInt32:
+        __ movl(dst, rax);
+        break;
+      case kAstInt64:
+        __ movq(dst, rax);
+        break;
+      case kAstFloat32:
+        __ movss(dst, xmm0);
+        break;
+      case kAstFloat64:
+        __ movsd(dst, xmm0);
+        break;
+      case kAstStmt:
+        break;
+    }
+  }
+
+  int PushTemp(LocalType type) {
+    int depth = temps_++;
+    if (temps_ > max_temps_) max_temps_ = temps_;
+    Store(type, TempSlot(depth));
+    return depth;
+  }
+
+  void RecordSafepoint() {
+    safepoints_.DefineSafepoint(&masm_, Safepoint::kSimple, 0,
+                                Safepoint::kNoLazyDeopt);
+  }
+
+  void SpillParameters() {
+    FunctionSig* sig = env_->sig;
+    size_t gp = 0;
+    size_t fp = 0;
+    for (size_t i = 0; i < sig->parameter_count(); i++) {
+      LocalType type = sig->GetParam(i);
+      Operand dst = LocalSlot(static_cast<uint32_t>(i));
+      if (IsFloat(type)) {
+        if (fp == arraysize(kFPParamRegisters)) return Bailout("stack params");
+        XMMRegister reg = kFPParamRegisters[fp++];
+        if (type == kAstFloat32) {
+          __ movss(dst, reg);
+        } else {
+          __ movsd(dst, reg);
+        }
+      } else {
+        if (gp == arraysize(kGPParamRegisters)) return Bailout("stack params");
+        __ movq(dst, kGPParamRegisters[gp++]);
+      }
+    }
+  }
+
+  void ZeroLocals() {
+    uint32_t first = static_cast<uint32_t>(env_->sig->parameter_count());
+    if (first == env_->total_locals) return;
+    __ xorl(rax, rax);
+    for (uint32_t i = first; i < env_->total_locals; i++) {
+      __ movq(LocalSlot(i), rax);
+    }
+  }
+
+  // Counts an invocation or loop iteration, calling the tier-up function
+  // when the function has become hot.
+  void EmitTierUpCheck() {
+    if (tier_up_.is_null()) return;
+    Label skip;
+    __ Move(kScratchRegister, counter_, RelocInfo::NONE64);
+    __ incl(Operand(kScratchRegister, 0));
+    __ cmpl(Operand(kScratchRegister, 0),
+            Immediate(FLAG_wasm_tier_up_threshold));
+    __ j(less, &skip);
+    __ Set(rax, index_);
+    __ call(tier_up_, RelocInfo::CODE_TARGET);
+    RecordSafepoint();
+    __ bind(&skip);
+  }
+
+  void EmitReturn(LocalType type) {
+    if (IsFloat(type)) __ movaps(kFPReturnRegister, xmm0);
+    __ movp(rsp, rbp);
+    __ popq(rbp);
+    __ ret(0);
+  }
+
+  void Emit(Tree* tree) {
+    if (bailout_ != nullptr) return;
+    WasmOpcode opcode = tree->opcode();
+    FunctionSig* sig = WasmOpcodes::Signature(opcode);
+    if (sig) {
+      // A simple expression with a fixed signature.
+      if (sig->parameter_count() == 2) return EmitBinop(tree);
+      return EmitUnop(tree);
+    }
+
+    switch (opcode) {
+      case kStmtNop:
+        break;
+      case kStmtIf: {
+        Label end;
+        Emit(tree->children[0]);
+        __ testl(rax, rax);
+        __ j(zero, &end);
+        Emit(tree->children[1]);
+        __ bind(&end);
+        break;
+      }
+      case kStmtIfThen:
+      case kExprTernary: {
+        Label if_false, end;
+        Emit(tree->children[0]);
+        __ testl(rax, rax);
+        __ j(zero, &if_false);
+        Emit(tree->children[1]);
+        __ jmp(&end);
+        __ bind(&if_false);
+        Emit(tree->children[2]);
+        __ bind(&end);
+        break;
+      }
+      case kStmtBlock: {
+        Label end;
+        blocks_.push_back({&end, nullptr});
+        for (int i = 0; i < tree->count; i++) Emit(tree->children[i]);
+        blocks_.pop_back();
+        __ bind(&end);
+        break;
+      }
+      case kStmtLoop: {
+        Label header, end;
+        __ bind(&header);
+        EmitTierUpCheck();
+        blocks_.push_back({&end, &header});
+        for (int i = 0; i < tree->count; i++) Emit(tree->children[i]);
+        blocks_.pop_back();
+        __ jmp(&header);
+        __ bind(&end);
+        break;
+      }
+      case kStmtContinue: {
+        size_t depth = ReadOperand<uint8_t>(tree->pc);
+        __ jmp(blocks_[blocks_.size() - depth - 1].continue_label);
+        break;
+      }
+      case kStmtBreak: {
+        size_t depth = ReadOperand<uint8_t>(tree->pc);
+        __ jmp(blocks_[blocks_.size() - depth - 1].break_label);
+        break;
+      }
+      case kStmtReturn: {
+        LocalType type = kAstStmt;
+        if (tree->count > 0) {
+          Emit(tree->children[0]);
+          type = tree->children[0]->type;
+        }
+        EmitReturn(type);
+        break;
+      }
+      case kExprInt8Const:
+        __ Set(rax, ReadOperand<int8_t>(tree->pc));
+        break;
+      case kExprInt32Const:
+        __ Set(rax, ReadOperand<int32_t>(tree->pc));
+        break;
+      case kExprInt64Const:
+        __ Set(rax, ReadOperand<int64_t>(tree->pc));
+        break;
+      case kExprFloat32Const:
+        __ Move(xmm0, ReadOperand<uint32_t>(tree->pc));
+        break;
+      case kExprFloat64Const:
+        __ Move(xmm0, ReadOperand<uint64_t>(tree->pc));
+        break;
+      case kExprGetLocal:
+        Load(tree->type, LocalSlot(ReadLEB128Operand(tree->pc)));
+        break;
+      case kExprSetLocal:
+        Emit(tree->children[0]);
+        Store(tree->type, LocalSlot(ReadLEB128Operand(tree->pc)));
+        break;
+      case kExprLoadGlobal: {
+        uint32_t index = ReadLEB128Operand(tree->pc);
+        LoadGlobalAddress(index);
+        LoadMemValue(env_->module->GetGlobalType(index), tree->type,
+                     Operand(kScratchRegister, 0));
+        break;
+      }
+      case kExprStoreGlobal: {
+        uint32_t index = ReadLEB128Operand(tree->pc);
+        Emit(tree->children[0]);
+        LoadGlobalAddress(index);
+        StoreMemValue(env_->module->GetGlobalType(index),
+                      Operand(kScratchRegister, 0));
+        break;
+      }
+      case kExprInt32LoadMemL:
+      case kExprInt64LoadMemL:
+      case kExprFloat32LoadMemL:
+      case kExprFloat64LoadMemL:
+        EmitLoadMem(tree);
+        break;
+      case kExprInt32StoreMemL:
+      case kExprInt64StoreMemL:
+      case kExprFloat32StoreMemL:
+      case kExprFloat64StoreMemL:
+        EmitStoreMem(tree);
+        break;
+      case kExprCallFunction:
+        EmitCallFunction(tree);
+        break;
+      case kExprComma:
+        Emit(tree->children[0]);
+        Emit(tree->children[1]);
+        break;
+      default:
+        Bailout(WasmOpcodes::OpcodeName(opcode));
+        break;
+    }
+  }
+
+  void EmitBinop(Tree* tree) {
+    LocalType left = tree->children[0]->type;
+    LocalType right = tree->children[1]->type;
+    Emit(tree->children[0]);
+    int temp = PushTemp(left);
+    Emit(tree->children[1]);
+    if (IsFloat(right)) {
+      __ movaps(xmm1, xmm0);
+    } else {
+      __ movq(rcx, rax);
+    }
+    Load(left, TempSlot(temp));
+    temps_--;
+
+    switch (tree->opcode()) {
+      case kExprInt32Add:
+        __ addl(rax, rcx);
+        break;
+      case kExprInt32Sub:
+        __ subl(rax, rcx);
+        break;
+      case kExprInt32Mul:
+        __ imull(rax, rcx);
+        break;
+      case kExprInt32And:
+        __ andl(rax, rcx);
+        break;
+      case kExprInt32Ior:
+        __ orl(rax, rcx);
+        break;
+      case kExprInt32Xor:
+        __ xorl(rax, rcx);
+        break;
+      case kExprInt32Shl:
+        __ shll_cl(rax);
+        break;
+      case kExprInt32Shr:
+        __ shrl_cl(rax);
+        break;
+      case kExprInt32Sar:
+        __ sarl_cl(rax);
+        break;
+      case kExprInt32Eq:
+        return EmitCompare32(equal);
+      case kExprInt32Ne:
+        return EmitCompare32(not_equal);
+      case kExprInt32Slt:
+        return EmitCompare32(less);
+      case kExprInt32Sle:
+        return EmitCompare32(less_equal);
+      case kExprInt32Ult:
+        return EmitCompare32(below);
+      case kExprInt32Ule:
+        return EmitCompare32(below_equal);
+      case kExprInt32Sgt:
+        return EmitCompare32(greater);
+      case kExprInt32Sge:
+        return EmitCompare32(greater_equal);
+      case kExprInt32Ugt:
+        return EmitCompare32(above);
+      case kExprInt32Uge:
+        return EmitCompare32(above_equal);
+      case kExprInt64Add:
+        __ addq(rax, rcx);
+        break;
+      case kExprInt64Sub:
+        __ subq(rax, rcx);
+        break;
+      case kExprInt64Mul:
+        __ imulq(rax, rcx);
+        break;
+      case kExprInt64And:
+        __ andq(rax, rcx);
+        break;
+      case kExprInt64Ior:
+        __ orq(rax, rcx);
+        break;
+      case kExprInt64Xor:
+        __ xorq(rax, rcx);
+        break;
+      case kExprInt64Shl:
+        __ shlq_cl(rax);
+        break;
+      case kExprInt64Shr:
+        __ shrq_cl(rax);
+        break;
+      case kExprInt64Sar:
+        __ sarq_cl(rax);
+        break;
+      case kExprInt64Eq:
+        return EmitCompare64(equal);
+      case kExprInt64Ne:
+        return EmitCompare64(not_equal);
+      case kExprInt64Slt:
+        return EmitCompare64(less);
+      case kExprInt64Sle:
+        return EmitCompare64(less_equal);
+      case kExprInt64Ult:
+        return EmitCompare64(below);
+      case kExprInt64Ule:
+        return EmitCompare64(below_equal);
+      case kExprInt64Sgt:
+        return EmitCompare64(greater);
+      case kExprInt64Sge:
+        return EmitCompare64(greater_equal);
+      case kExprInt64Ugt:
+        return EmitCompare64(above);
+      case kExprInt64Uge:
+        return EmitCompare64(above_equal);
+      case kExprFloat32Add:
+        __ addss(xmm0, xmm1);
+        break;
+      case kExprFloat32Sub:
+        __ subss(xmm0, xmm1);
+        break;
+      case kExprFloat32Mul:
+        __ mulss(xmm0, xmm1);
+        break;
+      case kExprFloat32Div:
+        __ divss(xmm0, xmm1);
+        break;
+      case kExprFloat64Add:
+        __ addsd(xmm0, xmm1);
+        break;
+      case kExprFloat64Sub:
+        __ subsd(xmm0, xmm1);
+        break;
+      case kExprFloat64Mul:
+        __ mulsd(xmm0, xmm1);
+        break;
+      case kExprFloat64Div:
+        __ divsd(xmm0, xmm1);
+        break;
+      case kExprFloat32Eq:
+      case kExprFloat64Eq:
+        // Unordered operands compare unequal.
+        EmitFloatCompare(right, xmm0, xmm1);
+        __ setcc(equal, rax);
+        __ setcc(no_parity, rcx);
+        __ andl(rax, rcx);
+        __ movzxbl(rax, rax);
+        break;
+      case kExprFloat32Ne:
+      case kExprFloat64Ne:
+        EmitFloatCompare(right, xmm0, xmm1);
+        __ setcc(not_equal, rax);
+        __ setcc(parity_even, rcx);
+        __ orl(rax, rcx);
+        __ movzxbl(rax, rax);
+        break;
+      // For the ordered comparisons, {above} and {above_equal} are false
+      // for unordered operands.
+      case kExprFloat32Lt:
+      case kExprFloat64Lt:
+        EmitFloatCompare(right, xmm1, xmm0);
+        return EmitSetcc(above);
+      case kExprFloat32Le:
+      case kExprFloat64Le:
+        EmitFloatCompare(right, xmm1, xmm0);
+        return EmitSetcc(above_equal);
+      case kExprFloat32Gt:
+      case kExprFloat64Gt:
+        EmitFloatCompare(right, xmm0, xmm1);
+        return EmitSetcc(above);
+      case kExprFloat32Ge:
+      case kExprFloat64Ge:
+        EmitFloatCompare(right, xmm0, xmm1);
+        return EmitSetcc(above_equal);
+      default:
+        Bailout(WasmOpcodes::OpcodeName(tree->opcode()));
+        break;
+    }
+  }
+
+  void EmitUnop(Tree* tree) {
+    Emit(tree->children[0]);
+    switch (tree->opcode()) {
+      case kExprBoolNot:
+        __ testl(rax, rax);
+        return EmitSetcc(zero);
+      case kExprInt32ConvertInt64:
+      case kExprInt64UConvertInt32:
+        __ movl(rax, rax);
+        break;
+      case kExprInt64SConvertInt32:
+        __ movsxlq(rax, rax);
+        break;
+      case kExprFloat32ConvertFloat64:
+        __ cvtsd2ss(xmm0, xmm0);
+        break;
+      case kExprFloat64ConvertFloat32:
+        __ cvtss2sd(xmm0, xmm0);
+        break;
+      case kExprFloat32SConvertInt32:
+        __ cvtlsi2ss(xmm0, rax);
+        break;
+      case kExprFloat64SConvertInt32:
+        __ cvtlsi2sd(xmm0, rax);
+        break;
+      default:
+        Bailout(WasmOpcodes::OpcodeName(tree->opcode()));
+        break;
+    }
+  }
+
+  void EmitSetcc(Condition cond) {
+    __ setcc(cond, rax);
+    __ movzxbl(rax, rax);
+  }
+
+  void EmitCompare32(Condition cond) {
+    __ cmpl(rax, rcx);
+    EmitSetcc(cond);
+  }
+
+  void EmitCompare64(Condition cond) {
+    __ cmpq(rax, rcx);
+    EmitSetcc(cond);
+  }
+
+  void EmitFloatCompare(LocalType type, XMMRegister left, XMMRegister right) {
+    if (type == kAstFloat32) {
+      __ ucomiss(left, right);
+    } else {
+      __ ucomisd(left, right);
+    }
+  }
+
+  void LoadGlobalAddress(uint32_t index) {
+    uintptr_t address = env_->module->globals_area +
+                        env_->module->module->globals->at(index).offset;
+    __ Move(kScratchRegister, reinterpret_cast<void*>(address),
+            RelocInfo::NONE64);
+  }
+
+  // Compares the zero-extended index in {reg} against the memory size,
+  // jumping to {out_of_bounds} if an access of {type} would not fit.
+  void EmitBoundsCheck(Register reg, MemType type, Label* out_of_bounds) {
+    uintptr_t size = env_->module->mem_end - env_->module->mem_start;
+    uintptr_t access_size = WasmOpcodes::MemSize(type);
+    if (size < access_size) {
+      __ jmp(out_of_bounds);
+      return;
+    }
+    // The limit does not fit into an immediate for memories of 2 GB or more.
+    int64_t limit = static_cast<int64_t>(size - access_size);
+    if (is_int32(limit)) {
+      __ cmpq(reg, Immediate(static_cast<int32_t>(limit)));
+    } else {
+      __ Set(kScratchRegister, limit);
+      __ cmpq(reg, kScratchRegister);
+    }
+    __ j(above, out_of_bounds);
+    __ Move(kScratchRegister, reinterpret_cast<void*>(env_->module->mem_start),
+            RelocInfo::NONE64);
+  }
+
+  // Out-of-bounds loads produce zero (NaN for floats), like CheckedLoad.
+  void EmitLoadMem(Tree* tree) {
+    MemType type = ReadMemAccessType(tree->pc, tree->type);
+    Label out_of_bounds, done;
+    Emit(tree->children[0]);
+    __ movl(rax, rax);
+    EmitBoundsCheck(rax, type, &out_of_bounds);
+    LoadMemValue(type, tree->type, Operand(kScratchRegister, rax, times_1, 0));
+    __ jmp(&done);
+    __ bind(&out_of_bounds);
+    if (IsFloat(tree->type)) {
+      __ pcmpeqd(xmm0, xmm0);  // All ones is a NaN in either precision.
+    } else {
+      __ xorl(rax, rax);
+    }
+    __ bind(&done);
+  }
+
+  // Out-of-bounds stores are ignored, like CheckedStore.
+  void EmitStoreMem(Tree* tree) {
+    LocalType value_type = tree->children[1]->type;
+    MemType type = ReadMemAccessType(tree->pc, value_type);
+    Label out_of_bounds;
+    Emit(tree->children[0]);
+    int temp = PushTemp(kAstInt32);
+    Emit(tree->children[1]);
+    __ movl(rcx, TempSlot(temp));
+    temps_--;
+    EmitBoundsCheck(rcx, type, &out_of_bounds);
+    StoreMemValue(type, Operand(kScratchRegister, rcx, times_1, 0));
+    __ bind(&out_of_bounds);
+  }
+
+  void LoadMemValue(MemType type, LocalType result, const Operand& src) {
+    bool is64 = result == kAstInt64;
+    switch (type) {
+      case kMemInt8:
+        if (is64) {
+          __ movsxbq(rax, src);
+        } else {
+          __ movsxbl(rax, src);
+        }
+        break;
+      case kMemUint8:
+        __ movzxbl(rax, src);
+        break;
+      case kMemInt16:
+        if (is64) {
+          __ movsxwq(rax, src);
+        } else {
+          __ movsxwl(rax, src);
+        }
+        break;
+      case kMemUint16:
+        __ movzxwl(rax, src);
+        break;
+      case kMemInt32:
+        if (is64) {
+          __ movsxlq(rax, src);
+        } else {
+          __ movl(rax, src);
+        }
+        break;
+      case kMemUint32:
+        __ movl(rax, src);
+        break;
+      case kMemInt64:
+      case kMemUint64:
+        __ movq(rax, src);
+        break;
+      case kMemFloat32:
+        __ movss(xmm0, src);
+        break;
+      case kMemFloat64:
+        __ movsd(xmm0, src);
+        break;
+    }
+  }
+
+  void StoreMemValue(MemType type, const Operand& dst) {
+    switch (type) {
+      case kMemInt8:
+      case kMemUint8:
+        __ movb(dst, rax);
+        break;
+      case kMemInt16:
+      case kMemUint16:
+        __ movw(dst, rax);
+        break;
+      case kMemInt32:
+      case kMemUint32:
+        __ movl(dst, rax);
+        break;
+      case kMemInt64:
+      case kMemUint64:
+        __ movq(dst, rax);
+        break;
+      case kMemFloat32:
+        __ movss(dst, xmm0);
+        break;
+      case kMemFloat64:
+        __ movsd(dst, xmm0);
+        break;
+    }
+  }
+
+  void EmitCallFunction(Tree* tree) {
+    uint32_t index = ReadLEB128Operand(tree->pc);
+    FunctionSig* sig = env_->module->GetFunctionSignature(index);
+
+    // Evaluate all arguments into temporary slots first.
+    int first = temps_;
+    for (int i = 0; i < tree->count; i++) {
+      Emit(tree->children[i]);
+      PushTemp(tree->children[i]->type);
+    }
+    temps_ = first;
+
+    size_t gp = 0;
+    size_t fp = 0;
+    for (size_t i = 0; i < sig->parameter_count(); i++) {
+      LocalType type = sig->GetParam(i);
+      Operand src = TempSlot(first + static_cast<int>(i));
+      if (IsFloat(type)) {
+        if (fp == arraysize(kFPParamRegisters)) return Bailout("stack params");
+        XMMRegister reg = kFPParamRegisters[fp++];
+        if (type == kAstFloat32) {
+          __ movss(reg, src);
+        } else {
+          __ movsd(reg, src);
+        }
+      } else {
+        if (gp == arraysize(kGPParamRegisters)) return Bailout("stack params");
+        __ movq(kGPParamRegisters[gp++], src);
+      }
+    }
+
+    __ call(env_->module->GetFunctionCode(index), RelocInfo::CODE_TARGET);
+    RecordSafepoint();
+    if (sig->return_count() > 0 && IsFloat(sig->GetReturn())) {
+      __ movaps(xmm0, kFPReturnRegister);
+    }
+  }
+};
+
+#undef __
+
+
+Handle<Code> CompileWasmBaseline(Isolate* isolate, FunctionEnv* env,
+                                 const byte* base, const byte* start,
+                                 const byte* end, int index, int32_t* counter,
+                                 Handle<Code> tier_up) {
+  if (env->module == nullptr) return Handle<Code>::null();
+  // Only instances compile with the baseline compiler, and their code
+  // neither receives the start of memory nor calls shared import wrappers.
+  CHECK(env->module->mem_buffer.is_null());
+  CHECK(env->module->import_table.is_null());
+  Zone zone;
+  ZoneVector<Tree*> trees(&zone);
+  TreeResult result = DecodeWasmTrees(&zone, env, base, start, end, &trees);
+  if (result.failed()) return Handle<Code>::null();
+  BaselineCompiler compiler(isolate, &zone, env, index, counter, tier_up);
+  return compiler.Compile(trees);
+}
+
+#else
+
+// TODO(titzer): port the baseline compiler to the other architectures.
+bool UseBaselineCompiler() { return false; }
+
+
+Handle<Code> CompileWasmBaseline(Isolate* isolate, FunctionEnv* env,
+                                 const byte* base, const byte* start,
+                                 const byte* end, int index, int32_t* counter,
+                                 Handle<Code> tier_up) {
+  return Handle<Code>::null();
+}
+
+#endif  // V8_TARGET_ARCH_X64
+}
+}
+}
@@ -0,0 +1,40 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef V8_WASM_BASELINE_COMPILER_H_
+#define V8_WASM_BASELINE_COMPILER_H_
+
+#include "src/handles.h"
+
+#include "src/wasm/decoder.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+// Returns true if functions are first compiled with the baseline compiler.
+// Requires {FLAG_wasm_baseline}, and is only supported on x64; elsewhere all
+// functions are compiled with TurboFan.
+bool UseBaselineCompiler();
+
+// Compiles a function with the baseline compiler, which emits machine code
+// in a single walk over the decoded trees, without building a TurboFan graph.
+// The code is slower than TurboFan code, but available almost immediately.
+// If {tier_up} is not null, the code counts its invocations and loop
+// iterations in {*counter} and calls {tier_up} with {index} as its only
+// argument once the count reaches {FLAG_wasm_tier_up_threshold}.
+// Returns a null handle if the function uses an opcode that the baseline
+// compiler does not support; the caller then falls back to TurboFan.
+// Baseline code embeds the addresses of the memory and globals of an
+// instance, so {env} must not share code between instances, i.e. it must
+// have neither a memory buffer nor an import table.
+Handle<Code> CompileWasmBaseline(Isolate* isolate, FunctionEnv* env,
+                                 const byte* base, const byte* start,
+                                 const byte* end, int index, int32_t* counter,
+                                 Handle<Code> tier_up);
+}
+}
+}
+
+#endif  // V8_WASM_BASELINE_COMPILER_H_
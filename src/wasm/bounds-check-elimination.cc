@@ -0,0 +1,365 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+
+#include "src/compiler/all-nodes.h"
+#include "src/compiler/js-graph.h"
+#include "src/compiler/machine-operator.h"
+#include "src/compiler/node-matchers.h"
+#include "src/compiler/node-properties.h"
+
+#include "src/wasm/bounds-check-elimination.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+using compiler::IrOpcode;
+using compiler::Node;
+using compiler::NodeProperties;
+
+namespace {
+// Limits the number of nodes and control nodes visited per memory access.
+const int kMaxSteps = 256;
+// Limits the depth of the expressions considered for a memory index.
+const int kMaxDepth = 8;
+
+const uint32_t kMaxNonNegative = static_cast<uint32_t>(kMaxInt);
+
+
+// Computes upper bounds of 32-bit values, interpreted as unsigned, that
+// hold at a given control node.
+class RangeAnalysis {
+ public:
+  explicit RangeAnalysis(Zone* zone)
+      : zone_(zone), assumptions_(zone), steps_(0) {}
+
+  // Returns true and sets {bound} if {node} is at most {bound} wherever
+  // {control} is reached.
+  bool Bound(Node* node, Node* control, uint32_t* bound) {
+    steps_ = kMaxSteps;
+    return UpperBound(node, control, 0, bound);
+  }
+
+ private:
+  // A phi that is assumed to be non-negative while its inputs are bounded.
+  struct Assumption {
+    Node* phi;
+    bool used;
+  };
+
+  Zone* zone_;
+  ZoneVector<Assumption> assumptions_;
+  int steps_;
+
+  bool UpperBound(Node* node, Node* control, int depth, uint32_t* bound) {
+    if (depth > kMaxDepth || --steps_ < 0) return false;
+    bool found = ValueBound(node, control, depth, bound);
+    // Refine the bound with the conditions of dominating branches.
+    for (Node* c = control; c != nullptr; c = Dominator(c)) {
+      if (c->opcode() != IrOpcode::kIfTrue &&
+          c->opcode() != IrOpcode::kIfFalse) {
+        continue;
+      }
+      Node* branch = NodeProperties::GetControlInput(c);
+      if (branch->opcode() != IrOpcode::kBranch) continue;
+      Refine(node, branch->InputAt(0), c->opcode() == IrOpcode::kIfTrue,
+             control, depth, &found, bound);
+    }
+    return found;
+  }
+
+  // Computes a bound of {node} from its operation and inputs.
+  bool ValueBound(Node* node, Node* control, int depth, uint32_t* bound) {
+    switch (node->opcode()) {
+      case IrOpcode::kInt32Constant:
+        *bound = static_cast<uint32_t>(compiler::OpParameter<int32_t>(node));
+        return true;
+      case IrOpcode::kWord32Equal:
+      case IrOpcode::kInt32LessThan:
+      case IrOpcode::kInt32LessThanOrEqual:
+      case IrOpcode::kUint32LessThan:
+      case IrOpcode::kUint32LessThanOrEqual:
+        *bound = 1;
+        return true;
+      case IrOpcode::kWord32And: {
+        uint32_t left, right;
+        bool has_left = UpperBound(node->InputAt(0), control, depth + 1, &left);
+        bool has_right =
+            UpperBound(node->InputAt(1), control, depth + 1, &right);
+        if (has_left && has_right) {
+          *bound = std::min(left, right);
+        } else if (has_left || has_right) {
+          *bound = has_left ? left : right;
+        }
+        return has_left || has_right;
+      }
+      case IrOpcode::kWord32Shr: {
+        compiler::Uint32BinopMatcher m(node);
+        if (!m.right().HasValue()) return false;
+        uint32_t left;
+        if (!UpperBound(m.left().node(), control, depth + 1, &left)) {
+          left = kMaxUInt32;
+        }
+        *bound = left >> (m.right().Value() & 0x1f);
+        return true;
+      }
+      case IrOpcode::kWord32Shl: {
+        compiler::Uint32BinopMatcher m(node);
+        uint32_t left;
+        if (!m.right().HasValue() ||
+            !UpperBound(m.left().node(), control, depth + 1, &left)) {
+          return false;
+        }
+        return Fits(static_cast<uint64_t>(left) << (m.right().Value() & 0x1f),
+                    bound);
+      }
+      case IrOpcode::kInt32Mul: {
+        compiler::Uint32BinopMatcher m(node);
+        uint32_t left;
+        if (!m.right().HasValue() ||
+            !UpperBound(m.left().node(), control, depth + 1, &left)) {
+          return false;
+        }
+        return Fits(static_cast<uint64_t>(left) * m.right().Value(), bound);
+      }
+      case IrOpcode::kInt32Add: {
+        // The sum does not wrap around if the sum of the bounds does not.
+        uint32_t left, right;
+        if (!UpperBound(node->InputAt(0), control, depth + 1, &left) ||
+            !UpperBound(node->InputAt(1), control, depth + 1, &right)) {
+          return false;
+        }
+        return Fits(static_cast<uint64_t>(left) + right, bound);
+      }
+      case IrOpcode::kUint32Div:
+        return UpperBound(node->InputAt(0), control, depth + 1, bound);
+      case IrOpcode::kUint32Mod: {
+        uint32_t left, right;
+        bool has_left = UpperBound(node->InputAt(0), control, depth + 1, &left);
+        bool has_right =
+            UpperBound(node->InputAt(1), control, depth + 1, &right) &&
+            right > 0;
+        if (has_left && has_right) {
+          *bound = std::min(left, right - 1);
+        } else if (has_left || has_right) {
+          *bound = has_left ? left : right - 1;
+        }
+        return has_left || has_right;
+      }
+      case IrOpcode::kLoad:
+        return TypeBound(compiler::LoadRepresentationOf(node->op()), bound);
+      case IrOpcode::kCheckedLoad:
+        return TypeBound(compiler::CheckedLoadRepresentationOf(node->op()),
+                         bound);
+      case IrOpcode::kPhi:
+        return PhiBound(node, depth, bound);
+      default:
+        return false;
+    }
+  }
+
+  // Computes a bound of {phi} as the maximum of the bounds of its inputs,
+  // each under the control input of the merge it flows in from. A phi that
+  // depends on itself, e.g. a loop induction variable, is bounded by
+  // induction: if its inputs are non-negative whenever the phi is, then the
+  // phi is non-negative in all iterations, and their bounds hold.
+  bool PhiBound(Node* phi, int depth, uint32_t* bound) {
+    for (Assumption& assumption : assumptions_) {
+      if (assumption.phi == phi) {
+        assumption.used = true;
+        *bound = kMaxNonNegative;
+        return true;
+      }
+    }
+    Node* merge = NodeProperties::GetControlInput(phi);
+    int count = phi->op()->ValueInputCount();
+    uint32_t result = 0;
+    bool found = true;
+    assumptions_.push_back({phi, false});
+    for (int i = 0; i < count; i++) {
+      uint32_t input;
+      if (!UpperBound(phi->InputAt(i), merge->InputAt(i), depth + 1, &input)) {
+        found = false;
+        break;
+      }
+      result = std::max(result, input);
+    }
+    bool used = assumptions_.back().used;
+    assumptions_.pop_back();
+    if (!found || (used && result > kMaxNonNegative)) return false;
+    *bound = result;
+    return true;
+  }
+
+  // Refines the bound of {node} with the comparison {cond}, which is known
+  // to be true if {holds}, or false otherwise.
+  void Refine(Node* node, Node* cond, bool holds, Node* control, int depth,
+              bool* found, uint32_t* bound) {
+    // Look through inverted conditions.
+    while (cond->opcode() == IrOpcode::kWord32Equal) {
+      compiler::Int32BinopMatcher m(cond);
+      if (!m.right().Is(0)) return;
+      cond = m.left().node();
+      holds = !holds;
+    }
+    bool is_signed;
+    bool strict;
+    switch (cond->opcode()) {
+      case IrOpcode::kInt32LessThan:
+        is_signed = true;
+        strict = true;
+        break;
+      case IrOpcode::kInt32LessThanOrEqual:
+        is_signed = true;
+        strict = false;
+        break;
+      case IrOpcode::kUint32LessThan:
+        is_signed = false;
+        strict = true;
+        break;
+      case IrOpcode::kUint32LessThanOrEqual:
+        is_signed = false;
+        strict = false;
+        break;
+      default:
+        return;
+    }
+    Node* limit;
+    if (holds && cond->InputAt(0) == node) {
+      limit = cond->InputAt(1);  // node < limit, or node <= limit.
+    } else if (!holds && cond->InputAt(1) == node) {
+      limit = cond->InputAt(0);  // node <= limit, or node < limit.
+      strict = !strict;
+    } else {
+      return;
+    }
+    // A signed comparison only bounds a node that is non-negative, in which
+    // case the limit is non-negative as well.
+    if (is_signed && !(*found && *bound <= kMaxNonNegative)) return;
+    uint32_t limit_bound;
+    if (!UpperBound(limit, control, depth + 1, &limit_bound)) return;
+    if (strict && limit_bound > 0) limit_bound--;
+    if (!*found || limit_bound < *bound) {
+      *bound = limit_bound;
+      *found = true;
+    }
+  }
+
+  // Returns the immediate dominator of {control}, or nullptr if it is the
+  // start or not known.
+  Node* Dominator(Node* control) {
+    if (--steps_ < 0) return nullptr;
+    switch (control->opcode()) {
+      case IrOpcode::kBranch:
+      case IrOpcode::kIfTrue:
+      case IrOpcode::kIfFalse:
+      case IrOpcode::kLoop:  // the entry of a loop dominates its body.
+        return NodeProperties::GetControlInput(control);
+      case IrOpcode::kMerge:
+        return MergeDominator(control);
+      default:
+        return nullptr;
+    }
+  }
+
+  // Returns the closest common dominator of the inputs of {merge}.
+  Node* MergeDominator(Node* merge) {
+    ZoneVector<Node*> chain(zone_);
+    for (Node* c = merge->InputAt(0); c != nullptr; c = Dominator(c)) {
+      chain.push_back(c);
+    }
+    size_t result = 0;
+    for (int i = 1; i < merge->InputCount(); i++) {
+      for (Node* c = merge->InputAt(i);; c = Dominator(c)) {
+        if (c == nullptr) return nullptr;
+        auto it = std::find(chain.begin(), chain.end(), c);
+        if (it != chain.end()) {
+          result = std::max(result, static_cast<size_t>(it - chain.begin()));
+          break;
+        }
+      }
+    }
+    return chain.empty() ? nullptr : chain[result];
+  }
+
+  static bool TypeBound(compiler::MachineType type, uint32_t* bound) {
+    if (type == compiler::kMachUint8) {
+      *bound = 0xff;
+      return true;
+    }
+    if (type == compiler::kMachUint16) {
+      *bound = 0xffff;
+      return true;
+    }
+    return false;
+  }
+
+  static bool Fits(uint64_t value, uint32_t* bound) {
+    if (value > kMaxUInt32) return false;
+    *bound = static_cast<uint32_t>(value);
+    return true;
+  }
+};
+
+
+// Returns the bound that the index of the access {node} is checked against,
+// which already accounts for the size of the access, or 0 if it is not a
+// constant.
+uint64_t CheckedLength(Node* node) {
+  Node* length = node->InputAt(2);
+  switch (length->opcode()) {
+    case IrOpcode::kInt32Constant:
+      return static_cast<uint32_t>(compiler::OpParameter<int32_t>(length));
+    case IrOpcode::kInt64Constant:
+      return static_cast<uint64_t>(compiler::OpParameter<int64_t>(length));
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+
+BoundsCheckStatistics EliminateBoundsChecks(TFGraph* jsgraph) {
+  BoundsCheckStatistics stats = {0, 0};
+  compiler::Graph* graph = jsgraph->graph();
+  compiler::MachineOperatorBuilder* machine = jsgraph->machine();
+  Zone zone;
+  compiler::AllNodes all(&zone, graph);
+  RangeAnalysis analysis(&zone);
+
+  for (Node* node : all.live) {
+    bool is_load = node->opcode() == IrOpcode::kCheckedLoad;
+    if (!is_load && node->opcode() != IrOpcode::kCheckedStore) continue;
+    compiler::MachineType type =
+        is_load ? compiler::CheckedLoadRepresentationOf(node->op())
+                : compiler::CheckedStoreRepresentationOf(node->op());
+    Node* index = node->InputAt(1);
+    uint32_t bound;
+    if (!analysis.Bound(index, NodeProperties::GetControlInput(node),
+                        &bound) ||
+        bound >= CheckedLength(node)) {
+      stats.remaining++;
+      continue;
+    }
+    // Lower to a plain access with a zero-extended index.
+    if (machine->Is64()) {
+      node->ReplaceInput(
+          1, graph->NewNode(machine->ChangeUint32ToUint64(), index));
+    }
+    node->RemoveInput(2);  // the length.
+    if (is_load) {
+      node->set_op(machine->Load(type));
+    } else {
+      node->set_op(machine->Store(
+          compiler::StoreRepresentation(type, compiler::kNoWriteBarrier)));
+    }
+    stats.eliminated++;
+  }
+  return stats;
+}
+}
+}
+}
@@ -0,0 +1,30 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef V8_WASM_BOUNDS_CHECK_ELIMINATION_H_
+#define V8_WASM_BOUNDS_CHECK_ELIMINATION_H_
+
+#include "src/wasm/tf-builder.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+// Statistics of the bounds checks of the memory accesses in one function.
+struct BoundsCheckStatistics {
+  int eliminated;  // accesses proven in bounds and lowered to plain accesses.
+  int remaining;   // accesses that keep their bounds check.
+};
+
+// Lowers the checked memory accesses in {graph} whose index is provably in
+// bounds of the memory to plain loads and stores. The range of an index is
+// derived from constants, masks, and shifts, and from the comparisons that
+// guard the access, such as the condition of a loop over an induction
+// variable. Only accesses to memory of a constant size are considered.
+BoundsCheckStatistics EliminateBoundsChecks(TFGraph* graph);
+}
+}
+}
+
+#endif  // V8_WASM_BOUNDS_CHECK_ELIMINATION_H_
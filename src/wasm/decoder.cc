@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+
 #include "src/signature.h"
 
 #include "src/zone-containers.h"
@@ -10,6 +12,7 @@
 
 #include "src/wasm/decoder.h"
 #include "src/wasm/tf-builder.h"
+#include "src/wasm/validator.h"
 #include "src/wasm/wasm-module.h"
 #include "src/wasm/wasm-opcodes.h"
 
@@ -26,18 +29,6 @@ namespace wasm {
 #define TRACE(...)
 #endif
 
-// The root of a decoded tree.
-struct Tree {
-  LocalType type : 3;  // tree type.
-  int count : 29;      // number of children.
-  const byte* pc;      // start of the syntax tree.
-  TFNode* node;        // node in the TurboFan graph.
-  Tree* children[1];   // pointers to children.
-
-  WasmOpcode opcode() const { return static_cast<WasmOpcode>(*pc); }
-};
-
-
 // A production represents an incomplete decoded tree in the LR decoder.
 struct Production {
   Tree* tree;  // the root of the syntax tree.
@@ -50,6 +41,149 @@ struct Production {
 };
 
 
+// The SSA values of the locals of an environment, kept in a persistent tree
+// indexed by local index. Environments share the nodes they have in common,
+// so copying the locals is O(1), and comparing two copies skips the subtrees
+// they share. Setting a local copies the path to its leaf, unless the nodes
+// on the path are owned by this copy, i.e. were created by it since it was
+// last copied.
+class SsaLocals {
+ public:
+  // Initializes the locals to {values[0 .. count - 1]}, owned by {owner}.
+  void Init(Zone* zone, uint32_t owner, int count, TFNode** values) {
+    count_ = count;
+    owner_ = owner;
+    height_ = 0;
+    for (int capacity = kFanOut; capacity < count; capacity *= kFanOut) {
+      height_++;
+    }
+    root_ = count > 0 ? Build(zone, height_, 0, values) : nullptr;
+  }
+
+  // Clears the locals.
+  void Clear() {
+    root_ = nullptr;
+    count_ = 0;
+  }
+
+  // Makes {owner} the owner of this copy. Both copies of the locals get a
+  // new owner after copying, so that neither modifies the shared nodes.
+  void set_owner(uint32_t owner) { owner_ = owner; }
+
+  TFNode* Get(int index) const {
+    DCHECK(index >= 0 && index < count_);
+    Node* node = root_;
+    for (int level = height_; level > 0; level--) {
+      node = node->children[(index >> (level * kBits)) & kMask];
+    }
+    return node->values[index & kMask];
+  }
+
+  void Set(Zone* zone, int index, TFNode* value) {
+    DCHECK(index >= 0 && index < count_);
+    Node** slot = &root_;
+    for (int level = height_;; level--) {
+      Node* node = *slot;
+      if (node->owner != owner_) {
+        Node* copy = reinterpret_cast<Node*>(zone->New(sizeof(Node)));
+        *copy = *node;
+        copy->owner = owner_;
+        *slot = node = copy;
+      }
+      if (level == 0) {
+        node->values[index & kMask] = value;
+        return;
+      }
+      slot = &node->children[(index >> (level * kBits)) & kMask];
+    }
+  }
+
+  // Calls {callback(index, value)} for each local.
+  template <typename Callback>
+  void ForEach(Callback callback) const {
+    if (root_) ForEach(root_, height_, 0, callback);
+  }
+
+  // Calls {callback(index, a_value, b_value)} for each local whose value
+  // differs between {a} and {b}, copies of the locals of the same function.
+  template <typename Callback>
+  static void ForEachDifference(const SsaLocals& a, const SsaLocals& b,
+                                Callback callback) {
+    DCHECK_EQ(a.count_, b.count_);
+    a.ForEachDifference(a.root_, b.root_, a.height_, 0, callback);
+  }
+
+ private:
+  static const int kBits = 4;
+  static const int kFanOut = 1 << kBits;
+  static const int kMask = kFanOut - 1;
+
+  // An inner node of height > 0, or a leaf of height 0. Subtrees covering
+  // only indices beyond the last local are null.
+  struct Node {
+    uint32_t owner;
+    union {
+      Node* children[kFanOut];
+      TFNode* values[kFanOut];
+    };
+  };
+
+  Node* root_;
+  int height_;
+  int count_;
+  uint32_t owner_;
+
+  Node* Build(Zone* zone, int level, int first, TFNode** values) {
+    Node* node = reinterpret_cast<Node*>(zone->New(sizeof(Node)));
+    node->owner = owner_;
+    int span = 1 << (level * kBits);
+    for (int i = 0; i < kFanOut; i++) {
+      int index = first + i * span;
+      if (level == 0) {
+        node->values[i] = index < count_ ? values[index] : nullptr;
+      } else {
+        node->children[i] =
+            index < count_ ? Build(zone, level - 1, index, values) : nullptr;
+      }
+    }
+    return node;
+  }
+
+  template <typename Callback>
+  void ForEach(Node* node, int level, int first, Callback callback) const {
+    int span = 1 << (level * kBits);
+    for (int i = 0; i < kFanOut; i++) {
+      int index = first + i * span;
+      if (index >= count_) return;
+      if (level == 0) {
+        callback(index, node->values[i]);
+      } else {
+        ForEach(node->children[i], level - 1, index, callback);
+      }
+    }
+  }
+
+  template <typename Callback>
+  void ForEachDifference(Node* a, Node* b, int level, int first,
+                         Callback callback) const {
+    if (a == b) return;  // shared subtree.
+    int span = 1 << (level * kBits);
+    for (int i = 0; i < kFanOut; i++) {
+      int index = first + i * span;
+      if (index >= count_) return;
+      if (level == 0) {
+        if (a->values[i] != b->values[i]) {
+          callback(index, a->values[i], b->values[i]);
+        }
+      } else {
+        ForEachDifference(a->children[i], b->children[i], level - 1, index,
+                          callback);
+      }
+    }
+  }
+};
+
+
 // An SsaEnv environment carries the current local variable renaming
 // as well as the current effect and control dependency in the TF graph.
 struct SsaEnv {
@@ -58,12 +192,12 @@ struct SsaEnv {
   State state;
   TFNode* control;
   TFNode* effect;
-  TFNode** locals;
+  SsaLocals locals;
 
   bool go() { return state == kReached || state == kMerged; }
   void Kill() {
     state = kControlEnd;
-    locals = nullptr;
+    locals.Clear();
     control = nullptr;
     effect = nullptr;
   }
@@ -94,7 +228,16 @@ class LR_WasmDecoder {
         trees_(zone),
         stack_(zone),
         blocks_(zone),
-        ifs_(zone) {}
+        ifs_(zone),
+        inlined_(zone),
+        base_end_(nullptr),
+        own_inlinable_(zone),
+        inlinable_(&own_inlinable_),
+        inline_args_(nullptr),
+        return_controls_(zone),
+        return_effects_(zone),
+        return_vals_(zone),
+        locals_owner_(0) {}
 
   TreeResult Decode(FunctionEnv* function_env, const byte* base, const byte* pc,
                     const byte* end) {
@@ -139,8 +282,58 @@ class LR_WasmDecoder {
     return result_;
   }
 
+  // Limits inlining to callees whose bodies end before {base_end}, e.g.
+  // because the rest of the module bytes has not arrived yet.
+  void set_base_end(const byte* base_end) { base_end_ = base_end; }
+
+  // The top-level trees of the last decoded function.
+  const ZoneVector<Tree*>& trees() const { return trees_; }
+
+  // Decodes the body of the function {index} into the graph of its caller,
+  // starting from the control and effect of {caller_env}, with the
+  // parameters bound to {args}. The returns of the callee are merged and
+  // become the control and effect of {caller_env}. Returns the merged
+  // return value, or nullptr for a void function.
+  TFNode* DecodeInlined(FunctionEnv* function_env, const byte* base,
+                        uint32_t index, const ZoneVector<uint32_t>& inlined,
+                        SsaEnv* caller_env, TFNode** args) {
+    ModuleEnv* module = function_env->module;
+    const WasmFunction& function = module->module->functions->at(index);
+    inlined_.assign(inlined.begin(), inlined.end());
+    inlined_.push_back(index);
+    inline_args_ = args;
+    inline_control_ = caller_env->control;
+    inline_effect_ = caller_env->effect;
+
+    TreeResult result =
+        Decode(function_env, base, base + function.code_start_offset,
+               base + function.code_end_offset);
+    CHECK(result.ok());  // the callee has been verified before.
+
+    // Merge the returns, of which there is at least one since the callee
+    // has no loops.
+    unsigned count = static_cast<unsigned>(return_controls_.size());
+    DCHECK_LT(0, count);
+    TFNode* val = return_vals_[0];
+    if (count == 1) {
+      caller_env->control = return_controls_[0];
+      caller_env->effect = return_effects_[0];
+    } else {
+      TFNode* merge = builder_.Merge(count, return_controls_.data());
+      caller_env->control = merge;
+      caller_env->effect =
+          builder_.EffectPhi(count, return_effects_.data(), merge);
+      if (val != nullptr) {
+        val = builder_.Phi(function_env->sig->GetReturn(), count,
+                           return_vals_.data(), merge);
+      }
+    }
+    return val;
+  }
+
  private:
   static const size_t kErrorMsgSize = 128;
+  static const size_t kMaxIndent = 64;
 
   Zone* zone_;
   TFBuilder builder_;
@@ -158,51 +351,91 @@ class LR_WasmDecoder {
   ZoneVector<Block> blocks_;
   ZoneVector<IfEnv> ifs_;
 
+  // The functions inlined into the current function, outermost first,
+  // ending with the current function if it is inlined itself.
+  ZoneVector<uint32_t> inlined_;
+
+  // The end of the module bytes that callees may be inlined from.
+  const byte* base_end_;
+
+  // Whether each function of the module may be inlined wherever it is
+  // called, decided once per function and shared with the decoders of
+  // inlined callees.
+  enum Inlinability : uint8_t { kUnknown, kInlinable, kNotInlinable };
+  ZoneVector<Inlinability> own_inlinable_;
+  ZoneVector<Inlinability>* inlinable_;
+
+  // For an inlined function: the arguments of the call, the control and
+  // effect at the call, and the control, effect, and value of each return.
+  TFNode** inline_args_;
+  TFNode* inline_control_;
+  TFNode* inline_effect_;
+  ZoneVector<TFNode*> return_controls_;
+  ZoneVector<TFNode*> return_effects_;
+  ZoneVector<TFNode*> return_vals_;
+
+  // The last owner given to a copy of the locals of an environment.
+  uint32_t locals_owner_;
+
+  // The buffer returned by {indentation()} for tracing.
+  char indentation_[kMaxIndent + 1];
+
+  bool inlining() const { return inline_args_ != nullptr; }
+
   void InitSsaEnv() {
     FunctionSig* sig = function_env_->sig;
     int param_count = static_cast<int>(sig->parameter_count());
-    TFNode* start = builder_.Start(param_count + 1);
+    TFNode* start = inlining() ? inline_control_
+                               : builder_.Start(param_count + 1);
     SsaEnv* ssa_env = Split(nullptr);
     int pos = 0;
     if (builder_.graph) {
+      TFNode** locals = reinterpret_cast<TFNode**>(
+          zone_->New(sizeof(TFNode*) * EnvironmentCount()));
       // Initialize parameters.
       for (int i = 0; i < param_count; i++) {
-        ssa_env->locals[pos++] = builder_.Param(i, sig->GetParam(i));
+        locals[pos++] = inlining() ? inline_args_[i]
+                                   : builder_.Param(i, sig->GetParam(i));
       }
       // Initialize int32 locals.
       if (function_env_->local_int32_count > 0) {
         TFNode* zero = builder_.Int32Constant(0);
         for (uint32_t i = 0; i < function_env_->local_int32_count; i++) {
-          ssa_env->locals[pos++] = zero;
+          locals[pos++] = zero;
         }
       }
       // Initialize int64 locals.
       if (function_env_->local_int64_count > 0) {
         TFNode* zero = builder_.Int64Constant(0);
         for (uint32_t i = 0; i < function_env_->local_int64_count; i++) {
-          ssa_env->locals[pos++] = zero;
+          locals[pos++] = zero;
         }
       }
       // Initialize float32 locals.
       if (function_env_->local_float32_count > 0) {
         TFNode* zero = builder_.Float32Constant(0);
         for (uint32_t i = 0; i < function_env_->local_float32_count; i++) {
-          ssa_env->locals[pos++] = zero;
+          locals[pos++] = zero;
         }
       }
       // Initialize float64 locals.
       if (function_env_->local_float64_count > 0) {
         TFNode* zero = builder_.Float64Constant(0);
         for (uint32_t i = 0; i < function_env_->local_float64_count; i++) {
-          ssa_env->locals[pos++] = zero;
+          locals[pos++] = zero;
         }
       }
       DCHECK_EQ(function_env_->total_locals, pos);
       DCHECK_EQ(EnvironmentCount(), pos);
+      ssa_env->locals.Init(zone_, NewLocalsOwner(), pos, locals);
     }
     ssa_env->control = start;
-    ssa_env->effect = start;
+    ssa_env->effect = inlining() ? inline_effect_ : start;
     builder_.module = function_env_->module;
+    if (!inlining() && builder_.module != nullptr &&
+        builder_.module->UsesMemBaseParam()) {
+      builder_.MemBaseParam(param_count);
+    }
     SetEnv(ssa_env);
   }
 
@@ -253,15 +486,12 @@ class LR_WasmDecoder {
     }
   }
 
-  char* indentation() {
-    static const int kMaxIndent = 64;
-    static char bytes[kMaxIndent + 1];
-    for (int i = 0; i < kMaxIndent; i++) bytes[i] = ' ';
-    bytes[kMaxIndent] = 0;
-    if (stack_.size() < kMaxIndent / 2) {
-      bytes[stack_.size() * 2] = 0;
-    }
-    return bytes;
+  const char* indentation() {
+    size_t indent = stack_.size() * 2;
+    if (indent > kMaxIndent) indent = kMaxIndent;
+    memset(indentation_, ' ', indent);
+    indentation_[indent] = 0;
+    return indentation_;
   }
 
   // Decodes the body of a function, producing reduced trees into {result}.
@@ -280,277 +510,225 @@ class LR_WasmDecoder {
         return;
       }
 
-      int len = 1;
       WasmOpcode opcode = static_cast<WasmOpcode>(*pc_);
       TRACE("wasm-decode module+%-6d %s func+%d: 0x%02x %s\n", baserel(pc_),
             indentation(), startrel(pc_), opcode,
             WasmOpcodes::OpcodeName(opcode));
 
-      FunctionSig* sig = WasmOpcodes::Signature(opcode);
-      if (sig) {
-        // A simple expression with a fixed signature.
-        Shift(sig->GetReturn(), static_cast<uint32_t>(sig->parameter_count()));
-        pc_ += len;
-        if (pc_ >= limit_) {
-          // End of code reached or exceeded.
-          if (pc_ > limit_ && result_.error_pc != nullptr) {
-            error("Beyond end of code");
-          }
+      const WasmOpcodeInfo& info = WasmOpcodes::Info(opcode);
+      int len = 1;
+      if (info.immediate != WasmOpcodeInfo::kVariableImmediate) {
+        len += info.immediate;
+      }
+      if (info.kind != kOpcodeSpecial) {
+        if (info.kind == kOpcodeInvalid) {
+          error("Invalid opcode");
           return;
         }
-        continue;  // back to decoding loop.
+        if (info.kind != kOpcodeSimple) {
+          MemAccessTypeOperand(pc_, info.result_type());  // check width.
+        }
+        // An expression with a fixed signature.
+        Shift(info.result_type(), info.arity);
+      } else {
+        DecodeSpecial(opcode, &len);
+      }
+      pc_ += len;
+      if (pc_ >= limit_) {
+        // End of code reached or exceeded.
+        if (pc_ > limit_ && result_.error_pc != nullptr) {
+          error("Beyond end of code");
+        }
+        return;
       }
+    }
+  }
 
-      switch (opcode) {
-        case kStmtNop:
+  // Decodes a statement or a miscellaneous expression. Updates {len}, the
+  // length of the opcode and its immediate, if the immediate varies in length.
+  void DecodeSpecial(WasmOpcode opcode, int* len) {
+    switch (opcode) {
+      case kStmtNop:
+        Leaf(kAstStmt);
+        break;
+      case kStmtIf: {
+        Shift(kAstStmt, 2);
+        break;
+      }
+      case kStmtIfThen: {
+        Shift(kAstStmt, 3);
+        break;
+      }
+      case kStmtSwitch:  // fallthru
+      case kStmtSwitchNf: {
+        int length = Operand<uint8_t>(pc_);
+        Shift(kAstStmt, length + 1);
+        SsaEnv* cont_env = nullptr;
+        SsaEnv* break_env = UnreachableEnv();
+        blocks_.push_back({cont_env, break_env});
+        break;
+      }
+      case kStmtBlock: {
+        int length = Operand<uint8_t>(pc_);
+        if (length == 0) {
           Leaf(kAstStmt);
-          break;
-        case kStmtIf: {
-          Shift(kAstStmt, 2);
-          break;
-        }
-        case kStmtIfThen: {
-          Shift(kAstStmt, 3);
-          break;
-        }
-        case kStmtSwitch:  // fallthru
-        case kStmtSwitchNf: {
-          int length = Operand<uint8_t>(pc_);
-          Shift(kAstStmt, length + 1);
+        } else {
+          Shift(kAstStmt, length);
           SsaEnv* cont_env = nullptr;
           SsaEnv* break_env = UnreachableEnv();
           blocks_.push_back({cont_env, break_env});
-          len = 2;
-          break;
-        }
-        case kStmtBlock: {
-          int length = Operand<uint8_t>(pc_);
-          if (length == 0) {
-            Leaf(kAstStmt);
-          } else {
-            Shift(kAstStmt, length);
-            SsaEnv* cont_env = nullptr;
-            SsaEnv* break_env = UnreachableEnv();
-            blocks_.push_back({cont_env, break_env});
-          }
-          len = 2;
-          break;
-        }
-        case kStmtLoop: {
-          int length = Operand<uint8_t>(pc_);
-          if (length == 0) {
-            BuildInfiniteLoop();
-            ssa_env_->state = SsaEnv::kControlEnd;
-            Leaf(kAstStmt);
-          } else {
-            Shift(kAstStmt, length);
-            PrepareForLoop(ssa_env_);
-            SsaEnv* cont_env = ssa_env_;
-            ssa_env_ = Split(ssa_env_);
-            ssa_env_->state = SsaEnv::kReached;
-            SsaEnv* break_env = UnreachableEnv();
-            blocks_.push_back({cont_env, break_env});
-          }
-          len = 2;
-          break;
-        }
-        case kStmtContinue: {
-          uint32_t depth = Operand<uint8_t>(pc_);
-          if (depth < blocks_.size()) {
-            Block* block = &blocks_[blocks_.size() - depth - 1];
-            if (block->cont_env) {
-              Goto(ssa_env_, block->cont_env);
-            } else {
-              error("improper continue to block");
-            }
-            ssa_env_->state = SsaEnv::kControlEnd;
-          } else {
-            error("improperly nested continue");
-          }
-          Leaf(kAstStmt);
-          len = 2;
-          break;
         }
-        case kStmtBreak: {
-          uint32_t depth = Operand<uint8_t>(pc_);
-          if (depth < blocks_.size()) {
-            Block* block = &blocks_[blocks_.size() - depth - 1];
-            Goto(ssa_env_, block->break_env);
-            ssa_env_->state = SsaEnv::kControlEnd;
-          } else {
-            error("improperly nested break");
-          }
+        break;
+      }
+      case kStmtLoop: {
+        int length = Operand<uint8_t>(pc_);
+        if (length == 0) {
+          BuildInfiniteLoop();
+          ssa_env_->state = SsaEnv::kControlEnd;
           Leaf(kAstStmt);
-          len = 2;
-          break;
-        }
-        case kStmtReturn: {
-          int count = static_cast<int>(function_env_->sig->return_count());
-          if (count == 0) {
-            builder_.Return(0, builder_.Buffer(0));
-            ssa_env_->state = SsaEnv::kControlEnd;
-            Leaf(kAstStmt);
-          } else {
-            Shift(kAstStmt, count);
-          }
-          break;
-        }
-        case kExprInt8Const: {
-          int32_t value = Operand<int8_t>(pc_);
-          Leaf(kAstInt32, builder_.Int32Constant(value));
-          len = 2;
-          break;
-        }
-        case kExprInt32Const: {
-          int32_t value = Operand<int32_t>(pc_);
-          Leaf(kAstInt32, builder_.Int32Constant(value));
-          len = 5;
-          break;
-        }
-        case kExprInt64Const: {
-          int64_t value = Operand<int64_t>(pc_);
-          Leaf(kAstInt64, builder_.Int64Constant(value));
-          len = 9;
-          break;
-        }
-        case kExprFloat32Const: {
-          float value = Operand<float>(pc_);
-          Leaf(kAstFloat32, builder_.Float32Constant(value));
-          len = 5;
-          break;
-        }
-        case kExprFloat64Const: {
-          double value = Operand<double>(pc_);
-          Leaf(kAstFloat64, builder_.Float64Constant(value));
-          len = 9;
-          break;
-        }
-        case kExprGetLocal: {
-          uint32_t index = LocalIndexOperand(pc_, &len);
-          TFNode* val = builder_.graph && function_env_->IsValidLocal(index)
-                            ? ssa_env_->locals[index]
-                            : builder_.Error();
-          Leaf(function_env_->GetLocalType(index), val);
-          break;
-        }
-        case kExprSetLocal: {
-          uint32_t index = LocalIndexOperand(pc_, &len);
-          LocalType type = function_env_->GetLocalType(index);
-          Shift(type, 1);
-          break;
-        }
-        case kExprLoadGlobal: {
-          uint32_t index = GlobalIndexOperand(pc_, &len);
-          LocalType type = WasmOpcodes::LocalTypeFor(
-              function_env_->module->GetGlobalType(index));
-          Leaf(type, builder_.LoadGlobal(index));
-          break;
-        }
-        case kExprStoreGlobal: {
-          uint32_t index = GlobalIndexOperand(pc_, &len);
-          LocalType type = WasmOpcodes::LocalTypeFor(
-              function_env_->module->GetGlobalType(index));
-          Shift(type, 1);
-          break;
-        }
-        case kExprInt32LoadMemL:  // fallthru
-        case kExprInt32LoadMemH: {
-          MemAccessTypeOperand(pc_, kAstInt32);  // check width.
-          Shift(kAstInt32, 1);
-          len = 2;
-          break;
-        }
-        case kExprInt64LoadMemL:  // fallthru.
-        case kExprInt64LoadMemH: {
-          MemAccessTypeOperand(pc_, kAstInt64);  // check width.
-          Shift(kAstInt64, 1);
-          len = 2;
-          break;
-        }
-        case kExprFloat32LoadMemL:  // fallthru.
-        case kExprFloat32LoadMemH:
-          MemAccessTypeOperand(pc_, kAstFloat32);  // check width.
-          Shift(kAstFloat32, 1);
-          len = 2;
-          break;
-        case kExprFloat64LoadMemL:  // fallthru.
-        case kExprFloat64LoadMemH:
-          MemAccessTypeOperand(pc_, kAstFloat64);  // check width.
-          Shift(kAstFloat64, 1);
-          len = 2;
-          break;
-        case kExprInt32StoreMemL:  // fallthru.
-        case kExprInt32StoreMemH: {
-          MemAccessTypeOperand(pc_, kAstInt32);  // check width.
-          Shift(kAstInt32, 2);
-          len = 2;
-          break;
-        }
-        case kExprInt64StoreMemL:  // fallthru.
-        case kExprInt64StoreMemH: {
-          MemAccessTypeOperand(pc_, kAstInt64);  // check width.
-          Shift(kAstInt64, 2);
-          len = 2;
-          break;
+        } else {
+          Shift(kAstStmt, length);
+          PrepareForLoop(ssa_env_);
+          SsaEnv* cont_env = ssa_env_;
+          ssa_env_ = Split(ssa_env_);
+          ssa_env_->state = SsaEnv::kReached;
+          SsaEnv* break_env = UnreachableEnv();
+          blocks_.push_back({cont_env, break_env});
         }
-        case kExprFloat32StoreMemL:  // fallthru.
-        case kExprFloat32StoreMemH:
-          MemAccessTypeOperand(pc_, kAstFloat32);  // check width.
-          Shift(kAstFloat32, 2);
-          len = 2;
-          break;
-        case kExprFloat64StoreMemL:  // fallthru.
-        case kExprFloat64StoreMemH:
-          MemAccessTypeOperand(pc_, kAstFloat64);  // check width.
-          Shift(kAstFloat64, 2);
-          len = 2;
-          break;
-        case kExprCallFunction: {
-          FunctionSig* sig = FunctionSigOperand(pc_, &len);
-          if (sig) {
-            LocalType type =
-                sig->return_count() == 0 ? kAstStmt : sig->GetReturn();
-            Shift(type, static_cast<int>(sig->parameter_count()));
+        break;
+      }
+      case kStmtContinue: {
+        uint32_t depth = Operand<uint8_t>(pc_);
+        if (depth < blocks_.size()) {
+          Block* block = &blocks_[blocks_.size() - depth - 1];
+          if (block->cont_env) {
+            Goto(ssa_env_, block->cont_env);
           } else {
-            Leaf(kAstInt32);  // error
+            error("improper continue to block");
           }
-          break;
+          ssa_env_->state = SsaEnv::kControlEnd;
+        } else {
+          error("improperly nested continue");
         }
-        case kExprCallIndirect: {
-          FunctionSig* sig = FunctionTableIndexOperand(pc_, &len);
-          if (sig) {
-            LocalType type = kAstInt32;
-            if (sig->return_count() == 1) {
-              type = sig->GetReturn();
-            } else {
-              error("function call should return exactly 1 result");
-            }
-            Shift(type, static_cast<int>(1 + sig->parameter_count()));
-          } else {
-            Leaf(kAstInt32);  // error
-          }
-          break;
+        Leaf(kAstStmt);
+        break;
+      }
+      case kStmtBreak: {
+        uint32_t depth = Operand<uint8_t>(pc_);
+        if (depth < blocks_.size()) {
+          Block* block = &blocks_[blocks_.size() - depth - 1];
+          Goto(ssa_env_, block->break_env);
+          ssa_env_->state = SsaEnv::kControlEnd;
+        } else {
+          error("improperly nested break");
         }
-        case kExprTernary: {
-          Shift(kAstInt32, 3);  // Result type is typeof(x) in {c ? x : y}.
-          break;
+        Leaf(kAstStmt);
+        break;
+      }
+      case kStmtReturn: {
+        int count = static_cast<int>(function_env_->sig->return_count());
+        if (count == 0) {
+          BuildReturn(0, builder_.Buffer(0));
+          ssa_env_->state = SsaEnv::kControlEnd;
+          Leaf(kAstStmt);
+        } else {
+          Shift(kAstStmt, count);
         }
-        case kExprComma: {
-          Shift(kAstInt32, 2);  // Result type is typeof(y) in {x, y}.
-          break;
+        break;
+      }
+      case kExprInt8Const: {
+        int32_t value = Operand<int8_t>(pc_);
+        Leaf(kAstInt32, builder_.Int32Constant(value));
+        break;
+      }
+      case kExprInt32Const: {
+        int32_t value = Operand<int32_t>(pc_);
+        Leaf(kAstInt32, builder_.Int32Constant(value));
+        break;
+      }
+      case kExprInt64Const: {
+        int64_t value = Operand<int64_t>(pc_);
+        Leaf(kAstInt64, builder_.Int64Constant(value));
+        break;
+      }
+      case kExprFloat32Const: {
+        float value = Operand<float>(pc_);
+        Leaf(kAstFloat32, builder_.Float32Constant(value));
+        break;
+      }
+      case kExprFloat64Const: {
+        double value = Operand<double>(pc_);
+        Leaf(kAstFloat64, builder_.Float64Constant(value));
+        break;
+      }
+      case kExprGetLocal: {
+        uint32_t index = LocalIndexOperand(pc_, len);
+        TFNode* val = builder_.graph && function_env_->IsValidLocal(index)
+                          ? ssa_env_->locals.Get(index)
+                          : builder_.Error();
+        Leaf(function_env_->GetLocalType(index), val);
+        break;
+      }
+      case kExprSetLocal: {
+        uint32_t index = LocalIndexOperand(pc_, len);
+        LocalType type = function_env_->GetLocalType(index);
+        Shift(type, 1);
+        break;
+      }
+      case kExprLoadGlobal: {
+        uint32_t index = GlobalIndexOperand(pc_, len);
+        LocalType type = WasmOpcodes::LocalTypeFor(
+            function_env_->module->GetGlobalType(index));
+        Leaf(type, builder_.LoadGlobal(index));
+        break;
+      }
+      case kExprStoreGlobal: {
+        uint32_t index = GlobalIndexOperand(pc_, len);
+        LocalType type = WasmOpcodes::LocalTypeFor(
+            function_env_->module->GetGlobalType(index));
+        Shift(type, 1);
+        break;
+      }
+      case kExprCallFunction: {
+        FunctionSig* sig = FunctionSigOperand(pc_, len);
+        if (sig) {
+          LocalType type =
+              sig->return_count() == 0 ? kAstStmt : sig->GetReturn();
+          Shift(type, static_cast<int>(sig->parameter_count()));
+        } else {
+          Leaf(kAstInt32);  // error
         }
-        default:
-          error("Invalid opcode");
-          return;
+        break;
       }
-      pc_ += len;
-      if (pc_ >= limit_) {
-        // End of code reached or exceeded.
-        if (pc_ > limit_ && result_.error_pc != nullptr) {
-          error("Beyond end of code");
+      case kExprCallIndirect: {
+        FunctionSig* sig = SignatureIndexOperand(pc_, len);
+        if (sig) {
+          LocalType type =
+              sig->return_count() == 0 ? kAstStmt : sig->GetReturn();
+          Shift(type, static_cast<int>(1 + sig->parameter_count()));
+        } else {
+          Leaf(kAstInt32);  // error
         }
-        return;
+        break;
       }
+      case kExprTernary: {
+        Shift(kAstInt32, 3);  // Result type is typeof(x) in {c ? x : y}.
+        break;
+      }
+      case kExprComma: {
+        Shift(kAstInt32, 2);  // Result type is typeof(y) in {x, y}.
+        break;
+      }
+      case kExprMemorySize: {
+        Leaf(kAstInt32, builder_.MemorySize());
+        break;
+      }
+      case kExprGrowMemory: {
+        Shift(kAstInt32, 1);
+        break;
+      }
+      default:
+        UNREACHABLE();
     }
   }
 
@@ -564,7 +742,7 @@ class LR_WasmDecoder {
 
   void AddImplicitReturnAtEnd() {
     int retcount = static_cast<int>(function_env_->sig->return_count());
-    if (retcount == 0) return builder_.ReturnVoid();
+    if (retcount == 0) return BuildReturn(0, builder_.Buffer(0));
 
     if (trees_.size() < function_env_->sig->return_count()) {
       error(limit_, nullptr,
@@ -590,7 +768,17 @@ class LR_WasmDecoder {
       }
     }
 
-    builder_.Return(retcount, buffer);
+    BuildReturn(retcount, buffer);
+  }
+
+  // Returns from the current function, or, if it is inlined, records the
+  // return to be merged into the caller.
+  void BuildReturn(unsigned count, TFNode** vals) {
+    if (!inlining()) return builder_.Return(count, vals);
+    if (!builder_.graph) return;
+    return_controls_.push_back(ssa_env_->control);
+    return_effects_.push_back(ssa_env_->effect);
+    return_vals_.push_back(count == 0 ? nullptr : vals[0]);
   }
 
   int baserel(const byte* ptr) {
@@ -604,21 +792,28 @@ class LR_WasmDecoder {
     TRACE("-----reduce module+%-6d %s func+%d: 0x%02x %s\n", baserel(p->pc()),
           indentation(), startrel(p->pc()), opcode,
           WasmOpcodes::OpcodeName(opcode));
-    FunctionSig* sig = WasmOpcodes::Signature(opcode);
-    if (sig) {
-      // A simple expression with a fixed signature.
-      TypeCheckLast(p, sig->GetParam(p->index - 1));
-      if (p->done()) {
-        if (sig->parameter_count() == 2) {
-          p->tree->node = builder_.Binop(opcode, p->tree->children[0]->node,
-                                         p->tree->children[1]->node);
-        } else if (sig->parameter_count() == 1) {
-          p->tree->node = builder_.Unop(opcode, p->tree->children[0]->node);
-        } else {
-          UNREACHABLE();
+    const WasmOpcodeInfo& info = WasmOpcodes::Info(opcode);
+    switch (info.kind) {
+      case kOpcodeSimple:
+        // A simple expression with a fixed signature.
+        TypeCheckLast(p, info.param_type(p->index - 1));
+        if (p->done()) {
+          if (info.arity == 2) {
+            p->tree->node = builder_.Binop(opcode, p->tree->children[0]->node,
+                                           p->tree->children[1]->node);
+          } else if (info.arity == 1) {
+            p->tree->node = builder_.Unop(opcode, p->tree->children[0]->node);
+          } else {
+            UNREACHABLE();
+          }
         }
-      }
-      return;
+        return;
+      case kOpcodeLoadMem:
+        return ReduceLoadMem(p, info);
+      case kOpcodeStoreMem:
+        return ReduceStoreMem(p, info);
+      default:
+        break;
     }
 
     switch (opcode) {
@@ -635,8 +830,9 @@ class LR_WasmDecoder {
           builder_.Branch(cond, &env->true_env->control,
                           &env->false_env->control);
           SetEnv(env->true_env);
-        } else {
-          // Just finished a case.
+        }
+        if (p->index > 1 || p->done()) {
+          // Just finished a case, or there are no cases.
           //          TypeCheckLast(p, kAstStmt);
           SsaEnv* fallthru = ssa_env_;
           IfEnv* env = &ifs_.back();
@@ -678,6 +874,7 @@ class LR_WasmDecoder {
             Goto(ssa_env_,
                  opcode == kStmtLoop ? last->cont_env : last->break_env);
           }
+          if (opcode == kStmtLoop) CloseLoop(last->cont_env);
           SetEnv(last->break_env);
           blocks_.pop_back();
         }
@@ -738,7 +935,7 @@ class LR_WasmDecoder {
           for (int i = 0; i < count; i++) {
             buffer[i] = p->tree->children[i]->node;
           }
-          builder_.Return(count, buffer);
+          BuildReturn(count, buffer);
           ssa_env_->state = SsaEnv::kControlEnd;
         }
         break;
@@ -748,7 +945,7 @@ class LR_WasmDecoder {
         uint32_t index = LocalIndexOperand(p->pc(), &unused);
         Tree* val = p->last();
         if (function_env_->GetLocalType(index) == val->type) {
-          if (builder_.graph) ssa_env_->locals[index] = val->node;
+          if (builder_.graph) ssa_env_->locals.Set(zone_, index, val->node);
           p->tree->node = val->node;
         } else {
           error(p->pc(), val->pc, "Typecheck failed in SetLocal");
@@ -770,40 +967,6 @@ class LR_WasmDecoder {
         break;
       }
 
-      case kExprInt32LoadMemL:
-        return ReduceLoadMem(p, false, kAstInt32);
-      case kExprInt32LoadMemH:
-        return ReduceLoadMem(p, true, kAstInt32);
-      case kExprInt64LoadMemL:
-        return ReduceLoadMem(p, false, kAstInt64);
-      case kExprInt64LoadMemH:
-        return ReduceLoadMem(p, true, kAstInt64);
-      case kExprFloat32LoadMemL:
-        return ReduceLoadMem(p, false, kAstFloat32);
-      case kExprFloat32LoadMemH:
-        return ReduceLoadMem(p, true, kAstFloat32);
-      case kExprFloat64LoadMemL:
-        return ReduceLoadMem(p, false, kAstFloat64);
-      case kExprFloat64LoadMemH:
-        return ReduceLoadMem(p, true, kAstFloat64);
-
-      case kExprInt32StoreMemL:
-        return ReduceStoreMem(p, false, kAstInt32);
-      case kExprInt32StoreMemH:
-        return ReduceStoreMem(p, true, kAstInt32);
-      case kExprInt64StoreMemL:
-        return ReduceStoreMem(p, false, kAstInt64);
-      case kExprInt64StoreMemH:
-        return ReduceStoreMem(p, true, kAstInt64);
-      case kExprFloat32StoreMemL:
-        return ReduceStoreMem(p, false, kAstFloat32);
-      case kExprFloat32StoreMemH:
-        return ReduceStoreMem(p, true, kAstFloat32);
-      case kExprFloat64StoreMemL:
-        return ReduceStoreMem(p, false, kAstFloat64);
-      case kExprFloat64StoreMemH:
-        return ReduceStoreMem(p, true, kAstFloat64);
-
       case kExprCallFunction: {
         int unused = 0;
         FunctionSig* sig = FunctionSigOperand(p->pc(), &unused);
@@ -819,25 +982,28 @@ class LR_WasmDecoder {
           for (int i = 1; i < count; i++) {
             buffer[i] = p->tree->children[i - 1]->node;
           }
-          p->tree->node = builder_.CallDirect(index, buffer);
+          if (ShouldInline(index)) {
+            p->tree->node = Inline(index, buffer + 1);
+          } else {
+            p->tree->node = builder_.CallDirect(index, buffer);
+          }
         }
         break;
       }
       case kExprCallIndirect: {
         int unused = 0;
-        FunctionSig* sig = FunctionTableIndexOperand(p->pc(), &unused);
+        FunctionSig* sig = SignatureIndexOperand(p->pc(), &unused);
+        if (!sig) break;
         if (p->index == 1) {
-          TypeCheckLast(p, kAstInt32);
-        } else {
-          TypeCheckLast(p, sig->GetParam(p->index));
+          TypeCheckLast(p, kAstInt32);  // key into the function table.
+        } else if (p->index > 1) {
+          TypeCheckLast(p, sig->GetParam(p->index - 2));
         }
         if (p->done()) {
           uint32_t count = p->tree->count;
           TFNode** buffer = builder_.Buffer(count);
-          // TODO(titzer): function table index operand
-          uint32_t index = Operand<uint8_t>(p->pc());
-          buffer[0] = nullptr;  // reserved for computed target.
-          for (int i = 1; i < count; i++) {
+          uint32_t index = UnsignedLEB128Operand(p->pc(), &unused);
+          for (int i = 0; i < count; i++) {
             buffer[i] = p->tree->children[i]->node;
           }
           p->tree->node = builder_.CallIndirect(index, buffer);
@@ -899,23 +1065,122 @@ class LR_WasmDecoder {
         }
         break;
       }
+      case kExprGrowMemory: {
+        TypeCheckLast(p, kAstInt32);
+        if (p->done()) p->tree->node = builder_.GrowMemory(p->last()->node);
+        break;
+      }
       default:
         break;
     }
   }
 
-  void ReduceLoadMem(Production* p, bool high, LocalType type) {
-    TypeCheckLast(p, high ? kAstInt64 : kAstInt32);  // index
-    MemType mem_type = MemAccessTypeOperand(p->pc(), type);
+  // Decides whether to inline a direct call to the function {index} into
+  // the graph. Small callees without loops are inlined, up to a depth that
+  // also bounds the unrolling of recursive calls.
+  bool ShouldInline(uint32_t index) {
+    if (!FLAG_wasm_inlining || !builder_.graph) return false;
+    if (inlined_.size() >= static_cast<size_t>(FLAG_wasm_inlining_max_depth)) {
+      return false;
+    }
+    WasmModule* module = function_env_->module->module;
+    if (module == nullptr || base_ == nullptr) return false;
+    if (std::find(inlined_.begin(), inlined_.end(), index) != inlined_.end()) {
+      return false;  // a recursive call.
+    }
+    if (inlinable_->size() <= index) {
+      inlinable_->resize(module->functions->size(), kUnknown);
+    }
+    if ((*inlinable_)[index] == kUnknown) {
+      (*inlinable_)[index] =
+          IsInlinable(module->functions->at(index)) ? kInlinable
+                                                    : kNotInlinable;
+    }
+    return (*inlinable_)[index] == kInlinable;
+  }
+
+  // Returns true if {function} is small, has arrived, and has no loops,
+  // since every path through such a function ends in a return that can be
+  // merged into the caller.
+  bool IsInlinable(const WasmFunction& function) {
+    if (function.external) return false;
+    // The callee is read from the bytes of the caller, where it may not
+    // have arrived yet.
+    if (base_ + function.code_end_offset > base_end_) return false;
+    int size = static_cast<int>(function.code_end_offset -
+                                function.code_start_offset);
+    if (size <= 0 || size > FLAG_wasm_inlining_max_size) return false;
+
+    FunctionEnv env;
+    InitFunctionEnv(&env, function);
+    Zone zone;
+    ZoneVector<Tree*> trees(&zone);
+    TreeResult result = DecodeWasmTrees(&zone, &env, base_,
+                                        base_ + function.code_start_offset,
+                                        base_ + function.code_end_offset,
+                                        &trees);
+    if (!result.ok()) return false;
+    for (Tree* tree : trees) {
+      if (HasLoop(tree)) return false;
+    }
+    return true;
+  }
+
+  static bool HasLoop(Tree* tree) {
+    if (tree->opcode() == kStmtLoop) return true;
+    for (int i = 0; i < tree->count; i++) {
+      if (HasLoop(tree->children[i])) return true;
+    }
+    return false;
+  }
+
+  void InitFunctionEnv(FunctionEnv* env, const WasmFunction& function) {
+    env->module = function_env_->module;
+    env->sig = function.sig;
+    env->local_int32_count = function.local_int32_count;
+    env->local_int64_count = function.local_int64_count;
+    env->local_float32_count = function.local_float32_count;
+    env->local_float64_count = function.local_float64_count;
+    env->SumLocals();
+  }
+
+  // Decodes the body of the function {index} into the current graph at the
+  // current position, with the given arguments, instead of calling it.
+  TFNode* Inline(uint32_t index, TFNode** args) {
+    const WasmFunction& function =
+        function_env_->module->module->functions->at(index);
+    TRACE("wasm-inline #%d (%d bytes) at depth %d\n", index,
+          function.code_end_offset - function.code_start_offset,
+          static_cast<int>(inlined_.size()) + 1);
+    FunctionEnv env;
+    InitFunctionEnv(&env, function);
+    // The arguments may live in the buffer of the builder, which the
+    // inlined decoder overwrites.
+    size_t count = function.sig->parameter_count();
+    TFNode** inline_args = zone_->NewArray<TFNode*>(count > 0 ? count : 1);
+    for (size_t i = 0; i < count; i++) inline_args[i] = args[i];
+    LR_WasmDecoder inliner(zone_, builder_.graph);
+    // The callee accesses the memory through the same base as the caller,
+    // which may be a parameter of the caller.
+    if (builder_.graph) inliner.builder_.mem_buffer = builder_.MemBuffer();
+    inliner.set_base_end(base_end_);
+    inliner.inlinable_ = inlinable_;
+    return inliner.DecodeInlined(&env, base_, index, inlined_, ssa_env_,
+                                 inline_args);
+  }
+
+  void ReduceLoadMem(Production* p, const WasmOpcodeInfo& info) {
+    TypeCheckLast(p, info.param_type(0));  // index
+    MemType mem_type = MemAccessTypeOperand(p->pc(), info.result_type());
     p->tree->node = builder_.LoadMem(mem_type, p->last()->node);
   }
 
-  void ReduceStoreMem(Production* p, bool high, LocalType type) {
+  void ReduceStoreMem(Production* p, const WasmOpcodeInfo& info) {
     if (p->index == 1) {
-      TypeCheckLast(p, high ? kAstInt64 : kAstInt32);  // index
+      TypeCheckLast(p, info.param_type(0));  // index
     } else if (p->index == 2) {
-      TypeCheckLast(p, type);
-      MemType mem_type = MemAccessTypeOperand(p->pc(), type);
+      TypeCheckLast(p, info.param_type(1));
+      MemType mem_type = MemAccessTypeOperand(p->pc(), info.result_type());
       p->tree->node = builder_.StoreMem(mem_type, p->tree->children[0]->node,
                                         p->tree->children[1]->node);
     }
@@ -945,7 +1210,7 @@ class LR_WasmDecoder {
     switch (to->state) {
       case SsaEnv::kUnreachable: {  // Overwrite destination.
         to->state = SsaEnv::kReached;
-        to->locals = from->locals;
+        to->locals = from->locals;  // {from} is killed below.
         to->control = from->control;
         to->effect = from->effect;
         break;
@@ -962,15 +1227,13 @@ class LR_WasmDecoder {
           to->effect = builder_.EffectPhi(2, effects, merge);
         }
         // Merge SSA values.
-        for (int i = EnvironmentCount() - 1; i >= 0; i--) {
-          TFNode* a = from->locals[i];
-          TFNode* b = to->locals[i];
-          if (a != b) {
-            TFNode* vals[] = {a, b};
-            to->locals[i] =
-                builder_.Phi(function_env_->GetLocalType(i), 2, vals, merge);
-          }
-        }
+        SsaLocals::ForEachDifference(
+            from->locals, to->locals, [=](int i, TFNode* a, TFNode* b) {
+              TFNode* vals[] = {a, b};
+              to->locals.Set(zone_, i, builder_.Phi(
+                                           function_env_->GetLocalType(i), 2,
+                                           vals, merge));
+            });
         break;
       }
       case SsaEnv::kMerged: {
@@ -987,21 +1250,22 @@ class LR_WasmDecoder {
           effects[count - 1] = from->effect;
           to->effect = builder_.EffectPhi(count, effects, merge);
         }
-        // Merge locals.
-        for (int i = EnvironmentCount() - 1; i >= 0; i--) {
-          TFNode* tnode = to->locals[i];
-          TFNode* fnode = from->locals[i];
-          if (builder_.IsPhiWithMerge(tnode, merge)) {
-            builder_.AppendToPhi(merge, tnode, fnode);
-          } else if (tnode != fnode) {
-            uint32_t count = builder_.InputCount(merge);
-            TFNode** vals = builder_.Buffer(count);
-            for (int j = 0; j < count - 1; j++) vals[j] = tnode;
-            vals[count - 1] = fnode;
-            to->locals[i] = builder_.Phi(function_env_->GetLocalType(i), count,
-                                         vals, merge);
-          }
-        }
+        // Merge locals. Only the locals that differ need an input; a loop
+        // phi that gets none is padded by {ExtendPhi} or {CloseLoop}.
+        SsaLocals::ForEachDifference(
+            from->locals, to->locals, [=](int i, TFNode* fnode, TFNode* tnode) {
+              if (builder_.IsPhiWithMerge(tnode, merge)) {
+                ExtendPhi(merge, tnode, fnode);
+              } else {
+                uint32_t count = builder_.InputCount(merge);
+                TFNode** vals = builder_.Buffer(count);
+                for (int j = 0; j < count - 1; j++) vals[j] = tnode;
+                vals[count - 1] = fnode;
+                to->locals.Set(zone_, i,
+                               builder_.Phi(function_env_->GetLocalType(i),
+                                            count, vals, merge));
+              }
+            });
         break;
       }
       default:
@@ -1016,6 +1280,7 @@ class LR_WasmDecoder {
     ssa_env_ = Split(ssa_env_);
     ssa_env_->state = SsaEnv::kReached;
     Goto(ssa_env_, cont_env);
+    CloseLoop(cont_env);
   }
 
   void PrepareForLoop(SsaEnv* env) {
@@ -1023,25 +1288,56 @@ class LR_WasmDecoder {
     env->control = builder_.Loop(env->control);
     env->effect = builder_.EffectPhi(1, &env->effect, env->control);
     builder_.Terminate(env->effect, env->control);
-    for (int i = EnvironmentCount() - 1; i >= 0; i--) {
-      env->locals[i] = builder_.Phi(function_env_->GetLocalType(i), 1,
-                                    &env->locals[i], env->control);
+    SsaLocals* locals = &env->locals;
+    TFNode* control = env->control;
+    locals->ForEach([=](int i, TFNode* value) {
+      locals->Set(zone_, i, builder_.Phi(function_env_->GetLocalType(i), 1,
+                                         &value, control));
+    });
+  }
+
+  // Appends {from} to {phi} as the input for the last input of {merge}. The
+  // inputs missing for earlier inputs of {merge} are the phi itself, since
+  // only a loop phi misses inputs, for back edges that leave its local
+  // unchanged.
+  void ExtendPhi(TFNode* merge, TFNode* phi, TFNode* from) {
+    unsigned count = builder_.InputCount(merge);
+    while (builder_.InputCount(phi) < count) {
+      builder_.AppendToPhi(merge, phi, phi);
     }
+    builder_.AppendToPhi(merge, phi, from);
   }
 
+  // Pads the phis of the loop {env} with inputs for the back edges that left
+  // their locals unchanged, once all back edges have been added.
+  void CloseLoop(SsaEnv* env) {
+    if (EnvironmentCount() == 0) return;
+    TFNode* merge = env->control;
+    unsigned count = builder_.InputCount(merge);
+    env->locals.ForEach([=](int i, TFNode* phi) {
+      if (!builder_.IsPhiWithMerge(phi, merge)) return;
+      while (builder_.InputCount(phi) <= count) {
+        builder_.AppendToPhi(merge, phi, phi);
+      }
+    });
+  }
+
+  uint32_t NewLocalsOwner() { return ++locals_owner_; }
+
   SsaEnv* Split(SsaEnv* from) {
     SsaEnv* result = reinterpret_cast<SsaEnv*>(zone_->New(sizeof(SsaEnv)));
-    size_t size = sizeof(TFNode*) * EnvironmentCount();
-    result->locals =
-        size > 0 ? reinterpret_cast<TFNode**>(zone_->New(size)) : nullptr;
     if (from) {
       DCHECK(from->go());
-      memcpy(result->locals, from->locals, size);
+      // Share the locals, which both copies modify by copying from now on.
+      result->locals = from->locals;
+      result->locals.set_owner(NewLocalsOwner());
+      from->locals.set_owner(NewLocalsOwner());
       result->control = from->control;
       result->effect = from->effect;
       result->state = from->state == SsaEnv::kUnreachable ? SsaEnv::kUnreachable
                                                           : SsaEnv::kReached;
     } else {
+      result->locals.Clear();
       result->state = SsaEnv::kReached;
     }
     return result;
@@ -1052,7 +1348,7 @@ class LR_WasmDecoder {
     result->state = SsaEnv::kUnreachable;
     result->control = nullptr;
     result->effect = nullptr;
-    result->locals = nullptr;
+    result->locals.Clear();
     return result;
   }
 
@@ -1117,10 +1413,10 @@ class LR_WasmDecoder {
     return sig;
   }
 
-  FunctionSig* FunctionTableIndexOperand(const byte* pc, int* length) {
+  FunctionSig* SignatureIndexOperand(const byte* pc, int* length) {
     uint32_t index = UnsignedLEB128Operand(pc, length);
-    FunctionSig* sig = function_env_->module->GetFunctionTableSignature(index);
-    if (!sig) error(pc, "invalid function table index");
+    FunctionSig* sig = function_env_->module->GetSignature(index);
+    if (!sig) error(pc, "invalid signature index");
     return sig;
   }
 
@@ -1228,17 +1524,30 @@ class LR_WasmDecoder {
 TreeResult VerifyWasmCode(FunctionEnv* env, const byte* base, const byte* start,
                           const byte* end) {
   Zone zone;
-  LR_WasmDecoder decoder(&zone, nullptr);
-  TreeResult result = decoder.Decode(env, base, start, end);
-  return result;
+  WasmValidator validator(&zone);
+  return validator.Validate(env, base, start, end);
 }
 
 
 TreeResult BuildTFGraph(TFGraph* graph, FunctionEnv* env, const byte* base,
-                        const byte* start, const byte* end) {
+                        const byte* base_end, const byte* start,
+                        const byte* end) {
   Zone zone;
   LR_WasmDecoder decoder(&zone, graph);
+  decoder.set_base_end(base_end);
+  TreeResult result = decoder.Decode(env, base, start, end);
+  return result;
+}
+
+
+TreeResult DecodeWasmTrees(Zone* zone, FunctionEnv* env, const byte* base,
+                           const byte* start, const byte* end,
+                           ZoneVector<Tree*>* trees) {
+  LR_WasmDecoder decoder(zone, nullptr);
   TreeResult result = decoder.Decode(env, base, start, end);
+  if (result.ok()) {
+    trees->insert(trees->end(), decoder.trees().begin(), decoder.trees().end());
+  }
   return result;
 }
 
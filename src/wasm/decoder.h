@@ -85,15 +85,36 @@ struct FunctionEnv {
   }
 };
 
-struct Tree;
+// The root of a decoded tree.
+struct Tree {
+  LocalType type : 3;  // tree type.
+  int count : 29;      // number of children.
+  const byte* pc;      // start of the syntax tree.
+  TFNode* node;        // node in the TurboFan graph.
+  Tree* children[1];   // pointers to children.
+
+  WasmOpcode opcode() const { return static_cast<WasmOpcode>(*pc); }
+};
+
 typedef Result<Tree*> TreeResult;
 
 std::ostream& operator<<(std::ostream& os, const Tree& tree);
 
 TreeResult VerifyWasmCode(FunctionEnv* env, const byte* base, const byte* start,
                           const byte* end);
+
+// Builds the TurboFan graph of the function body [start, end) of the module
+// whose bytes begin at {base}. Direct calls may be inlined if the body of the
+// callee ends before {base_end}; no calls are inlined if {base} is null.
 TreeResult BuildTFGraph(TFGraph* graph, FunctionEnv* env, const byte* base,
-                        const byte* start, const byte* end);
+                        const byte* base_end, const byte* start,
+                        const byte* end);
+
+// Verifies the code and allocates the decoded trees in {zone}, appending
+// the top-level trees of the function body to {trees}.
+TreeResult DecodeWasmTrees(Zone* zone, FunctionEnv* env, const byte* base,
+                           const byte* start, const byte* end,
+                           ZoneVector<Tree*>* trees);
 
 inline TreeResult VerifyWasmCode(FunctionEnv* env, const byte* start,
                                  const byte* end) {
@@ -102,7 +123,7 @@ inline TreeResult VerifyWasmCode(FunctionEnv* env, const byte* start,
 
 inline TreeResult BuildTFGraph(TFGraph* graph, FunctionEnv* env,
                                const byte* start, const byte* end) {
-  return BuildTFGraph(graph, env, nullptr, start, end);
+  return BuildTFGraph(graph, env, nullptr, nullptr, start, end);
 }
 }
 }
@@ -12,6 +12,7 @@
 #include "src/compiler/linkage.h"
 
 #include "src/wasm/tf-builder.h"
+#include "src/wasm/wasm-memory.h"
 #include "src/wasm/wasm-module.h"
 #include "src/wasm/wasm-opcodes.h"
 
@@ -88,6 +89,9 @@ TFBuilder::TFBuilder(Zone* z, TFGraph* g)
       module(nullptr),
       mem_buffer(nullptr),
       mem_size(nullptr),
+      globals_area(nullptr),
+      function_table(nullptr),
+      import_table(nullptr),
       control(nullptr),
       effect(nullptr),
       cur_buffer(def_buffer),
@@ -533,6 +537,22 @@ TFNode* TFBuilder::Float64Constant(double value) {
 }
 
 
+// Returns the zero value of {type}, or an int32 zero for statements.
+TFNode* TFBuilder::ZeroConstant(LocalType type) {
+  if (!graph) return nullptr;
+  switch (type) {
+    case kAstInt64:
+      return graph->Int64Constant(0);
+    case kAstFloat32:
+      return graph->Float32Constant(0);
+    case kAstFloat64:
+      return graph->Float64Constant(0);
+    default:
+      return graph->Int32Constant(0);
+  }
+}
+
+
 TFNode* TFBuilder::Constant(Handle<Object> value) {
   return graph ? graph->Constant(value) : nullptr;
 }
@@ -582,8 +602,12 @@ TFNode* TFBuilder::CallDirect(uint32_t index, TFNode** args) {
 
   FunctionSig* sig = module->GetFunctionSignature(index);
   const size_t params = sig->parameter_count();
+  // Shared import wrappers take the imported function instead of the start
+  // of linear memory.
+  const bool import = module->UsesImportTable(index);
+  const size_t implicit = import || module->UsesMemBaseParam() ? 1 : 0;
   const size_t extra = 2;  // effect and control inputs.
-  const size_t count = 1 + params + extra;
+  const size_t count = 1 + params + implicit + extra;
 
   if (args != cur_buffer || cur_bufsize < count) {
     // Reallocate the buffer to make space for extra inputs.
@@ -594,9 +618,23 @@ TFNode* TFBuilder::CallDirect(uint32_t index, TFNode** args) {
 
   // Add code object as constant.
   args[0] = Constant(module->GetFunctionCode(index));
+  if (import) {
+    // Pass the imported function of the instance first.
+    memmove(args + 2, args + 1, params * sizeof(TFNode*));
+    TFNode* function = graph->graph()->NewNode(
+        graph->machine()->Load(compiler::kMachAnyTagged), ImportTable(),
+        graph->IntPtrConstant(FixedArray::kHeaderSize - kHeapObjectTag +
+                              static_cast<int>(index) * kPointerSize),
+        *effect, *control);
+    *effect = function;
+    args[1] = function;
+  } else if (implicit > 0) {
+    // Pass the start of linear memory along.
+    args[params + 1] = MemBuffer();
+  }
   // Add effect and control inputs.
-  args[params + 1] = *effect;
-  args[params + 2] = *control;
+  args[params + implicit + 1] = *effect;
+  args[params + implicit + 2] = *control;
 
   const compiler::Operator* op =
       graph->common()->Call(module->GetCallDescriptor(graph->zone(), index));
@@ -607,13 +645,150 @@ TFNode* TFBuilder::CallDirect(uint32_t index, TFNode** args) {
 }
 
 
+// Calls the function at {args[0]} in the function table with the arguments
+// in {args}, if the key is within the table and the function has signature
+// {index}. Signatures are compared by their canonical ids, which the table
+// holds next to the code of its functions. A key outside the table traps
+// with the module's bounds message, and a signature mismatch traps with its
+// signature message; neither calls a function.
 TFNode* TFBuilder::CallIndirect(uint32_t index, TFNode** args) {
-  DCHECK_NULL(args[0]);
-  UNIMPLEMENTED();
-  return nullptr;
+  if (!graph) return nullptr;
+  compiler::Graph* g = graph->graph();
+  compiler::MachineOperatorBuilder* machine = graph->machine();
+
+  FunctionSig* sig = module->GetSignature(index);
+  LocalType type = sig->return_count() == 0 ? kAstStmt : sig->GetReturn();
+  TFNode* zero = ZeroConstant(type);
+  uint32_t table_size = module->FunctionTableSize();
+  if (table_size == 0) {
+    // No function can be called.
+    *effect = *control = Trap(module->trap_bounds_message, *effect, *control);
+    return zero;
+  }
+  DCHECK(!module->function_table.is_null());
+
+  const size_t params = sig->parameter_count();
+  const size_t implicit = module->UsesMemBaseParam() ? 1 : 0;
+  const size_t extra = 2;  // effect and control inputs.
+  const size_t count = 1 + params + implicit + extra;
+  TFNode** call_args =
+      reinterpret_cast<TFNode**>(zone->New(count * sizeof(TFNode*)));
+  memcpy(call_args + 1, args + 1, params * sizeof(TFNode*));
+  if (implicit > 0) call_args[params + 1] = MemBuffer();
+  TFNode* key = args[0];
+
+  // Check the key against the size of the table.
+  TFNode* in_bounds;
+  TFNode* out_of_bounds;
+  Branch(g->NewNode(machine->Uint32LessThan(), key,
+                    graph->Int32Constant(static_cast<int32_t>(table_size))),
+         &in_bounds, &out_of_bounds);
+  TFNode* bounds_trap =
+      Trap(module->trap_bounds_message, *effect, out_of_bounds);
+
+  // Check the canonical signature id of the entry, which is a small integer
+  // and can therefore be compared without untagging it.
+  TFNode* offset = key;
+  if (machine->Is64()) {
+    offset = g->NewNode(machine->ChangeUint32ToUint64(), offset);
+  }
+  offset = g->NewNode(machine->WordShl(), offset,
+                      graph->IntPtrConstant(kPointerSizeLog2));
+  TFNode* table = FunctionTable();
+  TFNode* sig_id = g->NewNode(
+      machine->Load(compiler::kMachPtr), table,
+      g->NewNode(machine->IntAdd(), offset,
+                 graph->IntPtrConstant(FixedArray::kHeaderSize -
+                                       kHeapObjectTag)),
+      *effect, in_bounds);
+  int canonical_id = module->module->CanonicalSignatureId(sig);
+  TFNode* expected = graph->IntPtrConstant(
+      reinterpret_cast<intptr_t>(Smi::FromInt(canonical_id)));
+  TFNode* sig_match;
+  TFNode* sig_mismatch;
+  *control = in_bounds;
+  Branch(g->NewNode(machine->WordEqual(), sig_id, expected), &sig_match,
+         &sig_mismatch);
+  TFNode* sig_trap =
+      Trap(module->trap_signature_message, sig_id, sig_mismatch);
+
+  // Load the code of the entry and call it.
+  TFNode* code = g->NewNode(
+      machine->Load(compiler::kMachAnyTagged), table,
+      g->NewNode(machine->IntAdd(), offset,
+                 graph->IntPtrConstant(FixedArray::kHeaderSize -
+                                       kHeapObjectTag +
+                                       static_cast<int>(table_size) *
+                                           kPointerSize)),
+      sig_id, sig_match);
+  call_args[0] = code;
+  call_args[params + implicit + 1] = code;
+  call_args[params + implicit + 2] = sig_match;
+  const compiler::Operator* op = graph->common()->Call(
+      module->GetWasmCallDescriptor(graph->zone(), sig));
+  TFNode* call = g->NewNode(op, static_cast<int>(count), call_args);
+
+  // Merge the call with the traps, which never produce a value.
+  TFNode* controls[] = {sig_match, sig_trap, bounds_trap};
+  TFNode* merge = Merge(3, controls);
+  TFNode* effects[] = {call, sig_trap, bounds_trap};
+  *effect = EffectPhi(3, effects, merge);
+  *control = merge;
+  if (type == kAstStmt) return zero;
+  TFNode* vals[] = {call, zero, zero};
+  return Phi(type, 3, vals, merge);
+}
+
+
+// Throws {message} as a wasm trap. The exception is rethrown through the
+// runtime, which needs no frame state, and unwinds the wasm frames up to
+// the nearest JavaScript handler. Control never continues after the call.
+TFNode* TFBuilder::Trap(Handle<String> message, TFNode* effect,
+                        TFNode* control) {
+  DCHECK(!module->trap_stub.is_null());
+  compiler::Graph* g = graph->graph();
+  Runtime::FunctionId f = Runtime::kReThrow;
+  const Runtime::Function* fun = Runtime::FunctionForId(f);
+  compiler::CallDescriptor* desc = compiler::Linkage::GetRuntimeCallDescriptor(
+      graph->zone(), f, fun->nargs, compiler::Operator::kNoProperties);
+  TFNode* inputs[] = {
+      graph->HeapConstant(module->trap_stub),
+      graph->HeapConstant(message),
+      graph->ExternalConstant(ExternalReference(f, graph->isolate())),
+      graph->Int32Constant(fun->nargs),
+      graph->HeapConstant(module->trap_context),
+      effect,
+      control};
+  return g->NewNode(graph->common()->Call(desc),
+                    static_cast<int>(arraysize(inputs)), inputs);
+}
+
+
+// Returns the function table of the module as a constant, which refers to
+// the table of an instance only through an embedded object, like
+// {BackingStore}.
+TFNode* TFBuilder::FunctionTable() {
+  if (!function_table) {
+    function_table = graph->HeapConstant(module->function_table);
+  }
+  return function_table;
+}
+
+
+// Returns the import table of the module as a constant, which refers to the
+// imports of an instance only through an embedded object, like
+// {FunctionTable}.
+TFNode* TFBuilder::ImportTable() {
+  if (!import_table) {
+    import_table = graph->HeapConstant(module->import_table);
+  }
+  return import_table;
 }
 
 
+// Converts the WASM value {node} of {type} to a JS value. Integral float
+// values are tagged as small integers where possible, instead of allocating
+// a heap number for them.
 TFNode* TFBuilder::ToJS(TFNode* node, TFNode* context, LocalType type) {
   if (!graph) return nullptr;
   compiler::Graph* g = graph->graph();
@@ -626,19 +801,121 @@ TFNode* TFBuilder::ToJS(TFNode* node, TFNode* context, LocalType type) {
       return node;
     case kAstFloat32:
       node = g->NewNode(graph->machine()->ChangeFloat32ToFloat64(), node);
-      return g->NewNode(simplified.ChangeFloat64ToTagged(), node);
+      return Float64ToJS(node);
     case kAstFloat64:
-      return g->NewNode(simplified.ChangeFloat64ToTagged(), node);
+      return Float64ToJS(node);
     case kAstStmt:
       return graph->UndefinedConstant();
   }
 }
 
 
+TFNode* TFBuilder::Float64ToJS(TFNode* node) {
+  compiler::Graph* g = graph->graph();
+  compiler::MachineOperatorBuilder* machine = graph->machine();
+  compiler::SimplifiedOperatorBuilder simplified(graph->zone());
+
+  // The value is an int32 if it survives the round trip, unless it is -0.
+  TFNode* int_value = g->NewNode(machine->ChangeFloat64ToInt32(), node);
+  TFNode* is_int = g->NewNode(
+      machine->Float64Equal(),
+      g->NewNode(machine->ChangeInt32ToFloat64(), int_value), node);
+  TFNode* is_not_minus_zero = g->NewNode(
+      machine->Word32Or(),
+      g->NewNode(machine->Word32Equal(),
+                 g->NewNode(machine->Word32Equal(), int_value,
+                            graph->Int32Constant(0)),
+                 graph->Int32Constant(0)),
+      g->NewNode(machine->Int32LessThanOrEqual(), graph->Int32Constant(0),
+                 g->NewNode(machine->Float64ExtractHighWord32(), node)));
+  TFNode* branch = g->NewNode(
+      graph->common()->Branch(compiler::BranchHint::kTrue),
+      g->NewNode(machine->Word32And(), is_int, is_not_minus_zero), *control);
+  TFNode* if_int = g->NewNode(graph->common()->IfTrue(), branch);
+  TFNode* if_number = g->NewNode(graph->common()->IfFalse(), branch);
+
+  // Only integers outside the small integer range need a heap number.
+  TFNode* smi = g->NewNode(simplified.ChangeInt32ToTagged(), int_value);
+  TFNode* number = g->NewNode(simplified.ChangeFloat64ToTagged(), node);
+  *control = g->NewNode(graph->common()->Merge(2), if_int, if_number);
+  return g->NewNode(graph->common()->Phi(compiler::kMachAnyTagged, 2), smi,
+                    number, *control);
+}
+
+
+// Converts the JS value {node} to a WASM value of {type}. Small integers and
+// heap numbers are converted inline; all other values take a deferred call
+// to ToNumber. Note that this neither reads nor writes the buffer returned
+// by {Buffer}, which callers use for call arguments.
 TFNode* TFBuilder::FromJS(TFNode* node, TFNode* context, LocalType type) {
   if (!graph) return nullptr;
+  if (type == kAstInt64 || type == kAstStmt) {
+    return FromFloat64(BuildJavaScriptToNumber(node, context), type);
+  }
+  compiler::Graph* g = graph->graph();
+  compiler::CommonOperatorBuilder* common = graph->common();
+  compiler::MachineOperatorBuilder* machine = graph->machine();
+  TFNode* entry_effect = *effect;
+
+  // Untag small integers.
+  TFNode* is_smi = g->NewNode(
+      machine->WordEqual(),
+      g->NewNode(machine->WordAnd(), node, graph->IntPtrConstant(kSmiTagMask)),
+      graph->IntPtrConstant(kSmiTag));
+  TFNode* branch =
+      g->NewNode(common->Branch(compiler::BranchHint::kTrue), is_smi, *control);
+  TFNode* if_smi = g->NewNode(common->IfTrue(), branch);
+  TFNode* if_heap_object = g->NewNode(common->IfFalse(), branch);
+  TFNode* smi_value =
+      g->NewNode(machine->WordSar(), node,
+                 graph->IntPtrConstant(kSmiShiftSize + kSmiTagSize));
+  if (machine->Is64()) {
+    smi_value = g->NewNode(machine->TruncateInt64ToInt32(), smi_value);
+  }
+  if (type != kAstInt32) {
+    smi_value = FromFloat64(
+        g->NewNode(machine->ChangeInt32ToFloat64(), smi_value), type);
+  }
+
+  // Load the value of heap numbers.
+  TFNode* map = g->NewNode(
+      machine->Load(compiler::kMachAnyTagged), node,
+      graph->IntPtrConstant(HeapObject::kMapOffset - kHeapObjectTag),
+      entry_effect, if_heap_object);
+  TFNode* is_heap_number =
+      g->NewNode(machine->WordEqual(), map,
+                 graph->HeapConstant(
+                     graph->isolate()->factory()->heap_number_map()));
+  branch = g->NewNode(common->Branch(compiler::BranchHint::kTrue),
+                      is_heap_number, if_heap_object);
+  TFNode* if_heap_number = g->NewNode(common->IfTrue(), branch);
+  TFNode* if_other = g->NewNode(common->IfFalse(), branch);
+  TFNode* number_load = g->NewNode(
+      machine->Load(compiler::kMachFloat64), node,
+      graph->IntPtrConstant(HeapNumber::kValueOffset - kHeapObjectTag), map,
+      if_heap_number);
+  TFNode* number_value = FromFloat64(number_load, type);
+
+  // Convert all other values with a call to ToNumber.
+  *control = if_other;
+  *effect = map;
+  TFNode* other_value =
+      FromFloat64(BuildJavaScriptToNumber(node, context), type);
+
+  TFNode* merge =
+      g->NewNode(common->Merge(3), if_smi, if_heap_number, *control);
+  *effect = g->NewNode(common->EffectPhi(3), entry_effect, number_load,
+                       *effect, merge);
+  *control = merge;
+  return g->NewNode(common->Phi(MachineTypeFor(type), 3), smi_value,
+                    number_value, other_value, merge);
+}
+
+
+// Calls ToNumber on the JS value {node}, and returns the result as a
+// float64.
+TFNode* TFBuilder::BuildJavaScriptToNumber(TFNode* node, TFNode* context) {
   compiler::Graph* g = graph->graph();
-  // Do a JavaScript ToNumber.
   TFNode* num = g->NewNode(graph->javascript()->ToNumber(), node, context,
                            graph->EmptyFrameState(), *effect, *control);
   *control = num;
@@ -646,8 +923,14 @@ TFNode* TFBuilder::FromJS(TFNode* node, TFNode* context, LocalType type) {
 
   // Change representation.
   compiler::SimplifiedOperatorBuilder simplified(graph->zone());
-  num = g->NewNode(simplified.ChangeTaggedToFloat64(), num);
+  return g->NewNode(simplified.ChangeTaggedToFloat64(), num);
+}
+
 
+// Converts the float64 {num} to a WASM value of {type} like JavaScript
+// would, e.g. truncating it modulo 2^32 for int32.
+TFNode* TFBuilder::FromFloat64(TFNode* num, LocalType type) {
+  compiler::Graph* g = graph->graph();
   switch (type) {
     case kAstInt32: {
       num = g->NewNode(graph->machine()->TruncateFloat64ToInt32(
@@ -681,8 +964,9 @@ void TFBuilder::BuildJSToWasmWrapper(Handle<Code> wasm_code, FunctionSig* sig) {
   CHECK_NOT_NULL(graph);
 
   int params = static_cast<int>(sig->parameter_count());
+  int implicit = module->UsesMemBaseParam() ? 1 : 0;
   compiler::Graph* g = graph->graph();
-  int count = params + 3;
+  int count = params + implicit + 3;
   TFNode** args = Buffer(count);
 
   // Build the start and the JS parameter nodes.
@@ -694,13 +978,37 @@ void TFBuilder::BuildJSToWasmWrapper(Handle<Code> wasm_code, FunctionSig* sig) {
       g->NewNode(graph->common()->Parameter(params + 1, "context"), start);
 
   int pos = 0;
-  args[pos++] = Constant(wasm_code);
+  if (wasm_code.is_null()) {
+    // Call the WASM code of the function the wrapper is installed on, which
+    // is the code of its shared function info, so that the wrapper can be
+    // shared by all functions of the same signature.
+    compiler::MachineOperatorBuilder* machine = graph->machine();
+    TFNode* closure = g->NewNode(
+        graph->common()->Parameter(
+            compiler::Linkage::kJSFunctionCallClosureParamIndex, "%closure"),
+        start);
+    TFNode* shared = g->NewNode(
+        machine->Load(compiler::kMachAnyTagged), closure,
+        graph->IntPtrConstant(JSFunction::kSharedFunctionInfoOffset -
+                              kHeapObjectTag),
+        *effect, *control);
+    TFNode* code = g->NewNode(
+        machine->Load(compiler::kMachAnyTagged), shared,
+        graph->IntPtrConstant(SharedFunctionInfo::kCodeOffset -
+                              kHeapObjectTag),
+        shared, *control);
+    *effect = code;
+    args[pos++] = code;
+  } else {
+    args[pos++] = Constant(wasm_code);
+  }
 
   // Convert JS parameters to WASM numbers.
   for (int i = 0; i < params; i++) {
     TFNode* param = g->NewNode(graph->common()->Parameter(i), start);
     args[pos++] = FromJS(param, context, sig->GetParam(i));
   }
+  if (implicit > 0) args[pos++] = MemBuffer();
 
   args[pos++] = *effect;
   args[pos++] = *control;
@@ -709,33 +1017,56 @@ void TFBuilder::BuildJSToWasmWrapper(Handle<Code> wasm_code, FunctionSig* sig) {
   compiler::CallDescriptor* desc =
       module->GetWasmCallDescriptor(graph->zone(), sig);
   TFNode* call = g->NewNode(graph->common()->Call(desc), count, args);
+  *effect = call;
   TFNode* jsval = ToJS(call, context,
                        sig->return_count() == 0 ? kAstStmt : sig->GetReturn());
-  TFNode* ret = g->NewNode(graph->common()->Return(), jsval, call, start);
+  TFNode* ret =
+      g->NewNode(graph->common()->Return(), jsval, *effect, *control);
 
   MergeControlToEnd(graph, ret);
 }
 
 
+// Builds a wrapper that calls {function}, or the JSFunction passed as an
+// implicit first parameter if {function} is null, so that the wrapper can be
+// shared by all imports of the same signature. A shared wrapper calls the
+// function directly if {arity_match} is set, i.e. if it declares as many
+// parameters as {sig}.
 void TFBuilder::BuildWasmToJSWrapper(Handle<JSFunction> function,
-                                     FunctionSig* sig) {
+                                     FunctionSig* sig, bool arity_match) {
   CHECK_NOT_NULL(graph);
-  int js_count = function->shared()->internal_formal_parameter_count();
   int wasm_count = static_cast<int>(sig->parameter_count());
+  int implicit = function.is_null() ? 1 : 0;
+  if (!function.is_null()) {
+    int js_count = function->shared()->internal_formal_parameter_count();
+    arity_match = js_count == wasm_count;
+  }
 
   // Build the start and the parameter nodes.
   Isolate* isolate = graph->isolate();
   compiler::Graph* g = graph->graph();
   compiler::CallDescriptor* desc;
-  TFNode* start = Start(wasm_count + 3);
+  TFNode* start = Start(wasm_count + implicit + 3);
   *effect = start;
   *control = start;
-  // JS context is the last parameter.
-  TFNode* context = Constant(Handle<Context>(function->context(), isolate));
+  TFNode* callee;
+  TFNode* context;
+  if (function.is_null()) {
+    // Call the function in the context it was created in.
+    callee = g->NewNode(graph->common()->Parameter(0), start);
+    context = g->NewNode(
+        graph->machine()->Load(compiler::kMachAnyTagged), callee,
+        graph->IntPtrConstant(JSFunction::kContextOffset - kHeapObjectTag),
+        *effect, *control);
+    *effect = context;
+  } else {
+    callee = graph->Constant(function);
+    context = Constant(Handle<Context>(function->context(), isolate));
+  }
   TFNode** args = Buffer(wasm_count + 6);
 
   int pos = 0;
-  if (js_count == wasm_count) {
+  if (arity_match) {
     // exact arity match, just call the function directly.
     desc = compiler::Linkage::GetJSCallDescriptor(
         g->zone(), false, 1 + wasm_count, compiler::CallDescriptor::kNoFlags);
@@ -752,12 +1083,12 @@ void TFBuilder::BuildWasmToJSWrapper(Handle<JSFunction> function,
         compiler::CallDescriptor::kNoFlags);
   }
 
-  args[pos++] = graph->Constant(function);   // JS function.
+  args[pos++] = callee;                      // JS function.
   args[pos++] = graph->UndefinedConstant();  // JS receiver.
 
   // Convert WASM numbers to JS values.
   for (int i = 0; i < wasm_count; i++) {
-    TFNode* param = g->NewNode(graph->common()->Parameter(i), start);
+    TFNode* param = g->NewNode(graph->common()->Parameter(implicit + i), start);
     args[pos++] = ToJS(param, context, sig->GetParam(i));
   }
 
@@ -767,38 +1098,215 @@ void TFBuilder::BuildWasmToJSWrapper(Handle<JSFunction> function,
   args[pos++] = *control;
 
   TFNode* call = g->NewNode(graph->common()->Call(desc), pos, args);
+  *effect = call;
 
   // Convert the return value back.
   TFNode* val = FromJS(call, context,
                        sig->return_count() == 0 ? kAstStmt : sig->GetReturn());
-  TFNode* ret = g->NewNode(graph->common()->Return(), val, call, start);
+  TFNode* ret = g->NewNode(graph->common()->Return(), val, *effect, *control);
 
   MergeControlToEnd(graph, ret);
 }
 
 
+void TFBuilder::BuildLazyCompileStub(Handle<JSFunction> compile_function,
+                                     FunctionSig* sig) {
+  CHECK_NOT_NULL(graph);
+  int wasm_count = static_cast<int>(sig->parameter_count());
+
+  // Build the start and the parameter nodes.
+  Isolate* isolate = graph->isolate();
+  compiler::Graph* g = graph->graph();
+  TFNode* start = Start(wasm_count + 3);
+  *effect = start;
+  *control = start;
+  TFNode* context =
+      Constant(Handle<Context>(compile_function->context(), isolate));
+  TFNode** args = Buffer(wasm_count + 6);
+
+  // Call the compile function without arguments through the
+  // CallFunctionStub. It returns the code object of the actual callee.
+  CallFunctionFlags flags = NO_CALL_FUNCTION_FLAGS;
+  CallFunctionStub stub(isolate, 0, flags);
+  CallInterfaceDescriptor d = stub.GetCallInterfaceDescriptor();
+  compiler::CallDescriptor* desc = compiler::Linkage::GetStubCallDescriptor(
+      isolate, g->zone(), d, 1, compiler::CallDescriptor::kNoFlags);
+
+  int pos = 0;
+  args[pos++] = graph->HeapConstant(stub.GetCode());  // CallFunctionStub
+  args[pos++] = graph->Constant(compile_function);    // JS function.
+  args[pos++] = graph->UndefinedConstant();           // JS receiver.
+  args[pos++] = context;
+  args[pos++] = *effect;
+  args[pos++] = *control;
+  TFNode* code = g->NewNode(graph->common()->Call(desc), pos, args);
+
+  // Forward the WASM parameters, including the start of linear memory, to
+  // the callee.
+  int implicit = module->UsesMemBaseParam() ? 1 : 0;
+  pos = 0;
+  args[pos++] = code;
+  for (int i = 0; i < wasm_count + implicit; i++) {
+    args[pos++] = g->NewNode(graph->common()->Parameter(i), start);
+  }
+  args[pos++] = code;
+  args[pos++] = *control;
+
+  desc = module->GetWasmCallDescriptor(g->zone(), sig);
+  TFNode* call = g->NewNode(graph->common()->Call(desc), pos, args);
+  TFNode* val = sig->return_count() == 0 ? graph->Int32Constant(0) : call;
+  TFNode* ret = g->NewNode(graph->common()->Return(), val, call, start);
+
+  MergeControlToEnd(graph, ret);
+}
+
 TFNode* TFBuilder::MemBuffer() {
-  if (!mem_buffer) mem_buffer = graph->IntPtrConstant(module->mem_start);
+  if (!mem_buffer) {
+    if (module->mem_buffer.is_null()) {
+      mem_buffer = graph->IntPtrConstant(module->mem_start);
+    } else {
+      mem_buffer = BackingStore(module->mem_buffer);
+    }
+  }
   return mem_buffer;
 }
 
 
+// Binds the start of linear memory to the implicit parameter {index}, for
+// functions that receive it as a parameter instead of loading it.
+void TFBuilder::MemBaseParam(unsigned index) {
+  if (!graph) return;
+  compiler::Graph* g = graph->graph();
+  mem_buffer = g->NewNode(graph->common()->Parameter(index), g->start());
+}
+
+
 TFNode* TFBuilder::MemSize() {
+  if (HasGrowableMemory()) {
+    // The size changes whenever the memory grows, which any call may do, so
+    // it is loaded from the memory buffer at each access. It is stored there
+    // as a small integer.
+    compiler::Graph* g = graph->graph();
+    TFNode* length = g->NewNode(
+        graph->machine()->Load(compiler::kMachAnyTagged),
+        graph->HeapConstant(module->mem_buffer),
+        graph->IntPtrConstant(JSArrayBuffer::kByteLengthOffset -
+                              kHeapObjectTag),
+        *effect, *control);
+    *effect = length;
+    return g->NewNode(graph->machine()->WordSar(), length,
+                      graph->IntPtrConstant(kSmiShiftSize + kSmiTagSize));
+  }
   if (!mem_size)
     mem_size = graph->IntPtrConstant(module->mem_end - module->mem_start);
   return mem_size;
 }
 
 
+// Returns the bound below which an index must be for an access of {type} to
+// lie entirely within the memory, which is the size of the memory less all
+// but one byte of the access, or 0 if the access does not fit at all.
+TFNode* TFBuilder::MemLimit(MemType type) {
+  uint32_t extra = WasmOpcodes::MemSize(type) - 1;
+  if (!HasGrowableMemory()) {
+    uintptr_t size = module->mem_end - module->mem_start;
+    return graph->IntPtrConstant(size < extra ? 0 : size - extra);
+  }
+  TFNode* size = MemorySize();
+  if (extra == 0) return size;
+  // Clamps at 0 without a branch: the mask is 0 if the memory is smaller
+  // than {extra}, and all ones otherwise.
+  compiler::Graph* g = graph->graph();
+  compiler::MachineOperatorBuilder* m = graph->machine();
+  TFNode* extra_node = graph->Int32Constant(extra);
+  TFNode* mask = g->NewNode(
+      m->Int32Sub(), g->NewNode(m->Uint32LessThan(), size, extra_node),
+      graph->Int32Constant(1));
+  TFNode* limit = g->NewNode(m->Int32Sub(), size, extra_node);
+  return g->NewNode(m->Word32And(), limit, mask);
+}
+
+
+// Only growable memory that compiled code accesses through its buffer can
+// grow; the size of any other memory is a constant.
+bool TFBuilder::HasGrowableMemory() {
+  return module && !module->mem_buffer.is_null() && module->module &&
+         module->module->mem_growable;
+}
+
+
+TFNode* TFBuilder::MemorySize() {
+  if (!graph) return nullptr;
+  TFNode* size = MemSize();
+  if (graph->machine()->Is64()) {
+    size = graph->graph()->NewNode(graph->machine()->TruncateInt64ToInt32(),
+                                   size);
+  }
+  return size;
+}
+
+
+TFNode* TFBuilder::GrowMemory(TFNode* delta) {
+  if (!graph) return nullptr;
+  if (!HasGrowableMemory()) return graph->Int32Constant(-1);
+  compiler::Graph* g = graph->graph();
+
+  // Growing commits more of the reservation of the memory, which does not
+  // allocate on the heap, so a plain C call suffices.
+  compiler::MachineSignature::Builder builder(g->zone(), 1, 2);
+  builder.AddReturn(compiler::kMachInt32);
+  builder.AddParam(compiler::kMachPtr);
+  builder.AddParam(compiler::kMachUint32);
+  compiler::CallDescriptor* desc =
+      compiler::Linkage::GetSimplifiedCDescriptor(g->zone(), builder.Build());
+  ApiFunction grow_memory(FUNCTION_ADDR(&GrowMemoryBuffer));
+  TFNode* function = graph->ExternalConstant(ExternalReference(
+      &grow_memory, ExternalReference::BUILTIN_CALL, graph->isolate()));
+  TFNode* call =
+      g->NewNode(graph->common()->Call(desc), function,
+                 graph->HeapConstant(module->mem_buffer), delta, *effect,
+                 *control);
+  *effect = call;
+  return call;
+}
+
+
+TFNode* TFBuilder::GlobalsArea() {
+  if (!globals_area) {
+    if (module->globals_buffer.is_null()) {
+      globals_area = graph->IntPtrConstant(module->globals_area);
+    } else {
+      globals_area = BackingStore(module->globals_buffer);
+    }
+  }
+  return globals_area;
+}
+
+
+// Loads the backing store address of {buffer} once at the start of the
+// function, so that the code refers to the memory of an instance only
+// through an embedded object, which can be replaced when the code is copied
+// for another instance.
+TFNode* TFBuilder::BackingStore(Handle<JSArrayBuffer> buffer) {
+  compiler::Graph* g = graph->graph();
+  const compiler::Operator* op = graph->machine()->Load(compiler::kMachPtr);
+  return g->NewNode(
+      op, graph->HeapConstant(buffer),
+      graph->IntPtrConstant(JSArrayBuffer::kBackingStoreOffset -
+                            kHeapObjectTag),
+      g->start(), g->start());
+}
+
+
 TFNode* TFBuilder::LoadGlobal(uint32_t index) {
   if (!graph) return nullptr;
   MemType mem_type = module->GetGlobalType(index);
-  TFNode* addr = graph->IntPtrConstant(
-      module->globals_area + module->module->globals->at(index).offset);
+  TFNode* offset =
+      graph->IntPtrConstant(module->module->globals->at(index).offset);
   const compiler::Operator* op =
       graph->machine()->Load(MachineTypeFor(mem_type));
-  TFNode* node = graph->graph()->NewNode(op, addr, graph->ZeroConstant(),
-                                         *effect, *control);
+  TFNode* node = graph->graph()->NewNode(op, GlobalsArea(), offset, *effect,
+                                         *control);
   *effect = node;
   return node;
 }
@@ -807,12 +1315,12 @@ TFNode* TFBuilder::LoadGlobal(uint32_t index) {
 TFNode* TFBuilder::StoreGlobal(uint32_t index, TFNode* val) {
   if (!graph) return nullptr;
   MemType mem_type = module->GetGlobalType(index);
-  TFNode* addr = graph->IntPtrConstant(
-      module->globals_area + module->module->globals->at(index).offset);
+  TFNode* offset =
+      graph->IntPtrConstant(module->module->globals->at(index).offset);
   const compiler::Operator* op =
       graph->machine()->Store(compiler::StoreRepresentation(
           MachineTypeFor(mem_type), compiler::kNoWriteBarrier));
-  TFNode* node = graph->graph()->NewNode(op, addr, graph->ZeroConstant(), val,
+  TFNode* node = graph->graph()->NewNode(op, GlobalsArea(), offset, val,
                                          *effect, *control);
   *effect = node;
   return node;
@@ -824,8 +1332,8 @@ TFNode* TFBuilder::LoadMem(MemType type, TFNode* index) {
   const compiler::Operator* op =
       graph->machine()->CheckedLoad(MachineTypeFor(type));
   TFNode* mem_buffer = MemBuffer();
-  TFNode* mem_size = MemSize();
-  TFNode* node = graph->graph()->NewNode(op, mem_buffer, index, mem_size,
+  TFNode* limit = MemLimit(type);
+  TFNode* node = graph->graph()->NewNode(op, mem_buffer, index, limit,
                                          *effect, *control);
   *effect = node;
   return node;
@@ -837,8 +1345,8 @@ TFNode* TFBuilder::StoreMem(MemType type, TFNode* index, TFNode* val) {
   const compiler::Operator* op =
       graph->machine()->CheckedStore(MachineTypeFor(type));
   TFNode* mem_buffer = MemBuffer();
-  TFNode* mem_size = MemSize();
-  TFNode* node = graph->graph()->NewNode(op, mem_buffer, index, mem_size, val,
+  TFNode* limit = MemLimit(type);
+  TFNode* node = graph->graph()->NewNode(op, mem_buffer, index, limit, val,
                                          *effect, *control);
   *effect = node;
   return node;
@@ -34,6 +34,9 @@ struct TFBuilder {
   ModuleEnv* module;
   TFNode* mem_buffer;
   TFNode* mem_size;
+  TFNode* globals_area;
+  TFNode* function_table;
+  TFNode* import_table;
   TFNode** control;
   TFNode** effect;
   TFNode** cur_buffer;
@@ -67,6 +70,7 @@ struct TFBuilder {
   TFNode* Int64Constant(int64_t value);
   TFNode* Float32Constant(float value);
   TFNode* Float64Constant(double value);
+  TFNode* ZeroConstant(LocalType type);
   TFNode* Constant(Handle<Object> value);
   TFNode* Binop(WasmOpcode opcode, TFNode* left, TFNode* right);
   TFNode* Unop(WasmOpcode opcode, TFNode* input);
@@ -82,23 +86,35 @@ struct TFBuilder {
   void Return(unsigned count, TFNode** vals);
   void ReturnVoid();
 
-  TFNode* FunctionTableLookup(unsigned index, TFNode* offset) {
-    return nullptr;
-  }
-
   TFNode* CallDirect(uint32_t index, TFNode** args);
-  TFNode* CallIndirect(uint32_t table_index, TFNode** args);
+  TFNode* CallIndirect(uint32_t index, TFNode** args);
+  TFNode* Trap(Handle<String> message, TFNode* effect, TFNode* control);
   void BuildJSToWasmWrapper(Handle<Code> wasm_code, FunctionSig* sig);
-  void BuildWasmToJSWrapper(Handle<JSFunction> function, FunctionSig* sig);
+  void BuildWasmToJSWrapper(Handle<JSFunction> function, FunctionSig* sig,
+                            bool arity_match = false);
+  void BuildLazyCompileStub(Handle<JSFunction> compile_function,
+                            FunctionSig* sig);
   TFNode* ToJS(TFNode* node, TFNode* context, LocalType type);
+  TFNode* Float64ToJS(TFNode* node);
   TFNode* FromJS(TFNode* node, TFNode* context, LocalType type);
+  TFNode* BuildJavaScriptToNumber(TFNode* node, TFNode* context);
+  TFNode* FromFloat64(TFNode* num, LocalType type);
   TFNode* Invert(TFNode* node);
 
   //-----------------------------------------------------------------------
   // Operations that access the mem.
   //-----------------------------------------------------------------------
   TFNode* MemBuffer();
+  void MemBaseParam(unsigned index);
   TFNode* MemSize();
+  TFNode* MemLimit(MemType type);
+  bool HasGrowableMemory();
+  TFNode* MemorySize();
+  TFNode* GrowMemory(TFNode* delta);
+  TFNode* GlobalsArea();
+  TFNode* FunctionTable();
+  TFNode* ImportTable();
+  TFNode* BackingStore(Handle<JSArrayBuffer> buffer);
   TFNode* LoadGlobal(uint32_t index);
   TFNode* StoreGlobal(uint32_t index, TFNode* val);
   TFNode* LoadMem(MemType type, TFNode* index);
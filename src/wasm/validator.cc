@@ -0,0 +1,496 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "src/flags.h"
+
+#include "src/wasm/validator.h"
+#include "src/wasm/wasm-module.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+WasmValidator::WasmValidator(Zone* zone)
+    : stack_(zone), blocks_(zone), last_trees_(zone) {}
+
+
+TreeResult WasmValidator::Validate(FunctionEnv* env, const byte* base,
+                                   const byte* start, const byte* end) {
+  CHECK(end >= start);
+  stack_.clear();
+  blocks_.clear();
+  last_trees_.resize(env->sig->return_count());
+  result_.error_code = kSuccess;
+  result_.val = nullptr;
+  result_.start = start;
+  result_.error_pc = nullptr;
+  result_.error_msg.Reset(nullptr);
+  result_.error_pt = nullptr;
+
+  function_env_ = env;
+  base_ = base;
+  start_ = start;
+  pc_ = start;
+  limit_ = end;
+  reachable_ = true;
+  tree_count_ = 0;
+
+  ValidateFunctionBody();
+
+  if (result_.ok()) {
+    if (reachable_) CheckImplicitReturn();
+    if (tree_count_ == 0) error(start_, "no trees created");
+  }
+  return result_;
+}
+
+
+void WasmValidator::ValidateFunctionBody() {
+  if (pc_ >= limit_) return;  // Nothing to do.
+
+  while (true) {
+    if (!reachable_) return error("unreachable code");
+
+    WasmOpcode opcode = static_cast<WasmOpcode>(*pc_);
+    const WasmOpcodeInfo& info = WasmOpcodes::Info(opcode);
+    int len = 1;
+    if (info.immediate != WasmOpcodeInfo::kVariableImmediate) {
+      len += info.immediate;
+    }
+    switch (info.kind) {
+      case kOpcodeLoadMem:
+      case kOpcodeStoreMem:
+        MemAccessTypeOperand(pc_, info.result_type());
+        if (failed()) return;
+      // Fall through.
+      case kOpcodeSimple:
+        Shift(info.result_type(), info.arity);
+        break;
+      case kOpcodeSpecial:
+        ValidateSpecial(opcode, &len);
+        break;
+      default:
+        return error("Invalid opcode");
+    }
+    if (failed()) return;
+
+    pc_ += len;
+    if (pc_ >= limit_) return;  // End of code reached or exceeded.
+  }
+}
+
+
+void WasmValidator::ValidateSpecial(WasmOpcode opcode, int* len) {
+  switch (opcode) {
+    case kStmtNop:
+      return Leaf(kAstStmt);
+    case kStmtIf:
+      return Shift(kAstStmt, 2);
+    case kStmtIfThen:
+      return Shift(kAstStmt, 3);
+    case kStmtSwitch:
+    case kStmtSwitchNf: {
+      int length = Operand<uint8_t>(pc_);
+      if (failed()) return;
+      blocks_.push_back({false, false});
+      return Shift(kAstStmt, length + 1);
+    }
+    case kStmtBlock:
+    case kStmtLoop: {
+      int length = Operand<uint8_t>(pc_);
+      if (failed()) return;
+      if (length == 0) {
+        // An empty loop never terminates.
+        if (opcode == kStmtLoop) reachable_ = false;
+        return Leaf(kAstStmt);
+      }
+      blocks_.push_back({opcode == kStmtLoop, false});
+      return Shift(kAstStmt, length);
+    }
+    case kStmtContinue: {
+      uint32_t depth = Operand<uint8_t>(pc_);
+      if (failed()) return;
+      if (depth >= blocks_.size()) return error("improperly nested continue");
+      if (!blocks_[blocks_.size() - depth - 1].is_loop) {
+        return error("improper continue to block");
+      }
+      reachable_ = false;
+      return Leaf(kAstStmt);
+    }
+    case kStmtBreak: {
+      uint32_t depth = Operand<uint8_t>(pc_);
+      if (failed()) return;
+      if (depth >= blocks_.size()) return error("improperly nested break");
+      blocks_[blocks_.size() - depth - 1].break_end = true;
+      reachable_ = false;
+      return Leaf(kAstStmt);
+    }
+    case kStmtReturn: {
+      int count = static_cast<int>(function_env_->sig->return_count());
+      if (count == 0) {
+        reachable_ = false;
+        return Leaf(kAstStmt);
+      }
+      return Shift(kAstStmt, count);
+    }
+    case kExprInt8Const:
+      Operand<int8_t>(pc_);
+      return Leaf(kAstInt32);
+    case kExprInt32Const:
+      Operand<int32_t>(pc_);
+      return Leaf(kAstInt32);
+    case kExprInt64Const:
+      Operand<int64_t>(pc_);
+      return Leaf(kAstInt64);
+    case kExprFloat32Const:
+      Operand<float>(pc_);
+      return Leaf(kAstFloat32);
+    case kExprFloat64Const:
+      Operand<double>(pc_);
+      return Leaf(kAstFloat64);
+    case kExprGetLocal: {
+      uint32_t index = LocalIndexOperand(pc_, len);
+      return Leaf(function_env_->GetLocalType(index));
+    }
+    case kExprSetLocal: {
+      uint32_t index = LocalIndexOperand(pc_, len);
+      return Shift(function_env_->GetLocalType(index), 1);
+    }
+    case kExprLoadGlobal: {
+      uint32_t index = GlobalIndexOperand(pc_, len);
+      if (failed()) return;
+      return Leaf(WasmOpcodes::LocalTypeFor(
+          function_env_->module->GetGlobalType(index)));
+    }
+    case kExprStoreGlobal: {
+      uint32_t index = GlobalIndexOperand(pc_, len);
+      if (failed()) return;
+      return Shift(WasmOpcodes::LocalTypeFor(
+                       function_env_->module->GetGlobalType(index)),
+                   1);
+    }
+    case kExprCallFunction:
+    case kExprCallIndirect: {
+      bool indirect = opcode == kExprCallIndirect;
+      FunctionSig* sig = indirect ? SignatureIndexOperand(pc_, len)
+                                  : FunctionSigOperand(pc_, len);
+      if (failed()) return;
+      LocalType type = sig->return_count() == 0 ? kAstStmt : sig->GetReturn();
+      Shift(type, static_cast<int>(sig->parameter_count()) + indirect);
+      if (!stack_.empty() && stack_.back().pc == pc_) stack_.back().sig = sig;
+      return;
+    }
+    case kExprTernary:
+      return Shift(kAstInt32, 3);  // Result type is typeof(x) in {c ? x : y}.
+    case kExprComma:
+      return Shift(kAstInt32, 2);  // Result type is typeof(y) in {x, y}.
+    case kExprMemorySize:
+      return Leaf(kAstInt32);
+    case kExprGrowMemory:
+      return Shift(kAstInt32, 1);
+    default:
+      UNREACHABLE();
+  }
+}
+
+
+void WasmValidator::CheckImplicitReturn() {
+  int retcount = static_cast<int>(last_trees_.size());
+  if (retcount == 0) return;
+  if (tree_count_ < last_trees_.size()) {
+    return error(limit_, nullptr,
+                 "ImplicitReturn expects %d arguments, only %d remain",
+                 retcount, static_cast<int>(tree_count_));
+  }
+  for (int index = 0; index < retcount; index++) {
+    const Value& tree = last_trees_[(tree_count_ - 1 - index) % retcount];
+    LocalType expected = function_env_->sig->GetReturn(index);
+    if (tree.last_type != expected) {
+      return error(
+          limit_, tree.last,
+          "ImplicitReturn[%d] expected type %s, found %s of type %s", index,
+          WasmOpcodes::TypeName(expected),
+          WasmOpcodes::OpcodeName(static_cast<WasmOpcode>(*tree.last)),
+          WasmOpcodes::TypeName(tree.last_type));
+    }
+  }
+}
+
+
+void WasmValidator::Leaf(LocalType type) {
+  Reduce({pc_, type, pc_, type});
+}
+
+
+void WasmValidator::Shift(LocalType type, int count) {
+  if (count == 0) return Leaf(type);
+  Production p;
+  p.pc = pc_;
+  p.type = type;
+  p.count = count;
+  p.index = 0;
+  p.sig = nullptr;
+  p.true_type = kAstStmt;
+  p.true_end = false;
+  stack_.push_back(p);
+}
+
+
+// Passes a finished expression to the production on top of the stack, and
+// the productions that it finishes to the ones below.
+void WasmValidator::Reduce(Value value) {
+  while (!stack_.empty()) {
+    Production* p = &stack_.back();
+    p->index++;
+    p->child = value;
+    Reduce(p);
+    if (failed() || !p->done()) return;
+    value.pc = p->pc;
+    value.type = p->type;
+    if (p->opcode() != kStmtBlock) {
+      value.last = p->pc;
+      value.last_type = p->type;
+    }
+    stack_.pop_back();
+  }
+  if (!last_trees_.empty()) {
+    last_trees_[tree_count_ % last_trees_.size()] = value;
+  }
+  tree_count_++;
+}
+
+
+void WasmValidator::Reduce(Production* p) {
+  WasmOpcode opcode = p->opcode();
+  const WasmOpcodeInfo& info = WasmOpcodes::Info(opcode);
+  if (info.kind != kOpcodeSpecial) {
+    // Simple expressions and memory accesses.
+    return TypeCheckLast(p, info.param_type(p->index - 1));
+  }
+
+  switch (opcode) {
+    case kStmtSwitch:
+    case kStmtSwitchNf:
+      if (p->index == 1) TypeCheckLast(p, kAstInt32);
+      // Every case and the end of the switch can be reached from the key.
+      reachable_ = true;
+      if (p->done()) blocks_.pop_back();
+      break;
+    case kStmtBlock:
+    case kStmtLoop:
+      if (p->done()) {
+        // The end of a block is reached by a break or by falling through,
+        // the end of a loop only by a break.
+        reachable_ = blocks_.back().break_end ||
+                     (reachable_ && opcode == kStmtBlock);
+        blocks_.pop_back();
+      }
+      break;
+    case kStmtIf:
+      if (p->index == 1) TypeCheckLast(p, kAstInt32);
+      // The true branch and the end of the if can be reached from the
+      // condition.
+      reachable_ = true;
+      break;
+    case kStmtIfThen:
+    case kExprTernary:
+      if (p->index == 1) {
+        TypeCheckLast(p, kAstInt32);
+      } else if (p->index == 2) {
+        if (opcode == kExprTernary && p->child.type == kAstStmt) {
+          return error(p->pc, p->child.pc,
+                       "%s[%d] expected expression, found %s statement",
+                       WasmOpcodes::OpcodeName(opcode), p->index - 1,
+                       WasmOpcodes::OpcodeName(
+                           static_cast<WasmOpcode>(*p->child.pc)));
+        }
+        p->true_type = p->child.type;
+        p->true_end = reachable_;
+      } else {
+        if (opcode == kExprTernary) {
+          TypeCheckLast(p, p->true_type);
+          p->type = p->true_type;
+        }
+        reachable_ = reachable_ || p->true_end;
+        break;
+      }
+      // Both branches can be reached from the condition.
+      reachable_ = true;
+      break;
+    case kStmtReturn:
+      TypeCheckLast(p, function_env_->sig->GetReturn(p->index - 1));
+      if (p->done()) reachable_ = false;
+      break;
+    case kExprSetLocal:
+      if (p->child.type != p->type) {
+        error(p->pc, p->child.pc, "Typecheck failed in SetLocal");
+      }
+      break;
+    case kExprStoreGlobal:
+      if (p->child.type != p->type) {
+        error(p->pc, p->child.pc, "Typecheck failed in StoreGlobal");
+      }
+      break;
+    case kExprCallFunction:
+      TypeCheckLast(p, p->sig->GetParam(p->index - 1));
+      break;
+    case kExprCallIndirect:
+      if (p->index == 1) {
+        TypeCheckLast(p, kAstInt32);  // key into the function table.
+      } else {
+        TypeCheckLast(p, p->sig->GetParam(p->index - 2));
+      }
+      break;
+    case kExprComma:
+      // The type of the comma operator is the type of the last expression.
+      if (p->done()) p->type = p->child.type;
+      break;
+    case kExprGrowMemory:
+      TypeCheckLast(p, kAstInt32);
+      break;
+    default:
+      break;
+  }
+}
+
+
+void WasmValidator::TypeCheckLast(Production* p, LocalType expected) {
+  if (p->child.type != expected) {
+    error(p->pc, p->child.pc, "%s[%d] expected type %s, found %s of type %s",
+          WasmOpcodes::OpcodeName(p->opcode()), p->index - 1,
+          WasmOpcodes::TypeName(expected),
+          WasmOpcodes::OpcodeName(static_cast<WasmOpcode>(*p->child.pc)),
+          WasmOpcodes::TypeName(p->child.type));
+  }
+}
+
+
+// Load an operand at [pc + 1].
+template <typename V>
+V WasmValidator::Operand(const byte* pc) {
+  if ((limit_ - pc) < static_cast<int>(1 + sizeof(V))) {
+    const char* msg = "Expected operand following opcode";
+    switch (sizeof(V)) {
+      case 1:
+        msg = "Expected 1-byte operand following opcode";
+        break;
+      case 2:
+        msg = "Expected 2-byte operand following opcode";
+        break;
+      case 4:
+        msg = "Expected 4-byte operand following opcode";
+        break;
+      default:
+        break;
+    }
+    error(pc, msg);
+    return -1;
+  }
+  return *reinterpret_cast<const V*>(pc + 1);
+}
+
+
+uint32_t WasmValidator::UnsignedLEB128Operand(const byte* pc, int* length) {
+  uint32_t result = 0;
+  const byte* ptr = pc + 1;
+  const byte* end = pc + 6;  // maximum 5 bytes.
+  if (end > limit_) end = limit_;
+  int shift = 0;
+  byte b = 0;
+  while (ptr < end) {
+    b = *ptr++;
+    result = result | ((b & 0x7F) << shift);
+    if ((b & 0x80) == 0) break;
+    shift += 7;
+  }
+  if (ptr == end && (b & 0x80)) error(pc, "invalid LEB128 varint");
+  DCHECK_LE(ptr - pc, 6);
+  *length = static_cast<int>(ptr - pc);
+  if (*length == 1) error(pc, "expected LEB128 varint");
+  return result;
+}
+
+
+uint32_t WasmValidator::LocalIndexOperand(const byte* pc, int* length) {
+  uint32_t index = UnsignedLEB128Operand(pc, length);
+  if (!function_env_->IsValidLocal(index)) {
+    error(pc, "invalid local variable index");
+  }
+  return index;
+}
+
+
+uint32_t WasmValidator::GlobalIndexOperand(const byte* pc, int* length) {
+  uint32_t index = UnsignedLEB128Operand(pc, length);
+  if (function_env_->module == nullptr ||
+      !function_env_->module->IsValidGlobal(index)) {
+    error(pc, "invalid global variable index");
+  }
+  return index;
+}
+
+
+FunctionSig* WasmValidator::FunctionSigOperand(const byte* pc, int* length) {
+  uint32_t index = UnsignedLEB128Operand(pc, length);
+  if (function_env_->module == nullptr ||
+      !function_env_->module->IsValidFunction(index)) {
+    error(pc, "invalid function index");
+    return nullptr;
+  }
+  FunctionSig* sig = function_env_->module->GetFunctionSignature(index);
+  if (!sig) error(pc, "invalid function index");
+  return sig;
+}
+
+
+FunctionSig* WasmValidator::SignatureIndexOperand(const byte* pc,
+                                                  int* length) {
+  uint32_t index = UnsignedLEB128Operand(pc, length);
+  FunctionSig* sig = function_env_->module == nullptr
+                         ? nullptr
+                         : function_env_->module->GetSignature(index);
+  if (!sig) error(pc, "invalid signature index");
+  return sig;
+}
+
+
+void WasmValidator::MemAccessTypeOperand(const byte* pc, LocalType type) {
+  byte operand = Operand<uint8_t>(pc);
+  if (failed() || type == kAstFloat32 || type == kAstFloat64) return;
+  if (operand &
+      ~(MemoryAccess::SignExtendField::kMask |
+        MemoryAccess::IntWidthField::kMask)) {
+    return error(pc, "unrecognized bits in memory access operand");
+  }
+  if (MemoryAccess::IntWidthField::decode(operand) == MemoryAccess::kInt64 &&
+      type != kAstInt64) {
+    error(pc, "invalid width for int memory access");
+  }
+}
+
+
+void WasmValidator::error(const byte* pc, const byte* pt, const char* format,
+                          ...) {
+  limit_ = start_;  // terminates the validation loop
+  if (result_.error_code == kSuccess) {
+#if DEBUG
+    if (FLAG_wasm_break_on_decoder_error) {
+      base::OS::DebugBreak();
+    }
+#endif
+    result_.error_code = kError;  // TODO(titzer): better error code
+    const int kMaxErrorMsg = 256;
+    char* buffer = new char[kMaxErrorMsg];
+    va_list arguments;
+    va_start(arguments, format);
+    base::OS::VSNPrintF(buffer, kMaxErrorMsg - 1, format, arguments);
+    va_end(arguments);
+    result_.error_msg.Reset(buffer);
+    result_.error_pc = pc;
+    result_.error_pt = pt;
+  }
+}
+}
+}
+}
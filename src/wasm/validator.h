@@ -0,0 +1,109 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef V8_WASM_VALIDATOR_H_
+#define V8_WASM_VALIDATOR_H_
+
+#include "src/zone-containers.h"
+
+#include "src/wasm/decoder.h"
+#include "src/wasm/wasm-opcodes.h"
+#include "src/wasm/wasm-result.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+// Validates function bodies by the same rules as the decoder, without
+// building trees or a graph. Instead of trees, it keeps a stack with an
+// entry for each unfinished expression and a stack with an entry for each
+// enclosing block, so its memory is proportional to the nesting depth. The
+// stacks are reused across calls to {Validate}, so validating the functions
+// of a module only allocates when the nesting depth exceeds that of all the
+// functions validated before.
+class WasmValidator {
+ public:
+  explicit WasmValidator(Zone* zone);
+
+  // Validates the body of a function in [{start}, {end}). The result has no
+  // value.
+  TreeResult Validate(FunctionEnv* env, const byte* base, const byte* start,
+                      const byte* end);
+
+ private:
+  // A validated expression or statement.
+  struct Value {
+    const byte* pc;    // the start of the expression.
+    LocalType type;    // the type of the expression.
+    const byte* last;  // the expression itself, or for a block the last
+                       // expression in the block, for implicit returns.
+    LocalType last_type;
+  };
+
+  // An expression or statement whose children are being validated.
+  struct Production {
+    const byte* pc;       // the start of the expression.
+    LocalType type;       // the type of the expression.
+    int count;            // the number of children.
+    int index;            // the number of children validated so far.
+    Value child;          // the last child validated.
+    FunctionSig* sig;     // for calls, the signature of the callee.
+    LocalType true_type;  // for ternaries, the type of the true expression.
+    bool true_end;        // for ifs and ternaries, whether the end of the
+                          // true branch is reachable.
+
+    WasmOpcode opcode() const { return static_cast<WasmOpcode>(*pc); }
+    bool done() const { return index >= count; }
+  };
+
+  // An enclosing block, loop, or switch, the target of breaks.
+  struct Block {
+    bool is_loop;    // whether the block is a loop, the target of continues.
+    bool break_end;  // whether a break reaches the end of the block.
+  };
+
+  ZoneVector<Production> stack_;
+  ZoneVector<Block> blocks_;
+  ZoneVector<Value> last_trees_;  // the last top-level trees validated, one
+                                  // for each implicitly returned value.
+
+  FunctionEnv* function_env_;
+  const byte* base_;
+  const byte* start_;
+  const byte* pc_;
+  const byte* limit_;
+  TreeResult result_;
+
+  bool reachable_;     // whether the current pc is reachable.
+  size_t tree_count_;  // the number of top-level trees validated.
+
+  void ValidateFunctionBody();
+  void ValidateSpecial(WasmOpcode opcode, int* len);
+  void CheckImplicitReturn();
+
+  void Leaf(LocalType type);
+  void Shift(LocalType type, int count);
+  void Reduce(Value value);
+  void Reduce(Production* p);
+  void TypeCheckLast(Production* p, LocalType expected);
+
+  template <typename V>
+  V Operand(const byte* pc);
+  uint32_t UnsignedLEB128Operand(const byte* pc, int* length);
+  uint32_t LocalIndexOperand(const byte* pc, int* length);
+  uint32_t GlobalIndexOperand(const byte* pc, int* length);
+  FunctionSig* FunctionSigOperand(const byte* pc, int* length);
+  FunctionSig* SignatureIndexOperand(const byte* pc, int* length);
+  void MemAccessTypeOperand(const byte* pc, LocalType type);
+
+  bool failed() const { return result_.failed(); }
+  void error(const char* msg) { error(pc_, nullptr, msg); }
+  void error(const byte* pc, const char* msg) { error(pc, nullptr, msg); }
+  void error(const byte* pc, const byte* pt, const char* format, ...);
+};
+}
+}
+}
+
+#endif  // V8_WASM_VALIDATOR_H_
@@ -9,10 +9,12 @@
 #include "src/factory.h"
 #include "src/api.h"
 #include "src/api-natives.h"
+#include "src/base/smart-pointers.h"
 
 #include "src/wasm/wasm-js.h"
 #include "src/wasm/wasm-module.h"
 #include "src/wasm/wasm-result.h"
+#include "src/wasm/wasm-wrapper.h"
 
 typedef uint8_t byte;
 
@@ -27,27 +29,76 @@ struct RawBuffer {
   size_t size() { return static_cast<size_t>(end - start); }
 };
 
+// Returns the bytes of argument 0 in place, without copying the bytes or
+// externalizing the buffer. The argument may be an ArrayBuffer or a view into
+// one, such as a Uint8Array, and the bytes may be narrowed further by an
+// optional offset and length in arguments {range_index} and
+// {range_index + 1}. Backing stores are never moved by the GC, and {args}
+// keeps the buffer alive, so the bytes stay valid until JavaScript runs.
+// Anything that outlives the call, such as a compiled module, or that runs
+// JavaScript, such as instantiation, copies the bytes.
 RawBuffer GetRawBufferArgument(
-    ErrorThrower& thrower, const v8::FunctionCallbackInfo<v8::Value>& args) {
-  if (args.Length() < 1 || !args[0]->IsArrayBuffer()) {
-    thrower.Error("Argument 0 must be an array buffer");
+    ErrorThrower& thrower, const v8::FunctionCallbackInfo<v8::Value>& args,
+    int range_index = 1) {
+  Local<ArrayBuffer> buffer;
+  size_t offset = 0;
+  size_t length = 0;
+  if (args.Length() > 0 && args[0]->IsArrayBuffer()) {
+    buffer = Local<ArrayBuffer>::Cast(args[0]);
+    length = buffer->ByteLength();
+  } else if (args.Length() > 0 && args[0]->IsArrayBufferView()) {
+    Local<ArrayBufferView> view = Local<ArrayBufferView>::Cast(args[0]);
+    buffer = view->Buffer();
+    offset = view->ByteOffset();
+    length = view->ByteLength();
+  } else {
+    thrower.Error("Argument 0 must be an array buffer or a view");
     return {nullptr, nullptr};
   }
-  Local<ArrayBuffer> buffer = Local<ArrayBuffer>::Cast(args[0]);
-  ArrayBuffer::Contents contents =
-      buffer->IsExternal() ? buffer->GetContents() : buffer->Externalize();
 
-  // TODO(titzer): allow offsets into buffers, views, etc.
+  // Narrow the bytes to the optional offset and length.
+  if (args.Length() > range_index && !args[range_index]->IsUndefined()) {
+    if (!args[range_index]->IsUint32()) {
+      thrower.Error("Argument %d must be a non-negative integer offset",
+                    range_index);
+      return {nullptr, nullptr};
+    }
+    uint32_t skip = Local<Uint32>::Cast(args[range_index])->Value();
+    if (skip > length) {
+      thrower.Error("Offset %u is out of bounds", skip);
+      return {nullptr, nullptr};
+    }
+    offset += skip;
+    length -= skip;
+  }
+  int length_index = range_index + 1;
+  if (args.Length() > length_index && !args[length_index]->IsUndefined()) {
+    if (!args[length_index]->IsUint32()) {
+      thrower.Error("Argument %d must be a non-negative integer length",
+                    length_index);
+      return {nullptr, nullptr};
+    }
+    uint32_t size = Local<Uint32>::Cast(args[length_index])->Value();
+    if (size > length) {
+      thrower.Error("Length %u is out of bounds", size);
+      return {nullptr, nullptr};
+    }
+    length = size;
+  }
 
+  // Unlike Externalize(), GetContents() leaves the backing store owned by
+  // the buffer. A neutered buffer has no backing store.
+  ArrayBuffer::Contents contents = buffer->GetContents();
   const byte* start = reinterpret_cast<const byte*>(contents.Data());
-  const byte* end = start + contents.ByteLength();
-
   if (start == nullptr) {
     thrower.Error("ArrayBuffer argument is empty");
+    return {nullptr, nullptr};
   }
-  return {start, end};
+  start += offset;
+  return {start, start + length};
 }
 
+
 void VerifyModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
   HandleScope scope(args.GetIsolate());
   i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
@@ -56,9 +107,14 @@ void VerifyModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
   RawBuffer buffer = GetRawBufferArgument(thrower, args);
   if (thrower.error()) return;
 
-  i::Zone zone;
-  internal::wasm::ModuleResult result = internal::wasm::DecodeWasmModule(
-      isolate, &zone, buffer.start, buffer.end);
+  internal::wasm::ModuleResult result;
+  {
+    // Verification reads the bytes in place and shouldn't allocate.
+    i::DisallowHeapAllocation no_allocation;
+    i::Zone zone;
+    result = internal::wasm::DecodeWasmModule(isolate, &zone, buffer.start,
+                                              buffer.end);
+  }
 
   if (result.failed()) {
     thrower.Failed("", result);
@@ -73,7 +129,6 @@ void VerifyFunction(const v8::FunctionCallbackInfo<v8::Value>& args) {
   i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
   ErrorThrower thrower(isolate, "WASM.verifyFunction()");
 
-  // TODO(titzer): no need to externalize to get the bytes for verification.
   RawBuffer buffer = GetRawBufferArgument(thrower, args);
   if (thrower.error()) return;
 
@@ -119,10 +174,10 @@ void CompileRun(const v8::FunctionCallbackInfo<v8::Value>& args) {
 }
 
 
-void InstantiateModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
+void CompileModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
   HandleScope scope(args.GetIsolate());
   i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
-  ErrorThrower thrower(isolate, "WASM.instantiateModule()");
+  ErrorThrower thrower(isolate, "WASM.compileModule()");
 
   RawBuffer buffer = GetRawBufferArgument(thrower, args);
   if (buffer.start == nullptr) return;
@@ -136,14 +191,119 @@ void InstantiateModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
   if (result.failed()) {
     thrower.Failed("", result);
   } else {
-    // Success. Instantiate the module and return the object.
-    i::Handle<i::JSObject> ffi = i::Handle<i::JSObject>::null();
-    if (args.Length() > 1 && args[1]->IsObject()) {
-      Local<Object> obj = Local<Object>::Cast(args[1]);
-      ffi = v8::Utils::OpenHandle(*obj);
+    // Success. Compile the module and return the compiled module object.
+    i::MaybeHandle<i::JSObject> object =
+        i::wasm::CompileWasmModule(isolate, result.val, thrower);
+
+    if (!object.is_null()) {
+      args.GetReturnValue().Set(v8::Utils::ToLocal(object.ToHandleChecked()));
+    }
+  }
+
+  if (result.val) delete result.val;
+}
+
+
+void CompileModuleFile(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  HandleScope scope(args.GetIsolate());
+  i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
+  ErrorThrower thrower(isolate, "WASM.compileModuleFile()");
+
+  if (args.Length() < 1 || !args[0]->IsString()) {
+    thrower.Error("Argument 0 must be a file name");
+    return;
+  }
+  String::Utf8Value path(args[0]);
+
+  // The module is decoded and compiled straight from the mapped file.
+  i::MaybeHandle<i::JSObject> object =
+      i::wasm::CompileWasmModuleFile(isolate, *path, thrower);
+  if (!object.is_null()) {
+    args.GetReturnValue().Set(v8::Utils::ToLocal(object.ToHandleChecked()));
+  }
+}
+
+
+// Returns the linear memory in argument {index} to share with a new
+// instance, which may be an ArrayBuffer or another module instance, or a
+// null handle if the argument is missing or undefined.
+i::Handle<i::JSArrayBuffer> GetMemoryArgument(
+    ErrorThrower& thrower, const v8::FunctionCallbackInfo<v8::Value>& args,
+    int index) {
+  i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
+  if (args.Length() <= index || args[index]->IsUndefined()) {
+    return i::Handle<i::JSArrayBuffer>::null();
+  }
+  i::Handle<i::Object> arg = v8::Utils::OpenHandle(*args[index]);
+  if (arg->IsJSArrayBuffer()) return i::Handle<i::JSArrayBuffer>::cast(arg);
+  i::Handle<i::JSArrayBuffer> memory;
+  if (arg->IsJSObject()) {
+    memory = i::wasm::GetInstanceMemory(isolate,
+                                        i::Handle<i::JSObject>::cast(arg));
+  }
+  if (memory.is_null()) {
+    thrower.Error("Argument %d must be an array buffer or a module instance",
+                  index);
+  }
+  return memory;
+}
+
+
+void InstantiateModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  HandleScope scope(args.GetIsolate());
+  i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
+  ErrorThrower thrower(isolate, "WASM.instantiateModule()");
+
+  i::Handle<i::JSObject> ffi = i::Handle<i::JSObject>::null();
+  if (args.Length() > 1 && args[1]->IsObject()) {
+    Local<Object> obj = Local<Object>::Cast(args[1]);
+    ffi = v8::Utils::OpenHandle(*obj);
+  }
+
+  // The linear memory to share follows the offset and length of the bytes,
+  // which are ignored for compiled modules.
+  i::Handle<i::JSArrayBuffer> memory = GetMemoryArgument(thrower, args, 4);
+  if (thrower.error()) return;
+
+  // A module compiled by WASM.compileModule() is instantiated without
+  // compiling it again.
+  if (args.Length() > 0 && args[0]->IsObject()) {
+    i::Handle<i::Object> arg = v8::Utils::OpenHandle(*args[0]);
+    if (i::wasm::IsWasmCompiledModule(*arg)) {
+      i::MaybeHandle<i::JSObject> object =
+          i::wasm::InstantiateCompiledModule(
+              isolate, i::Handle<i::JSObject>::cast(arg), ffi, memory);
+      if (!object.is_null()) {
+        args.GetReturnValue().Set(
+            v8::Utils::ToLocal(object.ToHandleChecked()));
+      }
+      return;
     }
+  }
+
+  // The offset and length of the bytes follow the foreign function interface.
+  RawBuffer buffer = GetRawBufferArgument(thrower, args, 2);
+  if (buffer.start == nullptr) return;
+
+  // Instantiation looks up the imports in {ffi}, which runs getters that may
+  // write to the bytes or neuter their buffer, so the module is decoded and
+  // compiled from a copy. Modules compiled by WASM.compileModule() are
+  // instantiated without one.
+  base::SmartArrayPointer<byte> copy(new byte[buffer.size()]);
+  memcpy(copy.get(), buffer.start, buffer.size());
+
+  // Decode but avoid a redundant pass over function bodies for verification.
+  // Verification will happen during compilation.
+  i::Zone zone;
+  internal::wasm::ModuleResult result = internal::wasm::DecodeWasmModule(
+      isolate, &zone, copy.get(), copy.get() + buffer.size(), false);
 
-    i::MaybeHandle<i::JSObject> object = result.val->Instantiate(isolate, ffi);
+  if (result.failed()) {
+    thrower.Failed("", result);
+  } else {
+    // Success. Instantiate the module and return the object.
+    i::MaybeHandle<i::JSObject> object = result.val->Instantiate(
+        isolate, ffi, i::MaybeHandle<i::FixedArray>(), memory);
 
     if (!object.is_null()) {
       args.GetReturnValue().Set(v8::Utils::ToLocal(object.ToHandleChecked()));
@@ -152,6 +312,66 @@ void InstantiateModule(const v8::FunctionCallbackInfo<v8::Value>& args) {
 
   if (result.val) delete result.val;
 }
+
+
+void GrowMemory(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  HandleScope scope(args.GetIsolate());
+  i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
+  ErrorThrower thrower(isolate, "WASM.growMemory()");
+
+  if (args.Length() < 1 || !v8::Utils::OpenHandle(*args[0])->IsJSObject()) {
+    thrower.Error("Argument 0 must be a module instance");
+    return;
+  }
+  if (args.Length() < 2 || !args[1]->IsUint32()) {
+    thrower.Error("Argument 1 must be a non-negative integer size");
+    return;
+  }
+  i::Handle<i::JSObject> instance =
+      i::Handle<i::JSObject>::cast(v8::Utils::OpenHandle(*args[0]));
+  uint32_t delta = Local<Uint32>::Cast(args[1])->Value();
+  args.GetReturnValue().Set(
+      i::wasm::GrowInstanceMemory(isolate, instance, delta));
+}
+
+
+void GetStatistics(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  HandleScope scope(args.GetIsolate());
+  i::Isolate* isolate = reinterpret_cast<i::Isolate*>(args.GetIsolate());
+  i::Factory* factory = isolate->factory();
+
+  internal::wasm::WasmCodeCacheStatistics stats =
+      internal::wasm::GetWasmCodeCacheStatistics(isolate);
+  i::Handle<i::JSObject> object =
+      factory->NewJSObject(isolate->object_function());
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("codeCacheHits"),
+      i::handle(i::Smi::FromInt(stats.hits), isolate), i::NONE);
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("codeCacheMisses"),
+      i::handle(i::Smi::FromInt(stats.misses), isolate), i::NONE);
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("codeCacheEntries"),
+      i::handle(i::Smi::FromInt(stats.entries), isolate), i::NONE);
+
+  internal::wasm::WasmWrapperStatistics wrapper_stats =
+      internal::wasm::GetWasmWrapperStatistics(isolate);
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("wrappersCompiled"),
+      i::handle(i::Smi::FromInt(wrapper_stats.compiled), isolate), i::NONE);
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("wrappersReused"),
+      i::handle(i::Smi::FromInt(wrapper_stats.reused), isolate), i::NONE);
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("importWrappersCompiled"),
+      i::handle(i::Smi::FromInt(wrapper_stats.import_compiled), isolate),
+      i::NONE);
+  i::JSObject::AddProperty(
+      object, factory->InternalizeUtf8String("importWrappersReused"),
+      i::handle(i::Smi::FromInt(wrapper_stats.import_reused), isolate),
+      i::NONE);
+  args.GetReturnValue().Set(v8::Utils::ToLocal(object));
+}
 }
 
 
@@ -198,9 +418,13 @@ void WasmJs::Install(Isolate* isolate, Handle<JSGlobalObject> global) {
 
   // Install functions on the WASM object.
   InstallFunc(isolate, wasm_object, "instantiateModule", InstantiateModule);
+  InstallFunc(isolate, wasm_object, "compileModule", CompileModule);
+  InstallFunc(isolate, wasm_object, "compileModuleFile", CompileModuleFile);
   InstallFunc(isolate, wasm_object, "verifyModule", VerifyModule);
   InstallFunc(isolate, wasm_object, "verifyFunction", VerifyFunction);
   InstallFunc(isolate, wasm_object, "compileRun", CompileRun);
+  InstallFunc(isolate, wasm_object, "growMemory", GrowMemory);
+  InstallFunc(isolate, wasm_object, "getStatistics", GetStatistics);
 }
 }  // namespace internal
 }  // namespace v8
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include "src/assembler.h"
+#include "src/flags.h"
 #include "src/macro-assembler.h"
 
 #include "src/wasm/wasm-module.h"
@@ -72,6 +73,7 @@ LinkageLocation stackloc(int i) {
 #define GP_RETURN_REGISTERS rax, rdx
 #define FP_PARAM_REGISTERS xmm1, xmm2, xmm3, xmm4, xmm5, xmm6
 #define FP_RETURN_REGISTERS xmm1, xmm2
+#define MEM_BASE_REGISTER r14
 
 #elif V8_TARGET_ARCH_X87
 // ===========================================================================
@@ -97,6 +99,7 @@ LinkageLocation stackloc(int i) {
 #define GP_RETURN_REGISTERS x0, x1
 #define FP_PARAM_REGISTERS d0, d1, d2, d3, d4, d5, d6, d7
 #define FP_RETURN_REGISTERS d0, d1
+#define MEM_BASE_REGISTER x21
 
 #elif V8_TARGET_ARCH_MIPS
 // ===========================================================================
@@ -187,13 +190,26 @@ struct Allocator {
 }  // namespace
 
 
-// General code uses the above configuration data.
-CallDescriptor* ModuleEnv::GetWasmCallDescriptor(Zone* zone,
-                                                 FunctionSig* fsig) {
+bool ModuleEnv::UsesMemBaseParam() {
+#ifdef MEM_BASE_REGISTER
+  return FLAG_wasm_mem_base_param && !mem_buffer.is_null();
+#else
+  return false;
+#endif
+}
+
+
+namespace {
+// General code uses the above configuration data. If {mem_base} is set, the
+// start of linear memory is passed after the parameters of {fsig}; if
+// {import_callee} is set, a JSFunction is passed before them.
+CallDescriptor* BuildWasmCallDescriptor(Zone* zone, FunctionSig* fsig,
+                                        bool mem_base, bool import_callee) {
+  const size_t implicit_count = (mem_base ? 1 : 0) + (import_callee ? 1 : 0);
   MachineSignature::Builder msig(zone, fsig->return_count(),
-                                 fsig->parameter_count());
-  LocationSignature::Builder locations(zone, fsig->return_count(),
-                                       fsig->parameter_count());
+                                 fsig->parameter_count() + implicit_count);
+  LocationSignature::Builder locations(
+      zone, fsig->return_count(), fsig->parameter_count() + implicit_count);
 
 #ifdef GP_RETURN_REGISTERS
   static const Register kGPReturnRegisters[] = {GP_RETURN_REGISTERS};
@@ -245,6 +261,12 @@ CallDescriptor* ModuleEnv::GetWasmCallDescriptor(Zone* zone,
   Allocator params(kGPParamRegisters, kGPParamRegistersCount, kFPParamRegisters,
                    kFPParamRegistersCount);
 
+  // The imported JSFunction is passed like a word-sized integer.
+  if (import_callee) {
+    msig.AddParam(compiler::kMachAnyTagged);
+    locations.AddParam(params.Next(kAstInt32));
+  }
+
   // Add register and/or stack parameter(s).
   const int parameter_count = static_cast<int>(fsig->parameter_count());
   for (int i = 0; i < parameter_count; i++) {
@@ -253,6 +275,18 @@ CallDescriptor* ModuleEnv::GetWasmCallDescriptor(Zone* zone,
     locations.AddParam(params.Next(param));
   }
 
+#ifdef MEM_BASE_REGISTER
+  // The start of linear memory follows the parameters, in a register that no
+  // other parameter uses. It is an ordinary implicit parameter: the register
+  // allocator does not reserve the register, so only calls and entries are
+  // guaranteed to pass the base in it. Within a function, the base may be
+  // moved to another register or spilled like any other value.
+  if (mem_base) {
+    msig.AddParam(compiler::kMachPtr);
+    locations.AddParam(regloc(MEM_BASE_REGISTER));
+  }
+#endif
+
   const RegList kCalleeSaveRegisters = 0;
   const RegList kCalleeSaveFPRegisters = 0;
 
@@ -272,6 +306,20 @@ CallDescriptor* ModuleEnv::GetWasmCallDescriptor(Zone* zone,
       CallDescriptor::kNoFlags,           // flags
       "c-call");
 }
+}  // namespace
+
+
+CallDescriptor* ModuleEnv::GetWasmCallDescriptor(Zone* zone,
+                                                 FunctionSig* fsig) {
+  return BuildWasmCallDescriptor(zone, fsig, UsesMemBaseParam(), false);
+}
+
+
+CallDescriptor* ModuleEnv::GetWasmImportCallDescriptor(Zone* zone,
+                                                       FunctionSig* fsig) {
+  // Import wrappers never access linear memory.
+  return BuildWasmCallDescriptor(zone, fsig, false, true);
+}
 }
 }
 }
@@ -82,6 +82,8 @@
   kExprCallIndirect, static_cast<byte>(index), func
 #define WASM_TERNARY(cond, tval, fval) kExprTernary, cond, tval, fval
 #define WASM_COMMA(left, right) kExprComma, left, right
+#define WASM_MEMORY_SIZE kExprMemorySize
+#define WASM_GROW_MEMORY(delta) kExprGrowMemory, delta
 #define WASM_NOT(x) kExprBoolNot, x
 
 
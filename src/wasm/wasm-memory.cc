@@ -0,0 +1,150 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "src/wasm/wasm-memory.h"
+
+#include <algorithm>
+
+#include "src/v8.h"
+
+#include "src/base/platform/platform.h"
+#include "src/flags.h"
+#include "src/global-handles.h"
+#include "src/wasm/wasm-module.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+namespace {
+// The state of the weak handle that releases a mapped array buffer.
+struct MappedBuffer {
+  Object** location;
+  void* memory;
+  size_t size;
+};
+
+
+void FreeMappedArrayBuffer(const v8::WeakCallbackInfo<void>& data) {
+  MappedBuffer* buffer = reinterpret_cast<MappedBuffer*>(data.GetParameter());
+  GlobalHandles::Destroy(buffer->location);
+  base::VirtualMemory::ReleaseRegion(buffer->memory, buffer->size);
+  delete buffer;
+}
+}  // namespace
+
+
+bool UseCopyOnWriteDataSegments() { return FLAG_wasm_cow_data_segments; }
+
+
+Handle<JSArrayBuffer> NewMappedArrayBuffer(Isolate* isolate, size_t size,
+                                           byte** backing_store) {
+  size_t mapped_size = RoundUp(size, base::OS::CommitPageSize());
+  void* memory = base::VirtualMemory::ReserveRegion(mapped_size);
+  if (memory == nullptr) return Handle<JSArrayBuffer>::null();
+  if (!base::VirtualMemory::CommitRegion(memory, mapped_size, false)) {
+    base::VirtualMemory::ReleaseRegion(memory, mapped_size);
+    return Handle<JSArrayBuffer>::null();
+  }
+  *backing_store = reinterpret_cast<byte*>(memory);
+
+  // Tenured, because code copied from the code cache embeds the buffer.
+  Handle<JSArrayBuffer> buffer = isolate->factory()->NewJSArrayBuffer(
+      SharedFlag::kNotShared, TENURED);
+  JSArrayBuffer::Setup(buffer, isolate, true, memory, static_cast<int>(size));
+  buffer->set_is_neuterable(false);
+
+  MappedBuffer* mapped = new MappedBuffer();
+  mapped->location = isolate->global_handles()->Create(*buffer).location();
+  mapped->memory = memory;
+  mapped->size = mapped_size;
+  GlobalHandles::MakeWeak(mapped->location, mapped, &FreeMappedArrayBuffer,
+                          v8::WeakCallbackType::kParameter);
+  return buffer;
+}
+
+
+namespace {
+// The reservation of a growable memory, which is released when its buffer
+// dies. Memory only grows, so the committed part of the reservation always
+// ends at the first page boundary at or after the byte length of the buffer.
+struct GrowableBuffer {
+  Object** location;
+  byte* memory;
+};
+
+
+void FreeGrowableArrayBuffer(const v8::WeakCallbackInfo<void>& data) {
+  GrowableBuffer* buffer =
+      reinterpret_cast<GrowableBuffer*>(data.GetParameter());
+  GlobalHandles::Destroy(buffer->location);
+  base::VirtualMemory::ReleaseRegion(buffer->memory, MaxGrowableMemorySize());
+  delete buffer;
+}
+}  // namespace
+
+
+size_t MaxGrowableMemorySize() {
+  // Compiled code reads the size as a small integer from the buffer.
+  size_t max_size = static_cast<size_t>(1) << WasmModule::kMaxMemSize;
+  size_t max_smi = RoundDown(static_cast<size_t>(Smi::kMaxValue),
+                             base::OS::CommitPageSize());
+  return std::min(max_size, max_smi);
+}
+
+
+Handle<JSArrayBuffer> NewGrowableArrayBuffer(Isolate* isolate, size_t size,
+                                             byte** backing_store) {
+  if (size > MaxGrowableMemorySize()) return Handle<JSArrayBuffer>::null();
+  size_t committed = RoundUp(size, base::OS::CommitPageSize());
+  void* start = base::VirtualMemory::ReserveRegion(MaxGrowableMemorySize());
+  if (start == nullptr) return Handle<JSArrayBuffer>::null();
+  if (!base::VirtualMemory::CommitRegion(start, committed, false)) {
+    base::VirtualMemory::ReleaseRegion(start, MaxGrowableMemorySize());
+    return Handle<JSArrayBuffer>::null();
+  }
+  byte* memory = reinterpret_cast<byte*>(start);
+  *backing_store = memory;
+
+  // Tenured, because code copied from the code cache embeds the buffer.
+  Handle<JSArrayBuffer> buffer = isolate->factory()->NewJSArrayBuffer(
+      SharedFlag::kNotShared, TENURED);
+  JSArrayBuffer::Setup(buffer, isolate, true, memory, static_cast<int>(size));
+  buffer->set_is_neuterable(false);
+
+  GrowableBuffer* growable = new GrowableBuffer();
+  growable->location = isolate->global_handles()->Create(*buffer).location();
+  growable->memory = memory;
+  GlobalHandles::MakeWeak(growable->location, growable,
+                          &FreeGrowableArrayBuffer,
+                          v8::WeakCallbackType::kParameter);
+  return buffer;
+}
+
+
+int32_t GrowMemoryBuffer(JSArrayBuffer* buffer, uint32_t delta) {
+  DisallowHeapAllocation no_allocation;
+  byte* memory = reinterpret_cast<byte*>(buffer->backing_store());
+  size_t old_size =
+      static_cast<size_t>(Smi::cast(buffer->byte_length())->value());
+  if (delta > MaxGrowableMemorySize() - old_size) return -1;
+  size_t new_size = old_size + delta;
+  size_t old_committed = RoundUp(old_size, base::OS::CommitPageSize());
+  size_t committed = RoundUp(new_size, base::OS::CommitPageSize());
+  if (committed > old_committed) {
+    if (!base::VirtualMemory::CommitRegion(memory + old_committed,
+                                           committed - old_committed, false)) {
+      return -1;
+    }
+  }
+  // Stores beyond the old size may have hit the rest of its last page, which
+  // becomes accessible now.
+  size_t dirty_end = std::min(new_size, old_committed);
+  if (dirty_end > old_size) memset(memory + old_size, 0, dirty_end - old_size);
+  buffer->set_byte_length(Smi::FromInt(static_cast<int>(new_size)));
+  return static_cast<int32_t>(old_size);
+}
+}
+}
+}
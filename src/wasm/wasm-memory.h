@@ -0,0 +1,46 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef V8_WASM_MEMORY_H_
+#define V8_WASM_MEMORY_H_
+
+#include "src/handles.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+// Returns true if the data segments of modules whose bytes are held by a
+// {WasmModuleFile} are mapped copy-on-write into linear memory instead of
+// copied. Requires {FLAG_wasm_cow_data_segments}.
+bool UseCopyOnWriteDataSegments();
+
+// Creates an array buffer of {size} bytes of zero-initialized linear memory
+// that is mapped by the engine instead of allocated by the embedder, so that
+// its pages may be remapped, and which is released when the buffer dies.
+// Returns a null handle on failure.
+Handle<JSArrayBuffer> NewMappedArrayBuffer(Isolate* isolate, size_t size,
+                                           byte** backing_store);
+
+// Returns the largest size that growable linear memory can grow to.
+size_t MaxGrowableMemorySize();
+
+// Creates an array buffer of {size} bytes of zero-initialized linear memory
+// at the start of a reservation of {MaxGrowableMemorySize()} bytes, so that
+// the memory can grow in place without copying. The memory is released when
+// the buffer dies. Returns a null handle on failure.
+Handle<JSArrayBuffer> NewGrowableArrayBuffer(Isolate* isolate, size_t size,
+                                             byte** backing_store);
+
+// Grows the memory of {buffer} by {delta} bytes by committing more of its
+// reservation, and updates the byte length of {buffer}, which must have been
+// created by {NewGrowableArrayBuffer}. Does not allocate, and is therefore
+// called directly from compiled code. Returns the previous size in bytes, or
+// -1 if the memory cannot grow by {delta} bytes.
+int32_t GrowMemoryBuffer(JSArrayBuffer* buffer, uint32_t delta);
+}
+}
+}
+
+#endif  // V8_WASM_MEMORY_H_
@@ -0,0 +1,190 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "src/wasm/wasm-module-file.h"
+
+#include "src/v8.h"
+
+#include "src/base/build_config.h"
+#include "src/base/platform/platform.h"
+#include "src/global-handles.h"
+#include "src/wasm/wasm-module.h"
+
+#if V8_OS_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if V8_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+namespace {
+// The state of the weak handle that unmaps a module file.
+struct ModuleFileBuffer {
+  Object** location;
+  WasmModuleFile* file;
+};
+
+
+void FreeModuleFileArrayBuffer(const v8::WeakCallbackInfo<void>& data) {
+  ModuleFileBuffer* buffer =
+      reinterpret_cast<ModuleFileBuffer*>(data.GetParameter());
+  GlobalHandles::Destroy(buffer->location);
+  delete buffer->file;
+  delete buffer;
+}
+}  // namespace
+
+
+#if V8_OS_POSIX
+
+WasmModuleFile* WasmModuleFile::Open(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0 || stat_buf.st_size <= 0 ||
+      static_cast<uint64_t>(stat_buf.st_size) > kMaxModuleSize) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(stat_buf.st_size);
+  void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+  // Keep the file open for mapping data segments.
+  return new WasmModuleFile(reinterpret_cast<byte*>(memory), size, fd);
+}
+
+
+WasmModuleFile* WasmModuleFile::FromBytes(const byte* start,
+                                          const byte* end) {
+#if V8_OS_LINUX && defined(__NR_memfd_create)
+  size_t size = static_cast<size_t>(end - start);
+  if (size == 0) return nullptr;
+  int fd = static_cast<int>(syscall(__NR_memfd_create, "wasm-module", 0));
+  if (fd < 0) return nullptr;
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = write(fd, start + written, size - written);
+    if (result <= 0) {
+      close(fd);
+      return nullptr;
+    }
+    written += static_cast<size_t>(result);
+  }
+  void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+  return new WasmModuleFile(reinterpret_cast<byte*>(memory), size, fd);
+#else
+  return nullptr;
+#endif
+}
+
+
+WasmModuleFile::~WasmModuleFile() {
+  munmap(start_, size_);
+  close(fd_);
+}
+
+
+void WasmModuleFile::CopyTo(byte* dest, size_t offset, size_t size) const {
+  DCHECK_LE(offset + size, size_);
+  size_t page_size = base::OS::CommitPageSize();
+  uintptr_t addr = reinterpret_cast<uintptr_t>(dest);
+  // Pages can only be mapped if {dest} and {offset} have the same alignment.
+  if (addr % page_size == offset % page_size) {
+    size_t head = RoundUp(addr, page_size) - addr;
+    size_t body = size > head ? RoundDown(size - head, page_size) : 0;
+    if (body > 0) {
+      void* target = dest + head;
+      void* result = mmap(target, body, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_FIXED, fd_, offset + head);
+      if (result == target) {
+        // Copy the unaligned edges.
+        memcpy(dest, start_ + offset, head);
+        size_t rest = head + body;
+        memcpy(dest + rest, start_ + offset + rest, size - rest);
+        return;
+      }
+      // A failed fixed mapping may have discarded the pages; commit them
+      // again and copy the whole range instead.
+      CHECK(base::VirtualMemory::CommitRegion(target, body, false));
+    }
+  }
+  memcpy(dest, start_ + offset, size);
+}
+
+#else  // V8_OS_POSIX
+
+// Without mmap, the file is read into memory instead of mapped, and its
+// data segments are always copied.
+WasmModuleFile* WasmModuleFile::Open(const char* path) {
+  FILE* file = base::OS::FOpen(path, "rb");
+  if (file == nullptr) return nullptr;
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);  // NOLINT(runtime/int)
+  rewind(file);
+  if (length <= 0 || static_cast<uint64_t>(length) > kMaxModuleSize) {
+    fclose(file);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(length);
+  byte* bytes = new byte[size];
+  bool ok = fread(bytes, 1, size, file) == size;
+  fclose(file);
+  if (!ok) {
+    delete[] bytes;
+    return nullptr;
+  }
+  return new WasmModuleFile(bytes, size, -1);
+}
+
+
+WasmModuleFile* WasmModuleFile::FromBytes(const byte* start,
+                                          const byte* end) {
+  return nullptr;
+}
+
+
+WasmModuleFile::~WasmModuleFile() { delete[] start_; }
+
+
+void WasmModuleFile::CopyTo(byte* dest, size_t offset, size_t size) const {
+  DCHECK_LE(offset + size, size_);
+  memcpy(dest, start_ + offset, size);
+}
+
+#endif  // V8_OS_POSIX
+
+
+Handle<JSArrayBuffer> NewModuleFileArrayBuffer(Isolate* isolate,
+                                               WasmModuleFile* file) {
+  Handle<JSArrayBuffer> buffer = isolate->factory()->NewJSArrayBuffer(
+      SharedFlag::kNotShared, TENURED);
+  JSArrayBuffer::Setup(buffer, isolate, true, const_cast<byte*>(file->start()),
+                       static_cast<int>(file->size()));
+  buffer->set_is_neuterable(false);
+
+  ModuleFileBuffer* weak = new ModuleFileBuffer();
+  weak->location = isolate->global_handles()->Create(*buffer).location();
+  weak->file = file;
+  GlobalHandles::MakeWeak(weak->location, weak, &FreeModuleFileArrayBuffer,
+                          v8::WeakCallbackType::kParameter);
+  return buffer;
+}
+}
+}
+}
@@ -0,0 +1,63 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef V8_WASM_MODULE_FILE_H_
+#define V8_WASM_MODULE_FILE_H_
+
+#include "src/handles.h"
+
+namespace v8 {
+namespace internal {
+namespace wasm {
+
+// A module file mapped read-only into memory, so that the module can be
+// decoded and compiled straight from the mapping instead of being read into
+// a buffer first. Only the pages that are touched are loaded, and they can be
+// dropped again under memory pressure, since they are backed by the file.
+// On platforms other than POSIX, the file is read into memory instead.
+class WasmModuleFile {
+ public:
+  // Maps the file at {path}. Returns {nullptr} if the file cannot be opened,
+  // is empty, or is larger than the largest module.
+  static WasmModuleFile* Open(const char* path);
+
+  // Creates an anonymous in-memory file that holds a copy of the given bytes,
+  // so that modules which do not come from a file can be mapped, too.
+  // Returns {nullptr} if anonymous files are not supported.
+  static WasmModuleFile* FromBytes(const byte* start, const byte* end);
+
+  ~WasmModuleFile();
+
+  const byte* start() const { return start_; }
+  const byte* end() const { return start_ + size_; }
+  size_t size() const { return size_; }
+
+  // Copies the {size} bytes at {offset} in the file to {dest}. Whole pages
+  // are mapped copy-on-write from the file instead of copied where the
+  // alignment of {dest} and {offset} allows it, so that they only become
+  // resident when touched. Hence {dest} must be memory that may be remapped,
+  // such as memory from {NewMappedArrayBuffer}.
+  void CopyTo(byte* dest, size_t offset, size_t size) const;
+
+ private:
+  WasmModuleFile(byte* start, size_t size, int fd)
+      : start_(start), size_(size), fd_(fd) {}
+
+  byte* start_;
+  size_t size_;
+  int fd_;  // descriptor of the file, or -1 if the file cannot be mapped.
+
+  DISALLOW_COPY_AND_ASSIGN(WasmModuleFile);
+};
+
+// Creates an external array buffer over the bytes of {file}, and transfers
+// the ownership of {file} to the buffer, which unmaps it when it dies. The
+// bytes are read-only, so the buffer must never be exposed to JavaScript.
+Handle<JSArrayBuffer> NewModuleFileArrayBuffer(Isolate* isolate,
+                                               WasmModuleFile* file);
+}
+}
+}
+
+#endif  // V8_WASM_MODULE_FILE_H_
@@ -2,21 +2,43 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <map>
+
+#include "include/v8-platform.h"
+
 #include "src/v8.h"
+#include "src/api.h"
+#include "src/code-stubs.h"
+#include "src/flags.h"
+#include "src/frames-inl.h"
+#include "src/global-handles.h"
 #include "src/macro-assembler.h"
 #include "src/objects.h"
 
 #include "src/simulator.h"
 
+#include "src/base/functional.h"
+#include "src/base/lazy-instance.h"
+#include "src/base/platform/mutex.h"
+#include "src/base/platform/semaphore.h"
+#include "src/base/platform/time.h"
+
 // TODO(titzer): wasm-module shouldn't need anything from the compiler.
 #include "src/compiler/common-operator.h"
 #include "src/compiler/js-graph.h"
 #include "src/compiler/pipeline.h"
 #include "src/compiler/machine-operator.h"
+#include "src/compiler/scheduler.h"
 
+#include "src/wasm/baseline-compiler.h"
+#include "src/wasm/bounds-check-elimination.h"
 #include "src/wasm/decoder.h"
 #include "src/wasm/tf-builder.h"
+#include "src/wasm/validator.h"
+#include "src/wasm/wasm-memory.h"
 #include "src/wasm/wasm-module.h"
+#include "src/wasm/wasm-module-file.h"
 #include "src/wasm/wasm-result.h"
 #include "src/wasm/wasm-wrapper.h"
 
@@ -152,84 +174,339 @@ class WasmLinker {
 
 namespace {
 // Internal constants for the layout of the module object.
-const int kWasmModuleInternalFieldCount = 4;
+const int kWasmModuleInternalFieldCount = 7;
 const int kWasmModuleFunctionTable = 0;
 const int kWasmModuleCodeTable = 1;
 const int kWasmMemArrayBuffer = 2;
 const int kWasmGlobalsArrayBuffer = 3;
+const int kWasmModuleCompilerData = 4;
+const int kWasmExternalMemArrayBuffer = 5;
+const int kWasmMemGrowable = 6;
+
+// Internal constants for the layout of the instance compiler data.
+const int kCompilerDataSize = 6;
+const int kCompiler = 0;
+const int kLinkTable = 1;
+const int kStubTable = 2;
+const int kWrapperTable = 3;
+const int kBaselineTable = 4;
+const int kTierUpWrapper = 5;
+
+
+bool SameSignature(FunctionSig* a, FunctionSig* b) {
+  if (a->return_count() != b->return_count()) return false;
+  if (a->parameter_count() != b->parameter_count()) return false;
+  for (size_t i = 0; i < a->return_count(); i++) {
+    if (a->GetReturn(i) != b->GetReturn(i)) return false;
+  }
+  for (size_t i = 0; i < a->parameter_count(); i++) {
+    if (a->GetParam(i) != b->GetParam(i)) return false;
+  }
+  return true;
+}
 
 
-// Helper function to compile a single function.
-Handle<Code> CompileFunction(ErrorThrower& thrower, Isolate* isolate,
-                             ModuleEnv* module_env,
-                             const WasmFunction& function, int index) {
-  if (FLAG_trace_wasm_compiler) {
-    // TODO(titzer): clean me up a bit.
-    OFStream os(stdout);
-    os << "Compiling WASM function #" << index << ":";
-    if (function.name_offset > 0) {
-      os << module_env->module->GetName(function.name_offset);
+// The compilation of a single wasm function, split into a phase that only
+// touches zone memory (decoding, graph building, and scheduling) and can
+// therefore run on any thread, and a phase that generates the machine code
+// and must run on the isolate's thread. The pipeline runs instruction
+// selection, register allocation and code generation in a single call that
+// ends by allocating the code object on the heap, so the backend cannot be
+// split off to the background yet.
+class WasmCompilationUnit {
+ public:
+  WasmCompilationUnit(Isolate* isolate, ModuleEnv* module_env,
+                      const WasmFunction* function, int index)
+      : isolate_(isolate),
+        module_env_(module_env),
+        function_(function),
+        index_(index),
+        base_(module_env->module->module_start),
+        base_end_(module_env->module->module_end),
+        start_(base_ + function->code_start_offset),
+        end_(base_ + function->code_end_offset),
+        graph_(&zone_),
+        common_(&zone_),
+        machine_(&zone_),
+        jsgraph_(isolate, &graph_, &common_, nullptr, &machine_),
+        schedule_(nullptr),
+        bounds_checks_() {
+    if (FLAG_trace_wasm_compiler) {
+      // TODO(titzer): clean me up a bit.
+      OFStream os(stdout);
+      os << "Compiling WASM function #" << index << ":";
+      if (function->name_offset > 0 &&
+          module_env->module->BoundsCheck(function->name_offset,
+                                          function->name_offset + 1)) {
+        // The name of a function in a streamed module may not have fully
+        // arrived, and the bytes are only terminated once all have.
+        const char* name = module_env->module->GetName(function->name_offset);
+        size_t available =
+            static_cast<size_t>(base_end_ - base_) - function->name_offset;
+        os.write(name, strnlen(name, available));
+      }
+      os << std::endl;
     }
-    os << std::endl;
+    // Initialize the function environment for decoding.
+    env_.module = module_env;
+    env_.sig = function->sig;
+    env_.local_int32_count = function->local_int32_count;
+    env_.local_int64_count = function->local_int64_count;
+    env_.local_float32_count = function->local_float32_count;
+    env_.local_float64_count = function->local_float64_count;
+    env_.SumLocals();
   }
-  // Initialize the function environment for decoding.
-  FunctionEnv env;
-  env.module = module_env;
-  env.sig = function.sig;
-  env.local_int32_count = function.local_int32_count;
-  env.local_int64_count = function.local_int64_count;
-  env.local_float32_count = function.local_float32_count;
-  env.local_float64_count = function.local_float64_count;
-  env.SumLocals();
 
-  // Create a TF graph during decoding.
-  Zone zone;
-  compiler::Graph graph(&zone);
-  compiler::CommonOperatorBuilder common(&zone);
-  compiler::MachineOperatorBuilder machine(&zone);
-  compiler::JSGraph jsgraph(isolate, &graph, &common, nullptr, &machine);
-  TreeResult result = BuildTFGraph(
-      &jsgraph, &env,                                                 // --
-      module_env->module->module_start,                               // --
-      module_env->module->module_start + function.code_start_offset,  // --
-      module_env->module->module_start + function.code_end_offset);   // --
+  // Decodes the function body into a TF graph and schedules it. Does not
+  // allocate on the heap and may run on a background thread, as long as the
+  // code objects of all callees have been created up front.
+  void BuildGraph() {
+    result_ = BuildTFGraph(&jsgraph_, &env_, base_, base_end_, start_, end_);
+    if (result_.ok()) {
+      if (FLAG_wasm_bounds_check_elimination) {
+        bounds_checks_ = EliminateBoundsChecks(&jsgraph_);
+      }
+      schedule_ = compiler::Scheduler::ComputeSchedule(
+          &zone_, &graph_, compiler::Scheduler::kNoFlags);
+    }
+  }
 
-  if (result.failed()) {
-    if (FLAG_trace_wasm_compiler) {
+  // Generates the machine code for the scheduled graph. Must be called on
+  // the isolate's thread after {BuildGraph}.
+  Handle<Code> FinishCompilation(ErrorThrower& thrower) {
+    if (result_.failed()) {
+      if (FLAG_trace_wasm_compiler) {
+        OFStream os(stdout);
+        os << "Compilation failed: " << result_ << std::endl;
+      }
+      // Add the function as another context for the exception
+      char buffer[256];
+      snprintf(buffer, 256, "Compiling WASM function #%d:%s failed:", index_,
+               module_env_->module->GetName(function_->name_offset));
+      thrower.Failed(buffer, result_);
+      return Handle<Code>::null();
+    }
+    if (FLAG_trace_wasm_bounds_checks) {
+      PrintF("Bounds checks of WASM function #%d:%s: %d eliminated, %d left\n",
+             index_, module_env_->module->GetName(function_->name_offset),
+             bounds_checks_.eliminated, bounds_checks_.remaining);
+    }
+
+    // Run the compiler pipeline to generate machine code.
+    compiler::CallDescriptor* descriptor =
+        const_cast<compiler::CallDescriptor*>(
+            module_env_->GetWasmCallDescriptor(&zone_, function_->sig));
+    CompilationInfo info("wasm", isolate_, &zone_);
+    Handle<Code> code = compiler::Pipeline::GenerateCodeForTesting(
+        &info, descriptor, &graph_, schedule_);
+
+#ifdef ENABLE_DISASSEMBLER
+    // Disassemble the code for debugging.
+    if (!code.is_null() && FLAG_print_opt_code) {
+      static const int kBufferSize = 128;
+      char buffer[kBufferSize];
+      const char* name = "";
+      if (function_->name_offset > 0) {
+        const byte* ptr =
+            module_env_->module->module_start + function_->name_offset;
+        name = reinterpret_cast<const char*>(ptr);
+      }
+      snprintf(buffer, kBufferSize, "WASM function #%d:%s", index_, name);
       OFStream os(stdout);
-      os << "Compilation failed: " << result << std::endl;
+      code->Disassemble(buffer, os);
     }
-    // Add the function as another context for the exception
-    char buffer[256];
-    snprintf(buffer, 256, "Compiling WASM function #%d:%s failed:", index,
-             module_env->module->GetName(function.name_offset));
-    thrower.Failed(buffer, result);
-    return Handle<Code>::null();
+#endif
+    return code;
   }
 
-  // Run the compiler pipeline to generate machine code.
-  compiler::CallDescriptor* descriptor = const_cast<compiler::CallDescriptor*>(
-      module_env->GetWasmCallDescriptor(&zone, function.sig));
-  CompilationInfo info("wasm", isolate, &zone);
-  Handle<Code> code =
-      compiler::Pipeline::GenerateCodeForTesting(&info, descriptor, &graph);
+  int index() const { return index_; }
+  const WasmFunction* function() const { return function_; }
 
-#ifdef ENABLE_DISASSEMBLER
-  // Disassemble the code for debugging.
-  if (!code.is_null() && FLAG_print_opt_code) {
-    static const int kBufferSize = 128;
-    char buffer[kBufferSize];
-    const char* name = "";
-    if (function.name_offset > 0) {
-      const byte* ptr = module_env->module->module_start + function.name_offset;
-      name = reinterpret_cast<const char*>(ptr);
-    }
-    snprintf(buffer, kBufferSize, "WASM function #%d:%s", index, name);
-    OFStream os(stdout);
-    code->Disassemble(buffer, os);
+ private:
+  Isolate* isolate_;
+  ModuleEnv* module_env_;
+  const WasmFunction* function_;
+  int index_;
+  const byte* base_;
+  const byte* base_end_;  // the end of the bytes that have arrived.
+  const byte* start_;
+  const byte* end_;
+  FunctionEnv env_;
+  Zone zone_;
+  compiler::Graph graph_;
+  compiler::CommonOperatorBuilder common_;
+  compiler::MachineOperatorBuilder machine_;
+  compiler::JSGraph jsgraph_;
+  compiler::Schedule* schedule_;
+  TreeResult result_;
+  BoundsCheckStatistics bounds_checks_;
+};
+
+
+// A queue of compilation units shared between the isolate's thread and the
+// background compilation tasks. Graphs are built in the order in which the
+// units were added, on up to {FLAG_wasm_num_compilation_tasks} background
+// tasks and on the isolate's thread, which generates the code of the units
+// in the same order. At most {limit} units are handed out for graph building
+// ahead of the first unit whose code has not been generated yet, and units
+// are deleted as soon as their code has been generated, so that only the
+// zones of the units in flight are alive at once.
+class WasmCompilationQueue {
+ public:
+  static const size_t kUnlimited = static_cast<size_t>(-1);
+
+  explicit WasmCompilationQueue(size_t limit)
+      : limit_(limit),
+        next_(0),
+        released_(0),
+        built_(0),
+        done_(0),
+        num_tasks_(0) {}
+
+  ~WasmCompilationQueue() {
+    // Drop the units whose graphs have not been built yet.
+    {
+      base::LockGuard<base::Mutex> guard(&mutex_);
+      next_ = units_.size();
+    }
+    WaitForTasks();
+    for (WasmCompilationUnit* unit : units_) delete unit;
   }
-#endif
-  return code;
+
+  // Appends a unit whose graph has not yet been built.
+  void Add(WasmCompilationUnit* unit) {
+    base::LockGuard<base::Mutex> guard(&mutex_);
+    units_.push_back(unit);
+    built_flags_.push_back(false);
+  }
+
+  size_t size() const { return units_.size(); }
+
+  // Builds the graph of the next unit, unless all of them have been handed
+  // out or too many are in flight. Returns whether a graph was built.
+  bool BuildNext() {
+    WasmCompilationUnit* unit;
+    size_t index;
+    {
+      base::LockGuard<base::Mutex> guard(&mutex_);
+      if (!CanHandOut()) return false;
+      index = next_++;
+      unit = units_[index];
+    }
+    unit->BuildGraph();
+    {
+      base::LockGuard<base::Mutex> guard(&mutex_);
+      built_flags_[index] = true;
+    }
+    built_.Signal();
+    return true;
+  }
+
+  // Starts background tasks for the units that may be handed out, keeping at
+  // most {FLAG_wasm_num_compilation_tasks} of them running. Tasks end when no
+  // unit may be handed out; those that ended are replaced here.
+  void StartTasks() {
+    while (num_tasks_ > 0 && done_.WaitFor(base::TimeDelta())) num_tasks_--;
+    size_t available;
+    {
+      base::LockGuard<base::Mutex> guard(&mutex_);
+      available = units_.size() - next_;
+      if (limit_ != kUnlimited) {
+        available = std::min(available, limit_ - (next_ - released_));
+      }
+    }
+    while (available > 0 && num_tasks_ < FLAG_wasm_num_compilation_tasks) {
+      V8::GetCurrentPlatform()->CallOnBackgroundThread(
+          new WasmCompilationTask(this, &done_),
+          v8::Platform::kShortRunningTask);
+      num_tasks_++;
+      available--;
+    }
+  }
+
+  // Returns unit {index} once its graph has been built. The isolate's thread
+  // helps out instead of idling.
+  WasmCompilationUnit* WaitForGraph(size_t index) {
+    while (true) {
+      {
+        base::LockGuard<base::Mutex> guard(&mutex_);
+        if (built_flags_[index]) return units_[index];
+      }
+      // The unit is being built by a task if it cannot be handed out here.
+      if (!BuildNext()) built_.Wait();
+    }
+  }
+
+  // Deletes unit {index}, whose code has been generated, which lets another
+  // unit be handed out.
+  void Release(size_t index) {
+    {
+      base::LockGuard<base::Mutex> guard(&mutex_);
+      DCHECK(built_flags_[index]);
+      delete units_[index];
+      units_[index] = nullptr;
+      released_++;
+    }
+    StartTasks();
+  }
+
+  // Sorts the units by function index, once all graphs have been built.
+  void SortByFunctionIndex() {
+    DCHECK_EQ(0, num_tasks_);
+    DCHECK_EQ(units_.size(), next_);
+    std::sort(units_.begin(), units_.end(),
+              [](WasmCompilationUnit* a, WasmCompilationUnit* b) {
+                return a->index() < b->index();
+              });
+  }
+
+  // Waits for all background tasks to end.
+  void WaitForTasks() {
+    for (; num_tasks_ > 0; num_tasks_--) done_.Wait();
+  }
+
+ private:
+  // A background task that builds graphs until no unit may be handed out.
+  class WasmCompilationTask : public v8::Task {
+   public:
+    WasmCompilationTask(WasmCompilationQueue* queue, base::Semaphore* done)
+        : queue_(queue), done_(done) {}
+
+    void Run() override {
+      while (queue_->BuildNext()) {
+      }
+      done_->Signal();
+    }
+
+   private:
+    WasmCompilationQueue* queue_;
+    base::Semaphore* done_;
+  };
+
+  bool CanHandOut() const {
+    if (next_ >= units_.size()) return false;
+    return limit_ == kUnlimited || next_ - released_ < limit_;
+  }
+
+  base::Mutex mutex_;
+  std::vector<WasmCompilationUnit*> units_;
+  std::vector<bool> built_flags_;
+  const size_t limit_;
+  size_t next_;      // the next unit to hand out.
+  size_t released_;  // the number of units whose code has been generated.
+  base::Semaphore built_;  // signaled whenever a graph has been built.
+
+  // Only used on the isolate's thread.
+  base::Semaphore done_;  // signaled whenever a task ends.
+  int num_tasks_;
+};
+
+
+// The number of units whose graphs may be built ahead of code generation,
+// enough to keep all tasks busy while the isolate's thread generates code.
+size_t CompilationUnitLimit() {
+  int tasks = std::max(FLAG_wasm_num_compilation_tasks, 0);
+  return 2 * static_cast<size_t>(tasks) + 1;
 }
 
 
@@ -246,12 +523,133 @@ Handle<JSArrayBuffer> NewArrayBuffer(Isolate* isolate, int size,
   }
 #endif
 
-  Handle<JSArrayBuffer> buffer = isolate->factory()->NewJSArrayBuffer();
+  // Tenured, because code copied from the code cache embeds the buffer.
+  Handle<JSArrayBuffer> buffer =
+      isolate->factory()->NewJSArrayBuffer(SharedFlag::kNotShared, TENURED);
   JSArrayBuffer::Setup(buffer, isolate, true, memory, size);
   buffer->set_is_neuterable(false);
   return buffer;
 }
 
+
+// Returns a buffer for the memory of the {external} buffer, which can no
+// longer be neutered, so that the memory lives as long as {external}. Code
+// copied from the code cache embeds the buffer, so a buffer in new space is
+// replaced by a tenured one that refers to the same memory.
+Handle<JSArrayBuffer> NewExternalArrayBuffer(Isolate* isolate,
+                                             Handle<JSArrayBuffer> external) {
+  external->set_is_neuterable(false);
+  if (!isolate->heap()->InNewSpace(*external)) return external;
+  Handle<JSArrayBuffer> buffer =
+      isolate->factory()->NewJSArrayBuffer(SharedFlag::kNotShared, TENURED);
+  JSArrayBuffer::Setup(buffer, isolate, true, external->backing_store(),
+                       static_cast<int>(external->byte_length()->Number()));
+  buffer->set_is_neuterable(false);
+  return buffer;
+}
+
+// Verifies the body of {function} in the module starting at {module_start}.
+TreeResult VerifyWasmFunction(WasmValidator* validator, ModuleEnv* menv,
+                              const byte* module_start,
+                              WasmFunction* function) {
+  FunctionEnv fenv;
+  fenv.module = menv;
+  fenv.sig = function->sig;
+  fenv.local_int32_count = function->local_int32_count;
+  fenv.local_int64_count = function->local_int64_count;
+  fenv.local_float32_count = function->local_float32_count;
+  fenv.local_float64_count = function->local_float64_count;
+  fenv.SumLocals();
+
+  return validator->Validate(&fenv, module_start,
+                             module_start + function->code_start_offset,
+                             module_start + function->code_end_offset);
+}
+
+
+// The function bodies of a module, shared between the thread decoding the
+// module and the background verification tasks. Bodies are handed out in
+// order of function index, and only the error of the lowest failing index is
+// kept, so the error reported does not depend on the scheduling.
+class WasmVerificationQueue {
+ public:
+  WasmVerificationQueue(ModuleEnv* menv, const byte* module_start)
+      : menv_(menv),
+        module_start_(module_start),
+        next_(0),
+        error_index_(kNoError) {}
+
+  // Verifies bodies with {validator} until none are left that could fail
+  // before the lowest failing index found so far.
+  void VerifyAll(WasmValidator* validator) {
+    uint32_t index;
+    while (Next(&index)) {
+      WasmFunction* function = &menv_->module->functions->at(index);
+      TreeResult result =
+          VerifyWasmFunction(validator, menv_, module_start_, function);
+      if (result.failed()) AddError(index, result);
+    }
+  }
+
+  // Only valid once every call to {VerifyAll} has returned.
+  bool failed() const { return error_index_ != kNoError; }
+  uint32_t error_index() const { return error_index_; }
+  TreeResult& error() { return error_; }
+
+ private:
+  static const uint32_t kNoError = 0xffffffff;
+
+  // Returns the index of the next body to verify in {index}, or false.
+  bool Next(uint32_t* index) {
+    base::LockGuard<base::Mutex> guard(&mutex_);
+    std::vector<WasmFunction>* functions = menv_->module->functions;
+    while (next_ < functions->size() && next_ < error_index_) {
+      uint32_t i = next_++;
+      if (!functions->at(i).external) {
+        *index = i;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void AddError(uint32_t index, TreeResult& result) {
+    base::LockGuard<base::Mutex> guard(&mutex_);
+    if (index < error_index_) {
+      error_index_ = index;
+      error_.CopyFrom(result);
+    }
+  }
+
+  base::Mutex mutex_;
+  ModuleEnv* menv_;
+  const byte* module_start_;
+  uint32_t next_;
+  uint32_t error_index_;
+  TreeResult error_;
+};
+
+
+// A background task that verifies bodies from the queue with a validator of
+// its own until the queue is done.
+class WasmVerificationTask : public v8::Task {
+ public:
+  WasmVerificationTask(WasmVerificationQueue* queue, base::Semaphore* done)
+      : queue_(queue), done_(done) {}
+
+  void Run() override {
+    Zone zone;
+    WasmValidator validator(&zone);
+    queue_->VerifyAll(&validator);
+    done_->Signal();
+  }
+
+ private:
+  WasmVerificationQueue* queue_;
+  base::Semaphore* done_;
+};
+
+
 // The main logic for decoding the bytes of a module.
 class ModuleDecoder {
  public:
@@ -259,72 +657,87 @@ class ModuleDecoder {
       : module_zone(zone),
         start_(module_start),
         cur_(module_start),
-        end_(module_end) {
+        end_(module_end),
+        validator_(zone) {
     result_.start = start_;
     if (end_ < start_) {
       error(start_, "end is less than start");
       end_ = start_;
     }
+    module_size_ = end_ - start_;
   }
 
   // Decodes an entire module.
   ModuleResult DecodeModule(WasmModule* module, bool verify_functions = true) {
-    cur_ = start_;
+    return DecodeDeclarations(module, verify_functions);
+  }
+
+  // Decodes the declarations of a module, i.e. its header, globals,
+  // functions, data segments, and function table, from a prefix of the
+  // module bytes. Offsets into the rest of the module are checked against
+  // {module_size}, which is an upper bound until all bytes have arrived;
+  // {CheckOffsets} checks them again once the actual size is known.
+  ModuleResult DecodeModulePrefix(WasmModule* module, size_t module_size) {
+    module_size_ = module_size;
+    return DecodeDeclarations(module, false);
+  }
+
+  // Checks the offsets in the declarations of {module} against the size of
+  // the module bytes.
+  ModuleResult CheckOffsets(WasmModule* module) {
     result_.val = module;
-    module->module_start = start_;
-    module->module_end = end_;
-    module->mem_size_log2 = 0;
-    module->mem_export = false;
-    module->mem_external = false;
-    module->functions = new std::vector<WasmFunction>();
-    module->globals = new std::vector<WasmGlobal>();
-    module->data_segments = new std::vector<WasmDataSegment>();
+    for (const WasmGlobal& global : *module->globals) {
+      CheckOffset(global.name_offset);
+    }
+    for (const WasmFunction& function : *module->functions) {
+      CheckOffset(function.name_offset);
+      CheckOffset(function.code_start_offset);
+      CheckOffset(function.code_end_offset);
+    }
+    for (const WasmDataSegment& segment : *module->data_segments) {
+      CheckOffset(segment.source_offset);
+    }
+    return result_;
+  }
 
-    // Decode the module header.
-    module->mem_size_log2 = u8();    // read the memory size
-    module->mem_export = u8() != 0;  // read memory export option
+  // Returns the number of bytes of the declarations of a module starting at
+  // {start_}, or 0 if there are not yet enough bytes to tell.
+  size_t DeclarationsSize() {
+    static const size_t kHeaderSize = 8;
+    static const size_t kGlobalSize = 6;
+    static const size_t kFunctionSize = 24;  // plus one byte per parameter.
+    static const size_t kDataSegmentSize = 13;
 
+    size_t available = end_ - start_;
+    if (available < kHeaderSize) return 0;
+    cur_ = start_;
+    u8();                                  // skip the memory size
+    uint8_t flags = u8();                  // read the module flags
     uint32_t globals_count = u16();        // read number of globals
     uint32_t functions_count = u16();      // read number of functions
     uint32_t data_segments_count = u16();  // read number of data segments
 
-    // Decode globals.
-    for (uint32_t i = 0; i < globals_count; i++) {
-      if (result_.failed()) break;
-      module->globals->push_back({0, kMemInt32, 0, false});
-      WasmGlobal* global = &module->globals->back();
-      DecodeGlobalInModule(global);
-    }
-
-    // Set up module environment for verification.
-    ModuleEnv menv;
-    menv.module = module;
-    menv.globals_area = 0;
-    menv.mem_start = 0;
-    menv.mem_end = 0;
-    menv.function_code = nullptr;
-
-    // Decode functions.
+    size_t size = kHeaderSize + globals_count * kGlobalSize;
     for (uint32_t i = 0; i < functions_count; i++) {
-      if (result_.failed()) break;
-      module->functions->push_back({nullptr, 0, 0, 0, 0, 0, 0, false, false});
-      WasmFunction* function = &module->functions->back();
-      DecodeFunctionInModule(function, verify_functions);
-
-      if (result_.ok() && verify_functions) {
-        if (!function->external) VerifyFunctionBody(i, &menv, function);
-      }
+      if (size >= available) return 0;
+      size += kFunctionSize + start_[size];  // read parameter count
     }
-
-    // Decode data segments.
-    for (uint32_t i = 0; i < data_segments_count; i++) {
-      if (result_.failed()) break;
-      module->data_segments->push_back({0, 0, 0});
-      WasmDataSegment* segment = &module->data_segments->back();
-      DecodeDataSegmentInModule(segment);
+    size += data_segments_count * kDataSegmentSize;
+    if (flags & kModuleFunctionTable) {
+      if (size + 2 > available) return 0;
+      cur_ = start_ + size;
+      uint32_t signatures_count = u16();  // read number of signatures
+      size += 2;
+      for (uint32_t i = 0; i < signatures_count; i++) {
+        if (size >= available) return 0;
+        size += 2 + start_[size];  // read parameter count
+      }
+      if (size + 2 > available) return 0;
+      cur_ = start_ + size;
+      uint32_t entries_count = u16();  // read number of table entries
+      size += 2 + entries_count * 2;
     }
-
-    return result_;
+    return size <= available ? size : 0;
   }
 
   // Decodes a single anonymous function starting at {start_}.
@@ -365,7 +778,82 @@ class ModuleDecoder {
   const byte* start_;
   const byte* cur_;
   const byte* end_;
+  size_t module_size_;
   ModuleResult result_;
+  WasmValidator validator_;  // reused for the bodies verified on this thread.
+
+  // Decodes the declarations of a module starting at {start_}.
+  ModuleResult DecodeDeclarations(WasmModule* module, bool verify_functions) {
+    cur_ = start_;
+    result_.val = module;
+    module->module_start = start_;
+    module->module_end = end_;
+    module->mem_size_log2 = 0;
+    module->mem_export = false;
+    module->mem_external = false;
+    module->mem_growable = false;
+    module->functions = new std::vector<WasmFunction>();
+    module->globals = new std::vector<WasmGlobal>();
+    module->data_segments = new std::vector<WasmDataSegment>();
+    module->signatures = new std::vector<FunctionSig*>();
+    module->function_table = new std::vector<uint16_t>();
+    module->file = nullptr;
+
+    // Decode the module header.
+    module->mem_size_log2 = u8();  // read the memory size
+    uint8_t flags = u8();          // read the module flags
+    module->mem_export = (flags & kModuleMemExport) != 0;
+    module->mem_external = (flags & kModuleMemExternal) != 0;
+    module->mem_growable = (flags & kModuleMemGrowable) != 0;
+
+    uint32_t globals_count = u16();        // read number of globals
+    uint32_t functions_count = u16();      // read number of functions
+    uint32_t data_segments_count = u16();  // read number of data segments
+
+    // Decode globals.
+    for (uint32_t i = 0; i < globals_count; i++) {
+      if (result_.failed()) break;
+      module->globals->push_back({0, kMemInt32, 0, false});
+      WasmGlobal* global = &module->globals->back();
+      DecodeGlobalInModule(global);
+    }
+
+    // Decode functions.
+    for (uint32_t i = 0; i < functions_count; i++) {
+      if (result_.failed()) break;
+      module->functions->push_back({nullptr, 0, 0, 0, 0, 0, 0, false, false});
+      WasmFunction* function = &module->functions->back();
+      DecodeFunctionInModule(function, verify_functions);
+    }
+
+    // Decode data segments.
+    for (uint32_t i = 0; i < data_segments_count; i++) {
+      if (result_.failed()) break;
+      module->data_segments->push_back({0, 0, 0});
+      WasmDataSegment* segment = &module->data_segments->back();
+      DecodeDataSegmentInModule(segment);
+    }
+
+    // Decode the function table.
+    if (result_.ok() && (flags & kModuleFunctionTable)) {
+      DecodeFunctionTableInModule(module);
+    }
+
+    // Verify the function bodies, which may refer to any of the functions
+    // and signatures declared above.
+    if (result_.ok() && verify_functions) {
+      ModuleEnv menv;
+      menv.module = module;
+      menv.globals_area = 0;
+      menv.mem_start = 0;
+      menv.mem_end = 0;
+      menv.function_code = nullptr;
+
+      VerifyFunctionBodies(&menv);
+    }
+
+    return result_;
+  }
 
   uint32_t off(const byte* ptr) { return static_cast<uint32_t>(ptr - start_); }
 
@@ -399,37 +887,70 @@ class ModuleDecoder {
     segment->init = u8();
   }
 
+  // Decodes the signatures of indirect calls and the entries of the function
+  // table starting at {cur_}.
+  void DecodeFunctionTableInModule(WasmModule* module) {
+    uint32_t signatures_count = u16();  // read number of signatures
+    for (uint32_t i = 0; i < signatures_count; i++) {
+      if (result_.failed()) return;
+      module->signatures->push_back(sig());  // read signature
+    }
+    uint32_t entries_count = u16();  // read number of table entries
+    for (uint32_t i = 0; i < entries_count; i++) {
+      if (result_.failed()) return;
+      uint16_t index = u16();  // read function index
+      if (index >= module->functions->size()) {
+        error(cur_ - 2, "invalid function index in function table");
+        return;
+      }
+      module->function_table->push_back(index);
+    }
+  }
+
   // Verifies the body (code) of a given function.
   void VerifyFunctionBody(uint32_t func_num, ModuleEnv* menv,
                           WasmFunction* function) {
-    FunctionEnv fenv;
-    fenv.module = menv;
-    fenv.sig = function->sig;
-    fenv.local_int32_count = function->local_int32_count;
-    fenv.local_int64_count = function->local_int64_count;
-    fenv.local_float32_count = function->local_float32_count;
-    fenv.local_float64_count = function->local_float64_count;
-    fenv.SumLocals();
-
     TreeResult result =
-        VerifyWasmCode(&fenv, start_, start_ + function->code_start_offset,
-                       start_ + function->code_end_offset);
-    if (result.failed()) {
-      // Wrap the error message from the function decoder.
-      std::ostringstream str;
-      str << "in function #" << func_num << ": ";
-      // TODO(titzer): add function name for the user?
-      str << result;
-      const char* raw = str.str().c_str();
-      size_t len = strlen(raw);
-      char* buffer = new char[len];
-      strncpy(buffer, raw, len);
-      buffer[len - 1] = 0;
+        VerifyWasmFunction(&validator_, menv, start_, function);
+    if (result.failed()) FunctionError(func_num, result);
+  }
 
-      // Copy error code and location.
-      result_.CopyFrom(result);
-      result_.error_msg.Reset(buffer);
+  // Verifies the bodies of all functions that are not external, using up to
+  // {FLAG_wasm_num_compilation_tasks} background tasks in addition to the
+  // calling thread. Reports the error of the lowest failing function index.
+  void VerifyFunctionBodies(ModuleEnv* menv) {
+    WasmVerificationQueue queue(menv, start_);
+    base::Semaphore done(0);
+    size_t functions_count = menv->module->functions->size();
+    size_t num_tasks = 0;
+    if (FLAG_wasm_num_compilation_tasks > 0 && functions_count > 1) {
+      num_tasks = std::min(static_cast<size_t>(FLAG_wasm_num_compilation_tasks),
+                           functions_count - 1);
+    }
+    for (size_t i = 0; i < num_tasks; i++) {
+      V8::GetCurrentPlatform()->CallOnBackgroundThread(
+          new WasmVerificationTask(&queue, &done),
+          v8::Platform::kShortRunningTask);
     }
+    queue.VerifyAll(&validator_);
+    for (size_t i = 0; i < num_tasks; i++) done.Wait();
+    if (queue.failed()) FunctionError(queue.error_index(), queue.error());
+  }
+
+  // Reports the failed verification {result} of the function {func_num}.
+  void FunctionError(uint32_t func_num, TreeResult& result) {
+    // Wrap the error message from the function decoder.
+    std::ostringstream str;
+    str << "in function #" << func_num << ": ";
+    // TODO(titzer): add function name for the user?
+    str << result;
+    std::string message = str.str();
+    char* buffer = new char[message.size() + 1];
+    memcpy(buffer, message.c_str(), message.size() + 1);
+
+    // Copy error code and location.
+    result_.CopyFrom(result);
+    result_.error_msg.Reset(buffer);
   }
 
   // Reads a single 8-bit unsigned integer (byte) and advances.
@@ -478,12 +999,19 @@ class ModuleDecoder {
   // the offset is within bounds and advances.
   uint32_t offset() {
     uint32_t offset = u32();
-    if (offset > (end_ - start_)) {
+    if (offset > module_size_) {
       error(cur_ - sizeof(uint32_t), "offset out of bounds of module");
     }
     return offset;
   }
 
+  // Checks a single offset decoded earlier against the size of the module.
+  void CheckOffset(uint32_t offset) {
+    if (offset > module_size_) {
+      error(start_, "offset out of bounds of module");
+    }
+  }
+
   // Reads a single 32-bit unsigned integer interpreted as an offset into the
   // data and validating the string there and advances.
   uint32_t string() { return offset(); }  // TODO: validate string
@@ -596,80 +1124,1099 @@ size_t ComputeGlobalsSize(std::vector<WasmGlobal>* globals) {
   return globals_size;
 }
 
-void LoadDataSegments(WasmModule* module, byte* mem_addr, size_t mem_size) {
+// Loads the initialized data segments of {module} into its memory. If {file}
+// holds the module bytes, whole pages of the segments are mapped from it
+// copy-on-write, which requires memory that may be remapped.
+void LoadDataSegments(WasmModule* module, byte* mem_addr, size_t mem_size,
+                      const WasmModuleFile* file = nullptr) {
   for (const WasmDataSegment& segment : *module->data_segments) {
     if (!segment.init) continue;
     CHECK_LT(segment.dest_addr, mem_size);
     CHECK_LT(segment.source_size, mem_size);
     CHECK_LT(segment.dest_addr + segment.source_size, mem_size);
     byte* addr = mem_addr + segment.dest_addr;
-    memcpy(addr, module->module_start + segment.source_offset,
-           segment.source_size);
+    if (file != nullptr) {
+      file->CopyTo(addr, segment.source_offset, segment.source_size);
+    } else {
+      memcpy(addr, module->module_start + segment.source_offset,
+             segment.source_size);
+    }
   }
 }
-}  // namespace
 
 
-// Instantiates a wasm module as a JSObject.
-//  * allocates a backing store of {mem_size} bytes.
-//  * installs a named property "memory" for that buffer if exported
-//  * installs named properties on the object for exported functions
-//  * compiles wasm code to machine code
-MaybeHandle<JSObject> WasmModule::Instantiate(Isolate* isolate,
-                                              Handle<JSObject> ffi) {
-  this->shared_isolate = isolate;  // TODO: have a real shared isolate.
-  ErrorThrower thrower(isolate, "WasmModule::Instantiate()");
+// Compiles {function} with the baseline compiler. Returns a null handle if
+// the baseline compiler does not support the function.
+Handle<Code> CompileBaseline(Isolate* isolate, ModuleEnv* module_env,
+                             const WasmFunction* function, int index,
+                             int32_t* counter, Handle<Code> tier_up) {
+  FunctionEnv env;
+  env.module = module_env;
+  env.sig = function->sig;
+  env.local_int32_count = function->local_int32_count;
+  env.local_int64_count = function->local_int64_count;
+  env.local_float32_count = function->local_float32_count;
+  env.local_float64_count = function->local_float64_count;
+  env.SumLocals();
+  const byte* module_start = module_env->module->module_start;
+  Handle<Code> code = CompileWasmBaseline(
+      isolate, &env, module_start, module_start + function->code_start_offset,
+      module_start + function->code_end_offset, index, counter, tier_up);
+  if (!code.is_null()) TRACE("Baseline compiled WASM function #%d\n", index);
+  return code;
+}
 
-  Factory* factory = isolate->factory();
-  // Memory is bigger than maximum supported size.
-  if (mem_size_log2 > kMaxMemSize) {
-    thrower.Error("Out of memory: wasm memory too large");
-    return MaybeHandle<JSObject>();
-  }
 
-  Handle<Map> map = factory->NewMap(
-      JS_OBJECT_TYPE,
-      JSObject::kHeaderSize + kWasmModuleInternalFieldCount * kPointerSize);
+void LazyCompileCallback(const v8::FunctionCallbackInfo<v8::Value>& args);
+void TierUpCallback(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+
+// Compiles the functions of a module instance when the module is compiled
+// lazily, with the baseline compiler, or both.
+// With lazy compilation, functions are compiled upon their first call. Until
+// then, every call site of a function targets a lazy compile stub that is
+// shared by all functions of the same signature. The stub calls back into
+// the runtime, which identifies the callee from the call site, compiles it,
+// patches the call site, and returns the code to the stub, which then
+// performs the original call.
+// With the baseline compiler, functions are first compiled with it where
+// possible. Baseline code counts its invocations and loop iterations and,
+// once hot, calls back into the runtime to recompile the function with
+// TurboFan. Calls to the baseline code are then redirected to the new code;
+// activations of the baseline code that are already running finish in it.
+// Owned by the module object and deleted when it dies; all code that can
+// still call back into the runtime keeps the module object alive.
+class WasmInstanceCompiler {
+ public:
+  // Sets up the compiler for {module_object}, whose imports have already
+  // been compiled into the {linker}. Compiles the wrappers of exported
+  // functions and either the lazy compile stubs or, if not {lazy}, all
+  // functions. Function bodies are verified up front so that compiling them
+  // later cannot fail.
+  static bool Install(Isolate* isolate, WasmModule* module,
+                      Handle<JSObject> module_object, ModuleEnv* module_env,
+                      WasmLinker* linker, Handle<FixedArray> code_table,
+                      const std::vector<Handle<String>>& names, bool lazy,
+                      ErrorThrower& thrower) {
+    Factory* factory = isolate->factory();
+    WasmInstanceCompiler* compiler =
+        new WasmInstanceCompiler(isolate, module_env);
+    compiler->MakeWeak(module_object);
+    if (!compiler->Decode(module, thrower)) return false;
+
+    int count = static_cast<int>(module->functions->size());
+    Handle<FixedArray> data =
+        factory->NewFixedArray(kCompilerDataSize, TENURED);
+    Handle<FixedArray> link_table = factory->NewFixedArray(count, TENURED);
+    Handle<FixedArray> stub_table = factory->NewFixedArray(count, TENURED);
+    Handle<FixedArray> wrapper_table = factory->NewFixedArray(count, TENURED);
+    Handle<FixedArray> baseline_table = factory->NewFixedArray(count, TENURED);
+    data->set(kCompiler,
+              *factory->NewForeign(reinterpret_cast<Address>(compiler)));
+    data->set(kLinkTable, *link_table);
+    data->set(kStubTable, *stub_table);
+    data->set(kWrapperTable, *wrapper_table);
+    data->set(kBaselineTable, *baseline_table);
+    data->set(kTierUpWrapper, Smi::FromInt(0));
+    module_object->SetInternalField(kWasmModuleCompilerData, *data);
+    module_object->SetInternalField(kWasmModuleCodeTable, *code_table);
+    for (int i = 0; i < count; i++) {
+      link_table->set(i, *linker->GetFunctionCode(i));
+    }
 
-  //-------------------------------------------------------------------------
-  // Allocate the module object.
-  //-------------------------------------------------------------------------
-  Handle<JSObject> module = factory->NewJSObjectFromMap(map, TENURED);
-  Handle<FixedArray> code_table =
-      factory->NewFixedArray(static_cast<int>(functions->size()), TENURED);
+    if (UseBaselineCompiler()) {
+      compiler->counters_.Reset(new int32_t[count]);
+      memset(compiler->counters_.get(), 0, count * sizeof(int32_t));
+      // Baseline code calls the tier-up function with its function index.
+      static LocalType kTierUpParams[] = {kAstInt32};
+      FunctionSig tier_up_sig(0, 1, kTierUpParams);
+      Handle<JSFunction> tier_up_function =
+          NewCallbackFunction(isolate, TierUpCallback, module_object, 1);
+      Handle<Code> tier_up =
+          CompileWasmToJSWrapper(isolate, module_env, tier_up_function,
+                                 &tier_up_sig, "WASM tier-up wrapper");
+      if (tier_up.is_null()) {
+        thrower.Error("Compilation of tier-up wrapper failed.");
+        return false;
+      }
+      data->set(kTierUpWrapper, *tier_up);
+    }
 
-  //-------------------------------------------------------------------------
-  // Allocate the linear memory.
-  //-------------------------------------------------------------------------
-  uint32_t mem_size = 1 << mem_size_log2;
-  byte* mem_addr = nullptr;
-  Handle<JSArrayBuffer> mem_buffer =
-      NewArrayBuffer(isolate, mem_size, &mem_addr);
-  if (!mem_addr) {
+    if (lazy) {
+      // Compile one lazy compile stub per signature.
+      Handle<JSFunction> compile_function =
+          NewCallbackFunction(isolate, LazyCompileCallback, module_object, 0);
+      std::vector<std::pair<FunctionSig*, Handle<Code>>> stubs;
+      for (int i = 0; i < count; i++) {
+        const WasmFunction& func = module->functions->at(i);
+        if (func.external) continue;
+        Handle<Code> stub;
+        for (auto& entry : stubs) {
+          if (SameSignature(entry.first, func.sig)) stub = entry.second;
+        }
+        if (stub.is_null()) {
+          stub = CompileLazyCompileStub(isolate, module_env, compile_function,
+                                        func.sig);
+          if (stub.is_null()) {
+            thrower.Error("Compilation of lazy compile stub failed.");
+            return false;
+          }
+          stubs.push_back(std::make_pair(func.sig, stub));
+        }
+        stub_table->set(i, *stub);
+      }
+    } else {
+      // Compile all functions up front, then link them to each other.
+      for (int i = 0; i < count; i++) {
+        if (module->functions->at(i).external) continue;
+        code_table->set(i, *compiler->Compile(data, i, UseBaselineCompiler()));
+      }
+      for (int i = 0; i < count; i++) {
+        if (module->functions->at(i).external) continue;
+        compiler->LinkLazily(*data, *code_table, Code::cast(code_table->get(i)),
+                             i);
+      }
+    }
+
+    // Exported functions call their placeholder until linked below.
+    for (int i = 0; i < count; i++) {
+      const WasmFunction& func = module->functions->at(i);
+      if (func.external || !func.exported) continue;
+      Handle<JSFunction> function = CompileJSToWasmWrapper(
+          isolate, module_env, names[i], linker->GetFunctionCode(i), i);
+      wrapper_table->set(i, function->code());
+      compiler->LinkLazily(*data, *code_table, function->code(), count + i);
+      JSObject::AddProperty(module_object, names[i], function, READ_ONLY);
+    }
+    return true;
+  }
+
+  // Called from a lazy compile stub. Returns the code of the callee.
+  static Handle<Code> CompileCallee(Isolate* isolate,
+                                    Handle<JSObject> module_object) {
+    Handle<FixedArray> data = GetData(isolate, module_object);
+    Handle<FixedArray> code_table = GetCodeTable(isolate, module_object);
+    return FromData(*data)->CompileCallSite(data, code_table);
+  }
+
+  // Called from hot baseline code. Recompiles function {index} with TurboFan.
+  static void TierUp(Isolate* isolate, Handle<JSObject> module_object,
+                     int index) {
+    Handle<FixedArray> data = GetData(isolate, module_object);
+    Handle<FixedArray> code_table = GetCodeTable(isolate, module_object);
+    FromData(*data)->TierUp(data, code_table, index);
+  }
+
+ private:
+  // A call site is identified by its caller and the offset of the call in
+  // the caller's code. The caller is identified by the index of the calling
+  // function, or the number of functions plus the index of the function for
+  // the JS wrapper of an exported function, or twice the number of functions
+  // plus the index of the function for baseline code that has been replaced.
+  typedef std::pair<int, int> CallSite;
+
+  Isolate* isolate_;
+  Zone zone_;
+  base::SmartArrayPointer<byte> module_bytes_;
+  WasmModule* module_;
+  ModuleEnv module_env_;
+  Object** module_object_location_;
+  std::map<CallSite, int> call_sites_;
+  base::SmartArrayPointer<int32_t> counters_;
+
+  WasmInstanceCompiler(Isolate* isolate, ModuleEnv* module_env)
+      : isolate_(isolate),
+        module_(nullptr),
+        module_env_(*module_env),
+        module_object_location_(nullptr) {
+    module_env_.module = nullptr;
+    module_env_.linker = nullptr;
+    module_env_.function_code = nullptr;
+    // The handles of the traps die with the scope of {module_env}, and are
+    // created anew for each compilation.
+    module_env_.trap_stub = Handle<Code>::null();
+    module_env_.trap_context = Handle<Context>::null();
+    module_env_.trap_bounds_message = Handle<String>::null();
+    module_env_.trap_signature_message = Handle<String>::null();
+  }
+
+  ~WasmInstanceCompiler() {
+    if (module_object_location_) {
+      GlobalHandles::Destroy(module_object_location_);
+    }
+    if (module_) {
+      delete module_->functions;
+      delete module_->globals;
+      delete module_->data_segments;
+      delete module_->signatures;
+      delete module_->function_table;
+      delete module_;
+    }
+  }
+
+  static void WeakCallback(const v8::WeakCallbackData<v8::Value, void>& data) {
+    delete reinterpret_cast<WasmInstanceCompiler*>(data.GetParameter());
+  }
+
+  void MakeWeak(Handle<JSObject> module_object) {
+    Handle<Object> global = isolate_->global_handles()->Create(*module_object);
+    module_object_location_ = global.location();
+    GlobalHandles::MakeWeak(module_object_location_, this, &WeakCallback);
+  }
+
+  // Creates a function that calls {callback} with {module_object} as data.
+  // It is not cached, so that it does not keep {module_object} alive longer
+  // than the code that calls it.
+  static Handle<JSFunction> NewCallbackFunction(Isolate* isolate,
+                                                v8::FunctionCallback callback,
+                                                Handle<JSObject> module_object,
+                                                int length) {
+    v8::Isolate* api_isolate = reinterpret_cast<v8::Isolate*>(isolate);
+    v8::Local<v8::Function> local =
+        v8::Function::New(api_isolate->GetCurrentContext(), callback,
+                          v8::Utils::ToLocal(module_object), length)
+            .ToLocalChecked();
+    return Handle<JSFunction>::cast(v8::Utils::OpenHandle(*local));
+  }
+
+  static Handle<FixedArray> GetData(Isolate* isolate,
+                                    Handle<JSObject> module_object) {
+    return Handle<FixedArray>(
+        FixedArray::cast(
+            module_object->GetInternalField(kWasmModuleCompilerData)),
+        isolate);
+  }
+
+  static Handle<FixedArray> GetCodeTable(Isolate* isolate,
+                                         Handle<JSObject> module_object) {
+    return Handle<FixedArray>(
+        FixedArray::cast(module_object->GetInternalField(kWasmModuleCodeTable)),
+        isolate);
+  }
+
+  static WasmInstanceCompiler* FromData(FixedArray* data) {
+    return reinterpret_cast<WasmInstanceCompiler*>(
+        Foreign::cast(data->get(kCompiler))->foreign_address());
+  }
+
+  // The bytes of {module} do not outlive the instantiation, so decode and
+  // verify a private copy.
+  bool Decode(WasmModule* module, ErrorThrower& thrower) {
+    size_t size = module->module_end - module->module_start;
+    module_bytes_.Reset(new byte[size]);
+    memcpy(module_bytes_.get(), module->module_start, size);
+    const byte* start = module_bytes_.get();
+    ModuleResult result =
+        DecodeWasmModule(isolate_, &zone_, start, start + size, true);
+    module_ = result.val;
+    if (result.failed()) {
+      thrower.Failed("", result);
+      return false;
+    }
+    AllocateGlobalsOffsets(module_->globals);
+    module_->shared_isolate = isolate_;
+    module_env_.module = module_;
+    return true;
+  }
+
+  Handle<Code> CompileCallSite(Handle<FixedArray> data,
+                               Handle<FixedArray> code_table) {
+    CallSite site = FindCallSite(*data, *code_table);
+    auto entry = call_sites_.find(site);
+    CHECK(entry != call_sites_.end());
+    int index = entry->second;
+    call_sites_.erase(entry);
+
+    Handle<Code> code = GetOrCompile(data, code_table, index);
+    PatchCallSite(*data, *code_table, site, *code);
+    return code;
+  }
+
+  // Walks the stack to the caller of the lazy compile stub.
+  CallSite FindCallSite(FixedArray* data, FixedArray* code_table) {
+    DisallowHeapAllocation no_gc;
+    FixedArray* stub_table = FixedArray::cast(data->get(kStubTable));
+    StackFrameIterator it(isolate_);
+    while (!it.done() && !Contains(stub_table, it.frame()->LookupCode())) {
+      it.Advance();
+    }
+    CHECK(!it.done());
+    it.Advance();
+    CHECK(!it.done());
+    Code* caller = it.frame()->LookupCode();
+    Address pc = it.frame()->pc();
+
+    // The call site is the last call before the return address.
+    Address call_pc = nullptr;
+    for (RelocIterator r(caller, RelocInfo::kCodeTargetMask); !r.done();
+         r.next()) {
+      Address reloc_pc = r.rinfo()->pc();
+      if (reloc_pc < pc && reloc_pc > call_pc) call_pc = reloc_pc;
+    }
+    CHECK_NOT_NULL(call_pc);
+    return CallSite(GetCallerId(data, code_table, caller),
+                    static_cast<int>(call_pc - caller->instruction_start()));
+  }
+
+  static bool Contains(FixedArray* table, Object* object) {
+    for (int i = 0; i < table->length(); i++) {
+      if (table->get(i) == object) return true;
+    }
+    return false;
+  }
+
+  static int GetCallerId(FixedArray* data, FixedArray* code_table,
+                         Code* caller) {
+    FixedArray* wrapper_table = FixedArray::cast(data->get(kWrapperTable));
+    FixedArray* baseline_table = FixedArray::cast(data->get(kBaselineTable));
+    int count = code_table->length();
+    for (int i = 0; i < count; i++) {
+      if (code_table->get(i) == caller) return i;
+      if (wrapper_table->get(i) == caller) return count + i;
+      if (baseline_table->get(i) == caller) return 2 * count + i;
+    }
+    UNREACHABLE();
+    return -1;
+  }
+
+  static Code* GetCaller(FixedArray* data, FixedArray* code_table,
+                         int caller_id) {
+    int count = code_table->length();
+    if (caller_id < count) return Code::cast(code_table->get(caller_id));
+    if (caller_id < 2 * count) {
+      FixedArray* wrapper_table = FixedArray::cast(data->get(kWrapperTable));
+      return Code::cast(wrapper_table->get(caller_id - count));
+    }
+    FixedArray* baseline_table = FixedArray::cast(data->get(kBaselineTable));
+    return Code::cast(baseline_table->get(caller_id - 2 * count));
+  }
+
+  // Compiles function {index}, with the baseline compiler if {baseline} and
+  // possible, otherwise with TurboFan. Calls in the new code target the
+  // placeholders and import wrappers.
+  Handle<Code> Compile(Handle<FixedArray> data, int index, bool baseline) {
+    Handle<FixedArray> link_table(FixedArray::cast(data->get(kLinkTable)),
+                                  isolate_);
+    std::vector<Handle<Code>> function_code;
+    for (int i = 0; i < link_table->length(); i++) {
+      function_code.push_back(
+          Handle<Code>(Code::cast(link_table->get(i)), isolate_));
+    }
+    module_env_.function_code = &function_code;
+    InitIndirectCallTraps(isolate_, &module_env_);
+
+    const WasmFunction* function = &module_->functions->at(index);
+    Handle<Code> code;
+    if (baseline) {
+      Handle<Code> tier_up(Code::cast(data->get(kTierUpWrapper)), isolate_);
+      code = CompileBaseline(isolate_, &module_env_, function, index,
+                             &counters_[index], tier_up);
+    }
+    if (code.is_null()) {
+      ErrorThrower thrower(isolate_, "WASM compilation");
+      WasmCompilationUnit unit(isolate_, &module_env_, function, index);
+      unit.BuildGraph();
+      code = unit.FinishCompilation(thrower);
+      // The function was verified upon instantiation.
+      CHECK(!code.is_null());
+    }
+    module_env_.function_code = nullptr;
+    return code;
+  }
+
+  Handle<Code> GetOrCompile(Handle<FixedArray> data,
+                            Handle<FixedArray> code_table, int index) {
+    if (code_table->get(index)->IsCode()) {
+      return Handle<Code>(Code::cast(code_table->get(index)), isolate_);
+    }
+    Handle<Code> code = Compile(data, index, UseBaselineCompiler());
+    TRACE("Lazily compiled WASM function #%d\n", index);
+    code_table->set(index, *code);
+    LinkLazily(*data, *code_table, *code, index);
+    return code;
+  }
+
+  void TierUp(Handle<FixedArray> data, Handle<FixedArray> code_table,
+              int index) {
+    // Never count again, even in activations of the baseline code that are
+    // still running.
+    counters_[index] = kMinInt;
+
+    Handle<Code> code = Compile(data, index, false);
+    TRACE("Tiered up WASM function #%d\n", index);
+
+    DisallowHeapAllocation no_gc;
+    Code* old_code = Code::cast(code_table->get(index));
+    FixedArray* baseline_table = FixedArray::cast(data->get(kBaselineTable));
+    baseline_table->set(index, old_code);
+
+    // Pending call sites in the old code keep working.
+    int count = code_table->length();
+    std::map<CallSite, int> call_sites;
+    for (auto& entry : call_sites_) {
+      CallSite site = entry.first;
+      if (site.first == index) site.first = 2 * count + index;
+      call_sites[site] = entry.second;
+    }
+    call_sites_.swap(call_sites);
+
+    code_table->set(index, *code);
+    LinkLazily(*data, *code_table, *code, index);
+
+    // Redirect all calls to the old code.
+    FixedArray* wrapper_table = FixedArray::cast(data->get(kWrapperTable));
+    for (int i = 0; i < count; i++) {
+      Retarget(code_table->get(i), old_code, *code);
+      Retarget(wrapper_table->get(i), old_code, *code);
+      Retarget(baseline_table->get(i), old_code, *code);
+    }
+  }
+
+  // Patches the calls to {from} in {caller}, if it is code, to call {to}.
+  static void Retarget(Object* caller, Code* from, Code* to) {
+    if (!caller->IsCode()) return;
+    Code* code = Code::cast(caller);
+    bool modified = false;
+    for (RelocIterator it(code, RelocInfo::kCodeTargetMask); !it.done();
+         it.next()) {
+      Code* target =
+          Code::GetCodeFromTargetAddress(it.rinfo()->target_address());
+      if (target != from) continue;
+      it.rinfo()->set_target_address(to->instruction_start(),
+                                     UPDATE_WRITE_BARRIER, SKIP_ICACHE_FLUSH);
+      modified = true;
+    }
+    if (modified) {
+      CpuFeatures::FlushICache(code->instruction_start(),
+                               code->instruction_size());
+    }
+  }
+
+  // Patches the calls to placeholders in {code} to call either the compiled
+  // callee or its lazy compile stub, recording the call site in the latter
+  // case.
+  void LinkLazily(FixedArray* data, FixedArray* code_table, Code* code,
+                  int caller_id) {
+    DisallowHeapAllocation no_gc;
+    FixedArray* stub_table = FixedArray::cast(data->get(kStubTable));
+    bool modified = false;
+    for (RelocIterator it(code, RelocInfo::kCodeTargetMask); !it.done();
+         it.next()) {
+      Code* target =
+          Code::GetCodeFromTargetAddress(it.rinfo()->target_address());
+      if (target->kind() != Code::PLACEHOLDER) continue;
+      int index = target->constant_pool_offset();
+      Object* callee = code_table->get(index);
+      if (!callee->IsCode()) {
+        int offset =
+            static_cast<int>(it.rinfo()->pc() - code->instruction_start());
+        call_sites_[CallSite(caller_id, offset)] = index;
+        callee = stub_table->get(index);
+      }
+      it.rinfo()->set_target_address(Code::cast(callee)->instruction_start(),
+                                     UPDATE_WRITE_BARRIER, SKIP_ICACHE_FLUSH);
+      modified = true;
+    }
+    if (modified) {
+      CpuFeatures::FlushICache(code->instruction_start(),
+                               code->instruction_size());
+    }
+  }
+
+  void PatchCallSite(FixedArray* data, FixedArray* code_table, CallSite site,
+                     Code* target) {
+    DisallowHeapAllocation no_gc;
+    Code* caller = GetCaller(data, code_table, site.first);
+    Address pc = caller->instruction_start() + site.second;
+    for (RelocIterator it(caller, RelocInfo::kCodeTargetMask); !it.done();
+         it.next()) {
+      if (it.rinfo()->pc() != pc) continue;
+      it.rinfo()->set_target_address(target->instruction_start(),
+                                     UPDATE_WRITE_BARRIER, SKIP_ICACHE_FLUSH);
+      CpuFeatures::FlushICache(caller->instruction_start(),
+                               caller->instruction_size());
+      return;
+    }
+    UNREACHABLE();
+  }
+};
+
+
+void LazyCompileCallback(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  Isolate* isolate = reinterpret_cast<Isolate*>(args.GetIsolate());
+  HandleScope scope(isolate);
+  Handle<JSObject> module_object =
+      Handle<JSObject>::cast(v8::Utils::OpenHandle(*args.Data()));
+  Handle<Code> code =
+      WasmInstanceCompiler::CompileCallee(isolate, module_object);
+  // The stub calls the returned code object directly.
+  args.GetReturnValue().Set(v8::Utils::ToLocal(Handle<Object>::cast(code)));
+}
+
+
+void TierUpCallback(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  Isolate* isolate = reinterpret_cast<Isolate*>(args.GetIsolate());
+  HandleScope scope(isolate);
+  Handle<JSObject> module_object =
+      Handle<JSObject>::cast(v8::Utils::OpenHandle(*args.Data()));
+  // The tier-up wrapper passes the function index as a small integer.
+  int index = Smi::cast(*v8::Utils::OpenHandle(*args[0]))->value();
+  WasmInstanceCompiler::TierUp(isolate, module_object, index);
+}
+
+
+// Internal constants for the layout of compiled module code, which is also
+// the layout of a code cache entry.
+const int kCompiledSize = 3;
+const int kCompiledCodeTable = 0;
+const int kCompiledWrapperTable = 1;
+const int kCompiledSentinels = 2;
+
+// Internal constants for the layout of the compiled module object.
+const int kWasmCompiledModuleInternalFieldCount = 4;
+const int kWasmCompiledModuleMarker = 0;
+const int kWasmCompiledModuleCode = 1;
+const int kWasmCompiledModuleBytes = 2;
+const int kWasmCompiledModuleFile = 3;
+const int kWasmCompiledModuleMarkerValue = 0x4d5357;
+
+// Internal constants for the objects an instance's code refers to.
+const int kInstanceObjectCount = 4;
+const int kInstanceMemBuffer = 0;
+const int kInstanceGlobalsBuffer = 1;
+const int kInstanceFunctionTable = 2;
+const int kInstanceImportTable = 3;
+
+
+// A cache of compiled module code, keyed by the module bytes and the flags
+// that affect code generation. An entry holds the function code and the
+// JS->WASM wrappers of a module, which refer to sentinels instead of the
+// memory and globals buffers of an instance and call imported functions
+// through placeholders.
+// The cache is a fixed array that hangs off the global object of the native
+// context as a hidden property, so that it dies with the context. Without a
+// context, nothing is cached.
+class WasmCodeCache {
+ public:
+  explicit WasmCodeCache(Isolate* isolate) : isolate_(isolate) {
+    if (isolate->context() == nullptr) return;
+    Handle<JSObject> global(isolate->native_context()->global_object(),
+                            isolate);
+    Handle<String> key = Key(isolate);
+    Handle<Object> cache(global->GetHiddenProperty(key), isolate);
+    if (cache->IsFixedArray()) {
+      cache_ = Handle<FixedArray>::cast(cache);
+      return;
+    }
+    cache_ = isolate->factory()->NewFixedArray(
+        kHeaderSize + kMaxEntries * kEntrySize, TENURED);
+    cache_->set(kHits, Smi::FromInt(0));
+    cache_->set(kMisses, Smi::FromInt(0));
+    cache_->set(kCount, Smi::FromInt(0));
+    JSObject::SetHiddenProperty(global, key, cache_);
+  }
+
+  bool is_available() const { return !cache_.is_null(); }
+
+  static WasmCodeCacheStatistics GetStatistics(Isolate* isolate) {
+    WasmCodeCacheStatistics stats = {0, 0, 0};
+    WasmCodeCache cache(isolate);
+    if (cache.is_available()) {
+      stats.hits = cache.Get(kHits);
+      stats.misses = cache.Get(kMisses);
+      stats.entries = cache.Get(kCount);
+    }
+    return stats;
+  }
+
+  // Returns the entry for the bytes of {module}, counting a hit or a miss.
+  MaybeHandle<FixedArray> Lookup(WasmModule* module) {
+    DCHECK(is_available());
+    int size = static_cast<int>(module->module_end - module->module_start);
+    int hash = BytesHash(module);
+    int flags_hash = CodegenFlagsHash();
+    for (int i = 0; i < Get(kCount); i++) {
+      int entry = kHeaderSize + i * kEntrySize;
+      if (Get(entry + kEntryHash) != hash ||
+          Get(entry + kEntryFlagsHash) != flags_hash ||
+          Get(entry + kEntryLength) != size) {
+        continue;
+      }
+      const byte* bytes = EntryBytes(cache_->get(entry + kEntryBytes), size);
+      if (bytes == nullptr ||
+          memcmp(bytes, module->module_start, size) != 0) {
+        continue;
+      }
+      Increment(kHits);
+      TRACE("WASM code cache hit\n");
+      return Handle<FixedArray>(
+          FixedArray::cast(cache_->get(entry + kEntryCode)), isolate_);
+    }
+    Increment(kMisses);
+    TRACE("WASM code cache miss\n");
+    return MaybeHandle<FixedArray>();
+  }
+
+  // Adds {data} as the entry for the bytes of {module}, evicting the oldest
+  // entry if the cache is full. If {bytes_buffer} holds the bytes of
+  // {module}, the entry refers to it instead of keeping a copy of the bytes.
+  void Insert(WasmModule* module, Handle<FixedArray> data,
+              Handle<JSArrayBuffer> bytes_buffer) {
+    DCHECK(is_available());
+    int size = static_cast<int>(module->module_end - module->module_start);
+    Handle<Object> bytes = bytes_buffer;
+    if (bytes_buffer.is_null()) {
+      Handle<ByteArray> copy =
+          isolate_->factory()->NewByteArray(size, TENURED);
+      memcpy(copy->GetDataStartAddress(), module->module_start, size);
+      bytes = copy;
+    }
+    int count = Get(kCount);
+    if (count == kMaxEntries) {
+      // Shift the entries down over the oldest one.
+      for (int i = kHeaderSize + kEntrySize; i < cache_->length(); i++) {
+        cache_->set(i - kEntrySize, cache_->get(i));
+      }
+      count--;
+    }
+    int entry = kHeaderSize + count * kEntrySize;
+    cache_->set(entry + kEntryBytes, *bytes);
+    cache_->set(entry + kEntryLength, Smi::FromInt(size));
+    cache_->set(entry + kEntryHash, Smi::FromInt(BytesHash(module)));
+    cache_->set(entry + kEntryFlagsHash, Smi::FromInt(CodegenFlagsHash()));
+    cache_->set(entry + kEntryCode, *data);
+    cache_->set(kCount, Smi::FromInt(count + 1));
+  }
+
+ private:
+  static const int kMaxEntries = 16;
+
+  // The layout of the cache.
+  static const int kHits = 0;
+  static const int kMisses = 1;
+  static const int kCount = 2;
+  static const int kHeaderSize = 3;
+
+  // The layout of an entry.
+  static const int kEntryBytes = 0;  // the buffer of the bytes, or a copy.
+  static const int kEntryLength = 1;  // the number of bytes.
+  static const int kEntryHash = 2;
+  static const int kEntryFlagsHash = 3;
+  static const int kEntryCode = 4;
+  static const int kEntrySize = 5;
+
+  Isolate* isolate_;
+  Handle<FixedArray> cache_;
+
+  static Handle<String> Key(Isolate* isolate) {
+    return isolate->factory()->InternalizeUtf8String("wasm code cache");
+  }
+
+  static int BytesHash(WasmModule* module) {
+    size_t hash = base::hash_range(module->module_start, module->module_end);
+    return static_cast<int>(hash & Smi::kMaxValue);
+  }
+
+  // Returns the {size} bytes of an entry, or {nullptr} if its buffer has
+  // been neutered since.
+  static const byte* EntryBytes(Object* bytes, int size) {
+    if (bytes->IsByteArray()) {
+      return ByteArray::cast(bytes)->GetDataStartAddress();
+    }
+    JSArrayBuffer* buffer = JSArrayBuffer::cast(bytes);
+    if (buffer->byte_length()->Number() < size) return nullptr;
+    return reinterpret_cast<const byte*>(buffer->backing_store());
+  }
+
+  int Get(int index) { return Smi::cast(cache_->get(index))->value(); }
+
+  void Increment(int index) {
+    cache_->set(index, Smi::FromInt(Get(index) + 1));
+  }
+};
+
+
+// Redirects the calls in copied {code} from the original code to the copies
+// in {targets}, and replaces embedded references to objects in {from} with
+// the corresponding objects in {to}.
+void RelocateCopiedCode(Code* code, const std::map<Address, Code*>& targets,
+                        FixedArray* from, FixedArray* to) {
+  int mode_mask = RelocInfo::kCodeTargetMask |
+                  RelocInfo::ModeMask(RelocInfo::EMBEDDED_OBJECT);
+  for (RelocIterator it(code, mode_mask); !it.done(); it.next()) {
+    RelocInfo::Mode mode = it.rinfo()->rmode();
+    if (RelocInfo::IsCodeTarget(mode)) {
+      auto target = targets.find(it.rinfo()->target_address());
+      if (target == targets.end()) continue;
+      it.rinfo()->set_target_address(target->second->instruction_start(),
+                                     UPDATE_WRITE_BARRIER, SKIP_ICACHE_FLUSH);
+    } else {
+      Object* object = it.rinfo()->target_object();
+      for (int i = 0; i < from->length(); i++) {
+        if (object != from->get(i)) continue;
+        it.rinfo()->set_target_object(to->get(i), UPDATE_WRITE_BARRIER,
+                                      SKIP_ICACHE_FLUSH);
+        break;
+      }
+    }
+  }
+  CpuFeatures::FlushICache(code->instruction_start(), code->instruction_size());
+}
+
+
+// Returns true if {code} embeds none of the objects in {from} and calls no
+// function code in {indices} that is not {shared}.
+bool IsInstanceIndependent(Code* code, FixedArray* from,
+                           const std::map<Address, int>& indices,
+                           const std::vector<bool>& shared) {
+  int mode_mask = RelocInfo::kCodeTargetMask |
+                  RelocInfo::ModeMask(RelocInfo::EMBEDDED_OBJECT);
+  for (RelocIterator it(code, mode_mask); !it.done(); it.next()) {
+    if (RelocInfo::IsCodeTarget(it.rinfo()->rmode())) {
+      auto index = indices.find(it.rinfo()->target_address());
+      if (index != indices.end() && !shared[index->second]) return false;
+    } else {
+      Object* object = it.rinfo()->target_object();
+      for (int i = 0; i < from->length(); i++) {
+        if (!from->get(i)->IsSmi() && object == from->get(i)) return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+// Copies the function code in {code_table} and the wrapper code in
+// {wrapper_table} into {new_code_table} and {new_wrapper_table}. The copies
+// call each other, and refer to the objects in {to} wherever the originals
+// refer to the objects in {from}. Slots of {new_code_table} that already
+// hold code, e.g. the wrappers of imported functions, are not overwritten;
+// calls to the original code of such slots are redirected to that code.
+// Code that refers to no instance object and only calls such code, e.g.
+// functions that access neither memory nor globals, is installed without
+// copying, and shared by all instances. So are shared wrappers.
+// All other code is copied: it embeds the objects of its instance, since
+// WASM code has no instance parameter through which an indirection could
+// reach them, and the JS->WASM wrappers, imports, and function tables call
+// it without one.
+void CopyInstanceCode(Isolate* isolate, WasmModule* module,
+                      Handle<FixedArray> code_table,
+                      Handle<FixedArray> wrapper_table,
+                      Handle<FixedArray> new_code_table,
+                      Handle<FixedArray> new_wrapper_table,
+                      Handle<FixedArray> from, Handle<FixedArray> to) {
+  Factory* factory = isolate->factory();
+  int count = code_table->length();
+  std::vector<bool> shared_wrapper(count, false);
+  for (int i = 0; i < count; i++) {
+    if (!wrapper_table->get(i)->IsCode()) continue;
+    shared_wrapper[i] = IsSharedJSToWasmWrapper(
+        isolate, Code::cast(wrapper_table->get(i)),
+        module->functions->at(i).sig);
+  }
+
+  // Find the instance-independent function code, assuming that all of it is
+  // until a function turns out to call code that is not.
+  std::vector<bool> shared(count, false);
+  std::vector<bool> wrapper_shared(count, false);
+  {
+    DisallowHeapAllocation no_gc;
+    std::map<Address, int> indices;
+    for (int i = 0; i < count; i++) {
+      if (!code_table->get(i)->IsCode()) continue;
+      indices[Code::cast(code_table->get(i))->instruction_start()] = i;
+      shared[i] = !new_code_table->get(i)->IsCode();
+    }
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int i = 0; i < count; i++) {
+        if (shared[i] && !IsInstanceIndependent(Code::cast(code_table->get(i)),
+                                                *from, indices, shared)) {
+          shared[i] = false;
+          changed = true;
+        }
+      }
+    }
+    for (int i = 0; i < count; i++) {
+      if (!wrapper_table->get(i)->IsCode()) continue;
+      Code* code = Code::cast(wrapper_table->get(i));
+      wrapper_shared[i] = shared_wrapper[i] ||
+                          IsInstanceIndependent(code, *from, indices, shared);
+    }
+  }
+
+  std::vector<bool> copied(count, false);
+  std::vector<bool> wrapper_copied(count, false);
+  for (int i = 0; i < count; i++) {
+    if (code_table->get(i)->IsCode() && !new_code_table->get(i)->IsCode()) {
+      Handle<Code> code(Code::cast(code_table->get(i)), isolate);
+      if (shared[i]) {
+        new_code_table->set(i, *code);
+      } else {
+        new_code_table->set(i, *factory->CopyCode(code));
+        copied[i] = true;
+      }
+    }
+    if (wrapper_table->get(i)->IsCode()) {
+      Handle<Code> code(Code::cast(wrapper_table->get(i)), isolate);
+      if (wrapper_shared[i]) {
+        new_wrapper_table->set(i, *code);
+      } else {
+        new_wrapper_table->set(i, *factory->CopyCode(code));
+        wrapper_copied[i] = true;
+      }
+    }
+  }
+
+  DisallowHeapAllocation no_gc;
+  std::map<Address, Code*> targets;
+  for (int i = 0; i < count; i++) {
+    if (!code_table->get(i)->IsCode() || shared[i]) continue;
+    targets[Code::cast(code_table->get(i))->instruction_start()] =
+        Code::cast(new_code_table->get(i));
+  }
+  for (int i = 0; i < count; i++) {
+    if (copied[i]) {
+      RelocateCopiedCode(Code::cast(new_code_table->get(i)), targets, *from,
+                         *to);
+    }
+    if (wrapper_copied[i]) {
+      RelocateCopiedCode(Code::cast(new_wrapper_table->get(i)), targets,
+                         *from, *to);
+    }
+  }
+}
+
+// Creates the import table of an instance of {module}, which holds the
+// imported JSFunctions by function index.
+Handle<FixedArray> NewImportTable(Isolate* isolate, WasmModule* module) {
+  return isolate->factory()->NewFixedArray(
+      static_cast<int>(module->functions->size()), TENURED);
+}
+
+
+// Creates the sentinel buffers, function table, and import table which
+// compiled code of {module} refers to instead of the memory, globals,
+// function table, and imports of an instance.
+Handle<FixedArray> NewInstanceSentinels(Isolate* isolate, WasmModule* module) {
+  Factory* factory = isolate->factory();
+  Handle<FixedArray> sentinels =
+      factory->NewFixedArray(kInstanceObjectCount, TENURED);
+  for (int i = kInstanceMemBuffer; i <= kInstanceGlobalsBuffer; i++) {
+    Handle<JSArrayBuffer> sentinel =
+        factory->NewJSArrayBuffer(SharedFlag::kNotShared, TENURED);
+    JSArrayBuffer::Setup(sentinel, isolate, true, nullptr, 0);
+    sentinels->set(i, *sentinel);
+  }
+  if (module->function_table->empty()) {
+    sentinels->set(kInstanceFunctionTable, Smi::FromInt(0));
+  } else {
+    sentinels->set(kInstanceFunctionTable, *NewFunctionTable(isolate, module));
+  }
+  sentinels->set(kInstanceImportTable, Smi::FromInt(0));
+  for (const WasmFunction& func : *module->functions) {
+    if (!func.external) continue;
+    sentinels->set(kInstanceImportTable, *NewImportTable(isolate, module));
+    break;
+  }
+  return sentinels;
+}
+
+
+// Sets up {module_env} for compiling {module} into code that refers to
+// {sentinels} instead of the memory and globals of an instance.
+void InitCompiledModuleEnv(Isolate* isolate, WasmModule* module,
+                           WasmLinker* linker, Handle<FixedArray> sentinels,
+                           ModuleEnv* module_env) {
+  AllocateGlobalsOffsets(module->globals);
+  module_env->module = module;
+  // Only the size of the memory is known.
+  module_env->mem_start = 0;
+  module_env->mem_end = static_cast<uintptr_t>(1) << module->mem_size_log2;
+  module_env->globals_area = 0;
+  module_env->mem_buffer = Handle<JSArrayBuffer>(
+      JSArrayBuffer::cast(sentinels->get(kInstanceMemBuffer)), isolate);
+  if (ComputeGlobalsSize(module->globals) > 0) {
+    module_env->globals_buffer = Handle<JSArrayBuffer>(
+        JSArrayBuffer::cast(sentinels->get(kInstanceGlobalsBuffer)), isolate);
+  }
+  if (sentinels->get(kInstanceFunctionTable)->IsFixedArray()) {
+    module_env->function_table = Handle<FixedArray>(
+        FixedArray::cast(sentinels->get(kInstanceFunctionTable)), isolate);
+  }
+  if (sentinels->get(kInstanceImportTable)->IsFixedArray()) {
+    module_env->import_table = Handle<FixedArray>(
+        FixedArray::cast(sentinels->get(kInstanceImportTable)), isolate);
+  }
+  InitIndirectCallTraps(isolate, module_env);
+  module_env->linker = linker;
+  module_env->function_code = nullptr;
+}
+
+
+// Generates the code for the units in {queue}, which are in function order,
+// and the wrappers of exported functions, and links them into compiled
+// module code.
+MaybeHandle<FixedArray> FinishCompiledModule(Isolate* isolate,
+                                             ModuleEnv* module_env,
+                                             WasmCompilationQueue* queue,
+                                             Handle<FixedArray> sentinels,
+                                             ErrorThrower& thrower) {
+  Factory* factory = isolate->factory();
+  WasmModule* module = module_env->module;
+  WasmLinker* linker = module_env->linker;
+  int count = static_cast<int>(module->functions->size());
+
+  // Generate code on this thread, in function order so that errors are
+  // reported deterministically.
+  Handle<FixedArray> code_table = factory->NewFixedArray(count, TENURED);
+  Handle<FixedArray> wrapper_table = factory->NewFixedArray(count, TENURED);
+  for (size_t i = 0; i < queue->size(); i++) {
+    WasmCompilationUnit* unit = queue->WaitForGraph(i);
+    int func_index = unit->index();
+    const WasmFunction& func = *unit->function();
+    Handle<Code> code = unit->FinishCompilation(thrower);
+    queue->Release(i);
+    if (code.is_null()) {
+      thrower.Error("Compilation of #%d:%s failed.", func_index,
+                    module->GetName(func.name_offset));
+      return MaybeHandle<FixedArray>();
+    }
+    // Install the code into the linker table.
+    linker->Finish(func_index, code);
+    code_table->set(func_index, *code);
+    if (func.exported && module_env->UsesMemBaseParam()) {
+      Handle<String> name =
+          factory->InternalizeUtf8String(module->GetName(func.name_offset));
+      Handle<JSFunction> function = CompileJSToWasmWrapper(
+          isolate, module_env, name, code, func_index);
+      wrapper_table->set(func_index, function->code());
+    } else if (func.exported) {
+      // The wrapper calls the code of the function it is installed on, and
+      // is therefore shared with all functions of the same signature.
+      wrapper_table->set(func_index, *GetSharedJSToWasmWrapper(
+                                         isolate, module_env, func.sig));
+    }
+  }
+
+  // Patch all direct call sites. Calls to imported functions keep calling
+  // their placeholders, which instantiation replaces with the shared import
+  // wrappers, passing the functions from the import table.
+  linker->Link();
+  int index = 0;
+  for (const WasmFunction& func : *module->functions) {
+    if (func.external) code_table->set(index, *linker->GetFunctionCode(index));
+    index++;
+  }
+
+  Handle<FixedArray> compiled = factory->NewFixedArray(kCompiledSize, TENURED);
+  compiled->set(kCompiledCodeTable, *code_table);
+  compiled->set(kCompiledWrapperTable, *wrapper_table);
+  compiled->set(kCompiledSentinels, *sentinels);
+  return compiled;
+}
+}  // namespace
+
+
+// Instantiates a wasm module as a JSObject.
+//  * allocates a backing store of {mem_size} bytes, unless {memory} is given.
+//  * installs a named property "memory" for that buffer if exported
+//  * installs named properties on the object for exported functions
+//  * compiles wasm code to machine code
+MaybeHandle<JSObject> WasmModule::Instantiate(
+    Isolate* isolate, Handle<JSObject> ffi,
+    MaybeHandle<FixedArray> compiled_code, Handle<JSArrayBuffer> memory) {
+  this->shared_isolate = isolate;  // TODO: have a real shared isolate.
+  ErrorThrower thrower(isolate, "WasmModule::Instantiate()");
+
+  Factory* factory = isolate->factory();
+  // Memory is bigger than maximum supported size.
+  if (mem_size_log2 > kMaxMemSize) {
+    thrower.Error("Out of memory: wasm memory too large");
+    return MaybeHandle<JSObject>();
+  }
+
+  Handle<Map> map = factory->NewMap(
+      JS_OBJECT_TYPE,
+      JSObject::kHeaderSize + kWasmModuleInternalFieldCount * kPointerSize);
+
+  //-------------------------------------------------------------------------
+  // Allocate the module object.
+  //-------------------------------------------------------------------------
+  Handle<JSObject> module = factory->NewJSObjectFromMap(map, TENURED);
+  Handle<FixedArray> code_table =
+      factory->NewFixedArray(static_cast<int>(functions->size()), TENURED);
+
+  //-------------------------------------------------------------------------
+  // Allocate the linear memory.
+  //-------------------------------------------------------------------------
+  uint32_t mem_size = 1 << mem_size_log2;
+  byte* mem_addr = nullptr;
+  // Data segments are mapped from the module file into memory that the
+  // engine maps itself, so that pages which are never touched cost nothing.
+  const WasmModuleFile* segment_file =
+      UseCopyOnWriteDataSegments() && memory.is_null() ? file : nullptr;
+  Handle<JSArrayBuffer> mem_buffer;
+  if (!memory.is_null() && mem_growable) {
+    // Only memory in a reservation of its own can grow in place.
+    thrower.Error("External memory cannot grow");
+    return MaybeHandle<JSObject>();
+  } else if (!memory.is_null()) {
+    // The memory is shared with whoever else holds {memory}. Compiled code
+    // accesses the declared size.
+    mem_addr = reinterpret_cast<byte*>(memory->backing_store());
+    if (memory->byte_length()->Number() < mem_size) {
+      thrower.Error("External memory is smaller than %u bytes", mem_size);
+      return MaybeHandle<JSObject>();
+    }
+    mem_buffer = NewExternalArrayBuffer(isolate, memory);
+  } else if (mem_external) {
+    thrower.Error("Memory is external, but none was supplied");
+    return MaybeHandle<JSObject>();
+  } else if (mem_growable) {
+    // Growable memory is placed at the start of a reservation that it can
+    // grow into.
+    mem_buffer = NewGrowableArrayBuffer(isolate, mem_size, &mem_addr);
+  } else if (segment_file != nullptr) {
+    mem_buffer = NewMappedArrayBuffer(isolate, mem_size, &mem_addr);
+  } else {
+    mem_buffer = NewArrayBuffer(isolate, mem_size, &mem_addr);
+  }
+  if (!mem_addr) {
     // Not enough space for backing store of memory
     thrower.Error("Out of memory: wasm memory");
     return MaybeHandle<JSObject>();
   }
 
   // Load initialized data segments.
-  LoadDataSegments(this, mem_addr, mem_size);
+  LoadDataSegments(this, mem_addr, mem_size, segment_file);
 
   module->SetInternalField(kWasmMemArrayBuffer, *mem_buffer);
+  if (memory.is_null()) {
+    module->SetInternalField(kWasmExternalMemArrayBuffer, Smi::FromInt(0));
+  } else {
+    // Keeps the external memory alive if {mem_buffer} only refers to it.
+    module->SetInternalField(kWasmExternalMemArrayBuffer, *memory);
+  }
+  module->SetInternalField(kWasmMemGrowable, Smi::FromInt(mem_growable));
 
   if (mem_export) {
     // Export the memory as a named property.
     Handle<String> name = factory->InternalizeUtf8String("memory");
-    JSObject::AddProperty(module, name, mem_buffer, READ_ONLY);
+    JSObject::AddProperty(module, name,
+                          memory.is_null() ? mem_buffer : memory, READ_ONLY);
   }
 
   //-------------------------------------------------------------------------
   // Allocate the globals area if necessary.
   //-------------------------------------------------------------------------
+  AllocateGlobalsOffsets(globals);
   size_t globals_size = ComputeGlobalsSize(globals);
   byte* globals_addr = nullptr;
   if (globals_size > 0) {
     Handle<JSArrayBuffer> globals_buffer =
-        NewArrayBuffer(isolate, mem_size, &globals_addr);
+        NewArrayBuffer(isolate, static_cast<int>(globals_size), &globals_addr);
     if (!globals_addr) {
       // Not enough space for backing store of globals.
       thrower.Error("Out of memory: wasm globals");
@@ -693,71 +2240,417 @@ MaybeHandle<JSObject> WasmModule::Instantiate(Isolate* isolate,
   module_env.globals_area = reinterpret_cast<uintptr_t>(globals_addr);
   module_env.linker = &linker;
   module_env.function_code = nullptr;
+  InitIndirectCallTraps(isolate, &module_env);
 
-  // First pass: compile each function and initialize the code table.
+  // First pass: look up the imported functions and create placeholders for
+  // all others, so that graph building below never allocates code objects.
+  std::vector<Handle<String>> names;
+  std::vector<Handle<JSFunction>> imports(functions->size());
   for (const WasmFunction& func : *functions) {
-    if (thrower.error()) break;
-
     const char* cstr = GetName(func.name_offset);
     Handle<String> name = factory->InternalizeUtf8String(cstr);
-    Handle<Code> code = Handle<Code>::null();
-    Handle<JSFunction> function = Handle<JSFunction>::null();
+    names.push_back(name);
     if (func.external) {
       // Lookup external function in FFI object.
-      if (!ffi.is_null()) {
-        MaybeHandle<Object> result = Object::GetProperty(ffi, name);
-        if (!result.is_null()) {
-          Handle<Object> obj = result.ToHandleChecked();
-          if (obj->IsJSFunction()) {
-            function = Handle<JSFunction>::cast(obj);
-            code =
-                CompileWasmToJSWrapper(isolate, &module_env, function, index);
-          } else {
-            thrower.Error("FFI function #%d:%s is not a JSFunction.", index,
-                          cstr);
-            return MaybeHandle<JSObject>();
-          }
-        } else {
-          thrower.Error("FFI function #%d:%s not found.", index, cstr);
-          return MaybeHandle<JSObject>();
-        }
-      } else {
+      if (ffi.is_null()) {
         thrower.Error("FFI table is not an object.");
         return MaybeHandle<JSObject>();
       }
-    } else {
-      // Compile the function.
-      code = CompileFunction(thrower, isolate, &module_env, func, index);
-      if (code.is_null()) {
-        thrower.Error("Compilation of #%d:%s failed.", index, cstr);
+      MaybeHandle<Object> result = Object::GetProperty(ffi, name);
+      if (result.is_null()) {
+        thrower.Error("FFI function #%d:%s not found.", index, cstr);
         return MaybeHandle<JSObject>();
       }
-      if (func.exported) {
-        function =
-            CompileJSToWasmWrapper(isolate, &module_env, name, code, index);
+      Handle<Object> obj = result.ToHandleChecked();
+      if (!obj->IsJSFunction()) {
+        thrower.Error("FFI function #%d:%s is not a JSFunction.", index, cstr);
+        return MaybeHandle<JSObject>();
       }
+      imports[index] = Handle<JSFunction>::cast(obj);
+    } else {
+      linker.GetFunctionCode(index);
     }
-    if (!code.is_null()) {
-      // Install the code into the linker table.
+    index++;
+  }
+
+  module->SetInternalField(kWasmModuleFunctionTable, Smi::FromInt(0));
+  module->SetInternalField(kWasmModuleCompilerData, Smi::FromInt(0));
+
+  // Modules that do not support tiered compilation are compiled eagerly with
+  // TurboFan, whatever the flags say; see {SupportsTieredCompilation}.
+  bool tiered = FLAG_wasm_lazy_compilation || UseBaselineCompiler();
+  if (tiered && !SupportsTieredCompilation() && FLAG_trace_wasm_compiler) {
+    PrintF("Compiling module eagerly: %s\n",
+           mem_growable ? "growable memory" : "function table");
+  }
+  if (compiled_code.is_null() && tiered && SupportsTieredCompilation()) {
+    // Defer the compilation of all functions to their first call, or compile
+    // them with the baseline compiler and tier up later. Imported functions
+    // are called through wrappers of their own.
+    for (index = 0; index < static_cast<int>(imports.size()); index++) {
+      if (imports[index].is_null()) continue;
+      Handle<Code> code = CompileWasmToJSWrapper(isolate, &module_env,
+                                                 imports[index], index);
       linker.Finish(index, code);
       code_table->set(index, *code);
     }
-    if (func.exported) {
-      // Exported functions are installed as read-only properties on the module.
-      JSObject::AddProperty(module, name, function, READ_ONLY);
+    if (!WasmInstanceCompiler::Install(isolate, this, module, &module_env,
+                                       &linker, code_table, names,
+                                       FLAG_wasm_lazy_compilation, thrower)) {
+      return MaybeHandle<JSObject>();
     }
-    index++;
+    return module;
   }
 
-  // Second pass: patch all direct call sites.
-  linker.Link();
+  // Copy the instance-independent code of the module, redirecting it to the
+  // memory, globals, and imports of this instance.
+  Handle<FixedArray> compiled;
+  if (!compiled_code.ToHandle(&compiled) &&
+      !Compile(isolate, thrower).ToHandle(&compiled)) {
+    return MaybeHandle<JSObject>();
+  }
+  Handle<FixedArray> compiled_code_table(
+      FixedArray::cast(compiled->get(kCompiledCodeTable)), isolate);
+  Handle<FixedArray> compiled_wrapper_table(
+      FixedArray::cast(compiled->get(kCompiledWrapperTable)), isolate);
+  Handle<FixedArray> sentinels(
+      FixedArray::cast(compiled->get(kCompiledSentinels)), isolate);
+
+  int count = static_cast<int>(functions->size());
+  Handle<FixedArray> wrapper_table = factory->NewFixedArray(count, TENURED);
+  Handle<FixedArray> instance_objects =
+      factory->NewFixedArray(kInstanceObjectCount);
+  instance_objects->set(kInstanceMemBuffer, *mem_buffer);
+  instance_objects->set(kInstanceGlobalsBuffer,
+                        module->GetInternalField(kWasmGlobalsArrayBuffer));
+  Handle<FixedArray> table;
+  if (!function_table->empty()) {
+    table = NewFunctionTable(isolate, this);
+    instance_objects->set(kInstanceFunctionTable, *table);
+    module->SetInternalField(kWasmModuleFunctionTable, *table);
+  } else {
+    instance_objects->set(kInstanceFunctionTable, Smi::FromInt(0));
+  }
+  if (sentinels->get(kInstanceImportTable)->IsFixedArray()) {
+    // Imported functions are called through wrappers shared by all imports
+    // of the same signature, which call the function passed from the import
+    // table of this instance.
+    Handle<FixedArray> import_table = NewImportTable(isolate, this);
+    for (int i = 0; i < count; i++) {
+      if (imports[i].is_null()) continue;
+      FunctionSig* sig = functions->at(i).sig;
+      bool arity_match =
+          imports[i]->shared()->internal_formal_parameter_count() ==
+          static_cast<int>(sig->parameter_count());
+      import_table->set(i, *imports[i]);
+      code_table->set(i, *GetSharedWasmToJSWrapper(isolate, &module_env, sig,
+                                                   arity_match));
+    }
+    instance_objects->set(kInstanceImportTable, *import_table);
+  } else {
+    instance_objects->set(kInstanceImportTable, Smi::FromInt(0));
+  }
+  CopyInstanceCode(isolate, this, compiled_code_table, compiled_wrapper_table,
+                   code_table, wrapper_table, sentinels, instance_objects);
+
+  // Fill the function table with the code of this instance. Indirect calls
+  // pass no imported function, so imports in the table get wrappers of their
+  // own.
+  std::vector<Handle<Code>> import_wrappers(count);
+  for (size_t i = 0; i < function_table->size(); i++) {
+    int func_index = function_table->at(i);
+    Handle<JSFunction> import = imports[func_index];
+    if (!import.is_null() && import_wrappers[func_index].is_null()) {
+      import_wrappers[func_index] =
+          CompileWasmToJSWrapper(isolate, &module_env, import, func_index);
+    }
+    Code* code = import.is_null() ? Code::cast(code_table->get(func_index))
+                                  : *import_wrappers[func_index];
+    SetFunctionTableCode(*table, static_cast<int>(i), code);
+  }
+
+  // Exported functions are installed as read-only properties on the module.
+  for (int i = 0; i < count; i++) {
+    const WasmFunction& func = functions->at(i);
+    if (func.external || !func.exported) continue;
+    Handle<Code> code(Code::cast(code_table->get(i)), isolate);
+    Handle<JSFunction> function =
+        NewJSToWasmFunction(isolate, names[i], code, func.sig);
+    function->set_code(Code::cast(wrapper_table->get(i)));
+    JSObject::AddProperty(module, names[i], function, READ_ONLY);
+  }
 
-  module->SetInternalField(kWasmModuleFunctionTable, Smi::FromInt(0));
   module->SetInternalField(kWasmModuleCodeTable, *code_table);
   return module;
 }
 
 
+// Compiles all functions of the module and the wrappers of exported
+// functions into code that is independent of any instance. The code refers
+// to sentinel buffers instead of the memory and globals buffers of an
+// instance, and calls imported functions through placeholders.
+MaybeHandle<FixedArray> WasmModule::Compile(
+    Isolate* isolate, ErrorThrower& thrower,
+    Handle<JSArrayBuffer> bytes_buffer) {
+  WasmCodeCache cache(isolate);
+  bool use_cache = FLAG_wasm_code_cache && cache.is_available();
+  Handle<FixedArray> compiled;
+  if (use_cache && cache.Lookup(this).ToHandle(&compiled)) return compiled;
+
+  Handle<FixedArray> sentinels = NewInstanceSentinels(isolate, this);
+  WasmLinker linker(isolate, functions->size());
+  ModuleEnv module_env;
+  InitCompiledModuleEnv(isolate, this, &linker, sentinels, &module_env);
+
+  // First pass: create placeholders for all functions, so that graph
+  // building below never allocates code objects.
+  int count = static_cast<int>(functions->size());
+  for (int i = 0; i < count; i++) linker.GetFunctionCode(i);
+
+  // Second pass: decode and build graphs for all functions on background
+  // threads, while this thread generates code and links.
+  WasmCompilationQueue queue(CompilationUnitLimit());
+  int index = 0;
+  for (const WasmFunction& func : *functions) {
+    if (!func.external) {
+      queue.Add(new WasmCompilationUnit(isolate, &module_env, &func, index));
+    }
+    index++;
+  }
+  queue.StartTasks();
+  if (!FinishCompiledModule(isolate, &module_env, &queue, sentinels, thrower)
+           .ToHandle(&compiled)) {
+    return MaybeHandle<FixedArray>();
+  }
+  if (use_cache) cache.Insert(this, compiled, bytes_buffer);
+  return compiled;
+}
+
+
+namespace {
+// Creates a compiled module object for the {compiled} code of a module whose
+// bytes are held by {bytes_buffer}, and by {file} if it is given. The buffer
+// owns the file.
+Handle<JSObject> NewCompiledModuleObject(Isolate* isolate,
+                                         Handle<FixedArray> compiled,
+                                         Handle<JSArrayBuffer> bytes_buffer,
+                                         WasmModuleFile* file) {
+  Factory* factory = isolate->factory();
+  Handle<Map> map = factory->NewMap(
+      JS_OBJECT_TYPE, JSObject::kHeaderSize +
+                          kWasmCompiledModuleInternalFieldCount * kPointerSize);
+  Handle<JSObject> object = factory->NewJSObjectFromMap(map, TENURED);
+  object->SetInternalField(kWasmCompiledModuleMarker,
+                           Smi::FromInt(kWasmCompiledModuleMarkerValue));
+  object->SetInternalField(kWasmCompiledModuleCode, *compiled);
+  object->SetInternalField(kWasmCompiledModuleBytes, *bytes_buffer);
+  if (file != nullptr) {
+    object->SetInternalField(
+        kWasmCompiledModuleFile,
+        *factory->NewForeign(reinterpret_cast<Address>(file)));
+  } else {
+    object->SetInternalField(kWasmCompiledModuleFile, Smi::FromInt(0));
+  }
+  return object;
+}
+}  // namespace
+
+
+MaybeHandle<JSObject> CompileWasmModule(Isolate* isolate, WasmModule* module,
+                                        ErrorThrower& thrower) {
+  // Keep a copy of the module bytes, which are decoded again upon
+  // instantiation. Data segments can only be mapped into instances from a
+  // copy in an in-memory file.
+  Handle<JSArrayBuffer> bytes_buffer;
+  WasmModuleFile* file = nullptr;
+  if (UseCopyOnWriteDataSegments()) {
+    file = WasmModuleFile::FromBytes(module->module_start, module->module_end);
+  }
+  if (file != nullptr) {
+    bytes_buffer = NewModuleFileArrayBuffer(isolate, file);
+  } else {
+    int size = static_cast<int>(module->module_end - module->module_start);
+    byte* bytes = nullptr;
+    bytes_buffer = NewArrayBuffer(isolate, size, &bytes);
+    if (!bytes) {
+      thrower.Error("Out of memory: wasm module bytes");
+      return MaybeHandle<JSObject>();
+    }
+    memcpy(bytes, module->module_start, size);
+  }
+
+  Handle<FixedArray> compiled;
+  if (!module->Compile(isolate, thrower, bytes_buffer).ToHandle(&compiled)) {
+    return MaybeHandle<JSObject>();
+  }
+  return NewCompiledModuleObject(isolate, compiled, bytes_buffer, file);
+}
+
+
+MaybeHandle<JSObject> CompileWasmModuleFile(Isolate* isolate, const char* path,
+                                            ErrorThrower& thrower) {
+  WasmModuleFile* file = WasmModuleFile::Open(path);
+  if (file == nullptr) {
+    thrower.Error("Cannot map wasm module file %s", path);
+    return MaybeHandle<JSObject>();
+  }
+  // From here on, the buffer owns the mapping.
+  Handle<JSArrayBuffer> bytes_buffer = NewModuleFileArrayBuffer(isolate, file);
+
+  // Decode but avoid a redundant pass over function bodies for verification.
+  // Verification will happen during compilation.
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, file->start(), file->end(), false);
+  MaybeHandle<JSObject> object;
+  if (result.failed()) {
+    thrower.Failed("", result);
+  } else {
+    Handle<FixedArray> compiled;
+    if (result.val->Compile(isolate, thrower, bytes_buffer)
+            .ToHandle(&compiled)) {
+      object = NewCompiledModuleObject(isolate, compiled, bytes_buffer, file);
+    }
+  }
+  if (result.val) delete result.val;
+  return object;
+}
+
+
+bool IsWasmCompiledModule(Object* object) {
+  if (!object->IsJSObject()) return false;
+  JSObject* js_object = JSObject::cast(object);
+  return js_object->GetInternalFieldCount() ==
+             kWasmCompiledModuleInternalFieldCount &&
+         js_object->GetInternalField(kWasmCompiledModuleMarker) ==
+             Smi::FromInt(kWasmCompiledModuleMarkerValue);
+}
+
+
+MaybeHandle<JSObject> InstantiateCompiledModule(
+    Isolate* isolate, Handle<JSObject> compiled_module, Handle<JSObject> ffi,
+    Handle<JSArrayBuffer> memory) {
+  DCHECK(IsWasmCompiledModule(*compiled_module));
+  Handle<FixedArray> compiled(
+      FixedArray::cast(
+          compiled_module->GetInternalField(kWasmCompiledModuleCode)),
+      isolate);
+  Handle<JSArrayBuffer> bytes_buffer(
+      JSArrayBuffer::cast(
+          compiled_module->GetInternalField(kWasmCompiledModuleBytes)),
+      isolate);
+  const byte* start = reinterpret_cast<const byte*>(
+      bytes_buffer->backing_store());
+  const byte* end =
+      start + static_cast<size_t>(bytes_buffer->byte_length()->Number());
+
+  // The bytes were verified when compiling.
+  Zone zone;
+  ModuleResult result = DecodeWasmModule(isolate, &zone, start, end, false);
+  CHECK(result.ok());
+  Object* file = compiled_module->GetInternalField(kWasmCompiledModuleFile);
+  if (file->IsForeign()) {
+    result.val->file = reinterpret_cast<WasmModuleFile*>(
+        Foreign::cast(file)->foreign_address());
+  }
+  MaybeHandle<JSObject> object =
+      result.val->Instantiate(isolate, ffi, compiled, memory);
+  delete result.val;
+  return object;
+}
+
+
+Handle<JSArrayBuffer> GetInstanceMemory(Isolate* isolate,
+                                        Handle<JSObject> module_object) {
+  if (module_object->GetInternalFieldCount() !=
+      kWasmModuleInternalFieldCount) {
+    return Handle<JSArrayBuffer>::null();
+  }
+  // Prefer the buffer that owns external memory, which keeps it alive.
+  Object* buffer = module_object->GetInternalField(kWasmExternalMemArrayBuffer);
+  if (!buffer->IsJSArrayBuffer()) {
+    buffer = module_object->GetInternalField(kWasmMemArrayBuffer);
+  }
+  if (!buffer->IsJSArrayBuffer()) return Handle<JSArrayBuffer>::null();
+  return Handle<JSArrayBuffer>(JSArrayBuffer::cast(buffer), isolate);
+}
+
+
+int32_t GrowInstanceMemory(Isolate* isolate, Handle<JSObject> module_object,
+                           uint32_t delta) {
+  if (module_object->GetInternalFieldCount() !=
+      kWasmModuleInternalFieldCount) {
+    return -1;
+  }
+  if (module_object->GetInternalField(kWasmMemGrowable) != Smi::FromInt(1)) {
+    return -1;
+  }
+  Object* buffer = module_object->GetInternalField(kWasmMemArrayBuffer);
+  return GrowMemoryBuffer(JSArrayBuffer::cast(buffer), delta);
+}
+
+
+bool IsTieredInstance(Handle<JSObject> module_object) {
+  if (module_object->GetInternalFieldCount() !=
+      kWasmModuleInternalFieldCount) {
+    return false;
+  }
+  return module_object->GetInternalField(kWasmModuleCompilerData)
+      ->IsFixedArray();
+}
+
+
+int CodegenFlagsHash() {
+  size_t hash = base::hash_combine(
+      FLAG_wasm_bounds_check_elimination, FLAG_wasm_inlining,
+      FLAG_wasm_inlining_max_depth, FLAG_wasm_inlining_max_size,
+      FLAG_wasm_mem_base_param);
+  return static_cast<int>(hash & Smi::kMaxValue);
+}
+
+
+WasmCodeCacheStatistics GetWasmCodeCacheStatistics(Isolate* isolate) {
+  return WasmCodeCache::GetStatistics(isolate);
+}
+
+
+int WasmModule::CanonicalSignatureId(FunctionSig* sig) {
+  for (size_t i = 0; i < signatures->size(); i++) {
+    if (SameSignature(signatures->at(i), sig)) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+
+Handle<FixedArray> NewFunctionTable(Isolate* isolate, WasmModule* module) {
+  int size = static_cast<int>(module->function_table->size());
+  Handle<FixedArray> table =
+      isolate->factory()->NewFixedArray(2 * size, TENURED);
+  for (int i = 0; i < size; i++) {
+    FunctionSig* sig =
+        module->functions->at(module->function_table->at(i)).sig;
+    table->set(i, Smi::FromInt(module->CanonicalSignatureId(sig)));
+  }
+  return table;
+}
+
+
+void SetFunctionTableCode(FixedArray* table, int index, Code* code) {
+  table->set(table->length() / 2 + index, code);
+}
+
+
+void InitIndirectCallTraps(Isolate* isolate, ModuleEnv* module_env) {
+  Factory* factory = isolate->factory();
+  module_env->trap_stub = CEntryStub(isolate, 1).GetCode();
+  module_env->trap_context = handle(isolate->native_context(), isolate);
+  module_env->trap_bounds_message = factory->InternalizeUtf8String(
+      "wasm trap: function table index out of bounds");
+  module_env->trap_signature_message = factory->InternalizeUtf8String(
+      "wasm trap: function signature mismatch");
+}
+
+
 Handle<Code> ModuleEnv::GetFunctionCode(uint32_t index) {
   DCHECK(IsValidFunction(index));
   if (linker) return linker->GetFunctionCode(index);
@@ -772,6 +2665,9 @@ compiler::CallDescriptor* ModuleEnv::GetCallDescriptor(Zone* zone,
   // Always make a direct call to whatever is in the table at that location.
   // A wrapper will be generated for FFI calls.
   WasmFunction* function = &module->functions->at(index);
+  if (UsesImportTable(index)) {
+    return GetWasmImportCallDescriptor(zone, function->sig);
+  }
   return GetWasmCallDescriptor(zone, function->sig);
 }
 
@@ -838,6 +2734,221 @@ FunctionResult DecodeWasmFunction(Isolate* isolate, Zone* zone,
 }
 
 
+// The compilation of a module whose bytes are streamed in. The graphs of
+// functions are built by background tasks, which take the functions from a
+// queue as their bodies arrive.
+class WasmStreamingCompilation {
+ public:
+  WasmStreamingCompilation(Isolate* isolate, WasmModule* module)
+      : isolate_(isolate),
+        linker_(isolate, module->functions->size()),
+        queue_(WasmCompilationQueue::kUnlimited) {
+    sentinels_ = NewInstanceSentinels(isolate, module);
+    InitCompiledModuleEnv(isolate, module, &linker_, sentinels_, &module_env_);
+    // Create placeholders for all functions, so that graph building never
+    // allocates code objects.
+    int count = static_cast<int>(module->functions->size());
+    for (int i = 0; i < count; i++) linker_.GetFunctionCode(i);
+  }
+
+  // Starts building the graph of function {index}, whose body has arrived.
+  // The unit reads the bytes that have arrived so far, which stay in place
+  // until compilation finishes, and inlines only callees among them.
+  void AddFunction(int index) {
+    WasmCompilationUnit* unit = new WasmCompilationUnit(
+        isolate_, &module_env_, &module_env_.module->functions->at(index),
+        index);
+    queue_.Add(unit);
+    queue_.StartTasks();
+  }
+
+  // Builds the graphs of all remaining functions. Returns once every graph
+  // has been built.
+  void BuildGraphs() {
+    // The isolate's thread helps out instead of idling.
+    while (queue_.BuildNext()) {
+    }
+    queue_.WaitForTasks();
+  }
+
+  // Generates the code for all functions after {BuildGraphs}.
+  MaybeHandle<FixedArray> Finish(ErrorThrower& thrower) {
+    queue_.SortByFunctionIndex();
+    return FinishCompiledModule(isolate_, &module_env_, &queue_, sentinels_,
+                                thrower);
+  }
+
+ private:
+  Isolate* isolate_;
+  WasmLinker linker_;
+  ModuleEnv module_env_;
+  Handle<FixedArray> sentinels_;
+  WasmCompilationQueue queue_;
+};
+
+
+WasmStreamingDecoder::WasmStreamingDecoder(Isolate* isolate, Zone* zone)
+    : isolate_(isolate),
+      zone_(zone),
+      capacity_(1),
+      size_(0),
+      module_(nullptr),
+      next_pending_(0),
+      failed_(false),
+      compilation_(nullptr) {
+  buffers_.push_back(new byte[capacity_]);
+}
+
+
+WasmStreamingDecoder::~WasmStreamingDecoder() {
+  delete compilation_;
+  delete module_;
+  for (byte* buffer : buffers_) delete[] buffer;
+}
+
+
+bool WasmStreamingDecoder::PushBytes(const byte* bytes, size_t size) {
+  if (failed_) return false;
+  if (size_ + size >= kMaxModuleSize) {
+    ModuleError error("size > maximum module size");
+    Fail(error);
+    return false;
+  }
+
+  // Append the bytes. Compilation units on background threads read the
+  // bytes that had arrived when they were created, so only the bytes after
+  // those are written in place, and a full buffer is copied into a larger
+  // one instead of reallocated. The terminating 0 is only added by {Finish},
+  // once no unit reads the bytes anymore.
+  if (size_ + size > capacity_) {
+    size_t capacity = std::max(2 * capacity_, size_ + size);
+    byte* buffer = new byte[capacity];
+    memcpy(buffer, buffers_.back(), size_);
+    buffers_.push_back(buffer);
+    capacity_ = capacity;
+  }
+  byte* start = buffers_.back();
+  memcpy(start + size_, bytes, size);
+  size_ += size;
+
+  if (module_ == nullptr) {
+    // Decode the declarations once all of them have arrived. Their offsets
+    // are checked against the maximum module size until the end is known.
+    ModuleDecoder scanner(zone_, start, start + size_);
+    size_t declarations_size = scanner.DeclarationsSize();
+    if (declarations_size == 0) return true;
+
+    WasmModule* module = new WasmModule();
+    ModuleDecoder decoder(zone_, start, start + declarations_size);
+    ModuleResult result = decoder.DecodeModulePrefix(module, kMaxModuleSize);
+    if (result.failed()) {
+      delete module;
+      Fail(result);
+      return false;
+    }
+    module_ = module;
+
+    // Functions are compiled in the order in which their bodies arrive.
+    for (size_t i = 0; i < module_->functions->size(); i++) {
+      if (!module_->functions->at(i).external) {
+        pending_.push_back(static_cast<int>(i));
+      }
+    }
+    std::vector<WasmFunction>* functions = module_->functions;
+    std::stable_sort(pending_.begin(), pending_.end(),
+                     [functions](int a, int b) {
+                       return functions->at(a).code_end_offset <
+                              functions->at(b).code_end_offset;
+                     });
+    compilation_ = new WasmStreamingCompilation(isolate_, module_);
+  }
+
+  module_->module_start = start;
+  module_->module_end = start + size_;
+  CompileCompleteFunctions();
+  return true;
+}
+
+
+ModuleResult WasmStreamingDecoder::Finish() {
+  const byte* start = buffers_.back();
+  if (!failed_ && size_ < kMinModuleSize) {
+    ModuleError error("size < minimum module size");
+    Fail(error);
+  }
+  if (!failed_ && module_ == nullptr) {
+    // Decode the incomplete declarations again to report the error.
+    WasmModule* module = new WasmModule();
+    ModuleDecoder decoder(zone_, start, start + size_);
+    ModuleResult result = decoder.DecodeModule(module, false);
+    delete module;
+    DCHECK(result.failed());
+    Fail(result);
+  }
+  if (!failed_) {
+    ModuleDecoder decoder(zone_, start, start + size_);
+    ModuleResult result = decoder.CheckOffsets(module_);
+    if (result.failed()) Fail(result);
+  }
+
+  ModuleResult result;
+  if (failed_) {
+    result.CopyFrom(error_);
+    return result;
+  }
+
+  // All function bodies have arrived, since their offsets are in bounds.
+  CompileCompleteFunctions();
+  DCHECK_EQ(pending_.size(), next_pending_);
+  compilation_->BuildGraphs();
+
+  // No unit reads the bytes anymore, so they can be terminated for names
+  // that run up to the end of the module.
+  if (size_ == capacity_) {
+    byte* buffer = new byte[size_ + 1];
+    memcpy(buffer, start, size_);
+    buffers_.push_back(buffer);
+    capacity_ = size_ + 1;
+    start = buffer;
+  }
+  buffers_.back()[size_] = 0;
+  for (size_t i = 0; i + 1 < buffers_.size(); i++) delete[] buffers_[i];
+  buffers_.erase(buffers_.begin(), buffers_.end() - 1);
+  module_->module_start = start;
+  module_->module_end = start + size_;
+  result.start = start;
+  result.val = module_;
+  module_ = nullptr;
+  return result;
+}
+
+
+MaybeHandle<FixedArray> WasmStreamingDecoder::FinishCompilation(
+    ErrorThrower& thrower) {
+  DCHECK(!failed_ && module_ == nullptr && compilation_ != nullptr);
+  MaybeHandle<FixedArray> compiled = compilation_->Finish(thrower);
+  delete compilation_;
+  compilation_ = nullptr;
+  return compiled;
+}
+
+
+void WasmStreamingDecoder::Fail(ModuleResult& result) {
+  failed_ = true;
+  error_.CopyFrom(result);
+}
+
+
+void WasmStreamingDecoder::CompileCompleteFunctions() {
+  while (next_pending_ < pending_.size()) {
+    int index = pending_[next_pending_];
+    if (module_->functions->at(index).code_end_offset > size_) break;
+    compilation_->AddFunction(index);
+    next_pending_++;
+  }
+}
+
+
 int32_t CompileAndRunWasmModule(Isolate* isolate, const byte* module_start,
                                 const byte* module_end) {
   HandleScope scope(isolate);
@@ -861,46 +2972,84 @@ int32_t CompileAndRunWasmModule(Isolate* isolate, const byte* module_start,
 }
 
 
-int32_t CompileAndRunWasmModule(Isolate* isolate, WasmModule* module) {
+namespace {
+int32_t CompileAndRunWasmModule(Isolate* isolate, WasmModule* module,
+                                byte* mem_addr, size_t mem_size) {
   ErrorThrower thrower(isolate, "CompileAndRunWasmModule");
 
-  // Allocate temporary linear memory and globals.
-  size_t mem_size = 1 << module->mem_size_log2;
+  // Allocate temporary globals.
   size_t globals_size = AllocateGlobalsOffsets(module->globals);
-
-  base::SmartArrayPointer<byte> mem_addr(new byte[mem_size]);
   base::SmartArrayPointer<byte> globals_addr(new byte[globals_size]);
-
-  memset(mem_addr.get(), 0, mem_size);
   memset(globals_addr.get(), 0, globals_size);
 
   // Create module environment.
   WasmLinker linker(isolate, module->functions->size());
   ModuleEnv module_env;
   module_env.module = module;
-  module_env.mem_start = reinterpret_cast<uintptr_t>(mem_addr.get());
-  module_env.mem_end = reinterpret_cast<uintptr_t>(mem_addr.get()) + mem_size;
+  module_env.mem_start = reinterpret_cast<uintptr_t>(mem_addr);
+  module_env.mem_end = reinterpret_cast<uintptr_t>(mem_addr) + mem_size;
   module_env.globals_area = reinterpret_cast<uintptr_t>(globals_addr.get());
   module_env.linker = &linker;
   module_env.function_code = nullptr;
+  if (!module->function_table->empty()) {
+    module_env.function_table = NewFunctionTable(isolate, module);
+  }
+  InitIndirectCallTraps(isolate, &module_env);
 
   // Load data segments.
   // TODO(titzer): throw instead of crashing if segments don't fit in memory?
-  LoadDataSegments(module, mem_addr.get(), mem_size);
+  LoadDataSegments(module, mem_addr, mem_size);
 
-  // Compile all functions.
-  Handle<Code> main_code = Handle<Code>::null();  // record last code.
+  // Create placeholders for all functions.
   int index = 0;
+  for (const WasmFunction& func : *module->functions) {
+    if (!func.external) linker.GetFunctionCode(index);
+    index++;
+  }
+
+  // Compile functions with the baseline compiler if enabled, without tier-up,
+  // then build the graphs of all remaining functions.
+  WasmCompilationQueue queue(CompilationUnitLimit());
+  index = 0;
   for (const WasmFunction& func : *module->functions) {
     if (!func.external) {
-      // Compile the function and install it in the code table.
-      Handle<Code> code =
-          CompileFunction(thrower, isolate, &module_env, func, index);
-      if (!code.is_null()) {
-        if (func.exported) main_code = code;
+      Handle<Code> code;
+      if (UseBaselineCompiler()) {
+        code = CompileBaseline(isolate, &module_env, &func, index, nullptr,
+                               Handle<Code>::null());
+      }
+      if (code.is_null()) {
+        queue.Add(new WasmCompilationUnit(isolate, &module_env, &func, index));
+      } else {
         linker.Finish(index, code);
       }
-      if (thrower.error()) return -1;
+    }
+    index++;
+  }
+  queue.StartTasks();
+
+  // Compile all functions and install them in the code table.
+  for (size_t i = 0; i < queue.size(); i++) {
+    WasmCompilationUnit* unit = queue.WaitForGraph(i);
+    Handle<Code> code = unit->FinishCompilation(thrower);
+    if (!code.is_null()) linker.Finish(unit->index(), code);
+    queue.Release(i);
+    if (thrower.error()) return -1;
+  }
+
+  // Fill the function table.
+  for (size_t i = 0; i < module->function_table->size(); i++) {
+    Handle<Code> code = linker.GetFunctionCode(module->function_table->at(i));
+    SetFunctionTableCode(*module_env.function_table, static_cast<int>(i),
+                         *code);
+  }
+
+  // The last exported function is the main function.
+  Handle<Code> main_code = Handle<Code>::null();
+  index = 0;
+  for (const WasmFunction& func : *module->functions) {
+    if (!func.external && func.exported) {
+      main_code = linker.GetFunctionCode(index);
     }
     index++;
   }
@@ -930,6 +3079,16 @@ int32_t CompileAndRunWasmModule(Isolate* isolate, WasmModule* module) {
   }
   return -1;
 }
+}  // namespace
+
+
+int32_t CompileAndRunWasmModule(Isolate* isolate, WasmModule* module) {
+  // Allocate temporary linear memory.
+  size_t mem_size = static_cast<size_t>(1) << module->mem_size_log2;
+  base::SmartArrayPointer<byte> mem_addr(new byte[mem_size]);
+  memset(mem_addr.get(), 0, mem_size);
+  return CompileAndRunWasmModule(isolate, module, mem_addr.get(), mem_size);
+}
 }
 }
 }
@@ -21,6 +21,15 @@ const size_t kMaxModuleSize = 1024 * 1024 * 1024;
 const size_t kMaxFunctionSize = 128 * 1024;
 const size_t kMaxStringSize = 256;
 
+// Flags in the second byte of the module header.
+const uint8_t kModuleMemExport = 0x01;  // the memory is exported.
+const uint8_t kModuleFunctionTable = 0x02;  // a function table follows the
+                                            // data segments.
+const uint8_t kModuleMemGrowable = 0x04;  // the memory can grow beyond its
+                                          // initial size.
+const uint8_t kModuleMemExternal = 0x08;  // the memory is supplied at
+                                          // instantiation.
+
 // Static representation of a wasm function.
 struct WasmFunction {
   FunctionSig* sig;      // signature of the function.
@@ -36,6 +45,7 @@ struct WasmFunction {
 };
 
 struct ModuleEnv;  // forward declaration of decoder interface.
+class WasmModuleFile;  // forward declaration of mapped module files.
 
 // Static representation of a wasm global variable.
 struct WasmGlobal {
@@ -63,10 +73,14 @@ struct WasmModule {
   const byte* module_end;    // end address for the module bytes.
   uint8_t mem_size_log2;     // size of the memory (log base 2).
   bool mem_export;           // true if the memory is exported.
-  bool mem_external;         // true if the memory is external.
+  bool mem_external;         // true if the memory must be supplied.
+  bool mem_growable;         // true if the memory can grow.
   std::vector<WasmFunction>* functions;         // functions in this module.
   std::vector<WasmGlobal>* globals;             // globals in this module.
   std::vector<WasmDataSegment>* data_segments;  // data segments in this module.
+  std::vector<FunctionSig*>* signatures;  // signatures of indirect calls.
+  std::vector<uint16_t>* function_table;  // functions in the function table.
+  const WasmModuleFile* file;  // file that holds the module bytes, if any.
 
   // Get a pointer to a string stored in the module bytes representing a name.
   const char* GetName(uint32_t offset) {
@@ -81,8 +95,39 @@ struct WasmModule {
     return start < size && end < size;
   }
 
-  // Creates a new instantiation of the module in the given isolate.
-  MaybeHandle<JSObject> Instantiate(Isolate* isolate, Handle<JSObject> ffi);
+  // Returns the canonical id of {sig} for indirect calls, i.e. the index of
+  // the first signature in {signatures} that is equal to it, or -1 if there
+  // is none. Indirect calls compare these ids instead of signatures.
+  int CanonicalSignatureId(FunctionSig* sig);
+
+  // Returns true if instances may defer compilation to the first call of each
+  // function, or compile with the baseline compiler first. The lazy compile
+  // stubs and the baseline compiler support neither function tables nor
+  // growable memory, so modules with either are always compiled eagerly with
+  // TurboFan, whatever the flags say.
+  bool SupportsTieredCompilation() const {
+    return function_table->empty() && !mem_growable;
+  }
+
+  // Creates a new instantiation of the module in the given isolate. If
+  // {compiled_code} is given, it must be the result of {Compile} for the
+  // same module bytes, and is copied instead of compiling the module again.
+  // If {memory} is given, the instance uses it as its linear memory instead
+  // of allocating its own, sharing it without copying. It must hold at
+  // least the declared size of the memory, and it can no longer be
+  // neutered.
+  MaybeHandle<JSObject> Instantiate(
+      Isolate* isolate, Handle<JSObject> ffi,
+      MaybeHandle<FixedArray> compiled_code = MaybeHandle<FixedArray>(),
+      Handle<JSArrayBuffer> memory = Handle<JSArrayBuffer>::null());
+
+  // Compiles the module into code that does not depend on any instance, and
+  // can therefore be copied into any number of instances. If given,
+  // {bytes_buffer} holds the module bytes for at least as long as the code
+  // lives, and the code cache refers to it instead of copying the bytes.
+  MaybeHandle<FixedArray> Compile(
+      Isolate* isolate, ErrorThrower& thrower,
+      Handle<JSArrayBuffer> bytes_buffer = Handle<JSArrayBuffer>::null());
 };
 
 // forward declaration.
@@ -95,6 +140,31 @@ struct ModuleEnv {
   uintptr_t mem_start;     // address of the start of linear memory.
   uintptr_t mem_end;       // address of the end of linear memory.
 
+  // If set, compiled code loads the start of linear memory and the globals
+  // area from these buffers instead of embedding their addresses, so that it
+  // can be copied for other instances.
+  Handle<JSArrayBuffer> mem_buffer;
+  Handle<JSArrayBuffer> globals_buffer;
+
+  // The function table for indirect calls, created by {NewFunctionTable}.
+  // Compiled code refers to it directly, so that copies of the code can be
+  // redirected to the table of another instance.
+  Handle<FixedArray> function_table;
+
+  // If set, compiled code calls imported functions through wrappers shared by
+  // all imports of the same signature, passing the JSFunction loaded from
+  // this table, which holds the imports of an instance by function index.
+  Handle<FixedArray> import_table;
+
+  // The runtime call stub, its context, and the exceptions with which an
+  // indirect call traps if its key is out of bounds of the function table or
+  // the entry has another signature, created by {InitIndirectCallTraps}.
+  // Graphs are built off the main thread, and cannot create them.
+  Handle<Code> trap_stub;
+  Handle<Context> trap_context;
+  Handle<String> trap_bounds_message;
+  Handle<String> trap_signature_message;
+
   WasmModule* module;
   WasmLinker* linker;
   std::vector<Handle<Code>>* function_code;
@@ -113,14 +183,35 @@ struct ModuleEnv {
     DCHECK(IsValidFunction(index));
     return module->functions->at(index).sig;
   }
+  bool UsesImportTable(uint32_t index) {
+    DCHECK(IsValidFunction(index));
+    return !import_table.is_null() && module->functions->at(index).external;
+  }
 
-  FunctionSig* GetFunctionTableSignature(uint32_t index) {
-    return nullptr;  // TODO(titzer): implement function tables
+  FunctionSig* GetSignature(uint32_t index) {
+    if (!module || !module->signatures) return nullptr;
+    if (index >= module->signatures->size()) return nullptr;
+    return module->signatures->at(index);
+  }
+  uint32_t FunctionTableSize() {
+    if (!module || !module->function_table) return 0;
+    return static_cast<uint32_t>(module->function_table->size());
   }
 
   Handle<Code> GetFunctionCode(uint32_t index);
 
+  // Returns true if compiled functions receive the start of linear memory as
+  // an implicit last parameter, passed in a fixed register but not reserved
+  // in the function body, instead of loading it from {mem_buffer} on entry.
+  // Only instance-independent code does, since it is always entered through
+  // wrappers that pass the register.
+  bool UsesMemBaseParam();
+
   compiler::CallDescriptor* GetWasmCallDescriptor(Zone* zone, FunctionSig* sig);
+  // Returns the descriptor of calls to shared import wrappers, which take the
+  // imported JSFunction as an implicit first parameter.
+  compiler::CallDescriptor* GetWasmImportCallDescriptor(Zone* zone,
+                                                        FunctionSig* sig);
   compiler::CallDescriptor* GetCallDescriptor(Zone* zone, uint32_t index);
 };
 
@@ -148,6 +239,120 @@ int32_t CompileAndRunWasmModule(Isolate* isolate, const byte* module_start,
 // given decoded module.
 int32_t CompileAndRunWasmModule(Isolate* isolate, WasmModule* module);
 
+// Compiles the decoded {module} and returns a compiled module object, which
+// can be instantiated any number of times without compiling again.
+MaybeHandle<JSObject> CompileWasmModule(Isolate* isolate, WasmModule* module,
+                                        ErrorThrower& thrower);
+
+// Maps the module file at {path} read-only, and decodes and compiles the
+// module straight from the mapping. The returned compiled module object refers
+// to the mapping instead of a copy of the bytes, so that instantiation reads
+// the data segments and names from the file, and unmaps it when it dies.
+MaybeHandle<JSObject> CompileWasmModuleFile(Isolate* isolate, const char* path,
+                                            ErrorThrower& thrower);
+
+// Returns true if {object} is a compiled module object.
+bool IsWasmCompiledModule(Object* object);
+
+// Creates a new instantiation of a compiled module object, whose linear
+// memory is {memory} if given, like {WasmModule::Instantiate}.
+MaybeHandle<JSObject> InstantiateCompiledModule(
+    Isolate* isolate, Handle<JSObject> compiled_module, Handle<JSObject> ffi,
+    Handle<JSArrayBuffer> memory = Handle<JSArrayBuffer>::null());
+
+// Returns the linear memory of the module instance {module_object}, e.g. to
+// supply it to another instance, or a null handle if {module_object} is not
+// a module instance.
+Handle<JSArrayBuffer> GetInstanceMemory(Isolate* isolate,
+                                        Handle<JSObject> module_object);
+
+// Grows the memory of the module instance {module_object} by {delta} bytes,
+// like the GrowMemory expression. Returns the previous size of the memory in
+// bytes, or -1 if it cannot grow by {delta} bytes, e.g. because it was not
+// declared growable.
+int32_t GrowInstanceMemory(Isolate* isolate, Handle<JSObject> module_object,
+                           uint32_t delta);
+
+// Returns true if the module instance {module_object} defers compilation to
+// lazy compile stubs or the baseline compiler, and false if it was compiled
+// eagerly with TurboFan.
+bool IsTieredInstance(Handle<JSObject> module_object);
+
+// Creates the function table of an instance of {module}. It holds the
+// canonical signature ids of the table entries as small integers, followed
+// by the code of the entries, which is installed with {SetFunctionTableCode}.
+Handle<FixedArray> NewFunctionTable(Isolate* isolate, WasmModule* module);
+
+// Installs {code} as the code of entry {index} of the function {table}.
+void SetFunctionTableCode(FixedArray* table, int index, Code* code);
+
+// Sets up the objects with which indirect calls compiled for {module_env}
+// trap, in the native context of {isolate}.
+void InitIndirectCallTraps(Isolate* isolate, ModuleEnv* module_env);
+
+class WasmStreamingCompilation;  // forward declaration.
+
+// Decodes a module from chunks of its bytes as they arrive, e.g. while the
+// module is read from a file or a pipe. The header, globals, functions, and
+// data segments are decoded as soon as their bytes are present, and each
+// function body is handed to compilation on background threads as soon as
+// its bytes have arrived, overlapping compilation with the transfer of the
+// rest of the module. Handles created by the decoder live in the current
+// handle scope, which must therefore outlive the decoder.
+class WasmStreamingDecoder {
+ public:
+  WasmStreamingDecoder(Isolate* isolate, Zone* zone);
+  ~WasmStreamingDecoder();
+
+  // Appends the next {size} bytes of the module. Returns false if the bytes
+  // so far do not form a valid module, in which case further bytes are
+  // ignored and {Finish} reports the error.
+  bool PushBytes(const byte* bytes, size_t size);
+
+  // Ends the module bytes, and returns the decoded module or the first
+  // error. The module refers to the bytes held by the decoder, which must
+  // therefore outlive it.
+  ModuleResult Finish();
+
+  // Finishes compiling the module returned by {Finish}, and returns its
+  // compiled code, e.g. for {WasmModule::Instantiate}.
+  MaybeHandle<FixedArray> FinishCompilation(ErrorThrower& thrower);
+
+ private:
+  Isolate* isolate_;
+  Zone* zone_;
+  // The module bytes are in the last buffer, followed by a terminating 0
+  // once {Finish} has built all graphs. The earlier buffers hold prefixes of
+  // them that compilation units may still read, and are released then.
+  std::vector<byte*> buffers_;
+  size_t capacity_;  // size of the last buffer.
+  size_t size_;      // number of module bytes received.
+  WasmModule* module_;       // module, once the declarations are decoded.
+  std::vector<int> pending_;  // functions not yet compiled, by code end.
+  size_t next_pending_;
+  bool failed_;
+  ModuleResult error_;
+  WasmStreamingCompilation* compilation_;
+
+  void Fail(ModuleResult& result);
+  void CompileCompleteFunctions();
+};
+
+// Returns a hash of the flags that affect the code compiled for a module,
+// which caches of compiled code are keyed on. Unlike {FlagList::Hash()}, it
+// is computed anew on each call, so it reflects flags that tests assign
+// directly.
+int CodegenFlagsHash();
+
+// Statistics of the per-context cache of compiled module code.
+struct WasmCodeCacheStatistics {
+  int hits;     // compilations that copied the code from the cache.
+  int misses;   // compilations that compiled the code and cached it.
+  int entries;  // modules currently in the cache.
+};
+
+WasmCodeCacheStatistics GetWasmCodeCacheStatistics(Isolate* isolate);
+
 // Exposed for testing. Decodes a single function signature, allocating it
 // in the given zone. Returns {nullptr} upon failure.
 FunctionSig* DecodeFunctionSignatureForTesting(Zone* zone, const byte* start,
@@ -5,6 +5,8 @@
 #include "src/wasm/wasm-opcodes.h"
 #include "src/signature.h"
 
+#include "src/base/lazy-instance.h"
+
 namespace v8 {
 namespace internal {
 namespace wasm {
@@ -79,38 +81,172 @@ const char* WasmOpcodes::TypeName(MemType type) {
 
 #define DECLARE_SIG_ENUM(name, ...) kSigEnum_##name,
 
-enum WasmOpcodeSig { FOREACH_SIGNATURE(DECLARE_SIG_ENUM) };
+enum WasmOpcodeSig { FOREACH_SIGNATURE(DECLARE_SIG_ENUM) kSigEnumCount };
 
-// TODO(titzer): not static-initializer safe. Wrap in LazyInstance.
-#define DECLARE_SIG(name, ...)                      \
-  static LocalType kTypes_##name[] = {__VA_ARGS__}; \
-  static const FunctionSig kSig_##name(             \
-      1, static_cast<int>(arraysize(kTypes_##name)) - 1, kTypes_##name);
+#define DECLARE_SIG(name, ...) \
+  static LocalType kTypes_##name[] = {__VA_ARGS__};
 
 FOREACH_SIGNATURE(DECLARE_SIG)
 
-#define DECLARE_SIG_ENTRY(name, ...) &kSig_##name,
-
-static const FunctionSig* kSimpleExprSigs[] = {
-    nullptr, FOREACH_SIGNATURE(DECLARE_SIG_ENTRY)};
-
-static byte kSimpleExprSigTable[256];
-
-
-// Initialize the signature table.
-static void InitSigTable() {
-#define SET_SIG_TABLE(name, opcode, sig) \
-  kSimpleExprSigTable[opcode] = static_cast<int>(kSigEnum_##sig) + 1;
-  FOREACH_SIMPLE_EXPR_OPCODE(SET_SIG_TABLE);
-#undef SET_SIG_TABLE
-}
+#define DECLARE_SIG_ENTRY(name, ...) \
+  FunctionSig(1, static_cast<int>(arraysize(kTypes_##name)) - 1, kTypes_##name),
+
+// The signatures of the simple expressions, indexed by {WasmOpcodeInfo::sig}
+// minus one. Signatures have no constant constructor, so the table is created
+// on first use instead of by a static initializer.
+struct SimpleExprSigTable {
+  SimpleExprSigTable() : sigs{FOREACH_SIGNATURE(DECLARE_SIG_ENTRY)} {}
+  FunctionSig sigs[kSigEnumCount];
+};
+
+static base::LazyInstance<SimpleExprSigTable>::type kSimpleExprSigTable =
+    LAZY_INSTANCE_INITIALIZER;
+
+
+// The arity, result type and operand types of each signature, as compile
+// time constants.
+template <int sig>
+struct SigTraits;
+
+#define SIG_PARAM_0(p0, ...) p0
+#define SIG_PARAM_1(p0, p1, ...) p1
+#define DECLARE_SIG_TRAITS(name, ret, ...)                                    \
+  template <>                                                                 \
+  struct SigTraits<kSigEnum_##name> {                                         \
+    static const byte kArity = arraysize(kTypes_##name) - 1;                  \
+    static const byte kType = ret;                                            \
+    static const byte kParam0 = SIG_PARAM_0(__VA_ARGS__, kAstStmt);           \
+    static const byte kParam1 = SIG_PARAM_1(__VA_ARGS__, kAstStmt, kAstStmt); \
+    static const byte kIndex = static_cast<int>(kSigEnum_##name) + 1;         \
+  };
+
+FOREACH_SIGNATURE(DECLARE_SIG_TRAITS)
+
+#undef DECLARE_SIG_TRAITS
+#undef SIG_PARAM_1
+#undef SIG_PARAM_0
+
+
+// The properties of an opcode, as compile time constants.
+template <byte kind, byte immediate, class Sig>
+struct OpcodeTraitsOf {
+  static const byte kKind = kind;
+  static const byte kImmediate = immediate;
+  static const byte kArity = Sig::kArity;
+  static const byte kType = Sig::kType;
+  static const byte kParam0 = Sig::kParam0;
+  static const byte kParam1 = Sig::kParam1;
+  static const byte kSig = Sig::kIndex;
+};
+
+// Stands in for the signature of opcodes without a fixed signature.
+struct NoSigTraits {
+  static const byte kArity = 0;
+  static const byte kType = kAstStmt;
+  static const byte kParam0 = kAstStmt;
+  static const byte kParam1 = kAstStmt;
+  static const byte kIndex = 0;
+};
+
+// The length of the immediate of statements and miscellaneous expressions.
+template <int opcode>
+struct SpecialImmediate {
+  static const byte kLength = 0;
+};
+
+#define DECLARE_IMMEDIATE(opcode, length) \
+  template <>                             \
+  struct SpecialImmediate<opcode> {       \
+    static const byte kLength = length;   \
+  };
+
+DECLARE_IMMEDIATE(kStmtBlock, 1)
+DECLARE_IMMEDIATE(kStmtSwitch, 1)
+DECLARE_IMMEDIATE(kStmtSwitchNf, 1)
+DECLARE_IMMEDIATE(kStmtLoop, 1)
+DECLARE_IMMEDIATE(kStmtContinue, 1)
+DECLARE_IMMEDIATE(kStmtBreak, 1)
+DECLARE_IMMEDIATE(kExprInt8Const, 1)
+DECLARE_IMMEDIATE(kExprInt32Const, 4)
+DECLARE_IMMEDIATE(kExprInt64Const, 8)
+DECLARE_IMMEDIATE(kExprFloat32Const, 4)
+DECLARE_IMMEDIATE(kExprFloat64Const, 8)
+DECLARE_IMMEDIATE(kExprGetLocal, WasmOpcodeInfo::kVariableImmediate)
+DECLARE_IMMEDIATE(kExprSetLocal, WasmOpcodeInfo::kVariableImmediate)
+DECLARE_IMMEDIATE(kExprLoadGlobal, WasmOpcodeInfo::kVariableImmediate)
+DECLARE_IMMEDIATE(kExprStoreGlobal, WasmOpcodeInfo::kVariableImmediate)
+DECLARE_IMMEDIATE(kExprCallFunction, WasmOpcodeInfo::kVariableImmediate)
+DECLARE_IMMEDIATE(kExprCallIndirect, WasmOpcodeInfo::kVariableImmediate)
+
+#undef DECLARE_IMMEDIATE
+
+// Bytes that are not opcodes.
+template <int opcode>
+struct OpcodeTraits : OpcodeTraitsOf<kOpcodeInvalid, 0, NoSigTraits> {};
+
+#define DECLARE_OPCODE_TRAITS(kind, immediate, opcode, sig) \
+  template <>                                               \
+  struct OpcodeTraits<opcode> : OpcodeTraitsOf<kind, immediate, sig> {};
+
+#define DECLARE_SPECIAL_TRAITS(name, opcode, sig)                          \
+  DECLARE_OPCODE_TRAITS(kOpcodeSpecial, SpecialImmediate<opcode>::kLength, \
+                        opcode, NoSigTraits)
+FOREACH_STMT_OPCODE(DECLARE_SPECIAL_TRAITS)
+FOREACH_MISC_EXPR_OPCODE(DECLARE_SPECIAL_TRAITS)
+#undef DECLARE_SPECIAL_TRAITS
+
+#define DECLARE_SIMPLE_TRAITS(name, opcode, sig) \
+  DECLARE_OPCODE_TRAITS(kOpcodeSimple, 0, opcode, SigTraits<kSigEnum_##sig>)
+FOREACH_SIMPLE_EXPR_OPCODE(DECLARE_SIMPLE_TRAITS)
+#undef DECLARE_SIMPLE_TRAITS
+
+#define DECLARE_LOAD_MEM_TRAITS(name, opcode, sig) \
+  DECLARE_OPCODE_TRAITS(kOpcodeLoadMem, 1, opcode, SigTraits<kSigEnum_##sig>)
+FOREACH_LOAD_MEM_EXPR_OPCODE(DECLARE_LOAD_MEM_TRAITS)
+#undef DECLARE_LOAD_MEM_TRAITS
+
+#define DECLARE_STORE_MEM_TRAITS(name, opcode, sig) \
+  DECLARE_OPCODE_TRAITS(kOpcodeStoreMem, 1, opcode, SigTraits<kSigEnum_##sig>)
+FOREACH_STORE_MEM_EXPR_OPCODE(DECLARE_STORE_MEM_TRAITS)
+#undef DECLARE_STORE_MEM_TRAITS
+
+#undef DECLARE_OPCODE_TRAITS
+
+// The table consists only of constants, so it is initialized statically and
+// is safe to read from any thread.
+#define OPCODE_INFO(opcode)                                        \
+  {OpcodeTraits<opcode>::kKind,                                    \
+   OpcodeTraits<opcode>::kImmediate,                               \
+   OpcodeTraits<opcode>::kArity,                                   \
+   OpcodeTraits<opcode>::kType,                                    \
+   {OpcodeTraits<opcode>::kParam0, OpcodeTraits<opcode>::kParam1}, \
+   OpcodeTraits<opcode>::kSig},
+#define OPCODE_INFO_16(base)                      \
+  OPCODE_INFO(base + 0x0) OPCODE_INFO(base + 0x1) \
+  OPCODE_INFO(base + 0x2) OPCODE_INFO(base + 0x3) \
+  OPCODE_INFO(base + 0x4) OPCODE_INFO(base + 0x5) \
+  OPCODE_INFO(base + 0x6) OPCODE_INFO(base + 0x7) \
+  OPCODE_INFO(base + 0x8) OPCODE_INFO(base + 0x9) \
+  OPCODE_INFO(base + 0xa) OPCODE_INFO(base + 0xb) \
+  OPCODE_INFO(base + 0xc) OPCODE_INFO(base + 0xd) \
+  OPCODE_INFO(base + 0xe) OPCODE_INFO(base + 0xf)
+
+const WasmOpcodeInfo WasmOpcodes::kOpcodeInfo[256] = {
+    OPCODE_INFO_16(0x00) OPCODE_INFO_16(0x10) OPCODE_INFO_16(0x20)
+    OPCODE_INFO_16(0x30) OPCODE_INFO_16(0x40) OPCODE_INFO_16(0x50)
+    OPCODE_INFO_16(0x60) OPCODE_INFO_16(0x70) OPCODE_INFO_16(0x80)
+    OPCODE_INFO_16(0x90) OPCODE_INFO_16(0xa0) OPCODE_INFO_16(0xb0)
+    OPCODE_INFO_16(0xc0) OPCODE_INFO_16(0xd0) OPCODE_INFO_16(0xe0)
+    OPCODE_INFO_16(0xf0)};
+
+#undef OPCODE_INFO_16
+#undef OPCODE_INFO
 
 
 FunctionSig* WasmOpcodes::Signature(WasmOpcode opcode) {
-  // TODO(titzer): use LazyInstance to make this thread safe.
-  if (kSimpleExprSigTable[kExprInt32Add] == 0) InitSigTable();
-  return const_cast<FunctionSig*>(
-      kSimpleExprSigs[kSimpleExprSigTable[static_cast<byte>(opcode)]]);
+  const WasmOpcodeInfo& info = Info(opcode);
+  if (info.kind != kOpcodeSimple) return nullptr;
+  return &kSimpleExprSigTable.Pointer()->sigs[info.sig - 1];
 }
 
 
@@ -86,7 +86,9 @@ typedef Signature<LocalType> FunctionSig;
   V(CallFunction, 0x19, _)          \
   V(CallIndirect, 0x1a, _)          \
   V(Ternary, 0x1b, _)               \
-  V(Comma, 0x1c, _)
+  V(Comma, 0x1c, _)                 \
+  V(MemorySize, 0x1d, _)            \
+  V(GrowMemory, 0x1e, _)
 
 // Load memory expressions.
 #define FOREACH_LOAD_MEM_EXPR_OPCODE(V) \
@@ -269,6 +271,7 @@ typedef Signature<LocalType> FunctionSig;
   V(d_id, kAstFloat64, kAstInt32, kAstFloat64)   \
   V(f_if, kAstFloat32, kAstInt32, kAstFloat32)   \
   V(l_il, kAstInt64, kAstInt32, kAstInt64)       \
+  V(i_li, kAstInt32, kAstInt64, kAstInt32)       \
   V(d_ld, kAstFloat64, kAstInt64, kAstFloat64)   \
   V(f_lf, kAstFloat32, kAstInt64, kAstFloat32)
 
@@ -284,6 +287,33 @@ enum WasmOpcode {
 #undef DECLARE_NAMED_ENUM
 };
 
+// Classes of opcodes, which select how the decoder handles an opcode.
+enum WasmOpcodeKind {
+  kOpcodeInvalid = 0,   // not an opcode
+  kOpcodeSimple = 1,    // an expression with a fixed signature
+  kOpcodeLoadMem = 2,   // a load from memory
+  kOpcodeStoreMem = 3,  // a store to memory
+  kOpcodeSpecial = 4    // a statement or miscellaneous expression
+};
+
+// Static properties of an opcode. The operand count and types are only
+// fixed for simple expressions and memory accesses.
+struct WasmOpcodeInfo {
+  static const byte kVariableImmediate = 0xff;
+
+  byte kind;       // the WasmOpcodeKind.
+  byte immediate;  // the length of the immediate, or kVariableImmediate.
+  byte arity;      // the number of operands.
+  byte type;       // the LocalType of the result.
+  byte params[2];  // the LocalTypes of the operands.
+  byte sig;        // the index of the signature of a simple expression.
+
+  LocalType result_type() const { return static_cast<LocalType>(type); }
+  LocalType param_type(int index) const {
+    return static_cast<LocalType>(params[index]);
+  }
+};
+
 // A collection of opcode-related static methods.
 class WasmOpcodes {
  public:
@@ -293,6 +323,12 @@ class WasmOpcodes {
   static const char* TypeName(MemType type);
   static FunctionSig* Signature(WasmOpcode opcode);
 
+  // Looks up the properties of {opcode} in a table that is initialized at
+  // compile time.
+  static const WasmOpcodeInfo& Info(WasmOpcode opcode) {
+    return kOpcodeInfo[static_cast<byte>(opcode)];
+  }
+
   static byte MemSize(MemType type) {
     switch (type) {
       case kMemInt8:
@@ -406,6 +442,9 @@ class WasmOpcodes {
         return 'v';
     }
   }
+
+ private:
+  static const WasmOpcodeInfo kOpcodeInfo[256];
 };
 }
 }
@@ -5,6 +5,8 @@
 #include "src/wasm/wasm-wrapper.h"
 #include "src/wasm/tf-builder.h"
 
+#include <vector>
+
 #include "src/compiler/pipeline.h"
 #include "src/compiler/machine-operator.h"
 #include "src/compiler/change-lowering.h"
@@ -18,27 +20,62 @@
 #include "src/compiler/graph-visualizer.h"
 #include "src/compiler/typer.h"
 
+#include "src/base/functional.h"
+#include "src/flags.h"
+
 namespace v8 {
 namespace internal {
 namespace wasm {
 
-Handle<JSFunction> CompileJSToWasmWrapper(Isolate* isolate, ModuleEnv* module,
-                                          Handle<String> name,
-                                          Handle<Code> wasm_code,
-                                          uint32_t index) {
-  WasmFunction* func = &module->module->functions->at(index);
+// Lowers the JavaScript and change operators in a wrapper graph to machine
+// operators.
+static void LowerJSOperators(Isolate* isolate, Zone* zone,
+                             compiler::JSGraph* jsgraph) {
+  compiler::Graph* graph = jsgraph->graph();
 
-  //----------------------------------------------------------------------------
-  // Create the JSFunction object.
-  //----------------------------------------------------------------------------
+  // Changes lowering requires types.
+  compiler::Typer typer(isolate, graph);
+  compiler::NodeVector roots(zone);
+  jsgraph->GetCachedNodes(&roots);
+  typer.Run(roots);
+
+  // Run generic and change lowering.
+  compiler::JSGenericLowering generic(true, jsgraph);
+  compiler::ChangeLowering changes(jsgraph);
+  compiler::GraphReducer graph_reducer(zone, graph, jsgraph->Dead());
+  graph_reducer.AddReducer(&changes);
+  graph_reducer.AddReducer(&generic);
+  graph_reducer.ReduceGraph();
+
+  if (FLAG_trace_turbo_graph) {  // Simple textual RPO.
+    OFStream os(stdout);
+    os << "-- Graph after change lowering -- " << std::endl;
+    os << compiler::AsRPO(*graph);
+  }
+}
+
+
+Handle<JSFunction> NewJSToWasmFunction(Isolate* isolate, Handle<String> name,
+                                       Handle<Code> wasm_code,
+                                       FunctionSig* sig) {
   Handle<SharedFunctionInfo> shared =
       isolate->factory()->NewSharedFunctionInfo(name, wasm_code);
-  int params = static_cast<int>(func->sig->parameter_count());
+  int params = static_cast<int>(sig->parameter_count());
   shared->set_length(params);
   shared->set_internal_formal_parameter_count(1 + params);
   Handle<JSFunction> function = isolate->factory()->NewFunction(name);
   function->set_shared(*shared);
+  return function;
+}
+
 
+namespace {
+// Compiles a JS->WASM wrapper for functions of signature {sig} which calls
+// {wasm_code}, or the code of the function it is installed on if
+// {wasm_code} is null. The {name} is only used for debugging output.
+Handle<Code> CompileJSToWasmWrapperCode(Isolate* isolate, ModuleEnv* module,
+                                        Handle<Code> wasm_code,
+                                        FunctionSig* sig, const char* name) {
   //----------------------------------------------------------------------------
   // Create the TFGraph
   //----------------------------------------------------------------------------
@@ -56,70 +93,293 @@ Handle<JSFunction> CompileJSToWasmWrapper(Isolate* isolate, ModuleEnv* module,
   builder.control = &control;
   builder.effect = &effect;
   builder.module = module;
-  builder.BuildJSToWasmWrapper(wasm_code, func->sig);
+  builder.BuildJSToWasmWrapper(wasm_code, sig);
 
   //----------------------------------------------------------------------------
   // Run the compilation pipeline.
   //----------------------------------------------------------------------------
-  {
-    // Changes lowering requires types.
-    compiler::Typer typer(isolate, &graph);
-    compiler::NodeVector roots(&zone);
-    jsgraph.GetCachedNodes(&roots);
-    typer.Run(roots);
-
-    // Run generic and change lowering.
-    compiler::JSGenericLowering generic(true, &jsgraph);
-    compiler::ChangeLowering changes(&jsgraph);
-    compiler::GraphReducer graph_reducer(&zone, &graph, jsgraph.Dead());
-    graph_reducer.AddReducer(&changes);
-    graph_reducer.AddReducer(&generic);
-    graph_reducer.ReduceGraph();
-
-    if (FLAG_trace_turbo_graph) {  // Simple textual RPO.
-      OFStream os(stdout);
-      os << "-- Graph after change lowering -- " << std::endl;
-      os << compiler::AsRPO(graph);
-    }
+  LowerJSOperators(isolate, &zone, &jsgraph);
 
-    // Schedule and compile to machine code.
-    int params = static_cast<int>(
-        module->GetFunctionSignature(index)->parameter_count());
-    compiler::CallDescriptor* incoming = compiler::Linkage::GetJSCallDescriptor(
-        &zone, false, params + 1, compiler::CallDescriptor::kNoFlags);
-    CompilationInfo info("js-to-wasm", isolate, &zone);
-    // TODO(titzer): info.ForceOptimizing();
-    Handle<Code> code = compiler::Pipeline::GenerateCodeForTesting(
-        &info, incoming, &graph, nullptr);
+  // Schedule and compile to machine code.
+  int params = static_cast<int>(sig->parameter_count());
+  compiler::CallDescriptor* incoming = compiler::Linkage::GetJSCallDescriptor(
+      &zone, false, params + 1, compiler::CallDescriptor::kNoFlags);
+  CompilationInfo info("js-to-wasm", isolate, &zone);
+  // TODO(titzer): info.ForceOptimizing();
+  Handle<Code> code = compiler::Pipeline::GenerateCodeForTesting(
+      &info, incoming, &graph, nullptr);
 
 #ifdef ENABLE_DISASSEMBLER
-    // Disassemble the wrapper code for debugging.
-    if (!code.is_null() && FLAG_print_opt_code) {
-      static const int kBufferSize = 128;
-      char buffer[kBufferSize];
-      const char* name = "";
-      if (func->name_offset > 0) {
-        const byte* ptr = module->module->module_start + func->name_offset;
-        name = reinterpret_cast<const char*>(ptr);
+  // Disassemble the wrapper code for debugging.
+  if (!code.is_null() && FLAG_print_opt_code) {
+    OFStream os(stdout);
+    code->Disassemble(name, os);
+  }
+#endif
+  return code;
+}
+
+
+// The JS->WASM wrappers that call the code of the function they are
+// installed on, and the WASM->JS wrappers that call the function passed to
+// them, one of each kind per signature, held in an open-addressed hash table
+// on the global object of the native context, together with the wrapper
+// statistics. The cache is unavailable without a context.
+class SharedWrapperCache {
+ public:
+  enum Kind {
+    kJSToWasm,           // calls the code of its function.
+    kWasmToJSDirect,     // calls a function of matching arity directly.
+    kWasmToJSAdaptArgs,  // calls a function through the CallFunctionStub.
+  };
+
+  // The statistics held in the header of the table.
+  enum Counter {
+    kCompiled = 0,
+    kReused = 1,
+    kImportCompiled = 2,
+    kImportReused = 3,
+  };
+
+  explicit SharedWrapperCache(Isolate* isolate) : isolate_(isolate) {
+    if (isolate->context() == nullptr) return;
+    Handle<JSObject> global(isolate->native_context()->global_object(),
+                            isolate);
+    Handle<Object> table(global->GetHiddenProperty(Key(isolate)), isolate);
+    if (table->IsFixedArray()) {
+      table_ = Handle<FixedArray>::cast(table);
+      return;
+    }
+    table_ = NewTable(kInitialCapacity);
+  }
+
+  bool is_available() const { return !table_.is_null(); }
+
+  static WasmWrapperStatistics GetStatistics(Isolate* isolate) {
+    WasmWrapperStatistics stats = {0, 0, 0, 0};
+    SharedWrapperCache cache(isolate);
+    if (cache.is_available()) {
+      stats.compiled = cache.Get(kCompiled);
+      stats.reused = cache.Get(kReused);
+      stats.import_compiled = cache.Get(kImportCompiled);
+      stats.import_reused = cache.Get(kImportReused);
+    }
+    return stats;
+  }
+
+  void Increment(Counter counter) {
+    if (!is_available()) return;
+    table_->set(counter, Smi::FromInt(Get(counter) + 1));
+  }
+
+  // Returns the wrapper of {kind} for {sig}, or null. Does not allocate.
+  Code* Lookup(Kind kind, FunctionSig* sig) {
+    if (!is_available()) return nullptr;
+    SigKey key = MakeKey(kind, sig);
+    int entry = FindEntry(*table_, key, KeyHash(key));
+    Object* code = table_->get(entry + kEntryCode);
+    return code->IsCode() ? Code::cast(code) : nullptr;
+  }
+
+  void Insert(Kind kind, FunctionSig* sig, Handle<Code> code) {
+    if (!is_available()) return;
+    if (2 * (Get(kCount) + 1) > Capacity(*table_)) Grow();
+    SigKey key = MakeKey(kind, sig);
+    int hash = KeyHash(key);
+    int entry = FindEntry(*table_, key, hash);
+    Handle<ByteArray> bytes = isolate_->factory()->NewByteArray(
+        static_cast<int>(key.size()), TENURED);
+    memcpy(bytes->GetDataStartAddress(), &key[0], key.size());
+    table_->set(entry + kEntryKey, *bytes);
+    table_->set(entry + kEntryHash, Smi::FromInt(hash));
+    table_->set(entry + kEntryCode, *code);
+    table_->set(kCount, Smi::FromInt(Get(kCount) + 1));
+  }
+
+ private:
+  // The wrappers depend on the flags through the WASM calling convention.
+  typedef std::vector<byte> SigKey;
+
+  // The layout of the table.
+  static const int kCount = 4;
+  static const int kHeaderSize = 5;
+  static const int kInitialCapacity = 16;  // a power of two.
+
+  // The layout of an entry, whose key is undefined if it is empty.
+  static const int kEntryKey = 0;  // a ByteArray holding the key.
+  static const int kEntryHash = 1;
+  static const int kEntryCode = 2;
+  static const int kEntrySize = 3;
+
+  Isolate* isolate_;
+  Handle<FixedArray> table_;
+
+  static Handle<String> Key(Isolate* isolate) {
+    return isolate->factory()->InternalizeUtf8String("wasm wrapper cache");
+  }
+
+  static SigKey MakeKey(Kind kind, FunctionSig* sig) {
+    SigKey key;
+    uint32_t flags_hash = static_cast<uint32_t>(CodegenFlagsHash());
+    for (int i = 0; i < 4; i++) {
+      key.push_back(static_cast<byte>(flags_hash >> (i * 8)));
+    }
+    key.push_back(static_cast<byte>(kind));
+    key.push_back(static_cast<byte>(sig->return_count()));
+    for (size_t i = 0; i < sig->return_count(); i++) {
+      key.push_back(static_cast<byte>(sig->GetReturn(i)));
+    }
+    for (size_t i = 0; i < sig->parameter_count(); i++) {
+      key.push_back(static_cast<byte>(sig->GetParam(i)));
+    }
+    return key;
+  }
+
+  static int KeyHash(const SigKey& key) {
+    size_t hash = base::hash_range(key.begin(), key.end());
+    return static_cast<int>(hash & Smi::kMaxValue);
+  }
+
+  static int Capacity(FixedArray* table) {
+    return (table->length() - kHeaderSize) / kEntrySize;
+  }
+
+  // Returns the index of the entry for {key}, or of the empty entry where
+  // it belongs.
+  static int FindEntry(FixedArray* table, const SigKey& key, int hash) {
+    int mask = Capacity(table) - 1;
+    for (int i = hash & mask;; i = (i + 1) & mask) {
+      int entry = kHeaderSize + i * kEntrySize;
+      Object* entry_key = table->get(entry + kEntryKey);
+      if (entry_key->IsUndefined()) return entry;
+      if (Smi::cast(table->get(entry + kEntryHash))->value() != hash) {
+        continue;
+      }
+      ByteArray* bytes = ByteArray::cast(entry_key);
+      if (bytes->length() == static_cast<int>(key.size()) &&
+          memcmp(bytes->GetDataStartAddress(), &key[0], key.size()) == 0) {
+        return entry;
       }
-      snprintf(buffer, kBufferSize, "JS->WASM function wrapper #%d:%s", index,
-               name);
-      OFStream os(stdout);
-      code->Disassemble(buffer, os);
     }
-#endif
-    // Set the JSFunction's machine code.
-    function->set_code(*code);
   }
+
+  Handle<FixedArray> NewTable(int capacity) {
+    Handle<FixedArray> table = isolate_->factory()->NewFixedArray(
+        kHeaderSize + capacity * kEntrySize, TENURED);
+    for (int i = 0; i < kHeaderSize; i++) table->set(i, Smi::FromInt(0));
+    Handle<JSObject> global(isolate_->native_context()->global_object(),
+                            isolate_);
+    JSObject::SetHiddenProperty(global, Key(isolate_), table);
+    return table;
+  }
+
+  // Moves the entries to a table of twice the capacity.
+  void Grow() {
+    Handle<FixedArray> old_table = table_;
+    table_ = NewTable(2 * Capacity(*old_table));
+    for (int i = 0; i < kHeaderSize; i++) table_->set(i, old_table->get(i));
+    for (int i = 0; i < Capacity(*old_table); i++) {
+      int from = kHeaderSize + i * kEntrySize;
+      Object* key = old_table->get(from + kEntryKey);
+      if (key->IsUndefined()) continue;
+      ByteArray* bytes = ByteArray::cast(key);
+      SigKey sig_key(bytes->GetDataStartAddress(),
+                     bytes->GetDataStartAddress() + bytes->length());
+      int hash = Smi::cast(old_table->get(from + kEntryHash))->value();
+      int to = FindEntry(*table_, sig_key, hash);
+      for (int j = 0; j < kEntrySize; j++) {
+        table_->set(to + j, old_table->get(from + j));
+      }
+    }
+  }
+
+  int Get(int index) { return Smi::cast(table_->get(index))->value(); }
+};
+}  // namespace
+
+
+Handle<JSFunction> CompileJSToWasmWrapper(Isolate* isolate, ModuleEnv* module,
+                                          Handle<String> name,
+                                          Handle<Code> wasm_code,
+                                          uint32_t index) {
+  WasmFunction* func = &module->module->functions->at(index);
+  Handle<JSFunction> function =
+      NewJSToWasmFunction(isolate, name, wasm_code, func->sig);
+
+  static const int kBufferSize = 128;
+  char buffer[kBufferSize];
+  const char* func_name = "";
+  if (func->name_offset > 0) {
+    const byte* ptr = module->module->module_start + func->name_offset;
+    func_name = reinterpret_cast<const char*>(ptr);
+  }
+  snprintf(buffer, kBufferSize, "JS->WASM function wrapper #%d:%s", index,
+           func_name);
+  Handle<Code> code =
+      CompileJSToWasmWrapperCode(isolate, module, wasm_code, func->sig, buffer);
+  SharedWrapperCache(isolate).Increment(SharedWrapperCache::kCompiled);
+  // Set the JSFunction's machine code.
+  function->set_code(*code);
   return function;
 }
 
 
+Handle<Code> GetSharedJSToWasmWrapper(Isolate* isolate, ModuleEnv* module,
+                                      FunctionSig* sig) {
+  // Wrappers that pass the start of linear memory refer to the memory of an
+  // instance, and cannot be shared.
+  CHECK(!module->UsesMemBaseParam());
+  SharedWrapperCache cache(isolate);
+  Code* cached = cache.Lookup(SharedWrapperCache::kJSToWasm, sig);
+  if (cached != nullptr) {
+    cache.Increment(SharedWrapperCache::kReused);
+    return Handle<Code>(cached, isolate);
+  }
+  Handle<Code> code =
+      CompileJSToWasmWrapperCode(isolate, module, Handle<Code>::null(), sig,
+                                 "JS->WASM shared function wrapper");
+  cache.Increment(SharedWrapperCache::kCompiled);
+  cache.Insert(SharedWrapperCache::kJSToWasm, sig, code);
+  return code;
+}
+
+
+bool IsSharedJSToWasmWrapper(Isolate* isolate, Code* code, FunctionSig* sig) {
+  SharedWrapperCache cache(isolate);
+  return cache.Lookup(SharedWrapperCache::kJSToWasm, sig) == code;
+}
+
+
+WasmWrapperStatistics GetWasmWrapperStatistics(Isolate* isolate) {
+  return SharedWrapperCache::GetStatistics(isolate);
+}
+
+
 Handle<Code> CompileWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
                                     Handle<JSFunction> function,
                                     uint32_t index) {
   WasmFunction* func = &module->module->functions->at(index);
+  static const int kBufferSize = 128;
+  char buffer[kBufferSize];
+  const char* name = "";
+  if (func->name_offset > 0) {
+    const byte* ptr = module->module->module_start + func->name_offset;
+    name = reinterpret_cast<const char*>(ptr);
+  }
+  snprintf(buffer, kBufferSize, "WASM->JS function wrapper #%d:%s", index,
+           name);
+  return CompileWasmToJSWrapper(isolate, module, function, func->sig, buffer);
+}
 
+
+namespace {
+// Compiles a WASM->JS wrapper for functions of signature {sig} which calls
+// {function}, or the function passed to it if {function} is null. The
+// {name} is only used for debugging output.
+Handle<Code> CompileWasmToJSWrapperCode(Isolate* isolate, ModuleEnv* module,
+                                        Handle<JSFunction> function,
+                                        FunctionSig* sig, bool arity_match,
+                                        const char* name) {
   //----------------------------------------------------------------------------
   // Create the TFGraph
   //----------------------------------------------------------------------------
@@ -137,33 +397,16 @@ Handle<Code> CompileWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
   builder.control = &control;
   builder.effect = &effect;
   builder.module = module;
-  builder.BuildWasmToJSWrapper(function, func->sig);
+  builder.BuildWasmToJSWrapper(function, sig, arity_match);
 
   Handle<Code> code = Handle<Code>::null();
   {
-    // Changes lowering requires types.
-    compiler::Typer typer(isolate, &graph);
-    compiler::NodeVector roots(&zone);
-    jsgraph.GetCachedNodes(&roots);
-    typer.Run(roots);
-
-    // Run generic and change lowering.
-    compiler::JSGenericLowering generic(true, &jsgraph);
-    compiler::ChangeLowering changes(&jsgraph);
-    compiler::GraphReducer graph_reducer(&zone, &graph, jsgraph.Dead());
-    graph_reducer.AddReducer(&changes);
-    graph_reducer.AddReducer(&generic);
-    graph_reducer.ReduceGraph();
-
-    if (FLAG_trace_turbo_graph) {  // Simple textual RPO.
-      OFStream os(stdout);
-      os << "-- Graph after change lowering -- " << std::endl;
-      os << compiler::AsRPO(graph);
-    }
+    LowerJSOperators(isolate, &zone, &jsgraph);
 
     // Schedule and compile to machine code.
     compiler::CallDescriptor* incoming =
-        module->GetWasmCallDescriptor(&zone, func->sig);
+        function.is_null() ? module->GetWasmImportCallDescriptor(&zone, sig)
+                           : module->GetWasmCallDescriptor(&zone, sig);
     CompilationInfo info("wasm-to-js", isolate, &zone);
     code = compiler::Pipeline::GenerateCodeForTesting(&info, incoming, &graph,
                                                       nullptr);
@@ -171,17 +414,83 @@ Handle<Code> CompileWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
 #ifdef ENABLE_DISASSEMBLER
     // Disassemble the wrapper code for debugging.
     if (!code.is_null() && FLAG_print_opt_code) {
-      static const int kBufferSize = 128;
-      char buffer[kBufferSize];
-      const char* name = "";
-      if (func->name_offset > 0) {
-        const byte* ptr = module->module->module_start + func->name_offset;
-        name = reinterpret_cast<const char*>(ptr);
-      }
-      snprintf(buffer, kBufferSize, "WASM->JS function wrapper #%d:%s", index,
-               name);
       OFStream os(stdout);
-      code->Disassemble(buffer, os);
+      code->Disassemble(name, os);
+    }
+#endif
+  }
+  return code;
+}
+}  // namespace
+
+
+Handle<Code> CompileWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
+                                    Handle<JSFunction> function,
+                                    FunctionSig* sig, const char* name) {
+  SharedWrapperCache(isolate).Increment(SharedWrapperCache::kImportCompiled);
+  return CompileWasmToJSWrapperCode(isolate, module, function, sig, false,
+                                    name);
+}
+
+
+Handle<Code> GetSharedWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
+                                      FunctionSig* sig, bool arity_match) {
+  SharedWrapperCache cache(isolate);
+  SharedWrapperCache::Kind kind = arity_match
+                                      ? SharedWrapperCache::kWasmToJSDirect
+                                      : SharedWrapperCache::kWasmToJSAdaptArgs;
+  Code* cached = cache.Lookup(kind, sig);
+  if (cached != nullptr) {
+    cache.Increment(SharedWrapperCache::kImportReused);
+    return Handle<Code>(cached, isolate);
+  }
+  Handle<Code> code = CompileWasmToJSWrapperCode(
+      isolate, module, Handle<JSFunction>::null(), sig, arity_match,
+      "WASM->JS shared function wrapper");
+  cache.Increment(SharedWrapperCache::kImportCompiled);
+  cache.Insert(kind, sig, code);
+  return code;
+}
+
+
+Handle<Code> CompileLazyCompileStub(Isolate* isolate, ModuleEnv* module,
+                                    Handle<JSFunction> compile_function,
+                                    FunctionSig* sig) {
+  //----------------------------------------------------------------------------
+  // Create the TFGraph
+  //----------------------------------------------------------------------------
+  Zone zone;
+  compiler::Graph graph(&zone);
+  compiler::CommonOperatorBuilder common(&zone);
+  compiler::JSOperatorBuilder javascript(&zone);
+  compiler::MachineOperatorBuilder machine(&zone);
+  compiler::JSGraph jsgraph(isolate, &graph, &common, &javascript, &machine);
+
+  TFNode* control = nullptr;
+  TFNode* effect = nullptr;
+
+  TFBuilder builder(&zone, &jsgraph);
+  builder.control = &control;
+  builder.effect = &effect;
+  builder.module = module;
+  builder.BuildLazyCompileStub(compile_function, sig);
+
+  Handle<Code> code = Handle<Code>::null();
+  {
+    LowerJSOperators(isolate, &zone, &jsgraph);
+
+    // Schedule and compile to machine code.
+    compiler::CallDescriptor* incoming =
+        module->GetWasmCallDescriptor(&zone, sig);
+    CompilationInfo info("wasm-lazy-compile", isolate, &zone);
+    code = compiler::Pipeline::GenerateCodeForTesting(&info, incoming, &graph,
+                                                      nullptr);
+
+#ifdef ENABLE_DISASSEMBLER
+    // Disassemble the stub code for debugging.
+    if (!code.is_null() && FLAG_print_opt_code) {
+      OFStream os(stdout);
+      code->Disassemble("WASM lazy compile stub", os);
     }
 #endif
   }
@@ -17,12 +17,64 @@ Handle<Code> CompileWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
                                     Handle<JSFunction> function,
                                     uint32_t index);
 
+// Wraps a JS function, producing a code object that can be called from WASM
+// with the signature {sig}. The {name} is only used for debugging output.
+Handle<Code> CompileWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
+                                    Handle<JSFunction> function,
+                                    FunctionSig* sig, const char* name);
+
 // Wraps a given wasm code object, producing a JSFunction that can be called
 // from JavaScript.
 Handle<JSFunction> CompileJSToWasmWrapper(Isolate* isolate, ModuleEnv* module,
                                           Handle<String> name,
                                           Handle<Code> wasm_code,
                                           uint32_t index);
+
+// Returns the code of a JS->WASM wrapper for functions of signature {sig},
+// which calls the WASM code of the function it is installed on, i.e. the
+// code of its shared function info. The wrapper is compiled once per
+// signature, codegen flags, and native context, and shared by all functions
+// of all instances.
+Handle<Code> GetSharedJSToWasmWrapper(Isolate* isolate, ModuleEnv* module,
+                                      FunctionSig* sig);
+
+// Returns the code of a WASM->JS wrapper for imports of signature {sig},
+// which calls the JSFunction passed as its implicit first parameter, as
+// described by {ModuleEnv::GetWasmImportCallDescriptor}. If {arity_match} is
+// set, the wrapper calls functions directly, and may only be used for
+// functions that declare as many parameters as {sig}. The wrapper is compiled
+// once per signature, arity match, codegen flags, and native context, and
+// shared by all imports of all instances.
+Handle<Code> GetSharedWasmToJSWrapper(Isolate* isolate, ModuleEnv* module,
+                                      FunctionSig* sig, bool arity_match);
+
+// Returns true if {code} is the wrapper that {GetSharedJSToWasmWrapper}
+// returns for {sig}.
+bool IsSharedJSToWasmWrapper(Isolate* isolate, Code* code, FunctionSig* sig);
+
+// Statistics of the JS->WASM and WASM->JS wrappers of an isolate.
+struct WasmWrapperStatistics {
+  int compiled;         // JS->WASM wrappers compiled, shared or not.
+  int reused;           // functions that reused a shared wrapper.
+  int import_compiled;  // WASM->JS wrappers compiled, shared or not.
+  int import_reused;    // imports that reused a shared wrapper.
+};
+
+WasmWrapperStatistics GetWasmWrapperStatistics(Isolate* isolate);
+
+// Creates the JSFunction for an exported function of signature {sig},
+// without code. The caller installs the code of a JS->WASM wrapper, e.g. one
+// copied from another instance of the same module.
+Handle<JSFunction> NewJSToWasmFunction(Isolate* isolate, Handle<String> name,
+                                       Handle<Code> wasm_code,
+                                       FunctionSig* sig);
+
+// Produces a stub with the calling convention of WASM functions of signature
+// {sig} which calls {compile_function} to obtain the code object of the
+// actual callee and then forwards its parameters to that code.
+Handle<Code> CompileLazyCompileStub(Isolate* isolate, ModuleEnv* module,
+                                    Handle<JSFunction> compile_function,
+                                    FunctionSig* sig);
 }
 }
 }
@@ -12,18 +12,28 @@
       'direct_dependent_settings': {
         'include_dirs': ['../..'],
         'sources': [
+          'baseline-compiler.cc',
+          'baseline-compiler.h',
+          'bounds-check-elimination.cc',
+          'bounds-check-elimination.h',
           'decoder.cc',
           'decoder.h',
           'encoder.cc',
           'encoder.h',
           'tf-builder.h',
           'tf-builder.cc',
+          'validator.cc',
+          'validator.h',
           'wasm-js.cc',
           'wasm-js.h',
           'wasm-linkage.cc',
           'wasm-macro-gen.h',
+          'wasm-memory.cc',
+          'wasm-memory.h',
           'wasm-module.cc',
           'wasm-module.h',
+          'wasm-module-file.cc',
+          'wasm-module-file.h',
           'wasm-opcodes.cc',
           'wasm-opcodes.h',
           'wasm-result.cc',
@@ -5,10 +5,23 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <set>
+
+#include "src/compiler/common-operator.h"
+#include "src/compiler/graph.h"
+#include "src/compiler/js-graph.h"
+#include "src/compiler/machine-operator.h"
+#include "src/compiler/node.h"
+#include "src/execution.h"
+#include "src/wasm/decoder.h"
 #include "src/wasm/encoder.h"
 #include "src/wasm/wasm-macro-gen.h"
+#include "src/wasm/wasm-memory.h"
 #include "src/wasm/wasm-module.h"
+#include "src/wasm/wasm-module-file.h"
 #include "src/wasm/wasm-opcodes.h"
+#include "src/wasm/wasm-wrapper.h"
 
 #include "test/cctest/cctest.h"
 
@@ -19,6 +32,22 @@ using namespace v8::internal::wasm;
 
 
 namespace {
+// Sets a flag for the lifetime of the scope, so that the old value is
+// restored on every path out of a test.
+template <typename T>
+class FlagScope {
+ public:
+  FlagScope(T* flag, T value) : flag_(flag), old_value_(*flag) {
+    *flag = value;
+  }
+  ~FlagScope() { *flag_ = old_value_; }
+
+ private:
+  T* flag_;
+  T old_value_;
+};
+
+
 void TestModule(const WasmModuleIndex& module, int32_t expected_result) {
   Isolate* isolate = CcTest::InitIsolateOnce();
   int32_t result =
@@ -124,3 +153,1057 @@ TEST(Run_WasmModule_CallMain_recursive) {
   builder.AddFunction(f.Build());
   TestModule(builder.BuildAndWrite(&zone), 55);
 }
+
+
+TEST(Run_WasmModule_ParallelCompilation) {
+  static const int kNumFunctions = 20;
+  FlagScope<int> num_tasks_flag(&FLAG_wasm_num_compilation_tasks, 4);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  // Function i returns i + 1 plus the result of calling function i - 1.
+  for (int i = 0; i < kNumFunctions; i++) {
+    WasmFunctionBuilder f(&zone);
+    f.ReturnType(kAstInt32);
+    if (i == 0) {
+      byte code[] = {WASM_RETURN(WASM_INT8(1))};
+      f.AddBody(code, sizeof(code));
+    } else {
+      byte code[] = {WASM_RETURN(
+          WASM_INT32_ADD(WASM_INT8(i + 1), WASM_CALL_FUNCTION0(i - 1)))};
+      f.AddBody(code, sizeof(code));
+    }
+    if (i == kNumFunctions - 1) f.Exported(1);
+    builder.AddFunction(f.Build());
+  }
+  TestModule(builder.BuildAndWrite(&zone),
+             kNumFunctions * (kNumFunctions + 1) / 2);
+}
+
+
+TEST(Run_WasmModule_Baseline_CallAdd) {
+  FlagScope<bool> baseline_flag(&FLAG_wasm_baseline, true);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f1(&zone);
+  f1.ReturnType(kAstInt32);
+  f1.AddParam(kAstInt32);
+  f1.AddParam(kAstInt32);
+  byte code1[] = {
+      WASM_RETURN(WASM_INT32_SUB(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)))};
+  f1.AddBody(code1, sizeof(code1));
+  builder.AddFunction(f1.Build());
+  WasmFunctionBuilder f2(&zone);
+  f2.ReturnType(kAstInt32);
+  f2.Exported(1);
+  byte code2[] = {
+      WASM_RETURN(WASM_CALL_FUNCTION(0, WASM_INT8(77), WASM_INT8(22)))};
+  f2.AddBody(code2, sizeof(code2));
+  builder.AddFunction(f2.Build());
+  TestModule(builder.BuildAndWrite(&zone), 55);
+}
+
+
+TEST(Run_WasmModule_Baseline_LoopAndMemory) {
+  FlagScope<bool> baseline_flag(&FLAG_wasm_baseline, true);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f(&zone);
+  f.ReturnType(kAstInt32);
+  f.LocalInt32Count(1);
+  f.Exported(1);
+  // Sums up 1..10 in memory, then reads the sum back.
+  byte code[] = {
+      WASM_WHILE(WASM_INT32_SLT(WASM_GET_LOCAL(0), WASM_INT8(10)),
+                 WASM_STORE_MEM(kMemInt32, WASM_ZERO,
+                                WASM_INT32_ADD(
+                                    WASM_LOAD_MEM(kMemInt32, WASM_ZERO),
+                                    WASM_INC_LOCAL(0)))),
+      WASM_RETURN(WASM_LOAD_MEM(kMemInt32, WASM_ZERO))};
+  f.AddBody(code, sizeof(code));
+  builder.AddFunction(f.Build());
+  TestModule(builder.BuildAndWrite(&zone), 55);
+}
+
+
+TEST(Run_WasmModule_Baseline_MemoryBounds) {
+  FlagScope<bool> baseline_flag(&FLAG_wasm_baseline, true);
+  static const int32_t kMemSize = 1 << 16;  // the builder's memory size.
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f(&zone);
+  f.ReturnType(kAstInt32);
+  f.Exported(1);
+  // Stores into the last word of memory, then reads it back, plus a read
+  // that straddles the end of memory and produces zero.
+  byte code[] = {
+      WASM_STORE_MEM(kMemInt32, WASM_INT32(kMemSize - 4), WASM_INT8(77)),
+      WASM_STORE_MEM(kMemInt32, WASM_INT32(kMemSize - 3), WASM_INT8(11)),
+      WASM_RETURN(
+          WASM_INT32_ADD(WASM_LOAD_MEM(kMemInt32, WASM_INT32(kMemSize - 4)),
+                         WASM_LOAD_MEM(kMemInt32, WASM_INT32(kMemSize - 1))))};
+  f.AddBody(code, sizeof(code));
+  builder.AddFunction(f.Build());
+  TestModule(builder.BuildAndWrite(&zone), 77);
+}
+
+
+TEST(Run_WasmModule_Baseline_Calls) {
+  FlagScope<bool> baseline_flag(&FLAG_wasm_baseline, true);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f1(&zone);
+  f1.ReturnType(kAstInt32);
+  f1.AddParam(kAstInt32);
+  f1.LocalInt32Count(1);
+  byte code1[] = {WASM_SET_LOCAL(1, WASM_INT8(3)),
+                  WASM_RETURN(WASM_INT32_MUL(WASM_GET_LOCAL(0),
+                                             WASM_GET_LOCAL(1)))};
+  f1.AddBody(code1, sizeof(code1));
+  builder.AddFunction(f1.Build());
+  WasmFunctionBuilder f2(&zone);
+  f2.ReturnType(kAstInt32);
+  f2.Exported(1);
+  byte code2[] = {WASM_RETURN(
+      WASM_INT32_ADD(WASM_CALL_FUNCTION(0, WASM_INT8(11)),
+                     WASM_CALL_FUNCTION(0, WASM_INT8(7))))};
+  f2.AddBody(code2, sizeof(code2));
+  builder.AddFunction(f2.Build());
+  TestModule(builder.BuildAndWrite(&zone), 54);
+}
+
+
+TEST(Run_WasmModule_LoopAndMemory) {
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f(&zone);
+  f.ReturnType(kAstInt32);
+  f.LocalInt32Count(1);
+  f.Exported(1);
+  // Sums up 1..10 in memory, then reads the sum back.
+  byte code[] = {
+      WASM_WHILE(WASM_INT32_SLT(WASM_GET_LOCAL(0), WASM_INT8(10)),
+                 WASM_STORE_MEM(kMemInt32, WASM_ZERO,
+                                WASM_INT32_ADD(
+                                    WASM_LOAD_MEM(kMemInt32, WASM_ZERO),
+                                    WASM_INC_LOCAL(0)))),
+      WASM_RETURN(WASM_LOAD_MEM(kMemInt32, WASM_ZERO))};
+  f.AddBody(code, sizeof(code));
+  builder.AddFunction(f.Build());
+  TestModule(builder.BuildAndWrite(&zone), 55);
+}
+
+
+TEST(Run_WasmModule_MemoryOutOfBounds) {
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f(&zone);
+  f.ReturnType(kAstInt32);
+  f.Exported(1);
+  // Accesses just past the end of memory are bounds-checked: the store is
+  // ignored and the load produces zero.
+  byte code[] = {
+      WASM_STORE_MEM(kMemInt32, WASM_INT32(64 * KB), WASM_INT8(99)),
+      WASM_RETURN(WASM_INT32_ADD(WASM_LOAD_MEM(kMemInt32, WASM_INT32(64 * KB)),
+                                 WASM_INT8(41)))};
+  f.AddBody(code, sizeof(code));
+  builder.AddFunction(f.Build());
+  TestModule(builder.BuildAndWrite(&zone), 41);
+}
+
+namespace {
+// A module whose exported function "main" returns sub(77, 22). It is encoded
+// by hand, since the module builder does not emit names.
+const byte kSubStart = 58;
+const byte kMainStart = kSubStart + 6;
+const byte kSubName = kMainStart + 7;
+const byte kMainName = kSubName + 4;
+const byte kStreamedModule[] = {
+    12, 0,  // memory
+    0, 0,   // globals
+    2, 0,   // functions
+    0, 0,   // data segments
+    // function #0: sub
+    2, kAstInt32, kAstInt32, kAstInt32,  // signature: int, int -> int
+    kSubName, 0, 0, 0,                   // name offset
+    kSubStart, 0, 0, 0,                  // code start offset
+    kMainStart, 0, 0, 0,                 // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,              // local counts
+    0,                                   // exported
+    0,                                   // external
+    // function #1: main
+    0, kAstInt32,                        // signature: -> int
+    kMainName, 0, 0, 0,                  // name offset
+    kMainStart, 0, 0, 0,                 // code start offset
+    kSubName, 0, 0, 0,                   // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,              // local counts
+    1,                                   // exported
+    0,                                   // external
+    // body of sub
+    WASM_RETURN(WASM_INT32_SUB(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1))),
+    // body of main
+    WASM_RETURN(WASM_CALL_FUNCTION(0, WASM_INT8(77), WASM_INT8(22))),
+    's', 'u', 'b', 0,      // name
+    'm', 'a', 'i', 'n', 0  // name
+};
+
+
+// Pushes {module} to a streaming decoder in chunks of {chunk_size} bytes.
+ModuleResult StreamModule(WasmStreamingDecoder* decoder, const byte* module,
+                          size_t size, size_t chunk_size) {
+  for (size_t pos = 0; pos < size; pos += chunk_size) {
+    if (!decoder->PushBytes(module + pos, std::min(chunk_size, size - pos))) {
+      break;
+    }
+  }
+  return decoder->Finish();
+}
+
+
+void TestStreamedModule(size_t chunk_size) {
+  CcTest::InitializeVM();
+  Isolate* isolate = CcTest::i_isolate();
+  HandleScope scope(isolate);
+  Zone zone;
+  WasmStreamingDecoder decoder(isolate, &zone);
+  ModuleResult result = StreamModule(&decoder, kStreamedModule,
+                                     sizeof(kStreamedModule), chunk_size);
+  CHECK(result.ok());
+  CHECK_EQ(2, static_cast<int>(result.val->functions->size()));
+
+  ErrorThrower thrower(isolate, "TestStreamedModule");
+  MaybeHandle<FixedArray> compiled = decoder.FinishCompilation(thrower);
+  CHECK(!thrower.error());
+  Handle<JSObject> module =
+      result.val->Instantiate(isolate, Handle<JSObject>::null(), compiled)
+          .ToHandleChecked();
+  delete result.val;
+
+  Handle<Object> main =
+      Object::GetProperty(module,
+                          isolate->factory()->InternalizeUtf8String("main"))
+          .ToHandleChecked();
+  Handle<Object> retval =
+      Execution::Call(isolate, main, isolate->factory()->undefined_value(), 0,
+                      nullptr)
+          .ToHandleChecked();
+  CHECK_EQ(55, static_cast<int32_t>(retval->Number()));
+}
+}  // namespace
+
+
+TEST(Run_WasmModule_Streaming) {
+  FlagScope<int> num_tasks_flag(&FLAG_wasm_num_compilation_tasks, 2);
+  TestStreamedModule(1);
+  TestStreamedModule(5);
+  TestStreamedModule(kMainStart);
+  TestStreamedModule(sizeof(kStreamedModule));
+}
+
+
+// Callees are inlined from the bytes received so far, which stay in place
+// while more bytes arrive.
+TEST(Run_WasmModule_Streaming_Inlining) {
+  FlagScope<int> num_tasks_flag(&FLAG_wasm_num_compilation_tasks, 2);
+  FlagScope<bool> inlining_flag(&FLAG_wasm_inlining, true);
+  TestStreamedModule(1);
+  TestStreamedModule(7);
+  TestStreamedModule(kMainStart);
+  TestStreamedModule(sizeof(kStreamedModule));
+}
+
+
+// The bytes are only terminated once all have arrived, so a name at the end
+// of the module can lack its own terminating 0.
+TEST(Run_WasmModule_Streaming_UnterminatedName) {
+  FlagScope<int> num_tasks_flag(&FLAG_wasm_num_compilation_tasks, 2);
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  for (size_t chunk_size : {1, 4, 64}) {
+    Zone zone;
+    WasmStreamingDecoder decoder(isolate, &zone);
+    ModuleResult result = StreamModule(&decoder, kStreamedModule,
+                                       sizeof(kStreamedModule) - 1, chunk_size);
+    CHECK(result.ok());
+    CHECK_EQ(0, strcmp("sub", result.val->GetName(kSubName)));
+    CHECK_EQ(0, strcmp("main", result.val->GetName(kMainName)));
+    ErrorThrower thrower(isolate, "Streaming_UnterminatedName");
+    decoder.FinishCompilation(thrower);
+    CHECK(!thrower.error());
+    delete result.val;
+  }
+}
+
+
+TEST(Run_WasmModule_Streaming_Errors) {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  {
+    // The module ends within the function declarations.
+    Zone zone;
+    WasmStreamingDecoder decoder(isolate, &zone);
+    CHECK(StreamModule(&decoder, kStreamedModule, kSubStart - 1, 3).failed());
+  }
+  {
+    // The module ends within the body of main, which declares its names
+    // beyond the end.
+    Zone zone;
+    WasmStreamingDecoder decoder(isolate, &zone);
+    CHECK(StreamModule(&decoder, kStreamedModule, kSubName - 1, 3).failed());
+  }
+}
+
+
+TEST(Run_WasmModule_MappedFile) {
+  static const char* kPath = "test-run-wasm-module-mapped.wasm";
+  FILE* file = OS::FOpen(kPath, "wb");
+  CHECK(file != nullptr);
+  CHECK_EQ(sizeof(kStreamedModule),
+           fwrite(kStreamedModule, 1, sizeof(kStreamedModule), file));
+  fclose(file);
+
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  ErrorThrower thrower(isolate, "Run_WasmModule_MappedFile");
+  Handle<JSObject> compiled =
+      CompileWasmModuleFile(isolate, kPath, thrower).ToHandleChecked();
+  CHECK(!thrower.error());
+  // The compiled module refers to the mapping, which outlives the file name.
+  OS::Remove(kPath);
+
+  for (int i = 0; i < 2; i++) {
+    Handle<JSObject> module =
+        InstantiateCompiledModule(isolate, compiled, Handle<JSObject>::null())
+            .ToHandleChecked();
+    Handle<Object> main =
+        Object::GetProperty(module,
+                            isolate->factory()->InternalizeUtf8String("main"))
+            .ToHandleChecked();
+    Handle<Object> retval =
+        Execution::Call(isolate, main, isolate->factory()->undefined_value(),
+                        0, nullptr)
+            .ToHandleChecked();
+    CHECK_EQ(55, static_cast<int32_t>(retval->Number()));
+  }
+
+  ErrorThrower missing_thrower(isolate, "Run_WasmModule_MappedFile");
+  CHECK(CompileWasmModuleFile(isolate, kPath, missing_thrower).is_null());
+  CHECK(missing_thrower.error());
+  isolate->clear_scheduled_exception();
+}
+
+
+TEST(Run_WasmModule_ModuleFileCopyTo) {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  size_t page_size = OS::CommitPageSize();
+  size_t size = 4 * page_size;
+  std::vector<byte> bytes(size);
+  for (size_t i = 0; i < size; i++) bytes[i] = static_cast<byte>(i * 7 + 1);
+  WasmModuleFile* file = WasmModuleFile::FromBytes(&bytes[0], &bytes[0] + size);
+  if (file == nullptr) return;  // No anonymous files on this platform.
+  Handle<JSArrayBuffer> file_buffer = NewModuleFileArrayBuffer(isolate, file);
+  CHECK(!file_buffer.is_null());
+
+  byte* mem = nullptr;
+  Handle<JSArrayBuffer> mem_buffer =
+      NewMappedArrayBuffer(isolate, 8 * page_size, &mem);
+  CHECK(!mem_buffer.is_null());
+
+  // Aligned alike, so that the whole pages in between are mapped.
+  file->CopyTo(mem + page_size + 10, 10, 3 * page_size);
+  CHECK_EQ(0, memcmp(mem + page_size + 10, &bytes[10], 3 * page_size));
+  // Aligned differently, so that everything is copied.
+  file->CopyTo(mem + 5 * page_size + 3, 10, page_size + 20);
+  CHECK_EQ(0, memcmp(mem + 5 * page_size + 3, &bytes[10], page_size + 20));
+  // The bytes around the copies stay zero.
+  CHECK_EQ(0, mem[page_size + 9]);
+  CHECK_EQ(0, mem[4 * page_size + 10]);
+  CHECK_EQ(0, mem[5 * page_size + 2]);
+  CHECK_EQ(0, mem[6 * page_size + 23]);
+
+  // Writes to mapped pages are private to the memory.
+  mem[2 * page_size] ^= 0xff;
+  CHECK_EQ(bytes[page_size], file->start()[page_size]);
+  CHECK_EQ(static_cast<byte>(bytes[page_size] ^ 0xff), mem[2 * page_size]);
+}
+
+
+namespace {
+void EmitUint32(std::vector<byte>* bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++) bytes->push_back((value >> (8 * i)) & 0xff);
+}
+}  // namespace
+
+
+TEST(Run_WasmModule_CopyOnWriteDataSegments) {
+  // The segment starts at the same offset within a page in the module bytes
+  // and in the memory, so that its whole pages can be mapped.
+  static const uint32_t kSourceOffset = 4096 + 100;
+  static const uint32_t kDest = 2 * 4096 + 100;
+  static const uint32_t kSegmentSize = 3 * 4096 + 100;
+  FlagScope<bool> cow_flag(&FLAG_wasm_cow_data_segments, true);
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+
+  // Returns the word at the given index in the segment.
+  byte code[] = {WASM_RETURN(WASM_LOAD_MEM(
+      kMemInt32, WASM_INT32_ADD(WASM_INT32(kDest), WASM_GET_LOCAL(0))))};
+  const uint32_t kCodeStart = 46;
+  const uint32_t kName = kCodeStart + sizeof(code);
+  std::vector<byte> bytes = {
+      16, 0,  // memory
+      0, 0,   // globals
+      1, 0,   // functions
+      1, 0,   // data segments
+      1, kAstInt32, kAstInt32  // signature: int -> int
+  };
+  EmitUint32(&bytes, kName);           // name offset
+  EmitUint32(&bytes, kCodeStart);      // code start offset
+  EmitUint32(&bytes, kName);           // code end offset
+  bytes.insert(bytes.end(), 8, 0);     // local counts
+  bytes.push_back(1);                  // exported
+  bytes.push_back(0);                  // external
+  EmitUint32(&bytes, kDest);           // data segment destination
+  EmitUint32(&bytes, kSourceOffset);   // data segment source offset
+  EmitUint32(&bytes, kSegmentSize);    // data segment size
+  bytes.push_back(1);                  // data segment init
+  CHECK_EQ(static_cast<size_t>(kCodeStart), bytes.size());
+  bytes.insert(bytes.end(), code, code + sizeof(code));
+  const char* name = "main";
+  bytes.insert(bytes.end(), name, name + strlen(name) + 1);
+  bytes.resize(kSourceOffset, 0);
+  for (uint32_t i = 0; i < kSegmentSize; i++) {
+    bytes.push_back(static_cast<byte>(i * 3));
+  }
+  const byte* data = &bytes[kSourceOffset];
+
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, &bytes[0], &bytes[0] + bytes.size());
+  CHECK(result.ok());
+  ErrorThrower thrower(isolate, "Run_WasmModule_CopyOnWriteDataSegments");
+  Handle<JSObject> compiled =
+      CompileWasmModule(isolate, result.val, thrower).ToHandleChecked();
+  delete result.val;
+
+  // Each instance gets its own copy of the segment.
+  for (int i = 0; i < 2; i++) {
+    Handle<JSObject> module =
+        InstantiateCompiledModule(isolate, compiled, Handle<JSObject>::null())
+            .ToHandleChecked();
+    Handle<Object> main =
+        Object::GetProperty(module,
+                            isolate->factory()->InternalizeUtf8String("main"))
+            .ToHandleChecked();
+    for (uint32_t offset = 0; offset + 4 <= kSegmentSize; offset += 997) {
+      Handle<Object> arg(Smi::FromInt(offset), isolate);
+      Handle<Object> retval =
+          Execution::Call(isolate, main,
+                          isolate->factory()->undefined_value(), 1, &arg)
+              .ToHandleChecked();
+      uint32_t expected = data[offset] | (data[offset + 1] << 8) |
+                          (data[offset + 2] << 16) |
+                          (static_cast<uint32_t>(data[offset + 3]) << 24);
+      CHECK_EQ(static_cast<int32_t>(expected),
+               static_cast<int32_t>(retval->Number()));
+    }
+  }
+}
+
+
+namespace {
+// A module with 64kb of memory with the given {mem_flags}, whose exported
+// function "main" grows the memory by the parameter, then stores to and
+// loads from an address beyond the initial 64kb.
+std::vector<byte> GrowMemoryModule(byte mem_flags) {
+  byte code[] = {WASM_RETURN(WASM_COMMA(
+      WASM_GROW_MEMORY(WASM_GET_LOCAL(0)),
+      WASM_COMMA(WASM_STORE_MEM(kMemInt32, WASM_INT32(100000),
+                                WASM_INT32(1234)),
+                 WASM_LOAD_MEM(kMemInt32, WASM_INT32(100000)))))};
+  const uint32_t kCodeStart = 33;
+  const uint32_t kName = kCodeStart + sizeof(code);
+  std::vector<byte> bytes = {
+      16, mem_flags,           // memory
+      0, 0,                    // globals
+      1, 0,                    // functions
+      0, 0,                    // data segments
+      1, kAstInt32, kAstInt32  // signature: int -> int
+  };
+  EmitUint32(&bytes, kName);        // name offset
+  EmitUint32(&bytes, kCodeStart);   // code start offset
+  EmitUint32(&bytes, kName);        // code end offset
+  bytes.insert(bytes.end(), 8, 0);  // local counts
+  bytes.push_back(1);               // exported
+  bytes.push_back(0);               // external
+  CHECK_EQ(static_cast<size_t>(kCodeStart), bytes.size());
+  bytes.insert(bytes.end(), code, code + sizeof(code));
+  const char* name = "main";
+  bytes.insert(bytes.end(), name, name + strlen(name) + 1);
+  return bytes;
+}
+}  // namespace
+
+
+TEST(Run_WasmModule_GrowMemory) {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  std::vector<byte> bytes = GrowMemoryModule(kModuleMemGrowable);
+
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, &bytes[0], &bytes[0] + bytes.size());
+  CHECK(result.ok());
+  CHECK(result.val->mem_growable);
+  Handle<JSObject> module =
+      result.val->Instantiate(isolate, Handle<JSObject>::null())
+          .ToHandleChecked();
+  delete result.val;
+  Handle<Object> main =
+      Object::GetProperty(module,
+                          isolate->factory()->InternalizeUtf8String("main"))
+          .ToHandleChecked();
+
+  // The grown memory keeps its contents.
+  for (int delta : {65536, 0}) {
+    Handle<Object> arg(Smi::FromInt(delta), isolate);
+    Handle<Object> retval =
+        Execution::Call(isolate, main, isolate->factory()->undefined_value(),
+                        1, &arg)
+            .ToHandleChecked();
+    CHECK_EQ(1234, static_cast<int32_t>(retval->Number()));
+  }
+
+  CHECK_EQ(131072, GrowInstanceMemory(isolate, module, 0));
+  CHECK_EQ(131072, GrowInstanceMemory(isolate, module, 4096));
+  CHECK_EQ(135168, GrowInstanceMemory(isolate, module, 0));
+  CHECK_EQ(-1, GrowInstanceMemory(isolate, module, 0x7fffffff));
+  CHECK_EQ(135168, GrowInstanceMemory(isolate, module, 0));
+}
+
+
+TEST(Run_WasmModule_GrowMemory_CompiledEagerly) {
+  // The lazy compile stubs and the baseline compiler do not support growable
+  // memory, so such modules are compiled eagerly with TurboFan instead.
+  FlagScope<bool> lazy_flag(&FLAG_wasm_lazy_compilation, true);
+  FlagScope<bool> baseline_flag(&FLAG_wasm_baseline, true);
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  for (byte mem_flags : {0, kModuleMemGrowable}) {
+    std::vector<byte> bytes = GrowMemoryModule(mem_flags);
+    Zone zone;
+    ModuleResult result =
+        DecodeWasmModule(isolate, &zone, &bytes[0], &bytes[0] + bytes.size());
+    CHECK(result.ok());
+    bool growable = mem_flags == kModuleMemGrowable;
+    CHECK_EQ(!growable, result.val->SupportsTieredCompilation());
+    Handle<JSObject> module =
+        result.val->Instantiate(isolate, Handle<JSObject>::null())
+            .ToHandleChecked();
+    delete result.val;
+    CHECK_EQ(!growable, IsTieredInstance(module));
+
+    // Both instances run "main"; only growable memory grows.
+    Handle<Object> main =
+        Object::GetProperty(module,
+                            isolate->factory()->InternalizeUtf8String("main"))
+            .ToHandleChecked();
+    Handle<Object> arg(Smi::FromInt(65536), isolate);
+    Handle<Object> retval =
+        Execution::Call(isolate, main, isolate->factory()->undefined_value(),
+                        1, &arg)
+            .ToHandleChecked();
+    CHECK_EQ(growable ? 1234 : 0, static_cast<int32_t>(retval->Number()));
+  }
+}
+
+
+namespace {
+// Instantiates a module whose exported function "main" stores the words
+// below its parameter to memory and sums them up through calls to another
+// function that loads them, and returns main(400).
+int32_t RunMemoryCallsModule() {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+
+  byte get_code[] = {WASM_RETURN(WASM_LOAD_MEM(kMemInt32, WASM_GET_LOCAL(0)))};
+  byte main_code[] = {WASM_BLOCK(
+      2, WASM_WHILE(
+             WASM_GET_LOCAL(0),
+             WASM_BLOCK(
+                 3, WASM_SET_LOCAL(0, WASM_INT32_SUB(WASM_GET_LOCAL(0),
+                                                     WASM_INT8(4))),
+                 WASM_STORE_MEM(kMemInt32, WASM_GET_LOCAL(0),
+                                WASM_GET_LOCAL(0)),
+                 WASM_SET_LOCAL(1, WASM_INT32_ADD(
+                                       WASM_GET_LOCAL(1),
+                                       WASM_CALL_FUNCTION(
+                                           0, WASM_GET_LOCAL(0)))))),
+      WASM_RETURN(WASM_GET_LOCAL(1)))};
+  const uint32_t kGetStart = 58;
+  const uint32_t kMainStart = kGetStart + sizeof(get_code);
+  const uint32_t kName = kMainStart + sizeof(main_code);
+  std::vector<byte> bytes = {
+      12, 0,  // memory
+      0, 0,   // globals
+      2, 0,   // functions
+      0, 0,   // data segments
+      1, kAstInt32, kAstInt32  // signature: int -> int
+  };
+  EmitUint32(&bytes, 0);            // name offset
+  EmitUint32(&bytes, kGetStart);    // code start offset
+  EmitUint32(&bytes, kMainStart);   // code end offset
+  bytes.insert(bytes.end(), 8, 0);  // local counts
+  bytes.push_back(0);               // exported
+  bytes.push_back(0);               // external
+  bytes.insert(bytes.end(), {1, kAstInt32, kAstInt32});
+  EmitUint32(&bytes, kName);        // name offset
+  EmitUint32(&bytes, kMainStart);   // code start offset
+  EmitUint32(&bytes, kName);        // code end offset
+  bytes.push_back(1);               // local int32 count
+  bytes.insert(bytes.end(), 7, 0);  // other local counts
+  bytes.push_back(1);               // exported
+  bytes.push_back(0);               // external
+  CHECK_EQ(static_cast<size_t>(kGetStart), bytes.size());
+  bytes.insert(bytes.end(), get_code, get_code + sizeof(get_code));
+  bytes.insert(bytes.end(), main_code, main_code + sizeof(main_code));
+  const char* name = "main";
+  bytes.insert(bytes.end(), name, name + strlen(name) + 1);
+
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, &bytes[0], &bytes[0] + bytes.size());
+  CHECK(result.ok());
+  Handle<JSObject> module =
+      result.val->Instantiate(isolate, Handle<JSObject>::null())
+          .ToHandleChecked();
+  delete result.val;
+  Handle<Object> main =
+      Object::GetProperty(module,
+                          isolate->factory()->InternalizeUtf8String("main"))
+          .ToHandleChecked();
+  Handle<Object> arg(Smi::FromInt(400), isolate);
+  Handle<Object> retval =
+      Execution::Call(isolate, main, isolate->factory()->undefined_value(), 1,
+                      &arg)
+          .ToHandleChecked();
+  return static_cast<int32_t>(retval->Number());
+}
+}  // namespace
+
+
+TEST(Run_WasmModule_MemBaseParam) {
+  static const int32_t kExpected = 19800;
+  FlagScope<bool> param_flag(&FLAG_wasm_mem_base_param, false);
+  FlagScope<bool> inlining_flag(&FLAG_wasm_inlining, false);
+  // The memory base loaded on entry, and passed as a parameter.
+  CHECK_EQ(kExpected, RunMemoryCallsModule());
+  FLAG_wasm_mem_base_param = true;
+  CHECK_EQ(kExpected, RunMemoryCallsModule());
+  // Inlined callees use the parameter of their caller.
+  FLAG_wasm_inlining = true;
+  CHECK_EQ(kExpected, RunMemoryCallsModule());
+}
+
+
+TEST(Run_WasmModule_InstancesShareIndependentCode) {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  // "pure" returns a constant, "load" reads memory of its instance.
+  byte pure_code[] = {WASM_RETURN(WASM_INT8(7))};
+  byte load_code[] = {WASM_RETURN(WASM_LOAD_MEM(kMemInt32, WASM_ZERO))};
+  const uint32_t kPureStart = 56;
+  const uint32_t kLoadStart = kPureStart + sizeof(pure_code);
+  const uint32_t kPureName = kLoadStart + sizeof(load_code);
+  const uint32_t kLoadName = kPureName + 5;
+  std::vector<byte> bytes = {
+      12, 0,  // memory
+      0, 0,   // globals
+      2, 0,   // functions
+      0, 0,   // data segments
+      0, kAstInt32  // signature: -> int
+  };
+  EmitUint32(&bytes, kPureName);    // name offset
+  EmitUint32(&bytes, kPureStart);   // code start offset
+  EmitUint32(&bytes, kLoadStart);   // code end offset
+  bytes.insert(bytes.end(), 8, 0);  // local counts
+  bytes.push_back(1);               // exported
+  bytes.push_back(0);               // external
+  bytes.insert(bytes.end(), {0, kAstInt32});
+  EmitUint32(&bytes, kLoadName);    // name offset
+  EmitUint32(&bytes, kLoadStart);   // code start offset
+  EmitUint32(&bytes, kPureName);    // code end offset
+  bytes.insert(bytes.end(), 8, 0);  // local counts
+  bytes.push_back(1);               // exported
+  bytes.push_back(0);               // external
+  CHECK_EQ(static_cast<size_t>(kPureStart), bytes.size());
+  bytes.insert(bytes.end(), pure_code, pure_code + sizeof(pure_code));
+  bytes.insert(bytes.end(), load_code, load_code + sizeof(load_code));
+  const char names[] = "pure\0load";
+  bytes.insert(bytes.end(), names, names + sizeof(names));
+
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, &bytes[0], &bytes[0] + bytes.size());
+  CHECK(result.ok());
+  ErrorThrower thrower(isolate, "InstancesShareIndependentCode");
+  Handle<FixedArray> compiled =
+      result.val->Compile(isolate, thrower).ToHandleChecked();
+  Handle<JSObject> instances[2];
+  for (int i = 0; i < 2; i++) {
+    instances[i] =
+        result.val->Instantiate(isolate, Handle<JSObject>::null(), compiled)
+            .ToHandleChecked();
+  }
+  delete result.val;
+
+  // The WASM code of an exported function is the code of its shared
+  // function info.
+  Code* code[2][2];
+  const char* kNames[] = {"pure", "load"};
+  for (int i = 0; i < 2; i++) {
+    for (int f = 0; f < 2; f++) {
+      Handle<String> name =
+          isolate->factory()->InternalizeUtf8String(kNames[f]);
+      Handle<Object> function =
+          Object::GetProperty(instances[i], name).ToHandleChecked();
+      code[i][f] = JSFunction::cast(*function)->shared()->code();
+    }
+  }
+  CHECK_EQ(code[0][0], code[1][0]);
+  CHECK_NE(code[0][1], code[1][1]);
+}
+
+
+TEST(Run_WasmModule_CodeCacheKeyedOnFlags) {
+  FlagScope<bool> cache_flag(&FLAG_wasm_code_cache, true);
+  FlagScope<bool> param_flag(&FLAG_wasm_mem_base_param, false);
+  LocalContext context;
+  Isolate* isolate = CcTest::i_isolate();
+  HandleScope scope(isolate);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f(&zone);
+  f.ReturnType(kAstInt32);
+  f.Exported(1);
+  byte code[] = {WASM_RETURN(WASM_LOAD_MEM(kMemInt32, WASM_ZERO))};
+  f.AddBody(code, sizeof(code));
+  builder.AddFunction(f.Build());
+  WasmModuleIndex bytes = builder.BuildAndWrite(&zone);
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, bytes.Begin(), bytes.End());
+  CHECK(result.ok());
+
+  // A flag that changes the calling convention misses the cache, even when
+  // it is assigned directly.
+  ErrorThrower thrower(isolate, "CodeCacheKeyedOnFlags");
+  WasmCodeCacheStatistics before = GetWasmCodeCacheStatistics(isolate);
+  Handle<FixedArray> first =
+      result.val->Compile(isolate, thrower).ToHandleChecked();
+  FLAG_wasm_mem_base_param = true;
+  Handle<FixedArray> second =
+      result.val->Compile(isolate, thrower).ToHandleChecked();
+  FLAG_wasm_mem_base_param = false;
+  Handle<FixedArray> third =
+      result.val->Compile(isolate, thrower).ToHandleChecked();
+  WasmCodeCacheStatistics after = GetWasmCodeCacheStatistics(isolate);
+  delete result.val;
+
+  CHECK_EQ(before.misses + 2, after.misses);
+  CHECK_EQ(before.hits + 1, after.hits);
+  CHECK(!first.is_identical_to(second));
+  CHECK(first.is_identical_to(third));
+}
+
+
+TEST(Run_WasmModule_SharedWrappersKeyedOnFlags) {
+  FlagScope<bool> cache_flag(&FLAG_wasm_code_cache, false);
+  FlagScope<bool> param_flag(&FLAG_wasm_mem_base_param, false);
+  FlagScope<bool> inlining_flag(&FLAG_wasm_inlining, false);
+  LocalContext context;
+  Isolate* isolate = CcTest::i_isolate();
+  HandleScope scope(isolate);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  for (int i = 0; i < 2; i++) {
+    WasmFunctionBuilder f(&zone);
+    f.ReturnType(kAstInt32);
+    f.Exported(1);
+    byte code[] = {WASM_RETURN(WASM_INT8(i))};
+    f.AddBody(code, sizeof(code));
+    builder.AddFunction(f.Build());
+  }
+  WasmModuleIndex bytes = builder.BuildAndWrite(&zone);
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, bytes.Begin(), bytes.End());
+  CHECK(result.ok());
+
+  // Both functions share one wrapper, until a flag that may change the
+  // calling convention is assigned, even directly.
+  ErrorThrower thrower(isolate, "SharedWrappersKeyedOnFlags");
+  WasmWrapperStatistics before = GetWasmWrapperStatistics(isolate);
+  result.val->Compile(isolate, thrower).ToHandleChecked();
+  FLAG_wasm_inlining = true;
+  result.val->Compile(isolate, thrower).ToHandleChecked();
+  FLAG_wasm_inlining = false;
+  result.val->Compile(isolate, thrower).ToHandleChecked();
+  WasmWrapperStatistics after = GetWasmWrapperStatistics(isolate);
+  delete result.val;
+
+  CHECK_EQ(before.compiled + 2, after.compiled);
+  CHECK_EQ(before.reused + 4, after.reused);
+}
+
+
+namespace {
+// Builds the graph of function {index} of the module {bytes}, and returns
+// the number of calls in it. Inlined calls leave no call behind.
+int CountCallsInGraph(const WasmModuleIndex& bytes, int index) {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, bytes.Begin(), bytes.End());
+  CHECK(result.ok());
+  WasmModule* module = result.val;
+  std::vector<Handle<Code>> function_code(module->functions->size(),
+                                          isolate->builtins()->Illegal());
+  ModuleEnv module_env;
+  module_env.module = module;
+  module_env.mem_start = 0;
+  module_env.mem_end = static_cast<uintptr_t>(1) << module->mem_size_log2;
+  module_env.globals_area = 0;
+  module_env.linker = nullptr;
+  module_env.function_code = &function_code;
+  const WasmFunction& function = module->functions->at(index);
+  FunctionEnv env;
+  env.module = &module_env;
+  env.sig = function.sig;
+  env.local_int32_count = function.local_int32_count;
+  env.local_int64_count = function.local_int64_count;
+  env.local_float32_count = function.local_float32_count;
+  env.local_float64_count = function.local_float64_count;
+  env.SumLocals();
+
+  Graph graph(&zone);
+  CommonOperatorBuilder common(&zone);
+  MachineOperatorBuilder machine(&zone);
+  JSGraph jsgraph(isolate, &graph, &common, nullptr, &machine);
+  const byte* base = module->module_start;
+  TreeResult tree = BuildTFGraph(&jsgraph, &env, base, module->module_end,
+                                 base + function.code_start_offset,
+                                 base + function.code_end_offset);
+  CHECK(tree.ok());
+
+  int calls = 0;
+  std::vector<Node*> stack(1, graph.end());
+  std::set<Node*> seen(stack.begin(), stack.end());
+  while (!stack.empty()) {
+    Node* node = stack.back();
+    stack.pop_back();
+    if (node->opcode() == IrOpcode::kCall) calls++;
+    for (Node* input : node->inputs()) {
+      if (seen.insert(input).second) stack.push_back(input);
+    }
+  }
+  delete module;
+  return calls;
+}
+}  // namespace
+
+
+TEST(Run_WasmModule_Inlining_MultipleReturns) {
+  FlagScope<bool> inlining_flag(&FLAG_wasm_inlining, true);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  // Function 0 returns the maximum of its parameters.
+  WasmFunctionBuilder f0(&zone);
+  f0.ReturnType(kAstInt32);
+  f0.AddParam(kAstInt32);
+  f0.AddParam(kAstInt32);
+  byte code0[] = {
+      WASM_IF_THEN(WASM_INT32_SGT(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)),
+                   WASM_RETURN(WASM_GET_LOCAL(0)),
+                   WASM_RETURN(WASM_GET_LOCAL(1)))};
+  f0.AddBody(code0, sizeof(code0));
+  builder.AddFunction(f0.Build());
+  // Function 1 stores its parameter to memory.
+  WasmFunctionBuilder f1(&zone);
+  f1.ReturnType(kAstInt32);
+  f1.AddParam(kAstInt32);
+  byte code1[] = {WASM_STORE_MEM(kMemInt32, WASM_ZERO, WASM_GET_LOCAL(0))};
+  f1.AddBody(code1, sizeof(code1));
+  builder.AddFunction(f1.Build());
+  WasmFunctionBuilder f2(&zone);
+  f2.ReturnType(kAstInt32);
+  f2.Exported(1);
+  byte code2[] = {WASM_BLOCK(
+      2, WASM_CALL_FUNCTION(1, WASM_CALL_FUNCTION(0, WASM_INT8(3),
+                                                  WASM_INT8(7))),
+      WASM_RETURN(WASM_INT32_ADD(
+          WASM_LOAD_MEM(kMemInt32, WASM_ZERO),
+          WASM_CALL_FUNCTION(0, WASM_INT8(40), WASM_INT8(-2)))))};
+  f2.AddBody(code2, sizeof(code2));
+  builder.AddFunction(f2.Build());
+  WasmModuleIndex module = builder.BuildAndWrite(&zone);
+  TestModule(module, 47);
+  // All three calls are inlined.
+  CHECK_EQ(0, CountCallsInGraph(module, 2));
+}
+
+
+TEST(Run_WasmModule_Inlining_Recursive) {
+  FlagScope<bool> inlining_flag(&FLAG_wasm_inlining, true);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  WasmFunctionBuilder f(&zone);
+  f.ReturnType(kAstInt32);
+  f.LocalInt32Count(1);
+  f.Exported(1);
+  byte code[] = {
+      WASM_BLOCK(
+          2,                                                             // --
+          WASM_SET_LOCAL(0, WASM_LOAD_MEM(kMemInt32, WASM_ZERO)),        // --
+          WASM_IF_THEN(WASM_INT32_SLT(WASM_GET_LOCAL(0), WASM_INT8(9)),  // --
+                       WASM_BLOCK(2,                                     // --
+                                  WASM_STORE_MEM(kMemInt32, WASM_ZERO,   // --
+                                                 WASM_INC_LOCAL(0)),     // --
+                                  WASM_RETURN(WASM_CALL_FUNCTION0(0))),  // --
+                       WASM_RETURN(WASM_INT8(55))))                      // --
+  };
+  f.AddBody(code, sizeof(code));
+  builder.AddFunction(f.Build());
+  WasmModuleIndex module = builder.BuildAndWrite(&zone);
+  TestModule(module, 55);
+  // The recursive call is inlined once, and the call in the inlined body is
+  // left as is.
+  CHECK_EQ(1, CountCallsInGraph(module, 0));
+}
+
+
+TEST(Run_WasmModule_Inlining_Budgets) {
+  static const int kNumFunctions = 12;
+  FlagScope<bool> inlining_flag(&FLAG_wasm_inlining, true);
+  FlagScope<int> max_depth_flag(&FLAG_wasm_inlining_max_depth, 3);
+  Zone zone;
+  WasmModuleBuilder builder(&zone);
+  // Function 0 sums up 1..10 in a loop and is therefore never inlined.
+  // Function i returns i + 1 plus the result of calling function i - 1.
+  for (int i = 0; i < kNumFunctions; i++) {
+    WasmFunctionBuilder f(&zone);
+    f.ReturnType(kAstInt32);
+    if (i == 0) {
+      f.LocalInt32Count(2);
+      byte code[] = {
+          WASM_WHILE(WASM_INT32_SLT(WASM_GET_LOCAL(0), WASM_INT8(10)),
+                     WASM_SET_LOCAL(1, WASM_INT32_ADD(WASM_GET_LOCAL(1),
+                                                      WASM_INC_LOCAL(0)))),
+          WASM_RETURN(WASM_GET_LOCAL(1))};
+      f.AddBody(code, sizeof(code));
+    } else {
+      byte code[] = {WASM_RETURN(
+          WASM_INT32_ADD(WASM_INT8(i + 1), WASM_CALL_FUNCTION0(i - 1)))};
+      f.AddBody(code, sizeof(code));
+    }
+    if (i == kNumFunctions - 1) f.Exported(1);
+    builder.AddFunction(f.Build());
+  }
+  WasmModuleIndex module = builder.BuildAndWrite(&zone);
+  TestModule(module, 55 + kNumFunctions * (kNumFunctions + 1) / 2 - 1);
+  // The calls of the last function are inlined three deep, which ends in a
+  // call of function 7. The loop of function 0 keeps its call in function 1.
+  CHECK_EQ(1, CountCallsInGraph(module, kNumFunctions - 1));
+  CHECK_EQ(1, CountCallsInGraph(module, 1));
+}
+
+
+TEST(Run_WasmModule_CallIndirect_Traps) {
+  // Modules with a function table are compiled eagerly with TurboFan, even
+  // if lazy or baseline compilation is enabled.
+  FlagScope<bool> lazy_flag(&FLAG_wasm_lazy_compilation, true);
+  FlagScope<bool> baseline_flag(&FLAG_wasm_baseline, true);
+  LocalContext context;
+  Isolate* isolate = CcTest::i_isolate();
+  HandleScope scope(isolate);
+
+  // "main" calls entry {key} of the table [add, neg] as (int, int) -> int.
+  byte add_code[] = {
+      WASM_RETURN(WASM_INT32_ADD(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)))};
+  byte neg_code[] = {
+      WASM_RETURN(WASM_INT32_SUB(WASM_ZERO, WASM_GET_LOCAL(0)))};
+  byte main_code[] = {WASM_RETURN(WASM_CALL_INDIRECT(
+      0, WASM_GET_LOCAL(0), WASM_INT8(5), WASM_INT8(6)))};
+  const uint32_t kAddStart = 96;
+  const uint32_t kNegStart = kAddStart + sizeof(add_code);
+  const uint32_t kMainStart = kNegStart + sizeof(neg_code);
+  const uint32_t kName = kMainStart + sizeof(main_code);
+  std::vector<byte> bytes = {
+      12, kModuleFunctionTable,  // memory and flags
+      0, 0,                      // globals
+      3, 0,                      // functions
+      0, 0,                      // data segments
+      2, kAstInt32, kAstInt32, kAstInt32  // signature: int, int -> int
+  };
+  EmitUint32(&bytes, 0);            // name offset
+  EmitUint32(&bytes, kAddStart);    // code start offset
+  EmitUint32(&bytes, kNegStart);    // code end offset
+  bytes.insert(bytes.end(), 10, 0);  // local counts, exported, external
+  bytes.insert(bytes.end(), {1, kAstInt32, kAstInt32});
+  EmitUint32(&bytes, 0);            // name offset
+  EmitUint32(&bytes, kNegStart);    // code start offset
+  EmitUint32(&bytes, kMainStart);   // code end offset
+  bytes.insert(bytes.end(), 10, 0);  // local counts, exported, external
+  bytes.insert(bytes.end(), {1, kAstInt32, kAstInt32});
+  EmitUint32(&bytes, kName);        // name offset
+  EmitUint32(&bytes, kMainStart);   // code start offset
+  EmitUint32(&bytes, kName);        // code end offset
+  bytes.insert(bytes.end(), 8, 0);  // local counts
+  bytes.push_back(1);               // exported
+  bytes.push_back(0);               // external
+  bytes.insert(bytes.end(), {1, 0});  // signatures
+  bytes.insert(bytes.end(), {2, kAstInt32, kAstInt32, kAstInt32});
+  bytes.insert(bytes.end(), {2, 0, 0, 0, 1, 0});  // table entries
+  CHECK_EQ(static_cast<size_t>(kAddStart), bytes.size());
+  bytes.insert(bytes.end(), add_code, add_code + sizeof(add_code));
+  bytes.insert(bytes.end(), neg_code, neg_code + sizeof(neg_code));
+  bytes.insert(bytes.end(), main_code, main_code + sizeof(main_code));
+  const char* name = "main";
+  bytes.insert(bytes.end(), name, name + strlen(name) + 1);
+
+  Zone zone;
+  ModuleResult result =
+      DecodeWasmModule(isolate, &zone, &bytes[0], &bytes[0] + bytes.size());
+  CHECK(result.ok());
+  CHECK(!result.val->SupportsTieredCompilation());
+  Handle<JSObject> module =
+      result.val->Instantiate(isolate, Handle<JSObject>::null())
+          .ToHandleChecked();
+  delete result.val;
+  CHECK(!IsTieredInstance(module));
+  Handle<Object> main =
+      Object::GetProperty(module,
+                          isolate->factory()->InternalizeUtf8String("main"))
+          .ToHandleChecked();
+  Handle<Object> undefined = isolate->factory()->undefined_value();
+
+  Handle<Object> arg(Smi::FromInt(0), isolate);
+  Handle<Object> retval =
+      Execution::Call(isolate, main, undefined, 1, &arg).ToHandleChecked();
+  CHECK_EQ(11, static_cast<int32_t>(retval->Number()));
+
+  // Entry 1 has another signature, and keys 2 and -1 are out of bounds.
+  static const struct {
+    int key;
+    const char* message;
+  } kTraps[] = {{1, "wasm trap: function signature mismatch"},
+                {2, "wasm trap: function table index out of bounds"},
+                {-1, "wasm trap: function table index out of bounds"}};
+  for (size_t i = 0; i < arraysize(kTraps); i++) {
+    v8::TryCatch try_catch(CcTest::isolate());
+    arg = Handle<Object>(Smi::FromInt(kTraps[i].key), isolate);
+    CHECK(Execution::Call(isolate, main, undefined, 1, &arg).is_null());
+    CHECK(try_catch.HasCaught());
+    v8::String::Utf8Value message(try_catch.Exception());
+    CHECK_EQ(0, strcmp(kTraps[i].message, *message));
+  }
+}
@@ -8,6 +8,7 @@
 #include "src/compiler/graph-visualizer.h"
 #include "src/compiler/js-graph.h"
 
+#include "src/wasm/bounds-check-elimination.h"
 #include "src/wasm/decoder.h"
 #include "src/wasm/wasm-macro-gen.h"
 #include "src/wasm/wasm-module.h"
@@ -63,6 +64,8 @@ class TestingModule : public ModuleEnv {
     if (module) {
       if (module->globals) delete module->globals;
       if (module->functions) delete module->functions;
+      if (module->signatures) delete module->signatures;
+      if (module->function_table) delete module->function_table;
       if (globals_area) free(reinterpret_cast<byte*>(globals_area));
       delete module;
     }
@@ -134,6 +137,33 @@ class TestingModule : public ModuleEnv {
     return &module->functions->back();
   }
 
+  byte AddSignature(FunctionSig* sig) {
+    AllocModule();
+    if (module->signatures == nullptr) {
+      module->signatures = new std::vector<FunctionSig*>();
+    }
+    module->signatures->push_back(sig);
+    size_t size = module->signatures->size();
+    CHECK(size < 127);
+    return static_cast<byte>(size - 1);
+  }
+
+  void AddIndirectFunctionTable(uint16_t* functions, uint32_t table_size) {
+    Isolate* isolate = CcTest::InitIsolateOnce();
+    AllocModule();
+    CHECK_NULL(module->function_table);
+    module->function_table = new std::vector<uint16_t>();
+    for (uint32_t i = 0; i < table_size; i++) {
+      module->function_table->push_back(functions[i]);
+    }
+    function_table = NewFunctionTable(isolate, module);
+    InitIndirectCallTraps(isolate, this);
+    for (uint32_t i = 0; i < table_size; i++) {
+      SetFunctionTableCode(*function_table, static_cast<int>(i),
+                           *function_code->at(functions[i]));
+    }
+  }
+
  private:
   size_t mem_size;
   unsigned global_offset;
@@ -157,6 +187,8 @@ class TestingModule : public ModuleEnv {
       module->globals = nullptr;
       module->functions = nullptr;
       module->data_segments = nullptr;
+      module->signatures = nullptr;
+      module->function_table = nullptr;
     }
   }
 };
@@ -171,7 +203,8 @@ class WasmRunner : public GraphBuilderTester<ReturnType> {
              MachineType p4 = kMachNone)
       : GraphBuilderTester<ReturnType>(p0, p1, p2, p3, p4),
         jsgraph(this->isolate(), this->graph(), this->common(), nullptr,
-                this->machine()) {
+                this->machine()),
+        bounds_checks() {
     init_env(&env_i_v, sigs.i_v());
     init_env(&env_i_i, sigs.i_i());
     init_env(&env_i_ii, sigs.i_ii());
@@ -197,6 +230,7 @@ class WasmRunner : public GraphBuilderTester<ReturnType> {
   FunctionEnv env_l_ll;
   FunctionEnv env_i_ll;
   FunctionEnv* function_env;
+  BoundsCheckStatistics bounds_checks;
 
   void Build(const byte* start, const byte* end) {
     TreeResult result = BuildTFGraph(&jsgraph, function_env, start, end);
@@ -209,6 +243,9 @@ class WasmRunner : public GraphBuilderTester<ReturnType> {
       str << ", msg = " << result.error_msg.get();
       FATAL(str.str().c_str());
     }
+    if (FLAG_wasm_bounds_check_elimination) {
+      bounds_checks = EliminateBoundsChecks(&jsgraph);
+    }
     if (FLAG_trace_turbo_graph) {
       OFStream os(stdout);
       os << AsRPO(*jsgraph.graph());
@@ -256,6 +293,7 @@ class WasmFunctionCompiler : public HandleAndZoneScope,
       str << ", msg = " << result.error_msg.get();
       FATAL(str.str().c_str());
     }
+    if (FLAG_wasm_bounds_check_elimination) EliminateBoundsChecks(&jsgraph);
     if (FLAG_trace_turbo_graph) {
       OFStream os(stdout);
       os << AsRPO(*jsgraph.graph());
@@ -839,6 +877,119 @@ TEST(Run_Wasm_Loop_if_break_fallthru) {
 }
 
 
+TEST(Run_Wasm_Loop_ContinuesSetDifferentLocals) {
+  // Each continue edge changes a different local, so every loop phi gets
+  // inputs from back edges that left its local unchanged.
+  WasmRunner<int32_t> r(kMachInt32);
+  const byte kI = r.AllocateLocal(kAstInt32);
+  const byte kOdd = r.AllocateLocal(kAstInt32);
+  const byte kEven = r.AllocateLocal(kAstInt32);
+  BUILD(r,
+        WASM_BLOCK(
+            2,
+            WASM_LOOP(
+                4, WASM_INC_LOCAL(kI),
+                WASM_IF(WASM_INT32_SLT(WASM_GET_LOCAL(0), WASM_GET_LOCAL(kI)),
+                        WASM_BREAK(0)),
+                WASM_IF(WASM_INT32_AND(WASM_GET_LOCAL(kI), WASM_INT8(1)),
+                        WASM_BLOCK(2, WASM_SET_LOCAL(
+                                          kOdd, WASM_INT32_ADD(
+                                                    WASM_GET_LOCAL(kOdd),
+                                                    WASM_GET_LOCAL(kI))),
+                                   WASM_CONTINUE(1))),
+                WASM_BLOCK(2, WASM_SET_LOCAL(
+                                  kEven, WASM_INT32_ADD(WASM_GET_LOCAL(kEven),
+                                                        WASM_GET_LOCAL(kI))),
+                           WASM_CONTINUE(1))),
+            WASM_RETURN(WASM_INT32_ADD(
+                WASM_INT32_MUL(WASM_GET_LOCAL(kOdd), WASM_INT32(1000)),
+                WASM_GET_LOCAL(kEven)))));
+  for (int32_t n = 0; n < 20; n++) {
+    int32_t odd = 0, even = 0;
+    for (int32_t i = 1; i <= n; i++) {
+      if (i & 1) {
+        odd += i;
+      } else {
+        even += i;
+      }
+    }
+    CHECK_EQ(odd * 1000 + even, r.Call(n));
+  }
+}
+
+
+TEST(Run_Wasm_Loop_NestedContinues) {
+  // The inner loop has two continue edges that change different locals, the
+  // outer loop has an explicit continue and a fall-through back edge.
+  WasmRunner<int32_t> r(kMachInt32);
+  const byte kJ = r.AllocateLocal(kAstInt32);
+  const byte kA = r.AllocateLocal(kAstInt32);
+  const byte kB = r.AllocateLocal(kAstInt32);
+  const byte kC = r.AllocateLocal(kAstInt32);
+  BUILD(
+      r,
+      WASM_BLOCK(
+          2,
+          WASM_LOOP(
+              1,
+              WASM_IF_THEN(
+                  WASM_GET_LOCAL(0),
+                  WASM_BLOCK(
+                      4, WASM_SET_LOCAL(0, WASM_INT32_SUB(WASM_GET_LOCAL(0),
+                                                          WASM_INT8(1))),
+                      WASM_SET_LOCAL(kJ, WASM_GET_LOCAL(0)),
+                      WASM_LOOP(
+                          1,
+                          WASM_IF_THEN(
+                              WASM_GET_LOCAL(kJ),
+                              WASM_BLOCK(
+                                  2, WASM_SET_LOCAL(
+                                         kJ, WASM_INT32_SUB(WASM_GET_LOCAL(kJ),
+                                                            WASM_INT8(1))),
+                                  WASM_IF_THEN(
+                                      WASM_INT32_AND(WASM_GET_LOCAL(kJ),
+                                                     WASM_INT8(1)),
+                                      WASM_BLOCK(
+                                          2, WASM_SET_LOCAL(
+                                                 kA, WASM_INT32_ADD(
+                                                         WASM_GET_LOCAL(kA),
+                                                         WASM_GET_LOCAL(kJ))),
+                                          WASM_CONTINUE(2)),
+                                      WASM_BLOCK(
+                                          2, WASM_SET_LOCAL(
+                                                 kB, WASM_INT32_ADD(
+                                                         WASM_GET_LOCAL(kB),
+                                                         WASM_GET_LOCAL(0))),
+                                          WASM_CONTINUE(2)))),
+                              WASM_BREAK(0))),
+                      WASM_IF(WASM_INT32_AND(WASM_GET_LOCAL(0), WASM_INT8(2)),
+                              WASM_BLOCK(2, WASM_INC_LOCAL(kC),
+                                         WASM_CONTINUE(2)))),
+                  WASM_BREAK(0))),
+          WASM_RETURN(WASM_INT32_ADD(
+              WASM_INT32_ADD(WASM_GET_LOCAL(kA),
+                             WASM_INT32_MUL(WASM_GET_LOCAL(kB),
+                                            WASM_INT32(1000))),
+              WASM_INT32_MUL(WASM_GET_LOCAL(kC), WASM_INT32(1000000))))));
+  for (int32_t n = 0; n < 20; n++) {
+    int32_t a = 0, b = 0, c = 0;
+    for (int32_t i = n; i > 0;) {
+      i--;
+      for (int32_t j = i; j > 0;) {
+        j--;
+        if (j & 1) {
+          a += j;
+        } else {
+          b += i;
+        }
+      }
+      if (i & 2) c++;
+    }
+    CHECK_EQ(a + b * 1000 + c * 1000000, r.Call(n));
+  }
+}
+
+
 TEST(Run_Wasm_LoadMemInt32) {
   WasmRunner<int32_t> r(kMachInt32);
   TestingModule module;
@@ -900,6 +1051,47 @@ TEST(Run_Wasm_LoadMemInt32_P) {
 }
 
 
+TEST(Run_Wasm_LoadMemInt32_StraddlingEnd) {
+  const int kNumElems = 8;
+  WasmRunner<int32_t> r(kMachInt32);
+  TestingModule module;
+  int32_t* memory = module.AddMemoryElems<int32_t>(kNumElems);
+  module.RandomizeMemory(4444);
+  r.function_env->module = &module;
+
+  BUILD(r, WASM_RETURN(WASM_LOAD_MEM(kMemInt32, WASM_GET_LOCAL(0))));
+
+  // Accesses that cross the end of memory are out of bounds as a whole.
+  CHECK_EQ(memory[kNumElems - 1], r.Call(4 * kNumElems - 4));
+  for (int i = 4 * kNumElems - 3; i <= 4 * kNumElems; i++) {
+    CHECK_EQ(0, r.Call(i));
+  }
+}
+
+
+TEST(Run_Wasm_StoreMemInt32_StraddlingEnd) {
+  const int kNumElems = 8;
+  WasmRunner<int32_t> r(kMachInt32);
+  TestingModule module;
+  int32_t* memory = module.AddMemoryElems<int32_t>(kNumElems);
+  byte* bytes = reinterpret_cast<byte*>(memory);
+  r.function_env->module = &module;
+
+  BUILD(r, WASM_BLOCK(2, WASM_STORE_MEM(kMemInt32, WASM_GET_LOCAL(0),
+                                        WASM_INT32(-1)),
+                      WASM_RETURN(WASM_ZERO)));
+
+  // Stores that cross the end of memory leave all of it untouched.
+  module.ZeroMemory();
+  for (int i = 4 * kNumElems - 3; i < 4 * kNumElems; i++) {
+    r.Call(i);
+    for (int j = 0; j < 4 * kNumElems; j++) CHECK_EQ(0, bytes[j]);
+  }
+  r.Call(4 * kNumElems - 4);
+  CHECK_EQ(-1, memory[kNumElems - 1]);
+}
+
+
 TEST(Run_Wasm_MemInt32_Sum) {
   WasmRunner<uint32_t> r(kMachInt32);
   const int kNumElems = 20;
@@ -935,6 +1127,150 @@ TEST(Run_Wasm_MemInt32_Sum) {
 }
 
 
+TEST(Run_Wasm_BoundsCheckElimination_Mask) {
+  const int kNumElems = 8;
+  WasmRunner<int32_t> r(kMachInt32);
+  TestingModule module;
+  int32_t* memory = module.AddMemoryElems<int32_t>(kNumElems);
+  module.RandomizeMemory(3333);
+  r.function_env->module = &module;
+
+  // The mask keeps the index and the access size within the 32-byte memory.
+  BUILD(r, WASM_RETURN(WASM_LOAD_MEM(
+               kMemInt32, WASM_INT32_AND(WASM_GET_LOCAL(0), WASM_INT8(28)))));
+  CHECK_EQ(1, r.bounds_checks.eliminated);
+  CHECK_EQ(0, r.bounds_checks.remaining);
+
+  for (int i = 0; i < kNumElems; i++) {
+    CHECK_EQ(memory[i], r.Call(i * 4));
+    CHECK_EQ(memory[i], r.Call(i * 4 + 32));
+  }
+}
+
+
+TEST(Run_Wasm_BoundsCheckElimination_Unproven) {
+  WasmRunner<int32_t> r(kMachInt32);
+  TestingModule module;
+  module.AddMemoryElems<int32_t>(8);
+  r.function_env->module = &module;
+
+  // The last 4-byte access below index 31 would cross the end of memory.
+  BUILD(r, WASM_RETURN(WASM_INT32_ADD(
+               WASM_LOAD_MEM(kMemInt32, WASM_GET_LOCAL(0)),
+               WASM_LOAD_MEM(kMemInt32, WASM_INT32_AND(WASM_GET_LOCAL(0),
+                                                       WASM_INT8(31))))));
+  CHECK_EQ(0, r.bounds_checks.eliminated);
+  CHECK_EQ(2, r.bounds_checks.remaining);
+}
+
+
+TEST(Run_Wasm_BoundsCheckElimination_UnsignedLoop) {
+  const int kNumElems = 20;
+  WasmRunner<uint32_t> r;
+  const byte kIndex = r.AllocateLocal(kAstInt32);
+  const byte kSum = r.AllocateLocal(kAstInt32);
+  TestingModule module;
+  uint32_t* memory = module.AddMemoryElems<uint32_t>(kNumElems);
+  r.function_env->module = &module;
+
+  // while (i <u 20) { sum += mem[i << 2]; i++ }
+  BUILD(r, WASM_BLOCK(
+               3, WASM_SET_LOCAL(kIndex, WASM_INT8(0)),
+               WASM_WHILE(
+                   WASM_INT32_ULT(WASM_GET_LOCAL(kIndex), WASM_INT8(kNumElems)),
+                   WASM_BLOCK(
+                       2, WASM_SET_LOCAL(
+                              kSum, WASM_INT32_ADD(
+                                        WASM_GET_LOCAL(kSum),
+                                        WASM_LOAD_MEM(
+                                            kMemInt32,
+                                            WASM_INT32_SHL(
+                                                WASM_GET_LOCAL(kIndex),
+                                                WASM_INT8(2))))),
+                       WASM_SET_LOCAL(kIndex,
+                                      WASM_INT32_ADD(WASM_GET_LOCAL(kIndex),
+                                                     WASM_INT8(1))))),
+               WASM_RETURN(WASM_GET_LOCAL(kSum))));
+  CHECK_EQ(1, r.bounds_checks.eliminated);
+  CHECK_EQ(0, r.bounds_checks.remaining);
+
+  for (int i = 0; i < 3; i++) {
+    module.RandomizeMemory(i * 44);
+    uint32_t expected = 0;
+    for (int j = 0; j < kNumElems; j++) expected += memory[j];
+    CHECK_EQ(expected, r.Call());
+  }
+}
+
+
+TEST(Run_Wasm_BoundsCheckElimination_SignedLoop) {
+  const int kNumElems = 20;
+  WasmRunner<int32_t> r;
+  const byte kIndex = r.AllocateLocal(kAstInt32);
+  TestingModule module;
+  int32_t* memory = module.AddMemoryElems<int32_t>(kNumElems);
+  r.function_env->module = &module;
+
+  // while (i <s 20) { mem[i << 2] = i; i++ }
+  BUILD(r, WASM_BLOCK(
+               3, WASM_SET_LOCAL(kIndex, WASM_INT8(0)),
+               WASM_WHILE(
+                   WASM_INT32_SLT(WASM_GET_LOCAL(kIndex), WASM_INT8(kNumElems)),
+                   WASM_BLOCK(
+                       2, WASM_STORE_MEM(kMemInt32,
+                                         WASM_INT32_SHL(WASM_GET_LOCAL(kIndex),
+                                                        WASM_INT8(2)),
+                                         WASM_GET_LOCAL(kIndex)),
+                       WASM_SET_LOCAL(kIndex,
+                                      WASM_INT32_ADD(WASM_GET_LOCAL(kIndex),
+                                                     WASM_INT8(1))))),
+               WASM_RETURN(WASM_GET_LOCAL(kIndex))));
+  CHECK_EQ(1, r.bounds_checks.eliminated);
+  CHECK_EQ(0, r.bounds_checks.remaining);
+
+  module.ZeroMemory();
+  CHECK_EQ(kNumElems, r.Call());
+  for (int i = 0; i < kNumElems; i++) CHECK_EQ(i, memory[i]);
+}
+
+
+TEST(Run_Wasm_BoundsCheckElimination_ParameterLoop) {
+  const int kNumElems = 20;
+  WasmRunner<uint32_t> r(kMachInt32);
+  const byte kIndex = r.AllocateLocal(kAstInt32);
+  const byte kSum = r.AllocateLocal(kAstInt32);
+  TestingModule module;
+  uint32_t* memory = module.AddMemoryElems<uint32_t>(kNumElems);
+  r.function_env->module = &module;
+
+  // The loop bound is a parameter, so the access keeps its check.
+  BUILD(r, WASM_BLOCK(
+               3, WASM_SET_LOCAL(kIndex, WASM_INT8(0)),
+               WASM_WHILE(
+                   WASM_INT32_ULT(WASM_GET_LOCAL(kIndex), WASM_GET_LOCAL(0)),
+                   WASM_BLOCK(
+                       2, WASM_SET_LOCAL(
+                              kSum, WASM_INT32_ADD(
+                                        WASM_GET_LOCAL(kSum),
+                                        WASM_LOAD_MEM(
+                                            kMemInt32,
+                                            WASM_INT32_SHL(
+                                                WASM_GET_LOCAL(kIndex),
+                                                WASM_INT8(2))))),
+                       WASM_SET_LOCAL(kIndex,
+                                      WASM_INT32_ADD(WASM_GET_LOCAL(kIndex),
+                                                     WASM_INT8(1))))),
+               WASM_RETURN(WASM_GET_LOCAL(kSum))));
+  CHECK_EQ(0, r.bounds_checks.eliminated);
+  CHECK_EQ(1, r.bounds_checks.remaining);
+
+  module.RandomizeMemory(55);
+  uint32_t expected = 0;
+  for (int j = 0; j < kNumElems; j++) expected += memory[j];
+  CHECK_EQ(expected, r.Call(kNumElems));
+}
+
+
 TEST(Run_Wasm_MemFloat32_Sum) {
   WasmRunner<int32_t> r(kMachInt32);
   const byte kSum = r.AllocateLocal(kAstFloat32);
@@ -1056,6 +1392,28 @@ TEST(Run_Wasm_Switch0) {
 }
 
 
+TEST(Run_Wasm_Switch0_Continue) {
+  // A switch without cases leaves no block behind, so the break and the
+  // continue after it target the loop.
+  static const byte kOpcodes[] = {kStmtSwitch, kStmtSwitchNf};
+  for (size_t i = 0; i < arraysize(kOpcodes); i++) {
+    WasmRunner<int32_t> r(kMachInt32);
+    const byte kCount = r.AllocateLocal(kAstInt32);
+    BUILD(r, WASM_BLOCK(
+                 2, WASM_LOOP(3, WASM_ID(kOpcodes[i], 0, WASM_GET_LOCAL(0)),
+                              WASM_IF(WASM_INT32_SLT(WASM_GET_LOCAL(kCount),
+                                                     WASM_GET_LOCAL(0)),
+                                      WASM_BLOCK(2, WASM_INC_LOCAL(kCount),
+                                                 WASM_CONTINUE(1))),
+                              WASM_BREAK(0)),
+                 WASM_RETURN(WASM_GET_LOCAL(kCount))));
+    CHECK_EQ(0, r.Call(0));
+    CHECK_EQ(1, r.Call(1));
+    CHECK_EQ(5, r.Call(5));
+  }
+}
+
+
 TEST(Run_Wasm_Switch1) {
   WasmRunner<int32_t> r(kMachInt32);
   BUILD(r, WASM_BLOCK(2, WASM_SWITCH(1, WASM_GET_LOCAL(0),
@@ -1516,6 +1874,41 @@ TEST(Run_WasmCall_Int32Add) {
 }
 
 
+TEST(Run_WasmCall_ValuesLiveAcrossCalls) {
+  TestSignatures sigs;
+  TestingModule module;
+
+  // Build the target functions, which keep values live across calls.
+  WasmFunctionCompiler t1(sigs.i_ii());
+  BUILD(t1, WASM_RETURN(WASM_INT32_SUB(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1))));
+  unsigned sub = t1.CompileAndAdd(&module);
+  WasmFunctionCompiler t2(sigs.i_ii());
+  t2.env.module = &module;
+  BUILD(t2, WASM_RETURN(WASM_INT32_ADD(
+                WASM_INT32_MUL(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)),
+                WASM_INT32_ADD(WASM_CALL_FUNCTION(sub, WASM_GET_LOCAL(0),
+                                                  WASM_GET_LOCAL(1)),
+                               WASM_CALL_FUNCTION(sub, WASM_GET_LOCAL(1),
+                                                  WASM_GET_LOCAL(0))))));
+  unsigned kernel = t2.CompileAndAdd(&module);
+
+  // Build the caller function.
+  WasmRunner<int32_t> r(kMachInt32, kMachInt32);
+  r.function_env->module = &module;
+  BUILD(r, WASM_RETURN(WASM_CALL_FUNCTION(kernel, WASM_GET_LOCAL(0),
+                                          WASM_GET_LOCAL(1))));
+
+  FOR_INT32_INPUTS(i) {
+    FOR_INT32_INPUTS(j) {
+      // sub(a, b) + sub(b, a) is zero, so only the product remains.
+      int32_t expected = static_cast<int32_t>(static_cast<uint32_t>(*i) *
+                                              static_cast<uint32_t>(*j));
+      CHECK_EQ(expected, r.Call(*i, *j));
+    }
+  }
+}
+
+
 #if WASM_64
 TEST(Run_WasmCall_Int64Sub) {
   // Build the target function.
@@ -1600,6 +1993,81 @@ TEST(Run_WasmCall_Float64Sub) {
 }
 
 
+TEST(Run_Wasm_SimpleCallIndirect) {
+  TestSignatures sigs;
+  TestingModule module;
+
+  // Build the target functions.
+  WasmFunctionCompiler t1(sigs.i_ii());
+  BUILD(t1, WASM_INT32_ADD(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)));
+  uint16_t f1 = static_cast<uint16_t>(t1.CompileAndAdd(&module));
+
+  WasmFunctionCompiler t2(sigs.i_ii());
+  BUILD(t2, WASM_INT32_SUB(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)));
+  uint16_t f2 = static_cast<uint16_t>(t2.CompileAndAdd(&module));
+
+  WasmFunctionCompiler t3(sigs.i_i());
+  BUILD(t3, WASM_GET_LOCAL(0));
+  uint16_t f3 = static_cast<uint16_t>(t3.CompileAndAdd(&module));
+
+  // Signature table.
+  module.AddSignature(sigs.f_ff());
+  module.AddSignature(sigs.i_i());
+  byte sig_i_ii = module.AddSignature(sigs.i_ii());
+
+  // Function table.
+  uint16_t table[] = {f1, f2, f1, f3};
+  module.AddIndirectFunctionTable(table, arraysize(table));
+
+  // Build the caller function.
+  WasmRunner<int32_t> r(kMachInt32);
+  r.function_env->module = &module;
+  BUILD(r, WASM_CALL_INDIRECT(sig_i_ii, WASM_GET_LOCAL(0), WASM_INT8(66),
+                              WASM_INT8(22)));
+
+  // Failed checks trap, which needs a JavaScript caller; see
+  // Run_WasmModule_CallIndirect_Traps.
+  CHECK_EQ(88, r.Call(0));
+  CHECK_EQ(44, r.Call(1));
+  CHECK_EQ(88, r.Call(2));
+}
+
+
+TEST(Run_Wasm_CallIndirect_Float64) {
+  TestSignatures sigs;
+  TestingModule module;
+
+  // Build the target functions.
+  WasmFunctionCompiler t1(sigs.d_dd());
+  BUILD(t1, WASM_FLOAT64_SUB(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)));
+  uint16_t f1 = static_cast<uint16_t>(t1.CompileAndAdd(&module));
+
+  WasmFunctionCompiler t2(sigs.d_dd());
+  BUILD(t2, WASM_FLOAT64_MUL(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)));
+  uint16_t f2 = static_cast<uint16_t>(t2.CompileAndAdd(&module));
+
+  // Signature table.
+  byte sig_d_dd = module.AddSignature(sigs.d_dd());
+
+  // Function table.
+  uint16_t table[] = {f1, f2};
+  module.AddIndirectFunctionTable(table, arraysize(table));
+
+  // Build the caller function.
+  WasmRunner<int32_t> r(kMachInt32, kMachInt32);
+  r.function_env->module = &module;
+  BUILD(r, WASM_INT32_SCONVERT_FLOAT64(WASM_CALL_INDIRECT(
+               sig_d_dd, WASM_GET_LOCAL(0), WASM_FLOAT64(7.5),
+               WASM_FLOAT64_SCONVERT_INT32(WASM_GET_LOCAL(1)))));
+
+  FOR_INT32_INPUTS(i) {
+    int32_t x = *i & 0xff;
+    CHECK_EQ(static_cast<int32_t>(7.5 - x), r.Call(0, x));
+    CHECK_EQ(static_cast<int32_t>(7.5 * x), r.Call(1, x));
+  }
+}
+
+
 //==========================================================
 // TODO(titzer): move me to test-run-wasm-module.cc
 //==========================================================
@@ -0,0 +1,430 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <vector>
+
+#include "src/base/platform/elapsed-timer.h"
+#include "src/base/sys-info.h"
+#include "src/compiler/common-operator.h"
+#include "src/compiler/graph.h"
+#include "src/compiler/js-graph.h"
+#include "src/compiler/machine-operator.h"
+#include "src/execution.h"
+#include "src/wasm/decoder.h"
+#include "src/wasm/wasm-macro-gen.h"
+#include "src/wasm/wasm-module.h"
+#include "src/wasm/wasm-opcodes.h"
+
+#include "test/cctest/cctest.h"
+#include "test/cctest/wasm/test-signatures.h"
+
+using namespace v8::base;
+using namespace v8::internal;
+using namespace v8::internal::compiler;
+using namespace v8::internal::wasm;
+
+// The benchmarks are too slow for regular test runs, so they only run with
+// --wasm-benchmarks, e.g.
+//   cctest --wasm-benchmarks test-wasm-benchmarks/Benchmark_WasmDecodeInt32
+
+namespace {
+// The size of each synthetic function body.
+const size_t kBodySize = 1 * MB;
+
+// How often each function body is verified.
+const int kIterations = 4;
+
+// The number of functions in a synthetic module, and the size of each body.
+const uint16_t kModuleFunctions = 64;
+const size_t kModuleBodySize = 256 * KB;
+
+// The smallest and largest number of locals and branches in the synthetic
+// functions for graph building.
+const int kMinBranches = 250;
+const int kMaxBranches = 4000;
+
+// How often the call kernel calls a function that loads from memory.
+const int32_t kCallIterations = 1 << 22;
+
+
+// Builds a function body of at least {kBodySize} bytes by repeating the
+// statement {stmt}.
+std::vector<byte> RepeatStatement(const byte* stmt, size_t length) {
+  std::vector<byte> body;
+  body.reserve(kBodySize + length);
+  while (body.size() < kBodySize) body.insert(body.end(), stmt, stmt + length);
+  return body;
+}
+
+
+// Verifies {body} repeatedly and prints the decoding throughput. The
+// function has two int32 parameters and one float64 local.
+void BenchmarkVerify(const char* name, const std::vector<byte>& body) {
+  TestSignatures sigs;
+  FunctionEnv env;
+  env.module = nullptr;
+  env.sig = sigs.v_ii();
+  env.local_int32_count = 0;
+  env.local_int64_count = 0;
+  env.local_float32_count = 0;
+  env.local_float64_count = 1;
+  env.SumLocals();
+
+  ElapsedTimer timer;
+  timer.Start();
+  for (int i = 0; i < kIterations; i++) {
+    TreeResult result = VerifyWasmCode(&env, &body[0], &body[0] + body.size());
+    CHECK(result.ok());
+  }
+  double seconds = timer.Elapsed().InSecondsF();
+  double megabytes = static_cast<double>(body.size()) * kIterations / MB;
+  PrintF("wasm-decode %-8s %7.1f MB/s\n", name, megabytes / seconds);
+}
+
+
+void AppendU16(std::vector<byte>* bytes, uint16_t value) {
+  bytes->push_back(static_cast<byte>(value));
+  bytes->push_back(static_cast<byte>(value >> 8));
+}
+
+
+void AppendU32(std::vector<byte>* bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    bytes->push_back(static_cast<byte>(value >> (i * 8)));
+  }
+}
+
+
+// Builds a module of {kModuleFunctions} functions with two int32 parameters
+// and one float64 local, each with a body of at least {kModuleBodySize}
+// bytes repeating the statement {stmt}.
+std::vector<byte> RepeatFunction(const byte* stmt, size_t length) {
+  std::vector<byte> body;
+  while (body.size() < kModuleBodySize) {
+    body.insert(body.end(), stmt, stmt + length);
+  }
+
+  static const size_t kHeaderSize = 8;
+  static const size_t kFunctionSize = 26;
+  std::vector<byte> module;
+  module.push_back(0);    // memory size
+  module.push_back(0);    // flags
+  AppendU16(&module, 0);  // globals
+  AppendU16(&module, kModuleFunctions);
+  AppendU16(&module, 0);  // data segments
+  size_t code_start = kHeaderSize + kModuleFunctions * kFunctionSize;
+  for (int i = 0; i < kModuleFunctions; i++) {
+    module.push_back(2);  // signature: (int, int) -> void
+    module.push_back(kAstStmt);
+    module.push_back(kAstInt32);
+    module.push_back(kAstInt32);
+    AppendU32(&module, 0);  // name offset
+    uint32_t offset = static_cast<uint32_t>(code_start + i * body.size());
+    AppendU32(&module, offset);
+    AppendU32(&module, offset + static_cast<uint32_t>(body.size()));
+    AppendU16(&module, 0);  // local int32 count
+    AppendU16(&module, 0);  // local int64 count
+    AppendU16(&module, 0);  // local float32 count
+    AppendU16(&module, 1);  // local float64 count
+    module.push_back(0);    // exported
+    module.push_back(0);    // external
+  }
+  CHECK_EQ(code_start, module.size());
+  for (int i = 0; i < kModuleFunctions; i++) {
+    module.insert(module.end(), body.begin(), body.end());
+  }
+  return module;
+}
+
+
+// Decodes and verifies {module} with 1 to N threads, where N is the number
+// of processors, and prints the verification throughput for each.
+void BenchmarkVerifyModule(const char* name, const std::vector<byte>& module) {
+  int old_num_tasks = FLAG_wasm_num_compilation_tasks;
+  int max_threads = std::max(1, SysInfo::NumberOfProcessors());
+  for (int threads = 1; threads <= max_threads; threads++) {
+    FLAG_wasm_num_compilation_tasks = threads - 1;
+    ElapsedTimer timer;
+    timer.Start();
+    for (int i = 0; i < kIterations; i++) {
+      Zone zone;
+      ModuleResult result = DecodeWasmModule(
+          nullptr, &zone, &module[0], &module[0] + module.size(), true);
+      CHECK(result.ok());
+      delete result.val;
+    }
+    double seconds = timer.Elapsed().InSecondsF();
+    double megabytes = static_cast<double>(module.size()) * kIterations / MB;
+    PrintF("wasm-verify-module %-8s %2d threads %7.1f MB/s\n", name, threads,
+           megabytes / seconds);
+  }
+  FLAG_wasm_num_compilation_tasks = old_num_tasks;
+}
+
+
+void AppendLEB128(std::vector<byte>* bytes, uint32_t value) {
+  while (value >= 0x80) {
+    bytes->push_back(static_cast<byte>(value | 0x80));
+    value >>= 7;
+  }
+  bytes->push_back(static_cast<byte>(value));
+}
+
+
+// Builds the graph of a function with one int32 parameter, {locals} int32
+// locals and the given {body}, and returns the time taken in seconds.
+double BuildGraphSeconds(int locals, const std::vector<byte>& body) {
+  TestSignatures sigs;
+  FunctionEnv env;
+  env.module = nullptr;
+  env.sig = sigs.v_i();
+  env.local_int32_count = locals;
+  env.local_int64_count = 0;
+  env.local_float32_count = 0;
+  env.local_float64_count = 0;
+  env.SumLocals();
+
+  HandleAndZoneScope scope;
+  Graph graph(scope.main_zone());
+  CommonOperatorBuilder common(scope.main_zone());
+  MachineOperatorBuilder machine(scope.main_zone());
+  JSGraph jsgraph(scope.main_isolate(), &graph, &common, nullptr, &machine);
+
+  ElapsedTimer timer;
+  timer.Start();
+  TreeResult result =
+      BuildTFGraph(&jsgraph, &env, &body[0], &body[0] + body.size());
+  CHECK(result.ok());
+  return timer.Elapsed().InSecondsF();
+}
+
+
+// Builds the graph of a function with {count} int32 locals, whose body is a
+// sequence of {count} ifs that each set a different local, and prints the
+// time taken. Each if splits and merges the environment, so the time per
+// branch should not grow with {count}.
+void BenchmarkBuildGraph(int count) {
+  std::vector<byte> body;
+  for (int i = 0; i < count; i++) {
+    body.push_back(kStmtIf);
+    body.push_back(kExprGetLocal);
+    body.push_back(0);
+    body.push_back(kExprSetLocal);
+    AppendLEB128(&body, static_cast<uint32_t>(i + 1));
+    body.push_back(kExprInt8Const);
+    body.push_back(1);
+  }
+
+  double seconds = BuildGraphSeconds(count, body);
+  PrintF("wasm-build-graph %5d locals %5d branches %8.3f ms %7.1f us/branch\n",
+         count, count, seconds * 1000, seconds * 1000000 / count);
+}
+
+
+// Builds the graph of a function with {locals} int32 locals, whose body is a
+// loop with {continues} continue edges that each set a different local, and
+// prints the time taken. The loop gets one phi per local and every back edge
+// adds one input to each phi, so the time per local and continue should not
+// grow with either.
+void BenchmarkBuildLoopGraph(int locals, int continues) {
+  CHECK_LT(continues, 255);
+  std::vector<byte> body;
+  body.push_back(kStmtLoop);
+  body.push_back(static_cast<byte>(continues + 1));
+  for (int i = 0; i < continues; i++) {
+    body.push_back(kStmtIf);
+    body.push_back(kExprGetLocal);
+    body.push_back(0);
+    body.push_back(kStmtBlock);
+    body.push_back(2);
+    body.push_back(kExprSetLocal);
+    AppendLEB128(&body, static_cast<uint32_t>(1 + i % locals));
+    body.push_back(kExprInt8Const);
+    body.push_back(static_cast<byte>(i & 0x7f));
+    body.push_back(kStmtContinue);
+    body.push_back(1);
+  }
+  body.push_back(kStmtBreak);
+  body.push_back(0);
+
+  double seconds = BuildGraphSeconds(locals, body);
+  double inputs = static_cast<double>(locals) * (continues + 1);
+  PrintF("wasm-build-loop %5d locals %3d continues %8.3f ms %7.1f ns/input\n",
+         locals, continues, seconds * 1000, seconds * 1e9 / inputs);
+}
+
+
+// Instantiates a module whose exported function "main" calls a function that
+// loads from memory in a loop, storing to memory between the calls, and
+// prints the time taken by the calls. Both functions access memory through
+// its base, which is either loaded on entry or passed as a parameter.
+// Returns the result.
+int32_t BenchmarkMemoryCalls(const char* name) {
+  Isolate* isolate = CcTest::InitIsolateOnce();
+  HandleScope scope(isolate);
+  const byte get_code[] = {WASM_RETURN(WASM_LOAD_MEM(
+      kMemInt32, WASM_INT32_AND(WASM_GET_LOCAL(0), WASM_INT32(0xfffc))))};
+  const byte main_code[] = {WASM_BLOCK(
+      2, WASM_WHILE(
+             WASM_GET_LOCAL(0),
+             WASM_BLOCK(
+                 3, WASM_SET_LOCAL(0, WASM_INT32_SUB(WASM_GET_LOCAL(0),
+                                                     WASM_INT8(1))),
+                 WASM_STORE_MEM(kMemInt32, WASM_INT32_AND(WASM_GET_LOCAL(0),
+                                                          WASM_INT32(0xfffc)),
+                                WASM_GET_LOCAL(0)),
+                 WASM_SET_LOCAL(1, WASM_INT32_ADD(
+                                       WASM_GET_LOCAL(1),
+                                       WASM_CALL_FUNCTION(
+                                           0, WASM_GET_LOCAL(0)))))),
+      WASM_RETURN(WASM_GET_LOCAL(1)))};
+  static const size_t kHeaderSize = 8;
+  static const size_t kFunctionSize = 25;
+  const uint32_t get_start = kHeaderSize + 2 * kFunctionSize;
+  const uint32_t main_start = get_start + sizeof(get_code);
+  const uint32_t name_offset = main_start + sizeof(main_code);
+
+  std::vector<byte> module;
+  module.push_back(16);   // memory size
+  module.push_back(0);    // flags
+  AppendU16(&module, 0);  // globals
+  AppendU16(&module, 2);  // functions
+  AppendU16(&module, 0);  // data segments
+  module.insert(module.end(), {1, kAstInt32, kAstInt32});  // int -> int
+  AppendU32(&module, 0);  // name offset
+  AppendU32(&module, get_start);
+  AppendU32(&module, main_start);
+  module.insert(module.end(), 8, 0);  // local counts
+  module.push_back(0);                // exported
+  module.push_back(0);                // external
+  module.insert(module.end(), {1, kAstInt32, kAstInt32});  // int -> int
+  AppendU32(&module, name_offset);
+  AppendU32(&module, main_start);
+  AppendU32(&module, name_offset);
+  AppendU16(&module, 1);  // local int32 count
+  module.insert(module.end(), 6, 0);  // other local counts
+  module.push_back(1);                // exported
+  module.push_back(0);                // external
+  CHECK_EQ(static_cast<size_t>(get_start), module.size());
+  module.insert(module.end(), get_code, get_code + sizeof(get_code));
+  module.insert(module.end(), main_code, main_code + sizeof(main_code));
+  const char kName[] = "main";
+  module.insert(module.end(), kName, kName + sizeof(kName));
+
+  Zone zone;
+  ModuleResult result = DecodeWasmModule(isolate, &zone, &module[0],
+                                         &module[0] + module.size());
+  CHECK(result.ok());
+  Handle<JSObject> instance =
+      result.val->Instantiate(isolate, Handle<JSObject>::null())
+          .ToHandleChecked();
+  delete result.val;
+  Handle<Object> main =
+      Object::GetProperty(instance,
+                          isolate->factory()->InternalizeUtf8String(kName))
+          .ToHandleChecked();
+  Handle<Object> arg(Smi::FromInt(kCallIterations), isolate);
+
+  ElapsedTimer timer;
+  timer.Start();
+  Handle<Object> retval =
+      Execution::Call(isolate, main, isolate->factory()->undefined_value(), 1,
+                      &arg)
+          .ToHandleChecked();
+  double seconds = timer.Elapsed().InSecondsF();
+  PrintF("wasm-memory-calls %-12s %8.3f ms %7.2f ns/call\n", name,
+         seconds * 1000, seconds * 1e9 / kCallIterations);
+  return static_cast<int32_t>(retval->Number());
+}
+}  // namespace
+
+
+TEST(Benchmark_WasmDecodeInt32) {
+  if (!FLAG_wasm_benchmarks) return;
+  static const byte stmt[] = {WASM_SET_LOCAL(
+      0, WASM_INT32_ADD(WASM_INT32_MUL(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)),
+                        WASM_INT8(7)))};
+  BenchmarkVerify("int32", RepeatStatement(stmt, sizeof(stmt)));
+}
+
+
+TEST(Benchmark_WasmDecodeFloat64) {
+  if (!FLAG_wasm_benchmarks) return;
+  static const byte stmt[] = {WASM_SET_LOCAL(
+      2,
+      WASM_FLOAT64_ADD(WASM_FLOAT64_MUL(WASM_GET_LOCAL(2), WASM_GET_LOCAL(2)),
+                       WASM_FLOAT64(0.5)))};
+  BenchmarkVerify("float64", RepeatStatement(stmt, sizeof(stmt)));
+}
+
+
+TEST(Benchmark_WasmDecodeMemory) {
+  if (!FLAG_wasm_benchmarks) return;
+  static const byte stmt[] = {WASM_STORE_MEM(
+      kMemInt32, WASM_GET_LOCAL(0),
+      WASM_INT32_ADD(WASM_LOAD_MEM(kMemInt32, WASM_GET_LOCAL(1)),
+                     WASM_INT8(1)))};
+  BenchmarkVerify("memory", RepeatStatement(stmt, sizeof(stmt)));
+}
+
+
+TEST(Benchmark_WasmDecodeControl) {
+  if (!FLAG_wasm_benchmarks) return;
+  static const byte stmt[] = {
+      WASM_IF_THEN(WASM_GET_LOCAL(0), WASM_SET_LOCAL(0, WASM_INT8(1)),
+                   WASM_SET_LOCAL(1, WASM_INT8(2)))};
+  BenchmarkVerify("control", RepeatStatement(stmt, sizeof(stmt)));
+}
+
+
+TEST(Benchmark_WasmVerifyModuleInt32) {
+  if (!FLAG_wasm_benchmarks) return;
+  static const byte stmt[] = {WASM_SET_LOCAL(
+      0, WASM_INT32_ADD(WASM_INT32_MUL(WASM_GET_LOCAL(0), WASM_GET_LOCAL(1)),
+                        WASM_INT8(7)))};
+  BenchmarkVerifyModule("int32", RepeatFunction(stmt, sizeof(stmt)));
+}
+
+
+TEST(Benchmark_WasmVerifyModuleControl) {
+  if (!FLAG_wasm_benchmarks) return;
+  static const byte stmt[] = {
+      WASM_IF_THEN(WASM_GET_LOCAL(0), WASM_SET_LOCAL(0, WASM_INT8(1)),
+                   WASM_SET_LOCAL(1, WASM_INT8(2)))};
+  BenchmarkVerifyModule("control", RepeatFunction(stmt, sizeof(stmt)));
+}
+
+
+TEST(Benchmark_WasmBuildGraphManyLocals) {
+  if (!FLAG_wasm_benchmarks) return;
+  for (int count = kMinBranches; count <= kMaxBranches; count *= 2) {
+    BenchmarkBuildGraph(count);
+  }
+}
+
+
+TEST(Benchmark_WasmBuildLoopGraph) {
+  if (!FLAG_wasm_benchmarks) return;
+  for (int locals = kMinBranches; locals <= kMaxBranches; locals *= 2) {
+    BenchmarkBuildLoopGraph(locals, 2);
+  }
+  for (int continues = 15; continues < 255; continues *= 2) {
+    BenchmarkBuildLoopGraph(kMinBranches, continues);
+  }
+}
+
+
+TEST(Benchmark_WasmMemBaseParam) {
+  if (!FLAG_wasm_benchmarks) return;
+  bool old_param = FLAG_wasm_mem_base_param;
+  bool old_inlining = FLAG_wasm_inlining;
+  FLAG_wasm_inlining = false;
+  FLAG_wasm_mem_base_param = false;
+  int32_t loaded = BenchmarkMemoryCalls("loaded");
+  FLAG_wasm_mem_base_param = true;
+  CHECK_EQ(loaded, BenchmarkMemoryCalls("parameter"));
+  FLAG_wasm_mem_base_param = old_param;
+  FLAG_wasm_inlining = old_inlining;
+}
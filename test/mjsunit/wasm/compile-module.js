@@ -0,0 +1,158 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Flags: --expose-gc
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kAstFloat64 = 4;
+var kStmtNop = 0;
+var kStmtIfThen = 2;
+var kStmtBlock = 3;
+var kStmtLoop = 6;
+var kStmtBreak = 8;
+var kStmtReturn = 0x9;
+var kExprInt8Const = 0x10;
+var kExprGetLocal = 0x15;
+var kExprSetLocal = 0x16;
+var kExprCallFunction = 0x19;
+var kExprInt32LoadMemL = 0x20;
+var kExprInt32Sub = 0x41;
+
+var kMemSize = 4096;
+
+function genMemoryModuleBytes() {
+  var kCodeStart = 8 + 25;
+  var kCodeEnd = kCodeStart + 30;
+  var kNameMainOffset = kCodeEnd;
+
+  return bytes(
+    12, 1,                      // memory
+    0, 0,                       // globals
+    1, 0,                       // functions
+    0, 0,                       // data segments
+    // -- main function
+    1, kAstInt32, kAstInt32,    // signature: int->int
+    kNameMainOffset, 0, 0, 0,   // name offset
+    kCodeStart, 0, 0, 0,        // code start offset
+    kCodeEnd, 0, 0, 0,          // code end offset
+    1, 0,                       // local int32 count
+    0, 0,                       // local int64 count
+    0, 0,                       // local float32 count
+    0, 0,                       // local float64 count
+    1,                          // exported
+    0,                          // external
+    // main body: while(i) { if(mem[i]) return -1; i -= 4; } return 0;
+    kStmtBlock,2,
+      kStmtLoop,1,
+        kStmtIfThen,kExprGetLocal,0,
+          kStmtBlock,2,
+            kStmtIfThen,kExprInt32LoadMemL,6,kExprGetLocal,0,
+              kStmtReturn, kExprInt8Const,-1,
+              kStmtNop,
+            kExprSetLocal,0,kExprInt32Sub,kExprGetLocal,0,kExprInt8Const,4,
+          kStmtBreak,0,
+      kStmtReturn,kExprInt8Const,0,
+    // names
+    'm', 'a', 'i', 'n', 0       //  --
+  );
+}
+
+function genImportModuleBytes() {
+  var kCodeStart = 8 + 26 + 26;
+  var kCodeEnd = kCodeStart + 7;
+  var kNameFunOffset = kCodeEnd;
+  var kNameMainOffset = kNameFunOffset + 4;
+
+  return bytes(
+    12, 1,                      // memory
+    0, 0,                       // globals
+    2, 0,                       // functions
+    0, 0,                       // data segments
+    // -- foreign function
+    2, kAstInt32, kAstFloat64, kAstFloat64, // signature: (f64,f64)->int
+    kNameFunOffset, 0, 0, 0,    // name offset
+    0, 0, 0, 0,                 // code start offset
+    0, 0, 0, 0,                 // code end offset
+    0, 0,                       // local int32 count
+    0, 0,                       // local int64 count
+    0, 0,                       // local float32 count
+    0, 0,                       // local float64 count
+    0,                          // exported
+    1,                          // external
+    // -- main function
+    2, kAstInt32, kAstFloat64, kAstFloat64, // signature: (f64,f64)->int
+    kNameMainOffset, 0, 0, 0,   // name offset
+    kCodeStart, 0, 0, 0,        // code start offset
+    kCodeEnd, 0, 0, 0,          // code end offset
+    0, 0,                       // local int32 count
+    0, 0,                       // local int64 count
+    0, 0,                       // local float32 count
+    0, 0,                       // local float64 count
+    1,                          // exported
+    0,                          // external
+    // main body
+    kStmtReturn,                // --
+    kExprCallFunction, 0,       // --
+    kExprGetLocal, 0,           // --
+    kExprGetLocal, 1,           // --
+    // names
+    'f', 'u', 'n', 0,           //  --
+    'm', 'a', 'i', 'n', 0       //  --
+  );
+}
+
+(function testInstancesHaveSeparateMemory() {
+  var compiled = WASM.compileModule(genMemoryModuleBytes());
+  var modules = [];
+  for (var i = 0; i < 3; i++) {
+    modules.push(WASM.instantiateModule(compiled));
+  }
+
+  for (var i = 0; i < modules.length; i++) {
+    assertEquals("function", typeof modules[i].main);
+    assertEquals(0, modules[i].main(kMemSize - 4));
+  }
+  new Int8Array(modules[1].memory)[kMemSize / 2] = 1;
+  assertEquals(0, modules[0].main(kMemSize - 4));
+  assertEquals(-1, modules[1].main(kMemSize - 4));
+  assertEquals(0, modules[2].main(kMemSize - 4));
+})();
+
+(function testInstancesHaveSeparateImports() {
+  var compiled = WASM.compileModule(genImportModuleBytes());
+  var sub = WASM.instantiateModule(compiled,
+                                   {fun: function(a, b) { return a - b; }});
+  var add = WASM.instantiateModule(compiled,
+                                   {fun: function(a, b) { return a + b; }});
+  assertEquals(11, sub.main(33, 22));
+  assertEquals(55, add.main(33, 22));
+  assertEquals(-11, sub.main(22, 33));
+})();
+
+(function testCompiledModuleSurvivesGC() {
+  var compiled = WASM.compileModule(genMemoryModuleBytes());
+  gc();
+  var module = WASM.instantiateModule(compiled);
+  gc();
+  new Int8Array(module.memory)[8] = 1;
+  assertEquals(-1, module.main(kMemSize - 4));
+})();
+
+(function testCompileErrors() {
+  var broken = genMemoryModuleBytes();
+  new Uint8Array(broken)[8 + 25] = 0xff;  // invalid opcode
+  assertThrows(function() { WASM.compileModule(broken); });
+  assertThrows(function() { WASM.compileModule({}); });
+})();
@@ -0,0 +1,81 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+var kAstInt32 = 1;
+var kStmtReturn = 0x9;
+var kExprMemorySize = 0x1d;
+var kModuleMemExport = 0x01;
+var kModuleMemGrowable = 0x04;
+var kMemSize = 65536;
+var kCodeStartOffset = 32;
+var kCodeEndOffset = 34;
+var kNameOffset = kCodeEndOffset;
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+function genModule(flags) {
+  return WASM.instantiateModule(bytes(
+    16, flags,                  // memory
+    0, 0,                       // globals
+    1, 0,                       // functions
+    0, 0,                       // data segments
+    0, kAstInt32,               // signature: void -> int
+    kNameOffset, 0, 0, 0,       // name offset
+    kCodeStartOffset, 0, 0, 0,  // code start offset
+    kCodeEndOffset, 0, 0, 0,    // code end offset
+    0, 0,                       // local int32 count
+    0, 0,                       // local int64 count
+    0, 0,                       // local float32 count
+    0, 0,                       // local float64 count
+    1,                          // exported
+    0,                          // external
+    kStmtReturn,                // body
+    kExprMemorySize,            // --
+    'm', 'a', 'i', 'n', 0       // name
+  ));
+}
+
+function testGrowMemory() {
+  var module = genModule(kModuleMemExport | kModuleMemGrowable);
+  var buffer = module.memory;
+  assertEquals(kMemSize, buffer.byteLength);
+  assertEquals(kMemSize, module.main());
+
+  var array = new Int32Array(buffer);
+  array[7] = 1234;
+
+  // The memory grows in place, so the buffer still holds the old contents.
+  assertEquals(kMemSize, WASM.growMemory(module, kMemSize));
+  assertEquals(2 * kMemSize, buffer.byteLength);
+  assertEquals(2 * kMemSize, module.main());
+  assertEquals(1234, new Int32Array(buffer)[7]);
+  assertEquals(0, new Int32Array(buffer)[kMemSize / 4 + 7]);
+
+  assertEquals(2 * kMemSize, WASM.growMemory(module, 0));
+  assertEquals(-1, WASM.growMemory(module, 0xffffffff));
+  assertEquals(2 * kMemSize, module.main());
+}
+
+testGrowMemory();
+
+function testFixedMemory() {
+  var module = genModule(kModuleMemExport);
+  assertEquals(kMemSize, module.main());
+  assertEquals(-1, WASM.growMemory(module, kMemSize));
+  assertEquals(kMemSize, module.memory.byteLength);
+}
+
+testFixedMemory();
+
+assertThrows(function() { WASM.growMemory(); });
+assertThrows(function() { WASM.growMemory({}, -1); });
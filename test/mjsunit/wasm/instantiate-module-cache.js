@@ -0,0 +1,114 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Flags: --wasm-code-cache --expose-gc
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstStmt = 0;
+var kAstInt32 = 1;
+var kAstInt64 = 2;
+var kAstFloat32 = 3;
+var kAstFloat64 = 4;
+var kStmtNop = 0;
+var kStmtIf = 1;
+var kStmtIfThen = 2;
+var kStmtBlock = 3;
+var kStmtLoop = 6;
+var kStmtBreak = 8;
+var kExprInt32LoadMemL = 0x20;
+var kExprInt8Const = 0x10;
+var kExprInt32Add = 0x40;
+var kExprInt32Sub = 0x41;
+var kExprGetLocal = 0x15;
+var kExprSetLocal = 0x16;
+var kExprFloat64Lt = 0x99;
+var kStmtReturn = 0x9;
+var kExprCallFunction = 0x19;
+
+var kMemSize = 4096;
+
+function genModuleBytes() {
+  var kModuleHeaderSize = 8;
+  var kFunctionSize = 24;
+  var kCodeStart = kModuleHeaderSize + (kFunctionSize + 1);
+  var kCodeEnd = kCodeStart + 30;
+  var kNameAddOffset = kCodeEnd;
+  var kNameMainOffset = kCodeEnd;
+
+  var data = bytes(
+    12, 1,                      // memory
+    0, 0,                       // globals
+    1, 0,                       // functions
+    0, 0,                       // data segments
+    // -- main function
+    1, kAstInt32, kAstInt32,    // signature: int->int
+    kNameMainOffset, 0, 0, 0,   // name offset
+    kCodeStart, 0, 0, 0,        // code start offset
+    kCodeEnd, 0, 0, 0,          // code end offset
+    1, 0,                       // local int32 count
+    0, 0,                       // local int64 count
+    0, 0,                       // local float32 count
+    0, 0,                       // local float64 count
+    1,                          // exported
+    0,                          // external
+    // main body: while(i) { if(mem[i]) return -1; i -= 4; } return 0;
+    kStmtBlock,2,
+      kStmtLoop,1,
+        kStmtIfThen,kExprGetLocal,0,
+          kStmtBlock,2,
+            kStmtIfThen,kExprInt32LoadMemL,6,kExprGetLocal,0,
+              kStmtReturn, kExprInt8Const,-1,
+              kStmtNop,
+            kExprSetLocal,0,kExprInt32Sub,kExprGetLocal,0,kExprInt8Const,4,
+          kStmtBreak,0,
+      kStmtReturn,kExprInt8Const,0,
+    // names
+    'm', 'a', 'i', 'n', 0       //  --
+  );
+
+  return data;
+}
+
+var data = genModuleBytes();
+
+(function testInstancesShareCode() {
+  var before = WASM.getStatistics();
+  var module1 = WASM.instantiateModule(data);
+  var module2 = WASM.instantiateModule(genModuleBytes());
+  var after = WASM.getStatistics();
+  // The second instantiation copies the code compiled for the first.
+  assertEquals(before.codeCacheMisses + 1, after.codeCacheMisses);
+  assertEquals(before.codeCacheHits + 1, after.codeCacheHits);
+
+  // But each instance has its own memory.
+  var array1 = new Int8Array(module1.memory);
+  var array2 = new Int8Array(module2.memory);
+  array1[kMemSize / 2] = 1;
+  assertEquals(-1, module1.main(kMemSize - 4));
+  assertEquals(0, module2.main(kMemSize - 4));
+  array2[kMemSize / 4] = 1;
+  array1[kMemSize / 2] = 0;
+  assertEquals(0, module1.main(kMemSize - 4));
+  assertEquals(-1, module2.main(kMemSize - 4));
+})();
+
+(function testCachedCodeSurvivesGC() {
+  gc();
+  var module = WASM.instantiateModule(data);
+  gc();
+  var array = new Int8Array(module.memory);
+  assertEquals(0, module.main(kMemSize - 4));
+  array[8] = 1;
+  assertEquals(-1, module.main(kMemSize - 4));
+})();
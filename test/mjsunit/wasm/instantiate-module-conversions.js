@@ -0,0 +1,83 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kAstFloat32 = 3;
+var kAstFloat64 = 4;
+var kExprGetLocal = 0x15;
+var kStmtReturn = 0x9;
+
+// An exported function id(x) of signature type -> type, which returns x.
+function instantiateIdentity(type) {
+  var kCodeStartOffset = 33;
+  var kCodeEndOffset = kCodeStartOffset + 3;
+  var kNameOffset = kCodeEndOffset;
+
+  var data = bytes(
+    12, 1,                      // memory
+    0, 0,                       // globals
+    1, 0,                       // functions
+    0, 0,                       // data segments
+    1, type, type,              // signature: t->t
+    kNameOffset, 0, 0, 0,       // name offset
+    kCodeStartOffset, 0, 0, 0,  // code start offset
+    kCodeEndOffset, 0, 0, 0,    // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,     // local counts
+    1,                          // exported
+    0,                          // external
+    kStmtReturn,                // --
+    kExprGetLocal, 0,           // --
+    'i', 'd', 0                 // name
+  );
+  return WASM.instantiateModule(data);
+}
+
+var valueOfCalls = 0;
+var objWithValueOf = {valueOf: function() { valueOfCalls++; return 7.5; }};
+
+// Small integers, heap numbers, and values that need ToNumber.
+var values = [
+  0, -0, 1, -1, 42, 1073741823, -1073741824, 1073741824, 2147483647,
+  -2147483648, 4294967296, 0.5, -1.25, 1e300, NaN, Infinity, -Infinity,
+  "17", "-3.5", "", "foo", true, false, null, undefined, objWithValueOf
+];
+
+(function testInt32Conversions() {
+  var module = instantiateIdentity(kAstInt32);
+  for (var i = 0; i < values.length; i++) {
+    assertEquals(values[i] | 0, module.id(values[i]));
+  }
+})();
+
+(function testFloat32Conversions() {
+  var module = instantiateIdentity(kAstFloat32);
+  for (var i = 0; i < values.length; i++) {
+    assertEquals(Math.fround(+values[i]), module.id(values[i]));
+  }
+})();
+
+(function testFloat64Conversions() {
+  var module = instantiateIdentity(kAstFloat64);
+  for (var i = 0; i < values.length; i++) {
+    assertEquals(+values[i], module.id(values[i]));
+  }
+})();
+
+(function testValueOfCalledOnce() {
+  var module = instantiateIdentity(kAstFloat64);
+  valueOfCalls = 0;
+  assertEquals(7.5, module.id(objWithValueOf));
+  assertEquals(1, valueOfCalls);
+})();
@@ -0,0 +1,134 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kExprInt32LoadMemL = 0x20;
+var kExprInt32StoreMemL = 0x30;
+var kExprGetLocal = 0x15;
+var kStmtReturn = 0x9;
+
+var kModuleMemExport = 0x01;
+var kModuleMemGrowable = 0x04;
+var kModuleMemExternal = 0x08;
+
+var kMemSize = 4096;
+
+// Exported functions load(addr) and store(addr, val) on a memory of
+// {kMemSize} bytes.
+function genModuleBytes(flags) {
+  var kLoadStart = 8 + 25 + 26;
+  var kStoreStart = kLoadStart + 5;
+  var kCodeEnd = kStoreStart + 7;
+  var kNameLoadOffset = kCodeEnd;
+  var kNameStoreOffset = kNameLoadOffset + 5;
+
+  return bytes(
+    12, flags,                  // memory
+    0, 0,                       // globals
+    2, 0,                       // functions
+    0, 0,                       // data segments
+    // -- load function
+    1, kAstInt32, kAstInt32,    // signature: int->int
+    kNameLoadOffset, 0, 0, 0,   // name offset
+    kLoadStart, 0, 0, 0,        // code start offset
+    kStoreStart, 0, 0, 0,       // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,     // local counts
+    1,                          // exported
+    0,                          // external
+    // -- store function
+    2, kAstInt32, kAstInt32, kAstInt32,  // signature: (int,int)->int
+    kNameStoreOffset, 0, 0, 0,  // name offset
+    kStoreStart, 0, 0, 0,       // code start offset
+    kCodeEnd, 0, 0, 0,          // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,     // local counts
+    1,                          // exported
+    0,                          // external
+    // load body
+    kStmtReturn,                // --
+    kExprInt32LoadMemL, 6,      // --
+    kExprGetLocal, 0,           // --
+    // store body
+    kStmtReturn,                // --
+    kExprInt32StoreMemL, 6,     // --
+    kExprGetLocal, 0,           // --
+    kExprGetLocal, 1,           // --
+    // names
+    'l', 'o', 'a', 'd', 0,      // --
+    's', 't', 'o', 'r', 'e', 0  // --
+  );
+}
+
+function instantiateWithMemory(module, memory) {
+  return WASM.instantiateModule(module, undefined, undefined, undefined,
+                                memory);
+}
+
+(function testArrayBufferMemory() {
+  var buffer = new ArrayBuffer(kMemSize);
+  var view = new Int32Array(buffer);
+  view[1] = 1234;
+  var module = instantiateWithMemory(
+      genModuleBytes(kModuleMemExport | kModuleMemExternal), buffer);
+  assertSame(buffer, module.memory);
+
+  // The instance reads and writes the buffer in place.
+  assertEquals(1234, module.load(4));
+  module.store(8, 77);
+  assertEquals(77, view[2]);
+  view[2] = 78;
+  assertEquals(78, module.load(8));
+})();
+
+(function testInstanceMemory() {
+  var module1 = WASM.instantiateModule(genModuleBytes(kModuleMemExport));
+  var module2 = instantiateWithMemory(genModuleBytes(0), module1);
+  var view = new Int32Array(module1.memory);
+
+  module1.store(12, 5);
+  assertEquals(5, module2.load(12));
+  module2.store(16, 6);
+  assertEquals(6, module1.load(16));
+  assertEquals(6, view[4]);
+})();
+
+(function testCompiledModuleMemory() {
+  var buffer = new ArrayBuffer(kMemSize);
+  new Int32Array(buffer)[1] = 4321;
+  var compiled = WASM.compileModule(genModuleBytes(kModuleMemExternal));
+  var module1 = instantiateWithMemory(compiled, buffer);
+  var module2 = instantiateWithMemory(compiled, buffer);
+  assertEquals(4321, module1.load(4));
+  module1.store(4, 99);
+  assertEquals(99, module2.load(4));
+})();
+
+(function testInvalidMemory() {
+  // External memory must be supplied, and must be large enough.
+  assertThrows(function() {
+    WASM.instantiateModule(genModuleBytes(kModuleMemExternal));
+  });
+  assertThrows(function() {
+    instantiateWithMemory(genModuleBytes(kModuleMemExternal),
+                          new ArrayBuffer(kMemSize / 2));
+  });
+  assertThrows(function() {
+    instantiateWithMemory(genModuleBytes(0), {});
+  });
+  // External memory is not reserved to grow into.
+  assertThrows(function() {
+    instantiateWithMemory(genModuleBytes(kModuleMemGrowable),
+                          new ArrayBuffer(kMemSize));
+  });
+})();
@@ -0,0 +1,80 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Flags: --allow-natives-syntax
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kExprInt8Const = 0x10;
+var kStmtReturn = 0x9;
+var kReturnValue = 77;
+
+function moduleBytes() {
+  var kCodeStart = 56;
+  var kCodeEnd = kCodeStart + 3;
+  var kNameFunOffset = kCodeEnd;
+  var kNameMainOffset = kNameFunOffset + 4;
+  return bytes(
+    12, 0,                      // memory
+    0, 0,                       // globals
+    2, 0,                       // functions
+    0, 0,                       // data segments
+    // -- foreign function
+    0, kAstInt32,               // signature: void -> int
+    kNameFunOffset, 0, 0, 0,    // name offset
+    0, 0, 0, 0,                 // code start offset
+    0, 0, 0, 0,                 // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,     // local counts
+    0,                          // exported
+    1,                          // external
+    // -- main function
+    0, kAstInt32,               // signature: void -> int
+    kNameMainOffset, 0, 0, 0,   // name offset
+    kCodeStart, 0, 0, 0,        // code start offset
+    kCodeEnd, 0, 0, 0,          // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,     // local counts
+    1,                          // exported
+    0,                          // external
+    // main body
+    kStmtReturn,                // --
+    kExprInt8Const,             // --
+    kReturnValue,               // --
+    // names
+    'f', 'u', 'n', 0,           // --
+    'm', 'a', 'i', 'n', 0       // --
+  );
+}
+
+// The getter of an import runs while the module is instantiated from the
+// bytes, and must not see or affect them.
+function testGetter(tamper) {
+  var data = moduleBytes();
+  var ffi = {};
+  Object.defineProperty(ffi, "fun", {
+    get: function() {
+      tamper(data);
+      return function() { return 0; };
+    }
+  });
+  assertEquals(kReturnValue, WASM.instantiateModule(data, ffi).main());
+}
+
+// Overwrite the bytes.
+testGetter(function(data) {
+  var view = new Uint8Array(data);
+  for (var i = 0; i < view.length; i++) view[i] = 0xff;
+});
+
+// Free the bytes.
+testGetter(function(data) { %ArrayBufferNeuter(data); });
@@ -0,0 +1,91 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kExprGetLocal = 0x15;
+var kExprCallFunction = 0x19;
+var kStmtReturn = 0x9;
+
+// Three imports f, g, and h of signature int -> int, and an exported
+// function main(x) which returns f(g(h(x))).
+function genModuleBytes() {
+  var kCodeStart = 8 + 4 * 25;
+  var kCodeEnd = kCodeStart + 9;
+  var kNameMainOffset = kCodeEnd + 6;
+  var data = [
+    0, 0,  // memory
+    0, 0,  // globals
+    4, 0,  // functions
+    0, 0   // data segments
+  ];
+  for (var i = 0; i < 3; i++) {
+    var name = kCodeEnd + 2 * i;
+    data.push(
+      1, kAstInt32, kAstInt32,  // signature: int -> int
+      name, 0, 0, 0,            // name offset
+      0, 0, 0, 0,               // code start offset
+      0, 0, 0, 0,               // code end offset
+      0, 0, 0, 0, 0, 0, 0, 0,   // local counts
+      0,                        // exported
+      1);                       // external
+  }
+  data.push(
+    1, kAstInt32, kAstInt32,    // signature: int -> int
+    kNameMainOffset, 0, 0, 0,   // name offset
+    kCodeStart, 0, 0, 0,        // code start offset
+    kCodeEnd, 0, 0, 0,          // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,     // local counts
+    1,                          // exported
+    0,                          // external
+    // main body
+    kStmtReturn,                // --
+    kExprCallFunction, 0,       // --
+    kExprCallFunction, 1,       // --
+    kExprCallFunction, 2,       // --
+    kExprGetLocal, 0,           // --
+    // names
+    'f', 0, 'g', 0, 'h', 0,     // --
+    'm', 'a', 'i', 'n', 0);     // --
+  return bytes.apply(null, data);
+}
+
+function genFFI(factor) {
+  return {
+    f: function(x) { return x * factor; },
+    // Called through the CallFunctionStub, since the arity does not match.
+    g: function() { return arguments[0] + 5; },
+    h: function(x) { return x - 1; }
+  };
+}
+
+(function testInstancesShareImportWrappers() {
+  var before = WASM.getStatistics();
+  var module1 = WASM.instantiateModule(genModuleBytes(), genFFI(3));
+  var module2 = WASM.instantiateModule(genModuleBytes(), genFFI(4));
+  var after = WASM.getStatistics();
+
+  // All six imports share one wrapper per arity match, compiled at most
+  // once.
+  var compiled = after.importWrappersCompiled - before.importWrappersCompiled;
+  var reused = after.importWrappersReused - before.importWrappersReused;
+  assertTrue(compiled <= 2);
+  assertEquals(6, compiled + reused);
+
+  // Yet each instance calls its own imports.
+  for (var x = -10; x < 10; x++) {
+    assertEquals(3 * (x - 1 + 5), module1.main(x));
+    assertEquals(4 * (x - 1 + 5), module2.main(x));
+  }
+})();
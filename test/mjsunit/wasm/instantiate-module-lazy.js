@@ -0,0 +1,100 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Flags: --wasm-lazy-compilation --expose-gc
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kExprInt32Sub = 0x41;
+var kExprGetLocal = 0x15;
+var kExprCallFunction = 0x19;
+var kStmtReturn = 0x9;
+
+var kSubStart = 60;
+var kSubEnd = kSubStart + 6;
+var kMainStart = kSubEnd;
+var kMainEnd = kMainStart + 7;
+var kSubName = kMainEnd;
+var kMainName = kSubName + 4;
+
+var data = bytes(
+  12, 1,                      // memory
+  0, 0,                       // globals
+  2, 0,                       // functions
+  0, 0,                       // data segments
+  // function #0: sub
+  2, kAstInt32, kAstInt32, kAstInt32,  // signature: int, int -> int
+  kSubName, 0, 0, 0,          // name offset
+  kSubStart, 0, 0, 0,         // code start offset
+  kSubEnd, 0, 0, 0,           // code end offset
+  0, 0,                       // local int32 count
+  0, 0,                       // local int64 count
+  0, 0,                       // local float32 count
+  0, 0,                       // local float64 count
+  1,                          // exported
+  0,                          // external
+  // function #1: main
+  2, kAstInt32, kAstInt32, kAstInt32,  // signature: int, int -> int
+  kMainName, 0, 0, 0,         // name offset
+  kMainStart, 0, 0, 0,        // code start offset
+  kMainEnd, 0, 0, 0,          // code end offset
+  0, 0,                       // local int32 count
+  0, 0,                       // local int64 count
+  0, 0,                       // local float32 count
+  0, 0,                       // local float64 count
+  1,                          // exported
+  0,                          // external
+  // body of sub
+  kStmtReturn,                // --
+  kExprInt32Sub,              // --
+  kExprGetLocal, 0,           // --
+  kExprGetLocal, 1,           // --
+  // body of main
+  kStmtReturn,                // --
+  kExprCallFunction, 0,       // --
+  kExprGetLocal, 0,           // --
+  kExprGetLocal, 1,           // --
+  's', 'u', 'b', 0,           // name
+  'm', 'a', 'i', 'n', 0       // name
+);
+
+(function testLazyCalls() {
+  var module = WASM.instantiateModule(data);
+
+  assertEquals("function", typeof module.sub);
+  assertEquals("function", typeof module.main);
+
+  // Compiles main and, through its call site, sub.
+  assertEquals(-55, module.main(33, 88));
+  // The call site in main has been patched.
+  assertEquals(-55555, module.main(33333, 88888));
+  // sub is already compiled; only its wrapper still needs patching.
+  assertEquals(-5555555, module.sub(3333333, 8888888));
+  assertEquals(1, module.sub(3, 2));
+})();
+
+(function testLazyCallsAfterGC() {
+  var main = WASM.instantiateModule(data).main;
+  gc();
+  // The module object is kept alive by the uncompiled code.
+  assertEquals(11, main(33, 22));
+  gc();
+  assertEquals(-11, main(22, 33));
+})();
+
+(function testVerificationIsEager() {
+  var broken = data.slice(0);
+  new Uint8Array(broken)[kSubStart + 1] = 0xff;  // invalid opcode
+  assertThrows(function() { WASM.instantiateModule(broken); });
+})();
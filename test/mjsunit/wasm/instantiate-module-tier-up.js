@@ -0,0 +1,90 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Flags: --wasm-baseline --wasm-tier-up-threshold=10 --expose-gc
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kExprInt32Sub = 0x41;
+var kExprGetLocal = 0x15;
+var kExprCallFunction = 0x19;
+var kStmtReturn = 0x9;
+
+var kSubStart = 60;
+var kSubEnd = kSubStart + 6;
+var kMainStart = kSubEnd;
+var kMainEnd = kMainStart + 7;
+var kSubName = kMainEnd;
+var kMainName = kSubName + 4;
+
+var data = bytes(
+  12, 1,                      // memory
+  0, 0,                       // globals
+  2, 0,                       // functions
+  0, 0,                       // data segments
+  // function #0: sub
+  2, kAstInt32, kAstInt32, kAstInt32,  // signature: int, int -> int
+  kSubName, 0, 0, 0,          // name offset
+  kSubStart, 0, 0, 0,         // code start offset
+  kSubEnd, 0, 0, 0,           // code end offset
+  0, 0,                       // local int32 count
+  0, 0,                       // local int64 count
+  0, 0,                       // local float32 count
+  0, 0,                       // local float64 count
+  1,                          // exported
+  0,                          // external
+  // function #1: main
+  2, kAstInt32, kAstInt32, kAstInt32,  // signature: int, int -> int
+  kMainName, 0, 0, 0,         // name offset
+  kMainStart, 0, 0, 0,        // code start offset
+  kMainEnd, 0, 0, 0,          // code end offset
+  0, 0,                       // local int32 count
+  0, 0,                       // local int64 count
+  0, 0,                       // local float32 count
+  0, 0,                       // local float64 count
+  1,                          // exported
+  0,                          // external
+  // body of sub
+  kStmtReturn,                // --
+  kExprInt32Sub,              // --
+  kExprGetLocal, 0,           // --
+  kExprGetLocal, 1,           // --
+  // body of main
+  kStmtReturn,                // --
+  kExprCallFunction, 0,       // --
+  kExprGetLocal, 0,           // --
+  kExprGetLocal, 1,           // --
+  's', 'u', 'b', 0,           // name
+  'm', 'a', 'i', 'n', 0       // name
+);
+
+(function testTierUp() {
+  var module = WASM.instantiateModule(data);
+
+  // Both functions start out in baseline code and are recompiled with
+  // TurboFan once they have been called often enough.
+  for (var i = 0; i < 100; i++) {
+    assertEquals(i - 88, module.main(i, 88));
+    assertEquals(-i, module.sub(0, i));
+  }
+})();
+
+(function testTierUpAfterGC() {
+  var main = WASM.instantiateModule(data).main;
+  gc();
+  for (var i = 0; i < 30; i++) {
+    assertEquals(2 * i, main(3 * i, i));
+    if (i == 15) gc();
+  }
+})();
@@ -0,0 +1,69 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Flags: --no-wasm-code-cache
+
+function bytes() {
+  var buffer = new ArrayBuffer(arguments.length);
+  var view = new Uint8Array(buffer);
+  for (var i = 0; i < arguments.length; i++) {
+    var val = arguments[i];
+    if ((typeof val) == "string") val = val.charCodeAt(0);
+    view[i] = val | 0;
+  }
+  return buffer;
+}
+
+var kAstInt32 = 1;
+var kExprInt8Const = 0x10;
+var kStmtReturn = 0x9;
+
+// Three exported functions of the same signature, returning 11, 22, and 33.
+function genModuleBytes() {
+  var kCodeStart = 80;
+  var kNameStart = kCodeStart + 9;
+  var data = [
+    0, 0,  // memory
+    0, 0,  // globals
+    3, 0,  // functions
+    0, 0   // data segments
+  ];
+  for (var i = 0; i < 3; i++) {
+    var start = kCodeStart + 3 * i;
+    data.push(
+      0, kAstInt32,                 // signature: void -> int
+      kNameStart + 2 * i, 0, 0, 0,  // name offset
+      start, 0, 0, 0,               // code start offset
+      start + 3, 0, 0, 0,           // code end offset
+      0, 0, 0, 0, 0, 0, 0, 0,       // local counts
+      1,                            // exported
+      0);                           // external
+  }
+  data.push(kStmtReturn, kExprInt8Const, 11,
+            kStmtReturn, kExprInt8Const, 22,
+            kStmtReturn, kExprInt8Const, 33,
+            'a', 0, 'b', 0, 'c', 0);
+  return bytes.apply(null, data);
+}
+
+(function testInstancesShareWrappers() {
+  var before = WASM.getStatistics();
+  var module1 = WASM.instantiateModule(genModuleBytes());
+  var module2 = WASM.instantiateModule(genModuleBytes());
+  var after = WASM.getStatistics();
+
+  // All six exports share a single wrapper, compiled at most once.
+  var compiled = after.wrappersCompiled - before.wrappersCompiled;
+  var reused = after.wrappersReused - before.wrappersReused;
+  assertTrue(compiled <= 1);
+  assertEquals(6, compiled + reused);
+
+  // Yet each calls its own code.
+  assertEquals(11, module1.a());
+  assertEquals(22, module1.b());
+  assertEquals(33, module1.c());
+  assertEquals(11, module2.a());
+  assertEquals(22, module2.b());
+  assertEquals(33, module2.c());
+})();
@@ -0,0 +1,82 @@
+// Copyright 2015 the V8 project authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+var kAstStmt = 0;
+var kAstInt32 = 1;
+var kStmtNop = 0;
+var kExprInt8Const = 0x10;
+var kStmtReturn = 0x9;
+var kReturnValue = 77;
+var kCodeStartOffset = 32;
+var kCodeEndOffset = 35;
+var kNameOffset = kCodeEndOffset;
+
+var module_bytes = [
+  0, 0,                       // memory
+  0, 0,                       // globals
+  1, 0,                       // functions
+  0, 0,                       // data segments
+  0, kAstInt32,               // signature: void -> int
+  kNameOffset, 0, 0, 0,       // name offset
+  kCodeStartOffset, 0, 0, 0,  // code start offset
+  kCodeEndOffset, 0, 0, 0,    // code end offset
+  0, 0,                       // local int32 count
+  0, 0,                       // local int64 count
+  0, 0,                       // local float32 count
+  0, 0,                       // local float64 count
+  1,                          // exported
+  0,                          // external
+  kStmtReturn,                // body
+  kExprInt8Const,             // --
+  kReturnValue,               // --
+  'm', 'a', 'i', 'n', 0       // name
+];
+
+// A bundle that holds the module between {kPadding} bytes of garbage.
+var kPadding = 13;
+var kSize = module_bytes.length;
+var bundle = new ArrayBuffer(kPadding + kSize + kPadding);
+var bundle_view = new Uint8Array(bundle);
+for (var i = 0; i < bundle_view.length; i++) bundle_view[i] = 0xff;
+for (var i = 0; i < kSize; i++) {
+  var val = module_bytes[i];
+  if ((typeof val) == "string") val = val.charCodeAt(0);
+  bundle_view[kPadding + i] = val;
+}
+
+// A view of exactly the module bytes.
+var view = new Uint8Array(bundle, kPadding, kSize);
+WASM.verifyModule(view);
+assertEquals(kReturnValue, WASM.compileRun(view));
+assertEquals(kReturnValue, WASM.instantiateModule(view).main());
+assertEquals(kReturnValue,
+             WASM.instantiateModule(WASM.compileModule(view)).main());
+
+// An offset and a length into the bundle.
+WASM.verifyModule(bundle, kPadding, kSize);
+assertEquals(kReturnValue, WASM.compileRun(bundle, kPadding, kSize));
+assertEquals(kReturnValue,
+             WASM.instantiateModule(bundle, undefined, kPadding, kSize).main());
+assertEquals(kReturnValue, WASM.instantiateModule(
+    WASM.compileModule(bundle, kPadding, kSize)).main());
+
+// An offset and a length into a view, which are relative to the view.
+var tail = new Uint8Array(bundle, kPadding - 3);
+WASM.verifyModule(tail, 3, kSize);
+assertEquals(kReturnValue, WASM.compileRun(tail, 3, kSize));
+
+// The bytes are read in place, so the buffer stays usable afterwards.
+assertEquals(kPadding + kSize + kPadding, bundle.byteLength);
+assertEquals(kReturnValue, bundle_view[kPadding + kCodeStartOffset + 2]);
+
+// The whole bundle isn't a module, and neither are bad ranges.
+assertThrows(function() { WASM.verifyModule(bundle); });
+assertThrows(function() { WASM.verifyModule(bundle_view); });
+assertThrows(function() { WASM.verifyModule(bundle, kPadding + 1, kSize); });
+assertThrows(function() { WASM.verifyModule(bundle, kPadding, kSize - 10); });
+assertThrows(function() { WASM.verifyModule(view, 0, kSize + 1); });
+assertThrows(function() { WASM.verifyModule(view, kSize + 1); });
+assertThrows(function() { WASM.verifyModule(bundle, -1, kSize); });
+assertThrows(function() { WASM.verifyModule(bundle, 1.5, kSize); });
+assertThrows(function() { WASM.verifyModule(bundle, kPadding, "s"); });
@@ -7,3 +7,6 @@ assertFalse(undefined == WASM);
 assertEquals("function", typeof WASM.verifyModule);
 assertEquals("function", typeof WASM.verifyFunction);
 assertEquals("function", typeof WASM.compileRun);
+assertEquals("function", typeof WASM.compileModule);
+assertEquals("function", typeof WASM.compileModuleFile);
+assertEquals("function", typeof WASM.growMemory);
@@ -9,6 +9,7 @@
 #include "test/cctest/wasm/test-signatures.h"
 
 #include "src/wasm/decoder.h"
+#include "src/wasm/validator.h"
 #include "src/wasm/wasm-macro-gen.h"
 #include "src/wasm/wasm-module.h"
 
@@ -92,10 +93,19 @@ class DecoderTest : public TestWithZone {
     env->SumLocals();
   }
 
-  // A wrapper around VerifyWasmCode() that renders a nice failure message.
+  // A wrapper around VerifyWasmCode() that renders a nice failure message,
+  // and checks that the LR decoder, which builds the graphs, accepts exactly
+  // the code that the validator accepts.
   void Verify(ErrorCode expected, FunctionEnv* env, const byte* start,
               const byte* end) {
     TreeResult result = VerifyWasmCode(env, start, end);
+    TreeResult lr_result = BuildTFGraph(nullptr, env, start, end);
+    if (lr_result.ok() != result.ok()) {
+      std::ostringstream str;
+      str << "Validator and LR decoder disagree: " << result.error_code
+          << " vs. " << lr_result.error_code;
+      FATAL(str.str().c_str());
+    }
     if (result.error_code != expected) {
       ptrdiff_t pc = result.error_pc - result.start;
       ptrdiff_t pt = result.error_pt - result.start;
@@ -447,6 +457,17 @@ TEST_F(DecoderTest, Switches4_break) {
 }
 
 
+TEST_F(DecoderTest, Switches0_continue) {
+  // A switch without cases ends its block, so the continue targets the loop.
+  static const byte code[] = {kStmtLoop,      2, kStmtSwitch,   0,
+                              kExprInt8Const, 0, kStmtContinue, 0};
+  EXPECT_VERIFIES(&env_v_v, code);
+  static const byte codenf[] = {kStmtLoop,      2, kStmtSwitchNf, 0,
+                                kExprInt8Const, 0, kStmtContinue, 0};
+  EXPECT_VERIFIES(&env_v_v, codenf);
+}
+
+
 TEST_F(DecoderTest, Block0) {
   static const byte code[] = {kStmtBlock, 0};
   EXPECT_VERIFIES(&env_v_v, code);
@@ -689,6 +710,22 @@ TEST_F(DecoderTest, Comma1) {
 }
 
 
+TEST_F(DecoderTest, MemorySize) {
+  static const byte kCode[] = {kExprMemorySize};
+  EXPECT_VERIFIES(&env_i_i, kCode);
+  EXPECT_FAILURE(&env_l_l, kCode);
+}
+
+
+TEST_F(DecoderTest, GrowMemory) {
+  static const byte kCode[] = {kExprGrowMemory, kExprGetLocal, 0};
+  EXPECT_VERIFIES(&env_i_i, kCode);
+  EXPECT_FAILURE(&env_i_d, kCode);
+  EXPECT_FAILURE(&env_l_l, kCode);
+  EXPECT_FAILURE_INLINE(&env_i_i, kExprGrowMemory);
+}
+
+
 TEST_F(DecoderTest, Ternary_off_end) {
   static const byte kCode[] = {kExprTernary, kExprGetLocal, 0, kExprGetLocal, 0,
                                kExprGetLocal, 0};
@@ -978,6 +1015,81 @@ TEST_F(DecoderTest, AllSimpleExpressions) {
 }
 
 
+TEST_F(DecoderTest, ValidatorReuse) {
+  // A validator keeps no state from one function body to the next.
+  static const byte unfinished[] = {kStmtLoop, 2, kStmtBlock, 1, kStmtBlock, 2,
+                                    kStmtSwitch, 1};
+  static const byte invalid[] = {kStmtBlock, 1, kStmtBreak, 1};
+  static const byte valid[] = {kStmtBlock, 1, kStmtBreak, 0};
+  static const byte ret[] = {kExprGetLocal, 0};
+  WasmValidator validator(zone());
+  for (int i = 0; i < 2; i++) {
+    TreeResult result = validator.Validate(&env_v_v, nullptr, unfinished,
+                                           unfinished + arraysize(unfinished));
+    EXPECT_EQ(unfinished, result.error_pc);  // no trees created.
+    result = validator.Validate(&env_v_v, nullptr, invalid,
+                                invalid + arraysize(invalid));
+    EXPECT_EQ(invalid + 2, result.error_pc);  // improperly nested break.
+    result =
+        validator.Validate(&env_v_v, nullptr, valid, valid + arraysize(valid));
+    EXPECT_TRUE(result.ok());
+    result = validator.Validate(&env_i_i, nullptr, ret, ret + arraysize(ret));
+    EXPECT_TRUE(result.ok());
+    result = validator.Validate(&env_i_f, nullptr, ret, ret + arraysize(ret));
+    EXPECT_FALSE(result.ok());
+  }
+}
+
+
+TEST_F(DecoderTest, OpcodeInfo) {
+// The opcode table agrees with the signatures of simple expressions.
+#define CHECK_SIMPLE_INFO(name, opcode, sig)                             \
+  {                                                                      \
+    const WasmOpcodeInfo& info = WasmOpcodes::Info(kExpr##name);         \
+    FunctionSig* sig = WasmOpcodes::Signature(kExpr##name);              \
+    EXPECT_EQ(kOpcodeSimple, info.kind);                                 \
+    EXPECT_EQ(0, info.immediate);                                        \
+    EXPECT_EQ(sig->parameter_count(), info.arity);                       \
+    EXPECT_EQ(sig->GetReturn(), info.result_type());                     \
+    for (size_t i = 0; i < sig->parameter_count(); i++) {                \
+      EXPECT_EQ(sig->GetParam(i), info.param_type(static_cast<int>(i))); \
+    }                                                                    \
+  }
+
+  FOREACH_SIMPLE_EXPR_OPCODE(CHECK_SIMPLE_INFO);
+
+#undef CHECK_SIMPLE_INFO
+
+  for (size_t i = 0; i < arraysize(kMemTypes); i++) {
+    MemType mem_type = kMemTypes[i];
+    LocalType type = WasmOpcodes::LocalTypeFor(mem_type);
+    WasmOpcode load = static_cast<WasmOpcode>(
+        WasmOpcodes::LoadStoreOpcodeOf(mem_type, false));
+    WasmOpcode store = static_cast<WasmOpcode>(
+        WasmOpcodes::LoadStoreOpcodeOf(mem_type, true));
+    EXPECT_EQ(kOpcodeLoadMem, WasmOpcodes::Info(load).kind);
+    EXPECT_EQ(1, WasmOpcodes::Info(load).arity);
+    EXPECT_EQ(1, WasmOpcodes::Info(load).immediate);
+    EXPECT_EQ(type, WasmOpcodes::Info(load).result_type());
+    EXPECT_EQ(kAstInt32, WasmOpcodes::Info(load).param_type(0));
+    EXPECT_EQ(kOpcodeStoreMem, WasmOpcodes::Info(store).kind);
+    EXPECT_EQ(2, WasmOpcodes::Info(store).arity);
+    EXPECT_EQ(1, WasmOpcodes::Info(store).immediate);
+    EXPECT_EQ(type, WasmOpcodes::Info(store).result_type());
+    EXPECT_EQ(kAstInt32, WasmOpcodes::Info(store).param_type(0));
+    EXPECT_EQ(type, WasmOpcodes::Info(store).param_type(1));
+  }
+
+  EXPECT_EQ(kOpcodeSpecial, WasmOpcodes::Info(kStmtBlock).kind);
+  EXPECT_EQ(1, WasmOpcodes::Info(kStmtBlock).immediate);
+  EXPECT_EQ(8, WasmOpcodes::Info(kExprFloat64Const).immediate);
+  EXPECT_EQ(static_cast<byte>(WasmOpcodeInfo::kVariableImmediate),
+            WasmOpcodes::Info(kExprGetLocal).immediate);
+  EXPECT_EQ(kOpcodeInvalid,
+            WasmOpcodes::Info(static_cast<WasmOpcode>(0xff)).kind);
+}
+
+
 TEST_F(DecoderTest, AllLoadMemCombinations) {
   for (size_t i = 0; i < arraysize(kLocalTypes); i++) {
     LocalType local_type = kLocalTypes[i];
@@ -1073,10 +1185,16 @@ class TestModuleEnv : public ModuleEnv {
     function_code = nullptr;
     mod.functions = &functions;
     mod.globals = &globals;
+    mod.signatures = &signatures;
+    mod.function_table = nullptr;
   }
   void AddFunction(FunctionSig* sig) {
     functions.push_back({sig, 0, 0, 0, 0, 0, 0, 0, false, false});
   }
+  byte AddSignature(FunctionSig* sig) {
+    signatures.push_back(sig);
+    return static_cast<byte>(signatures.size() - 1);
+  }
   void AddGlobal(MemType mem_type) {
     globals.push_back({0, mem_type, 0, false});
   }
@@ -1085,6 +1203,7 @@ class TestModuleEnv : public ModuleEnv {
   WasmModule mod;
   std::vector<WasmFunction> functions;
   std::vector<WasmGlobal> globals;
+  std::vector<FunctionSig*> signatures;
 };
 }
 
@@ -1183,6 +1302,57 @@ TEST_F(DecoderTest, CallsWithMismatchedSigs3) {
 }
 
 
+TEST_F(DecoderTest, SimpleIndirectCalls) {
+  FunctionEnv* env = &env_i_i;
+  TestModuleEnv module_env;
+  env->module = &module_env;
+
+  byte f0 = module_env.AddSignature(sigs.i_v());
+  byte f1 = module_env.AddSignature(sigs.i_i());
+  byte f2 = module_env.AddSignature(sigs.i_ii());
+
+  EXPECT_VERIFIES_INLINE(env, WASM_CALL_INDIRECT0(f0, WASM_ZERO));
+  EXPECT_VERIFIES_INLINE(env, WASM_CALL_INDIRECT(f1, WASM_ZERO, WASM_INT8(22)));
+  EXPECT_VERIFIES_INLINE(
+      env, WASM_CALL_INDIRECT(f2, WASM_ZERO, WASM_INT8(32), WASM_INT8(72)));
+}
+
+
+TEST_F(DecoderTest, IndirectCallsOutOfBounds) {
+  FunctionEnv* env = &env_i_i;
+  TestModuleEnv module_env;
+  env->module = &module_env;
+
+  EXPECT_FAILURE_INLINE(env, WASM_CALL_INDIRECT0(0, WASM_ZERO));
+  module_env.AddSignature(sigs.i_v());
+  EXPECT_VERIFIES_INLINE(env, WASM_CALL_INDIRECT0(0, WASM_ZERO));
+
+  EXPECT_FAILURE_INLINE(env, WASM_CALL_INDIRECT(1, WASM_ZERO, WASM_INT8(22)));
+  module_env.AddSignature(sigs.i_i());
+  EXPECT_VERIFIES_INLINE(env, WASM_CALL_INDIRECT(1, WASM_ZERO, WASM_INT8(27)));
+
+  EXPECT_FAILURE_INLINE(env, WASM_CALL_INDIRECT(2, WASM_ZERO, WASM_INT8(27)));
+}
+
+
+TEST_F(DecoderTest, IndirectCallsWithMismatchedSigs) {
+  FunctionEnv* env = &env_i_i;
+  TestModuleEnv module_env;
+  env->module = &module_env;
+
+  byte f0 = module_env.AddSignature(sigs.i_f());
+
+  EXPECT_FAILURE_INLINE(env, WASM_CALL_INDIRECT(f0, WASM_ZERO, WASM_INT8(17)));
+  EXPECT_FAILURE_INLINE(env, WASM_CALL_INDIRECT(f0, WASM_ZERO, WASM_INT64(27)));
+  EXPECT_FAILURE_INLINE(env,
+                        WASM_CALL_INDIRECT(f0, WASM_ZERO, WASM_FLOAT64(37.2)));
+  EXPECT_FAILURE_INLINE(
+      env, WASM_CALL_INDIRECT(f0, WASM_INT64(1), WASM_FLOAT32(17.6)));
+  EXPECT_VERIFIES_INLINE(env,
+                         WASM_CALL_INDIRECT(f0, WASM_ZERO, WASM_FLOAT32(17.6)));
+}
+
+
 TEST_F(DecoderTest, Int32Globals) {
   FunctionEnv* env = &env_i_i;
   TestModuleEnv module_env;
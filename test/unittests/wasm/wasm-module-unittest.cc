@@ -4,6 +4,8 @@
 
 #include "test/unittests/test-utils.h"
 
+#include "src/base/platform/platform.h"
+#include "src/wasm/decoder.h"
 #include "src/wasm/wasm-module.h"
 #include "src/wasm/wasm-opcodes.h"
 
@@ -371,6 +373,276 @@ TEST_F(ModuleVerifyTest, TwoDataSegments) {
 }
 
 
+#define FUNCTION_TABLE_MODULE_HEADER(functions_count)                   \
+  0, kModuleFunctionTable, 0, 0, static_cast<uint8_t>(functions_count), \
+      static_cast<uint8_t>(functions_count >> 8), 0, 0
+
+#define EXTERNAL_FUNCTION(...)                                   \
+  __VA_ARGS__,                 /* signature */                   \
+      0, 0, 0, 0,              /* name offset */                 \
+      0, 0, 0, 0,              /* code start offset */           \
+      0, 0, 0, 0,              /* code end offset */             \
+      0, 0, 0, 0, 0, 0, 0, 0,  /* local counts */                \
+      0, 1                     /* exported, external */
+
+TEST_F(ModuleVerifyTest, OneFunctionTable) {
+  static const byte data[] = {
+      FUNCTION_TABLE_MODULE_HEADER(2),
+      EXTERNAL_FUNCTION(1, kAstInt32, kAstInt32),  // func#0: int -> int
+      EXTERNAL_FUNCTION(0, 0),                     // func#1: void -> void
+      // function table --------------------------------------------
+      2, 0,                     // signature count
+      0, 0,                     // sig#0: void -> void
+      1, kAstInt32, kAstInt32,  // sig#1: int -> int
+      3, 0,                     // entry count
+      0, 0,                     // entry#0: func#0
+      1, 0,                     // entry#1: func#1
+      0, 0,                     // entry#2: func#0
+  };
+
+  {
+    ModuleResult result = DecodeModule(data, data + arraysize(data));
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(2, result.val->functions->size());
+    EXPECT_EQ(2, result.val->signatures->size());
+    EXPECT_EQ(3, result.val->function_table->size());
+
+    EXPECT_EQ(0, result.val->signatures->at(0)->parameter_count());
+    EXPECT_EQ(1, result.val->signatures->at(1)->parameter_count());
+
+    EXPECT_EQ(0, result.val->function_table->at(0));
+    EXPECT_EQ(1, result.val->function_table->at(1));
+    EXPECT_EQ(0, result.val->function_table->at(2));
+
+    WasmModule* module = result.val;
+    EXPECT_EQ(1, module->CanonicalSignatureId(module->functions->at(0).sig));
+    EXPECT_EQ(0, module->CanonicalSignatureId(module->functions->at(1).sig));
+  }
+
+  for (size_t size = 0; size < arraysize(data); size++) {
+    // Should fall off end of module bytes.
+    ModuleResult result = DecodeModule(data, data + size);
+    EXPECT_FALSE(result.ok());
+  }
+}
+
+
+TEST_F(ModuleVerifyTest, FunctionTableWithInvalidFunctionIndex) {
+  static const byte data[] = {
+      FUNCTION_TABLE_MODULE_HEADER(1),
+      EXTERNAL_FUNCTION(0, 0),  // func#0: void -> void
+      // function table --------------------------------------------
+      0, 0,  // signature count
+      2, 0,  // entry count
+      0, 0,  // entry#0: func#0
+      1, 0,  // entry#1: invalid
+  };
+
+  EXPECT_FAILURE(data);
+}
+
+
+TEST_F(ModuleVerifyTest, FunctionWithIndirectCall) {
+  static const byte kCodeStartOffset = 42;
+  static const byte kCodeEndOffset = 48;
+
+  static const byte data[] = {
+      FUNCTION_TABLE_MODULE_HEADER(1),
+      // func#0 ----------------------------------------------------
+      1, 0, kAstInt32,            // signature: int -> void
+      0, 0, 0, 0,                 // name offset
+      kCodeStartOffset, 0, 0, 0,  // code start offset
+      kCodeEndOffset, 0, 0, 0,    // code end offset
+      0, 0, 0, 0,                 // local int32 and int64 count
+      0, 0, 0, 0,                 // local float32 and float64 count
+      0,                          // exported
+      0,                          // external
+      // function table --------------------------------------------
+      1, 0,             // signature count
+      1, 0, kAstInt32,  // sig#0: int -> void
+      1, 0,             // entry count
+      0, 0,             // entry#0: func#0
+      // rest ------------------------------------------------------
+      kExprCallIndirect, 0, kExprGetLocal, 0, kExprGetLocal, 0,  // body
+  };
+
+  CHECK_EQ(kCodeEndOffset, arraysize(data));
+  EXPECT_VERIFIES(data);
+}
+
+
+TEST_F(ModuleVerifyTest, FunctionWithIndirectCallOfInvalidSignature) {
+  static const byte kCodeStartOffset = 42;
+  static const byte kCodeEndOffset = 48;
+
+  static const byte data[] = {
+      FUNCTION_TABLE_MODULE_HEADER(1),
+      // func#0 ----------------------------------------------------
+      1, 0, kAstInt32,            // signature: int -> void
+      0, 0, 0, 0,                 // name offset
+      kCodeStartOffset, 0, 0, 0,  // code start offset
+      kCodeEndOffset, 0, 0, 0,    // code end offset
+      0, 0, 0, 0,                 // local int32 and int64 count
+      0, 0, 0, 0,                 // local float32 and float64 count
+      0,                          // exported
+      0,                          // external
+      // function table --------------------------------------------
+      1, 0,             // signature count
+      1, 0, kAstInt32,  // sig#0: int -> void
+      1, 0,             // entry count
+      0, 0,             // entry#0: func#0
+      // rest ------------------------------------------------------
+      kExprCallIndirect, 1, kExprGetLocal, 0, kExprGetLocal, 0,  // body
+  };
+
+  CHECK_EQ(kCodeEndOffset, arraysize(data));
+  EXPECT_FAILURE(data);
+}
+
+
+#define VOID_FUNCTION(code_start_offset)                       \
+  0, 0,                               /* signature */          \
+      0, 0, 0, 0,                     /* name offset */        \
+      code_start_offset, 0, 0, 0,     /* code start offset */  \
+      code_start_offset + 2, 0, 0, 0, /* code end offset */    \
+      0, 0, 0, 0, 0, 0, 0, 0,         /* local counts */       \
+      0, 0                            /* exported, external */
+
+
+TEST_F(ModuleVerifyTest, LowestFunctionErrorWins) {
+  static const byte kCodeStartOffset = 128;
+
+  static const byte data[] = {
+      MODULE_HEADER(0, 5, 0),  // globals, functions, data segments
+      VOID_FUNCTION(kCodeStartOffset),
+      VOID_FUNCTION(kCodeStartOffset + 2),
+      VOID_FUNCTION(kCodeStartOffset + 4),
+      VOID_FUNCTION(kCodeStartOffset + 6),
+      VOID_FUNCTION(kCodeStartOffset + 8),
+      kStmtNop, kStmtNop,  // func#0: ok
+      kStmtBreak, 0,       // func#1: improperly nested break
+      kStmtNop, kStmtNop,  // func#2: ok
+      kStmtBreak, 0,       // func#3: improperly nested break
+      kStmtContinue, 0,    // func#4: improperly nested continue
+  };
+
+  CHECK_EQ(kCodeStartOffset + 10, arraysize(data));
+
+  // The error does not depend on how many tasks verify the bodies.
+  int old_num_tasks = FLAG_wasm_num_compilation_tasks;
+  for (int num_tasks = 0; num_tasks <= 4; num_tasks++) {
+    FLAG_wasm_num_compilation_tasks = num_tasks;
+    for (int i = 0; i < 10; i++) {
+      ModuleResult result = DecodeModule(data, data + arraysize(data));
+      EXPECT_FALSE(result.ok());
+      EXPECT_EQ(data + kCodeStartOffset + 2, result.error_pc);
+      EXPECT_EQ(0, strncmp("in function #1:", result.error_msg.get(), 15));
+    }
+  }
+  FLAG_wasm_num_compilation_tasks = old_num_tasks;
+}
+
+
+namespace {
+// A module of three functions that exercise calls and control flow.
+const byte kThreadsModule[] = {
+    MODULE_HEADER(0, 3, 0),  // globals, functions, data segments
+    // func#0 ----------------------------------------------------
+    2, kAstInt32, kAstInt32, kAstInt32,  // signature: (int, int) -> int
+    0, 0, 0, 0,                          // name offset
+    83, 0, 0, 0,                         // code start offset
+    88, 0, 0, 0,                         // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,              // local counts
+    0, 0,                                // exported, external
+    // func#1 ----------------------------------------------------
+    0, 0,                    // signature: void -> void
+    0, 0, 0, 0,              // name offset
+    88, 0, 0, 0,             // code start offset
+    94, 0, 0, 0,             // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,  // local counts
+    0, 0,                    // exported, external
+    // func#2 ----------------------------------------------------
+    1, 0, kAstInt32,         // signature: int -> void
+    0, 0, 0, 0,              // name offset
+    94, 0, 0, 0,             // code start offset
+    99, 0, 0, 0,             // code end offset
+    0, 0, 0, 0, 0, 0, 0, 0,  // local counts
+    0, 0,                    // exported, external
+    // bodies ----------------------------------------------------
+    kExprInt32Add, kExprGetLocal, 0, kExprGetLocal, 1,           // func#0
+    kExprCallFunction, 0, kExprInt8Const, 1, kExprInt8Const, 2,  // func#1
+    kStmtIfThen, kExprGetLocal, 0, kStmtNop, kStmtNop,           // func#2
+};
+
+const int kThreadsIterations = 200;
+
+
+// Decodes and verifies {kThreadsModule}, and decodes the trees of its
+// functions, over and over on a thread of its own.
+class DecodeThread : public base::Thread {
+ public:
+  DecodeThread() : base::Thread(Options("DecodeThread")), failures_(0) {}
+
+  void Run() override {
+    const byte* start = kThreadsModule;
+    const byte* end = kThreadsModule + arraysize(kThreadsModule);
+    for (int i = 0; i < kThreadsIterations; i++) {
+      Zone zone;
+      ModuleResult result = DecodeWasmModule(nullptr, &zone, start, end);
+      if (result.failed()) {
+        failures_++;
+        continue;
+      }
+      ModuleEnv menv;
+      menv.module = result.val;
+      menv.globals_area = 0;
+      menv.mem_start = 0;
+      menv.mem_end = 0;
+      menv.function_code = nullptr;
+      for (WasmFunction& function : *result.val->functions) {
+        FunctionEnv fenv;
+        fenv.module = &menv;
+        fenv.sig = function.sig;
+        fenv.local_int32_count = function.local_int32_count;
+        fenv.local_int64_count = function.local_int64_count;
+        fenv.local_float32_count = function.local_float32_count;
+        fenv.local_float64_count = function.local_float64_count;
+        fenv.SumLocals();
+        ZoneVector<Tree*> trees(&zone);
+        TreeResult trees_result = DecodeWasmTrees(
+            &zone, &fenv, start, start + function.code_start_offset,
+            start + function.code_end_offset, &trees);
+        if (trees_result.failed()) failures_++;
+      }
+      if (!WasmOpcodes::Signature(kExprInt32Add)) failures_++;
+      delete result.val;
+    }
+  }
+
+  int failures() const { return failures_; }
+
+ private:
+  int failures_;
+};
+}
+
+
+TEST_F(ModuleVerifyTest, DecodeOnManyThreads) {
+  static const int kThreads = 8;
+
+  // Each module is also verified by background tasks.
+  int old_num_tasks = FLAG_wasm_num_compilation_tasks;
+  FLAG_wasm_num_compilation_tasks = 2;
+
+  DecodeThread threads[kThreads];
+  for (int i = 0; i < kThreads; i++) threads[i].Start();
+  for (int i = 0; i < kThreads; i++) threads[i].Join();
+  for (int i = 0; i < kThreads; i++) EXPECT_EQ(0, threads[i].failures());
+
+  FLAG_wasm_num_compilation_tasks = old_num_tasks;
+}
+
+
 class SignatureDecodeTest : public TestWithZone {};
 
 